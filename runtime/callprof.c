@@ -0,0 +1,356 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ntrt.h"
+
+#define INITIAL_FRAMES 64
+#define INITIAL_EDGES 64
+#define DEFAULT_FILE "ntc.calls"
+
+typedef struct func_stats {
+  uint64_t calls;
+  uint64_t inclusive;
+  uint64_t exclusive;
+} func_stats;
+
+/* caller and callee indices plus one, 0 for a call from outside any
+ * instrumented function; an empty slot has no calls */
+typedef struct edge_slot {
+  uint32_t caller;
+  uint32_t callee;
+  uint64_t calls;
+} edge_slot;
+
+typedef struct edge_table {
+  edge_slot* slots;
+  uint32_t capacity;
+  uint32_t count;
+} edge_table;
+
+typedef struct frame {
+  int32_t index;
+  uint64_t start;
+  /* inclusive cycles of the calls made from this frame */
+  uint64_t children;
+} frame;
+
+/* owned by one thread until exit, when the report reads every one */
+typedef struct thread_profile {
+  func_stats* stats;
+  /* frames of each function on the stack, so that recursion adds the
+   * inclusive cycles of the outermost frame only */
+  uint32_t* active;
+  edge_table edges;
+  frame* frames;
+  uint32_t depth;
+  uint32_t capacity;
+  /* calls entered while the frame stack could not grow */
+  uint32_t untracked;
+  struct thread_profile* next;
+} thread_profile;
+
+static ntrt_func_site* registered_sites = NULL;
+static int32_t num_sites = 0;
+static thread_profile* thread_profiles = NULL;
+static pthread_mutex_t profiles_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread thread_profile* current = NULL;
+/* set once allocating a thread's tables failed, it stays untracked */
+static __thread int disabled = 0;
+
+static int grow_edges(edge_table* table);
+
+static edge_slot* find_edge(edge_table* table, uint32_t caller,
+                            uint32_t callee) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = (caller * 0x9e3779b1u ^ callee * 0x85ebca6bu) & mask;
+  for (;;) {
+    edge_slot* slot = &table->slots[index];
+    if (slot->calls == 0 ||
+        (slot->caller == caller && slot->callee == callee)) {
+      return slot;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+static void add_edge(edge_table* table, uint32_t caller, uint32_t callee,
+                     uint64_t calls) {
+  edge_slot* slot;
+  /* keep the load factor at or below one half */
+  if ((table->count + 1) * 2 > table->capacity && !grow_edges(table)) {
+    return;
+  }
+  slot = find_edge(table, caller, callee);
+  if (slot->calls == 0) {
+    slot->caller = caller;
+    slot->callee = callee;
+    ++table->count;
+  }
+  slot->calls += calls;
+}
+
+static int grow_edges(edge_table* table) {
+  edge_table grown;
+  uint32_t i;
+  grown.capacity = table->capacity ? table->capacity * 2 : INITIAL_EDGES;
+  grown.count = 0;
+  grown.slots = calloc(grown.capacity, sizeof(edge_slot));
+  if (grown.slots == NULL) {
+    return 0;
+  }
+  for (i = 0; i < table->capacity; ++i) {
+    edge_slot* old = &table->slots[i];
+    if (old->calls != 0) {
+      *find_edge(&grown, old->caller, old->callee) = *old;
+      ++grown.count;
+    }
+  }
+  free(table->slots);
+  *table = grown;
+  return 1;
+}
+
+static thread_profile* start_thread(void) {
+  thread_profile* profile = calloc(1, sizeof(thread_profile));
+  if (profile != NULL) {
+    profile->stats = calloc(num_sites, sizeof(func_stats));
+    profile->active = calloc(num_sites, sizeof(uint32_t));
+  }
+  if (profile == NULL || profile->stats == NULL || profile->active == NULL) {
+    if (profile != NULL) {
+      free(profile->stats);
+      free(profile->active);
+      free(profile);
+    }
+    disabled = 1;
+    return NULL;
+  }
+  pthread_mutex_lock(&profiles_lock);
+  profile->next = thread_profiles;
+  thread_profiles = profile;
+  pthread_mutex_unlock(&profiles_lock);
+  current = profile;
+  return profile;
+}
+
+void ntrt_func_enter(ntrt_func_site* site, uint64_t cycles) {
+  thread_profile* profile = current;
+  frame* top;
+  int32_t index = site->index;
+  if (profile == NULL) {
+    if (disabled || (profile = start_thread()) == NULL) {
+      return;
+    }
+  }
+  if (profile->depth == profile->capacity) {
+    uint32_t capacity =
+        profile->capacity ? profile->capacity * 2 : INITIAL_FRAMES;
+    frame* frames = realloc(profile->frames, capacity * sizeof(frame));
+    if (frames == NULL) {
+      ++profile->untracked;
+      return;
+    }
+    profile->frames = frames;
+    profile->capacity = capacity;
+  }
+  add_edge(&profile->edges,
+           profile->depth ? profile->frames[profile->depth - 1].index + 1 : 0,
+           index + 1, 1);
+  ++profile->stats[index].calls;
+  ++profile->active[index];
+  top = &profile->frames[profile->depth++];
+  top->index = index;
+  top->start = cycles;
+  top->children = 0;
+}
+
+void ntrt_func_exit(uint64_t cycles) {
+  thread_profile* profile = current;
+  frame* top;
+  uint64_t elapsed;
+  if (profile == NULL || profile->depth == 0) {
+    return;
+  }
+  if (profile->untracked != 0) {
+    --profile->untracked;
+    return;
+  }
+  top = &profile->frames[--profile->depth];
+  elapsed = cycles - top->start;
+  profile->stats[top->index].exclusive +=
+      elapsed > top->children ? elapsed - top->children : 0;
+  if (--profile->active[top->index] == 0) {
+    profile->stats[top->index].inclusive += elapsed;
+  }
+  if (profile->depth != 0) {
+    profile->frames[profile->depth - 1].children += elapsed;
+  }
+}
+
+static const char** site_names;
+static func_stats* totals;
+
+static int by_exclusive(const void* lhs, const void* rhs) {
+  uint64_t a = totals[*(const int32_t*)lhs].exclusive;
+  uint64_t b = totals[*(const int32_t*)rhs].exclusive;
+  return a < b ? 1 : a > b ? -1 : 0;
+}
+
+static const char* edge_name(uint32_t index) {
+  return index == 0 ? "<root>" : site_names[index - 1];
+}
+
+static void write_text(FILE* out, const int32_t* order, edge_table* edges) {
+  uint64_t total = 0;
+  int32_t i;
+  uint32_t j;
+  for (i = 0; i < num_sites; ++i) {
+    total += totals[i].exclusive;
+  }
+  fprintf(out, "flat profile, in cycles\n");
+  fprintf(out, "%7s %16s %16s %12s %12s  %s\n", "%self", "self", "inclusive",
+          "calls", "self/call", "function");
+  for (i = 0; i < num_sites; ++i) {
+    func_stats* stats = &totals[order[i]];
+    if (stats->calls == 0) {
+      continue;
+    }
+    fprintf(out, "%7.2f %16llu %16llu %12llu %12llu  %s\n",
+            total ? 100.0 * stats->exclusive / total : 0.0,
+            (unsigned long long)stats->exclusive,
+            (unsigned long long)stats->inclusive,
+            (unsigned long long)stats->calls,
+            (unsigned long long)(stats->exclusive / stats->calls),
+            site_names[order[i]]);
+  }
+  fprintf(out, "\ncall graph, in calls\n");
+  for (i = 0; i < num_sites; ++i) {
+    uint32_t index = order[i] + 1;
+    if (totals[order[i]].calls == 0) {
+      continue;
+    }
+    fprintf(out, "%s\n", site_names[order[i]]);
+    for (j = 0; j < edges->capacity; ++j) {
+      edge_slot* slot = &edges->slots[j];
+      if (slot->calls != 0 && slot->callee == index) {
+        fprintf(out, "  <- %-32s %12llu\n", edge_name(slot->caller),
+                (unsigned long long)slot->calls);
+      }
+    }
+    for (j = 0; j < edges->capacity; ++j) {
+      edge_slot* slot = &edges->slots[j];
+      if (slot->calls != 0 && slot->caller == index) {
+        fprintf(out, "  -> %-32s %12llu\n", edge_name(slot->callee),
+                (unsigned long long)slot->calls);
+      }
+    }
+  }
+}
+
+static void write_json(FILE* out, const int32_t* order, edge_table* edges) {
+  const char* separator = "";
+  int32_t i;
+  uint32_t j;
+  fprintf(out, "{\"unit\": \"cycles\", \"functions\": [");
+  for (i = 0; i < num_sites; ++i) {
+    func_stats* stats = &totals[order[i]];
+    if (stats->calls == 0) {
+      continue;
+    }
+    fprintf(out,
+            "%s\n  {\"name\": \"%s\", \"calls\": %llu, \"self\": %llu, "
+            "\"inclusive\": %llu}",
+            separator, site_names[order[i]],
+            (unsigned long long)stats->calls,
+            (unsigned long long)stats->exclusive,
+            (unsigned long long)stats->inclusive);
+    separator = ",";
+  }
+  fprintf(out, "\n], \"edges\": [");
+  separator = "";
+  for (j = 0; j < edges->capacity; ++j) {
+    edge_slot* slot = &edges->slots[j];
+    if (slot->calls == 0) {
+      continue;
+    }
+    if (slot->caller == 0) {
+      fprintf(out, "%s\n  {\"caller\": null", separator);
+    } else {
+      fprintf(out, "%s\n  {\"caller\": \"%s\"", separator,
+              edge_name(slot->caller));
+    }
+    fprintf(out, ", \"callee\": \"%s\", \"calls\": %llu}",
+            edge_name(slot->callee), (unsigned long long)slot->calls);
+    separator = ",";
+  }
+  fprintf(out, "\n]}\n");
+}
+
+/* sums the tables of every thread, running threads are read as they are */
+static void report(void) {
+  const char* filename = getenv("NTRT_CALL_PROFILE");
+  size_t length;
+  edge_table edges = {NULL, 0, 0};
+  int32_t* order;
+  thread_profile* profile;
+  ntrt_func_site* site;
+  FILE* out;
+  int32_t i;
+  uint32_t j;
+  if (filename == NULL || filename[0] == '\0') {
+    filename = DEFAULT_FILE;
+  }
+  totals = calloc(num_sites, sizeof(func_stats));
+  site_names = calloc(num_sites, sizeof(const char*));
+  order = calloc(num_sites, sizeof(int32_t));
+  if (totals == NULL || site_names == NULL || order == NULL) {
+    return;
+  }
+  for (site = registered_sites; site != NULL; site = site->next) {
+    site_names[site->index] = site->name;
+  }
+  pthread_mutex_lock(&profiles_lock);
+  for (profile = thread_profiles; profile != NULL; profile = profile->next) {
+    for (i = 0; i < num_sites; ++i) {
+      totals[i].calls += profile->stats[i].calls;
+      totals[i].inclusive += profile->stats[i].inclusive;
+      totals[i].exclusive += profile->stats[i].exclusive;
+    }
+    for (j = 0; j < profile->edges.capacity; ++j) {
+      edge_slot* slot = &profile->edges.slots[j];
+      if (slot->calls != 0) {
+        add_edge(&edges, slot->caller, slot->callee, slot->calls);
+      }
+    }
+  }
+  pthread_mutex_unlock(&profiles_lock);
+  for (i = 0; i < num_sites; ++i) {
+    order[i] = i;
+  }
+  qsort(order, num_sites, sizeof(int32_t), by_exclusive);
+
+  out = strcmp(filename, "-") == 0 ? stderr : fopen(filename, "w");
+  if (out == NULL) {
+    fprintf(stderr, "ntrt: cannot write call profile %s\n", filename);
+    return;
+  }
+  length = strlen(filename);
+  if (length > 5 && strcmp(filename + length - 5, ".json") == 0) {
+    write_json(out, order, &edges);
+  } else {
+    write_text(out, order, &edges);
+  }
+  if (out != stderr) {
+    fclose(out);
+  }
+}
+
+void ntrt_func_register(ntrt_func_site* site) {
+  if (registered_sites == NULL) {
+    atexit(report);
+  }
+  site->index = num_sites++;
+  site->next = registered_sites;
+  registered_sites = site;
+}
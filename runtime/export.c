@@ -0,0 +1,13 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ntrt.h"
+
+void ntrt_export_length_error(const char* function, int32_t parameter,
+                              uint64_t length, uint64_t required) {
+  fprintf(stderr,
+          "ntrt: %s: array parameter %d has %" PRIu64 " elements, needs "
+          "%" PRIu64 "\n",
+          function, (int)parameter, length, required);
+  abort();
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ntrt.h"
+
+/* every slot holds a used flag, the key words and the value */
+#define SLOT_WORDS(table) ((table)->key_words + 2)
+#define INITIAL_CAPACITY 64
+
+static ntrt_memo_table* registered_tables = NULL;
+
+static uint64_t hash_key(const uint64_t* key, uint32_t key_words) {
+  uint64_t hash = 0x9e3779b97f4a7c15ull;
+  uint32_t i;
+  for (i = 0; i < key_words; ++i) {
+    hash ^= key[i];
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+static uint64_t* find_slot(uint64_t* slots, uint32_t capacity,
+                           uint32_t key_words, const uint64_t* key) {
+  uint32_t mask = capacity - 1;
+  uint32_t index = (uint32_t)hash_key(key, key_words) & mask;
+  for (;;) {
+    uint64_t* slot = slots + (size_t)index * (key_words + 2);
+    if (slot[0] == 0 ||
+        memcmp(slot + 1, key, key_words * sizeof(uint64_t)) == 0) {
+      return slot;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+/* doubles the table, returns 0 when memory is exhausted */
+static int grow(ntrt_memo_table* table) {
+  uint32_t capacity = table->capacity ? table->capacity * 2 : INITIAL_CAPACITY;
+  uint32_t words = SLOT_WORDS(table);
+  uint64_t* slots = calloc((size_t)capacity * words, sizeof(uint64_t));
+  uint32_t i;
+  if (slots == NULL) {
+    return 0;
+  }
+  for (i = 0; i < table->capacity; ++i) {
+    uint64_t* old = table->slots + (size_t)i * words;
+    if (old[0] != 0) {
+      memcpy(find_slot(slots, capacity, table->key_words, old + 1), old,
+             words * sizeof(uint64_t));
+    }
+  }
+  free(table->slots);
+  table->slots = slots;
+  table->capacity = capacity;
+  return 1;
+}
+
+int ntrt_memo_lookup(ntrt_memo_table* table, const uint64_t* key,
+                     uint64_t* value) {
+  uint64_t* slot;
+  int found = 0;
+  ntrt_lock(&table->lock);
+  if (table->count != 0) {
+    slot = find_slot(table->slots, table->capacity, table->key_words, key);
+    if (slot[0] != 0) {
+      *value = slot[table->key_words + 1];
+      found = 1;
+    }
+  }
+  ntrt_unlock(&table->lock);
+  return found;
+}
+
+void ntrt_memo_insert(ntrt_memo_table* table, const uint64_t* key,
+                      uint64_t value) {
+  uint64_t* slot;
+  ntrt_lock(&table->lock);
+  /* the load factor stays at or below one half */
+  if (table->count < table->max_entries &&
+      ((table->count + 1) * 2 <= table->capacity || grow(table))) {
+    slot = find_slot(table->slots, table->capacity, table->key_words, key);
+    if (slot[0] == 0) {
+      slot[0] = 1;
+      memcpy(slot + 1, key, table->key_words * sizeof(uint64_t));
+      ++table->count;
+    }
+    slot[table->key_words + 1] = value;
+  }
+  ntrt_unlock(&table->lock);
+}
+
+static void report(void) {
+  ntrt_memo_table* table;
+  for (table = registered_tables; table != NULL; table = table->next) {
+    fprintf(stderr, "memo: %s hits %llu misses %llu entries %u\n",
+            table->name, (unsigned long long)table->hits,
+            (unsigned long long)table->misses, table->count);
+  }
+}
+
+void ntrt_memo_register(ntrt_memo_table* table) {
+  if (registered_tables == NULL) {
+    atexit(report);
+  }
+  table->next = registered_tables;
+  registered_tables = table;
+}
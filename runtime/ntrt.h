@@ -0,0 +1,207 @@
+/* ntrt: runtime support library for code generated by ntc */
+#ifndef NTRT_H
+#define NTRT_H
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache of a memo function. The compiler emits one statically initialized
+ * table per function, the layout must match CodeGenerator::get_memo_type.
+ * Keys are the function arguments widened to 64 bit words. Lookups and
+ * inserts take the lock of the table, memo functions may be called from
+ * several threads. */
+typedef struct ntrt_memo_table {
+  const char* name;
+  uint32_t key_words;
+  uint32_t max_entries;
+  /* only maintained by code compiled with --stats */
+  uint64_t hits;
+  uint64_t misses;
+  /* private to the runtime */
+  uint32_t capacity;
+  uint32_t count;
+  int32_t lock;
+  uint64_t* slots;
+  struct ntrt_memo_table* next;
+} ntrt_memo_table;
+
+/* returns 1 and stores the cached result to value on a hit */
+int ntrt_memo_lookup(ntrt_memo_table* table, const uint64_t* key,
+                     uint64_t* value);
+
+/* caches value for key, silently dropped once max_entries is reached */
+void ntrt_memo_insert(ntrt_memo_table* table, const uint64_t* key,
+                      uint64_t value);
+
+/* reports the hit/miss counters of table to stderr at exit */
+void ntrt_memo_register(ntrt_memo_table* table);
+
+/* Thread pool behind parallel for. The compiler outlines the loop body into
+ * a function that every pool thread runs once, taking iteration ranges of
+ * [0, count) from ntrt_loop_next until it returns 0. The pool size is
+ * NTRT_NUM_THREADS or the number of online processors. */
+enum {
+  NTRT_SCHEDULE_STATIC,
+  NTRT_SCHEDULE_DYNAMIC,
+  NTRT_SCHEDULE_GUIDED,
+};
+
+typedef struct ntrt_loop ntrt_loop;
+
+typedef void (*ntrt_parallel_body)(void* context, ntrt_loop* loop);
+
+/* chunk 0 selects the default of the schedule: one block per thread for
+ * static, single iterations for dynamic and guided */
+void ntrt_parallel_for(int64_t count, int32_t schedule, int64_t chunk,
+                       ntrt_parallel_body body, void* context);
+
+int ntrt_loop_next(ntrt_loop* loop, int64_t* begin, int64_t* end);
+
+/* runs the outlined body on the calling thread as one range, used when the
+ * trip count is below the threshold of -fauto-parallel */
+void ntrt_serial_for(int64_t count, ntrt_parallel_body body, void* context);
+
+int ntrt_thread_count(void);
+
+/* guards the merge of reduction variables */
+void ntrt_parallel_lock(void);
+
+void ntrt_parallel_unlock(void);
+
+/* Work stealing runtime behind spawn and sync. Each pool thread owns a
+ * deque of spawned tasks, idle threads steal the oldest task of a random
+ * victim. The compiler emits a task record per spawn in the spawning frame,
+ * starting with this header, and one group per spawning function. */
+typedef struct ntrt_task_group {
+  /* only touched by the spawning thread, so the common case of a task that
+   * is never stolen needs no atomic operation */
+  int64_t spawned;
+  int64_t finished;
+  /* tasks finished by thieves */
+  int64_t stolen;
+} ntrt_task_group;
+
+typedef struct ntrt_task {
+  void (*run)(struct ntrt_task* task);
+  /* set by ntrt_spawn */
+  ntrt_task_group* group;
+} ntrt_task;
+
+void ntrt_spawn(ntrt_task* task, ntrt_task_group* group);
+
+/* returns once every task spawned into group has finished, running
+ * queued and stolen work in the meantime */
+void ntrt_sync(ntrt_task_group* group);
+
+/* Plain threads behind thread_spawn and thread_join. The record holding
+ * the arguments is copied before ntrt_thread_spawn returns, the handle
+ * must be joined exactly once. */
+typedef void (*ntrt_thread_body)(void* record);
+
+int64_t ntrt_thread_spawn(ntrt_thread_body body, const void* record,
+                          int64_t size);
+
+void ntrt_thread_join(int64_t thread);
+
+/* lock and unlock on an atomic int, 0 is unlocked; waiters spin briefly
+ * and then yield */
+void ntrt_lock(int32_t* word);
+
+void ntrt_unlock(int32_t* word);
+
+/* Counters of a function built with -fprofile-generate. The compiler emits
+ * one statically initialized record per function, the layout must match
+ * CodeGenerator::get_profile_type. At exit the counters are added to the
+ * matching lines of the profile file, or appended to it; NTRT_PROFILE_FILE
+ * overrides the file name the compiler passes. */
+typedef struct ntrt_profile_data {
+  const char* name;
+  uint64_t checksum;
+  uint64_t* counters;
+  uint32_t num_counters;
+  /* private to the runtime */
+  struct ntrt_profile_data* next;
+} ntrt_profile_data;
+
+void ntrt_profile_register(ntrt_profile_data* data, const char* filename);
+
+/* Call profile of -finstrument-functions=profile. Every instrumented
+ * function has a site record the compiler registers at startup and calls
+ * ntrt_func_enter and ntrt_func_exit with the cycle counter. Each thread
+ * keeps its own call counts, inclusive and exclusive cycles and call edges;
+ * at exit they are summed into a flat profile and a call graph written to
+ * NTRT_CALL_PROFILE (default ntc.calls, "-" for stderr, JSON if the name
+ * ends in .json). */
+typedef struct ntrt_func_site {
+  const char* name;
+  /* private to the runtime */
+  int32_t index;
+  struct ntrt_func_site* next;
+} ntrt_func_site;
+
+void ntrt_func_register(ntrt_func_site* site);
+
+void ntrt_func_enter(ntrt_func_site* site, uint64_t cycles);
+
+void ntrt_func_exit(uint64_t cycles);
+
+/* Trace events of trace(id, value) and trace_span("name") { ... }. Each
+ * thread appends timestamped events to its own lock-free ring of
+ * NTRT_TRACE_EVENTS entries (default 65536), events that do not fit are
+ * dropped and counted. ntrt_trace_flush drains every ring into
+ * NTRT_TRACE_FILE (default ntc.trace.json) and runs again at exit. A name
+ * ending in .json selects the Chrome trace format, any other the binary
+ * one: "NTRTRACE", the int32 span count and each span name as a uint32
+ * length and its bytes, then records of a uint64 time in nanoseconds, the
+ * int64 value, the int32 trace id or span index, the uint16 thread and the
+ * uint16 kind (0 value, 1 span begin, 2 span end). The compiler registers
+ * a site per span at startup. */
+typedef struct ntrt_trace_site {
+  const char* name;
+  /* private to the runtime */
+  int32_t index;
+  struct ntrt_trace_site* next;
+} ntrt_trace_site;
+
+void ntrt_trace_register(ntrt_trace_site* site);
+
+void ntrt_trace(int32_t id, int64_t value);
+
+void ntrt_trace_begin(ntrt_trace_site* site);
+
+void ntrt_trace_end(ntrt_trace_site* site);
+
+void ntrt_trace_flush(void);
+
+/* Hardware counters of --perf-counters. Each call of a measured function
+ * reads cycles, instructions, branch misses and cache misses as one
+ * perf_event_open group of the calling thread, plus the wall time; the
+ * outermost call of a recursion is one sample. At exit the median and
+ * median absolute deviation of every metric go to stderr. Counters that
+ * cannot be opened are left out, down to wall time alone. NTRT_PERF_FILE
+ * collects the samples of repeated runs, the report then covers them all. */
+typedef struct ntrt_perf_site {
+  const char* name;
+  /* private to the runtime */
+  int32_t index;
+  struct ntrt_perf_site* next;
+} ntrt_perf_site;
+
+void ntrt_perf_register(ntrt_perf_site* site);
+
+void ntrt_perf_begin(ntrt_perf_site* site);
+
+void ntrt_perf_end(ntrt_perf_site* site);
+
+/* C entry points of export functions check the length passed with an
+ * array against the length the array parameter is declared with; this
+ * reports a shorter one and aborts */
+void ntrt_export_length_error(const char* function, int32_t parameter,
+                              uint64_t length, uint64_t required);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,218 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ntrt.h"
+
+#define MAX_THREADS 256
+
+typedef struct job {
+  ntrt_parallel_body body;
+  void* context;
+  int64_t count;
+  int64_t chunk;
+  int32_t schedule;
+  int32_t threads;
+  /* first iteration not handed out yet, dynamic and guided schedules */
+  int64_t next;
+} job;
+
+struct ntrt_loop {
+  job* job;
+  int32_t thread;
+  /* chunks this thread has taken under the static schedule */
+  int64_t taken;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t reduce_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* serializes parallel loops started by independent threads */
+static pthread_mutex_t dispatch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int pool_threads = 0;
+static job* current_job = NULL;
+static uint64_t generation = 0;
+static int running = 0;
+static __thread int in_parallel = 0;
+
+static int64_t min64(int64_t a, int64_t b) { return a < b ? a : b; }
+
+static int64_t max64(int64_t a, int64_t b) { return a > b ? a : b; }
+
+int ntrt_loop_next(ntrt_loop* loop, int64_t* begin, int64_t* end) {
+  job* job = loop->job;
+  int64_t first;
+  int64_t size;
+  switch (job->schedule) {
+    case NTRT_SCHEDULE_DYNAMIC:
+      size = max64(job->chunk, 1);
+      first = __atomic_fetch_add(&job->next, size, __ATOMIC_RELAXED);
+      break;
+    case NTRT_SCHEDULE_GUIDED:
+      first = __atomic_load_n(&job->next, __ATOMIC_RELAXED);
+      do {
+        if (first >= job->count) {
+          return 0;
+        }
+        /* half of an even share of what is left, never below chunk */
+        size = max64((job->count - first) / (2 * job->threads),
+                     max64(job->chunk, 1));
+      } while (!__atomic_compare_exchange_n(&job->next, &first, first + size,
+                                            1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED));
+      break;
+    default:
+      if (job->chunk <= 0) {
+        /* one contiguous block per thread */
+        if (loop->taken++ != 0) {
+          return 0;
+        }
+        first = job->count / job->threads * loop->thread +
+                min64(loop->thread, job->count % job->threads);
+        size = job->count / job->threads +
+               (loop->thread < job->count % job->threads);
+      } else {
+        /* chunks dealt round robin */
+        first = (loop->taken++ * job->threads + loop->thread) * job->chunk;
+        size = job->chunk;
+      }
+      break;
+  }
+  if (first >= job->count || size <= 0) {
+    return 0;
+  }
+  *begin = first;
+  *end = min64(first + size, job->count);
+  return 1;
+}
+
+static void run(job* job, int32_t thread) {
+  ntrt_loop loop;
+  loop.job = job;
+  loop.thread = thread;
+  loop.taken = 0;
+  in_parallel = 1;
+  job->body(job->context, &loop);
+  in_parallel = 0;
+}
+
+static void* worker(void* argument) {
+  int32_t thread = (int32_t)(intptr_t)argument;
+  uint64_t seen = 0;
+  for (;;) {
+    job* job;
+    pthread_mutex_lock(&pool_mutex);
+    while (generation == seen) {
+      pthread_cond_wait(&work_ready, &pool_mutex);
+    }
+    seen = generation;
+    job = current_job;
+    pthread_mutex_unlock(&pool_mutex);
+
+    run(job, thread);
+
+    pthread_mutex_lock(&pool_mutex);
+    if (--running == 0) {
+      pthread_cond_signal(&work_done);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+  }
+  return NULL;
+}
+
+int ntrt_thread_count(void) {
+  const char* env;
+  long threads;
+  if (pool_threads != 0) {
+    return pool_threads;
+  }
+  env = getenv("NTRT_NUM_THREADS");
+  threads = env != NULL ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads < 1) {
+    threads = 1;
+  } else if (threads > MAX_THREADS) {
+    threads = MAX_THREADS;
+  }
+  return (int)threads;
+}
+
+/* workers are started on first use and live until the process exits */
+static int start_pool(void) {
+  int threads = ntrt_thread_count();
+  int i;
+  for (i = 1; i < threads; ++i) {
+    pthread_t handle;
+    if (pthread_create(&handle, NULL, worker, (void*)(intptr_t)i) != 0) {
+      break;
+    }
+    pthread_detach(handle);
+  }
+  return i;
+}
+
+void ntrt_parallel_for(int64_t count, int32_t schedule, int64_t chunk,
+                       ntrt_parallel_body body, void* context) {
+  job job;
+  if (count <= 0) {
+    return;
+  }
+  job.body = body;
+  job.context = context;
+  job.count = count;
+  job.chunk = chunk;
+  job.schedule = schedule;
+  job.next = 0;
+  job.threads = 1;
+  if (in_parallel) {
+    /* nested loops run on the thread that reached them */
+    run(&job, 0);
+    in_parallel = 1;
+    return;
+  }
+
+  pthread_mutex_lock(&dispatch_mutex);
+  pthread_mutex_lock(&pool_mutex);
+  if (pool_threads == 0) {
+    pool_threads = start_pool();
+  }
+  job.threads = pool_threads;
+  if (job.threads > 1) {
+    current_job = &job;
+    running = job.threads - 1;
+    ++generation;
+    pthread_cond_broadcast(&work_ready);
+  }
+  pthread_mutex_unlock(&pool_mutex);
+
+  run(&job, 0);
+
+  pthread_mutex_lock(&pool_mutex);
+  while (running != 0) {
+    pthread_cond_wait(&work_done, &pool_mutex);
+  }
+  current_job = NULL;
+  pthread_mutex_unlock(&pool_mutex);
+  pthread_mutex_unlock(&dispatch_mutex);
+}
+
+void ntrt_serial_for(int64_t count, ntrt_parallel_body body, void* context) {
+  job job;
+  ntrt_loop loop;
+  job.body = body;
+  job.context = context;
+  job.count = count;
+  job.chunk = 0;
+  job.schedule = NTRT_SCHEDULE_STATIC;
+  job.next = 0;
+  job.threads = 1;
+  loop.job = &job;
+  loop.thread = 0;
+  loop.taken = 0;
+  if (count > 0) {
+    body(context, &loop);
+  }
+}
+
+void ntrt_parallel_lock(void) { pthread_mutex_lock(&reduce_mutex); }
+
+void ntrt_parallel_unlock(void) { pthread_mutex_unlock(&reduce_mutex); }
@@ -0,0 +1,402 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "ntrt.h"
+
+#define NUM_COUNTERS 4
+/* wall time followed by the counters */
+#define NUM_METRICS (NUM_COUNTERS + 1)
+#define MAX_NAME 1024
+
+static const struct {
+  uint64_t config;
+  const char* name;
+} counters[NUM_COUNTERS] = {
+    {PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"},
+    {PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+};
+
+typedef struct reading {
+  uint64_t nanoseconds;
+  uint64_t counts[NUM_COUNTERS];
+  /* time the group was enabled and on the PMU, they differ once the
+   * kernel multiplexes more counters than the hardware has */
+  uint64_t enabled;
+  uint64_t running;
+} reading;
+
+/* the counters of one thread as a group, so they are read together and
+ * scheduled onto the PMU together */
+typedef struct thread_counters {
+  int leader;
+  /* position of each counter in a group read, -1 if it did not open */
+  int slots[NUM_COUNTERS];
+  int num_open;
+  /* per site: calls on the stack, and the reading of the outermost */
+  uint32_t* active;
+  reading* starts;
+} thread_counters;
+
+/* NUM_METRICS values per sample, NAN for a counter that did not open */
+typedef struct sample_list {
+  double* values;
+  uint32_t count;
+  uint32_t capacity;
+} sample_list;
+
+static ntrt_perf_site* registered_sites = NULL;
+static int32_t num_sites = 0;
+static sample_list* samples = NULL;
+static pthread_mutex_t samples_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t warned = PTHREAD_ONCE_INIT;
+static int open_error = 0;
+static int open_failed[NUM_COUNTERS];
+static __thread thread_counters* current = NULL;
+/* set once allocating a thread's state failed, it is not measured */
+static __thread int disabled = 0;
+
+static uint64_t monotonic_nanoseconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static int open_counter(uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  /* user space only also works under perf_event_paranoid 2 */
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/* once per process, threads open the same counters */
+static void warn(void) {
+  int i;
+  if (open_error != 0) {
+    fprintf(stderr, "ntrt: perf counters unavailable (%s), measuring wall "
+                    "time only\n",
+            open_error == ENOENT ? "no hardware events"
+                                 : strerror(open_error));
+    if (open_error == EACCES || open_error == EPERM) {
+      fprintf(stderr, "ntrt: see /proc/sys/kernel/perf_event_paranoid\n");
+    }
+    return;
+  }
+  for (i = 0; i < NUM_COUNTERS; ++i) {
+    if (open_failed[i]) {
+      fprintf(stderr, "ntrt: perf counter %s unavailable\n",
+              counters[i].name);
+    }
+  }
+}
+
+static thread_counters* start_thread(void) {
+  thread_counters* state = calloc(1, sizeof(thread_counters));
+  int i;
+  if (state != NULL) {
+    state->active = calloc(num_sites, sizeof(uint32_t));
+    state->starts = calloc(num_sites, sizeof(reading));
+  }
+  if (state == NULL || state->active == NULL || state->starts == NULL) {
+    if (state != NULL) {
+      free(state->active);
+      free(state->starts);
+      free(state);
+    }
+    disabled = 1;
+    return NULL;
+  }
+  state->leader = -1;
+  for (i = 0; i < NUM_COUNTERS; ++i) {
+    int fd = open_counter(counters[i].config, state->leader);
+    state->slots[i] = -1;
+    if (fd < 0) {
+      /* no PMU, no permission or no perf_event_open at all */
+      if (state->leader < 0 && (errno == EACCES || errno == EPERM ||
+                                errno == ENOSYS || errno == ENODEV)) {
+        open_error = errno;
+        break;
+      }
+      open_failed[i] = 1;
+      continue;
+    }
+    if (state->leader < 0) {
+      state->leader = fd;
+    }
+    state->slots[i] = state->num_open++;
+  }
+  if (state->leader < 0 && open_error == 0) {
+    open_error = ENOENT;
+  }
+  pthread_once(&warned, warn);
+  current = state;
+  return state;
+}
+
+static void read_counters(thread_counters* state, reading* out) {
+  /* nr, time enabled, time running, then the values in group order */
+  uint64_t buffer[3 + NUM_COUNTERS];
+  int i;
+  memset(out, 0, sizeof(reading));
+  if (state->leader >= 0 &&
+      read(state->leader, buffer, sizeof(buffer)) >=
+          (ssize_t)((3 + state->num_open) * sizeof(uint64_t))) {
+    out->enabled = buffer[1];
+    out->running = buffer[2];
+    for (i = 0; i < NUM_COUNTERS; ++i) {
+      if (state->slots[i] >= 0) {
+        out->counts[i] = buffer[3 + state->slots[i]];
+      }
+    }
+  }
+  out->nanoseconds = monotonic_nanoseconds();
+}
+
+/* with samples_lock held */
+static void append_sample(int32_t index, const double* values) {
+  sample_list* list;
+  if (samples == NULL) {
+    samples = calloc(num_sites, sizeof(sample_list));
+    if (samples == NULL) {
+      return;
+    }
+  }
+  list = &samples[index];
+  if (list->count == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+    double* grown =
+        realloc(list->values, capacity * NUM_METRICS * sizeof(double));
+    if (grown == NULL) {
+      return;
+    }
+    list->values = grown;
+    list->capacity = capacity;
+  }
+  memcpy(&list->values[list->count++ * NUM_METRICS], values,
+         NUM_METRICS * sizeof(double));
+}
+
+static void add_sample(int32_t index, const double* values) {
+  pthread_mutex_lock(&samples_lock);
+  append_sample(index, values);
+  pthread_mutex_unlock(&samples_lock);
+}
+
+void ntrt_perf_begin(ntrt_perf_site* site) {
+  thread_counters* state = current;
+  if (state == NULL) {
+    if (disabled || (state = start_thread()) == NULL) {
+      return;
+    }
+  }
+  /* recursive calls belong to the outermost sample */
+  if (state->active[site->index]++ == 0) {
+    read_counters(state, &state->starts[site->index]);
+  }
+}
+
+void ntrt_perf_end(ntrt_perf_site* site) {
+  thread_counters* state = current;
+  reading end;
+  const reading* start;
+  double values[NUM_METRICS];
+  double scale;
+  int i;
+  if (state == NULL || state->active[site->index] == 0 ||
+      --state->active[site->index] != 0) {
+    return;
+  }
+  read_counters(state, &end);
+  start = &state->starts[site->index];
+  values[0] = (double)(end.nanoseconds - start->nanoseconds);
+  scale = end.running > start->running
+              ? (double)(end.enabled - start->enabled) /
+                    (end.running - start->running)
+              : 1.0;
+  for (i = 0; i < NUM_COUNTERS; ++i) {
+    values[i + 1] = state->slots[i] < 0
+                        ? NAN
+                        : (double)(end.counts[i] - start->counts[i]) * scale;
+  }
+  add_sample(site->index, values);
+}
+
+static int by_value(const void* lhs, const void* rhs) {
+  double a = *(const double*)lhs;
+  double b = *(const double*)rhs;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static double median(double* values, uint32_t count) {
+  qsort(values, count, sizeof(double), by_value);
+  return count % 2 ? values[count / 2]
+                   : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/* median and median absolute deviation of one metric over the samples it
+ * was measured in, 0 if none */
+static uint32_t summarize(const sample_list* list, int metric,
+                          double* center, double* deviation) {
+  double* values = malloc((list->count + 1) * sizeof(double));
+  uint32_t count = 0;
+  uint32_t i;
+  if (values == NULL) {
+    return 0;
+  }
+  for (i = 0; i < list->count; ++i) {
+    double value = list->values[i * NUM_METRICS + metric];
+    if (!isnan(value)) {
+      values[count++] = value;
+    }
+  }
+  if (count != 0) {
+    *center = median(values, count);
+    for (i = 0; i < count; ++i) {
+      values[i] = fabs(values[i] - *center);
+    }
+    *deviation = median(values, count);
+  }
+  free(values);
+  return count;
+}
+
+static int32_t find_site(const char* name) {
+  ntrt_perf_site* site;
+  for (site = registered_sites; site != NULL; site = site->next) {
+    if (strcmp(site->name, name) == 0) {
+      return site->index;
+    }
+  }
+  return -1;
+}
+
+/* NTRT_PERF_FILE collects the samples of every run, one per line as the
+ * name and the metrics with - for a counter that did not open; the report
+ * then covers all runs so far. Called with samples_lock held. */
+static void merge_runs(const char* filename) {
+  FILE* file = fopen(filename, "a");
+  char name[MAX_NAME];
+  int32_t i;
+  uint32_t j;
+  int k;
+  if (file == NULL) {
+    fprintf(stderr, "ntrt: cannot write perf samples %s\n", filename);
+    return;
+  }
+  for (i = 0; i < num_sites; ++i) {
+    const char* site_name = NULL;
+    ntrt_perf_site* site;
+    for (site = registered_sites; site != NULL; site = site->next) {
+      if (site->index == i) {
+        site_name = site->name;
+      }
+    }
+    for (j = 0; j < samples[i].count; ++j) {
+      fprintf(file, "%s", site_name);
+      for (k = 0; k < NUM_METRICS; ++k) {
+        double value = samples[i].values[j * NUM_METRICS + k];
+        if (isnan(value)) {
+          fprintf(file, " -");
+        } else {
+          fprintf(file, " %.0f", value);
+        }
+      }
+      fputc('\n', file);
+    }
+    samples[i].count = 0;
+  }
+  fclose(file);
+  file = fopen(filename, "r");
+  if (file == NULL) {
+    return;
+  }
+  while (fscanf(file, "%1023s", name) == 1) {
+    double values[NUM_METRICS];
+    int32_t index = find_site(name);
+    for (k = 0; k < NUM_METRICS; ++k) {
+      char field[64];
+      if (fscanf(file, "%63s", field) != 1) {
+        fclose(file);
+        return;
+      }
+      values[k] = strcmp(field, "-") == 0 ? NAN : strtod(field, NULL);
+    }
+    /* samples of other programs sharing the file */
+    if (index >= 0) {
+      append_sample(index, values);
+    }
+  }
+  fclose(file);
+}
+
+static void report(void) {
+  const char* filename = getenv("NTRT_PERF_FILE");
+  ntrt_perf_site* site;
+  pthread_mutex_lock(&samples_lock);
+  if (samples == NULL) {
+    samples = calloc(num_sites, sizeof(sample_list));
+    if (samples == NULL) {
+      pthread_mutex_unlock(&samples_lock);
+      return;
+    }
+  }
+  if (filename != NULL && filename[0] != '\0') {
+    merge_runs(filename);
+  }
+  fprintf(stderr, "===------ ntrt perf counters ------===\n");
+  for (site = registered_sites; site != NULL; site = site->next) {
+    sample_list* list = &samples[site->index];
+    double centers[NUM_METRICS];
+    uint32_t counts[NUM_METRICS];
+    int k;
+    fprintf(stderr, "%s: %u samples\n", site->name, list->count);
+    if (list->count == 0) {
+      continue;
+    }
+    fprintf(stderr, "  %-14s %16s %16s\n", "", "median", "MAD");
+    for (k = 0; k < NUM_METRICS; ++k) {
+      double deviation = 0;
+      counts[k] = summarize(list, k, &centers[k], &deviation);
+      if (counts[k] == 0) {
+        continue;
+      }
+      if (k == 0) {
+        fprintf(stderr, "  %-14s %16.3f %16.3f\n", "time (us)",
+                centers[k] / 1e3, deviation / 1e3);
+      } else {
+        fprintf(stderr, "  %-14s %16.0f %16.0f\n", counters[k - 1].name,
+                centers[k], deviation);
+      }
+    }
+    /* cycles and instructions */
+    if (counts[1] != 0 && counts[2] != 0 && centers[1] != 0) {
+      fprintf(stderr, "  %-14s %16.2f\n", "IPC", centers[2] / centers[1]);
+    }
+  }
+  pthread_mutex_unlock(&samples_lock);
+}
+
+void ntrt_perf_register(ntrt_perf_site* site) {
+  if (registered_sites == NULL) {
+    atexit(report);
+  }
+  site->index = num_sites++;
+  site->next = registered_sites;
+  registered_sites = site;
+}
@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ntrt.h"
+
+#define MAX_NAME 1024
+
+static ntrt_profile_data* registered_data = NULL;
+static const char* profile_filename = NULL;
+
+/* a line of the old profile that no function of this program claims */
+typedef struct kept_record {
+  char* name;
+  unsigned long long checksum;
+  uint32_t num_counters;
+  unsigned long long* counters;
+  struct kept_record* next;
+} kept_record;
+
+static ntrt_profile_data* find_data(const char* name,
+                                    unsigned long long checksum,
+                                    uint32_t num_counters) {
+  ntrt_profile_data* data;
+  for (data = registered_data; data != NULL; data = data->next) {
+    if (strcmp(data->name, name) == 0 && data->checksum == checksum &&
+        data->num_counters == num_counters) {
+      return data;
+    }
+  }
+  return NULL;
+}
+
+/* adds the counters of earlier runs to the live ones, records of other
+ * programs or older builds are kept as they are */
+static kept_record* merge(FILE* in) {
+  kept_record* kept = NULL;
+  char name[MAX_NAME];
+  unsigned long long checksum;
+  unsigned num_counters;
+  while (fscanf(in, "%1023s %llu %u", name, &checksum, &num_counters) == 3) {
+    ntrt_profile_data* data = find_data(name, checksum, num_counters);
+    kept_record* record = NULL;
+    uint32_t i;
+    if (data == NULL) {
+      record = calloc(1, sizeof(kept_record));
+      if (record == NULL) {
+        break;
+      }
+      record->name = strdup(name);
+      record->checksum = checksum;
+      record->num_counters = num_counters;
+      record->counters = calloc(num_counters + 1, sizeof(unsigned long long));
+      record->next = kept;
+      kept = record;
+    }
+    for (i = 0; i < num_counters; ++i) {
+      unsigned long long counter;
+      if (fscanf(in, "%llu", &counter) != 1) {
+        return kept;
+      }
+      if (data != NULL) {
+        data->counters[i] += counter;
+      } else if (record->counters != NULL) {
+        record->counters[i] = counter;
+      }
+    }
+  }
+  return kept;
+}
+
+static void write_profile(void) {
+  const char* filename = getenv("NTRT_PROFILE_FILE");
+  char* temporary;
+  FILE* file;
+  kept_record* kept = NULL;
+  ntrt_profile_data* data;
+  uint32_t i;
+  if (filename == NULL || filename[0] == '\0') {
+    filename = profile_filename;
+  }
+  file = fopen(filename, "r");
+  if (file != NULL) {
+    kept = merge(file);
+    fclose(file);
+  }
+  /* written next to the profile and renamed over it, so an interrupted run
+   * never leaves half a profile behind */
+  temporary = malloc(strlen(filename) + 5);
+  if (temporary == NULL) {
+    return;
+  }
+  sprintf(temporary, "%s.tmp", filename);
+  file = fopen(temporary, "w");
+  if (file == NULL) {
+    fprintf(stderr, "ntrt: cannot write profile %s\n", filename);
+    free(temporary);
+    return;
+  }
+  for (data = registered_data; data != NULL; data = data->next) {
+    fprintf(file, "%s %llu %u", data->name,
+            (unsigned long long)data->checksum, data->num_counters);
+    for (i = 0; i < data->num_counters; ++i) {
+      fprintf(file, " %llu", (unsigned long long)data->counters[i]);
+    }
+    fputc('\n', file);
+  }
+  for (; kept != NULL; kept = kept->next) {
+    if (kept->name == NULL || kept->counters == NULL) {
+      continue;
+    }
+    fprintf(file, "%s %llu %u", kept->name, kept->checksum,
+            kept->num_counters);
+    for (i = 0; i < kept->num_counters; ++i) {
+      fprintf(file, " %llu", kept->counters[i]);
+    }
+    fputc('\n', file);
+  }
+  if (fclose(file) != 0 || rename(temporary, filename) != 0) {
+    fprintf(stderr, "ntrt: cannot write profile %s\n", filename);
+  }
+  free(temporary);
+}
+
+void ntrt_profile_register(ntrt_profile_data* data, const char* filename) {
+  if (registered_data == NULL) {
+    profile_filename = filename;
+    atexit(write_profile);
+  }
+  data->next = registered_data;
+  registered_data = data;
+}
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ntrt.h"
+
+#define MAX_WORKERS 256
+#define INITIAL_CAPACITY 256
+/* failed steal rounds before an idle worker goes to sleep */
+#define IDLE_ROUNDS 64
+
+/* Chase-Lev work stealing deque: the owner pushes and pops at bottom,
+ * thieves take from top. Arrays only grow, replaced ones are kept alive
+ * because a thief may still read from them. */
+typedef struct deque_array {
+  int64_t size;
+  struct deque_array* previous;
+  ntrt_task* tasks[];
+} deque_array;
+
+typedef struct worker {
+  int64_t top;
+  int64_t bottom;
+  deque_array* array;
+  uint32_t seed;
+} worker;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static worker workers[MAX_WORKERS];
+static int worker_count = 0;
+static int sleepers = 0;
+static __thread worker* self = NULL;
+
+static deque_array* new_array(int64_t size, deque_array* previous) {
+  deque_array* array =
+      malloc(sizeof(deque_array) + (size_t)size * sizeof(ntrt_task*));
+  if (array == NULL) {
+    abort();
+  }
+  array->size = size;
+  array->previous = previous;
+  return array;
+}
+
+static ntrt_task* get(deque_array* array, int64_t index) {
+  return __atomic_load_n(&array->tasks[index & (array->size - 1)],
+                         __ATOMIC_RELAXED);
+}
+
+static void put(deque_array* array, int64_t index, ntrt_task* task) {
+  __atomic_store_n(&array->tasks[index & (array->size - 1)], task,
+                   __ATOMIC_RELAXED);
+}
+
+static void push(worker* w, ntrt_task* task) {
+  int64_t bottom = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+  int64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  deque_array* array = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+  if (bottom - top > array->size - 1) {
+    deque_array* grown = new_array(array->size * 2, array);
+    int64_t i;
+    for (i = top; i < bottom; ++i) {
+      put(grown, i, get(array, i));
+    }
+    __atomic_store_n(&w->array, grown, __ATOMIC_RELEASE);
+    array = grown;
+  }
+  put(array, bottom, task);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+static ntrt_task* pop(worker* w) {
+  int64_t bottom = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+  deque_array* array = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+  int64_t top;
+  ntrt_task* task = NULL;
+  __atomic_store_n(&w->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  top = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+  if (top <= bottom) {
+    task = get(array, bottom);
+    if (top == bottom) {
+      /* last task, race the thieves for it */
+      if (!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        task = NULL;
+      }
+      __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+  } else {
+    __atomic_store_n(&w->bottom, bottom + 1, __ATOMIC_RELAXED);
+  }
+  return task;
+}
+
+static ntrt_task* steal(worker* w) {
+  int64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  int64_t bottom;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  bottom = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+  if (top < bottom) {
+    deque_array* array = __atomic_load_n(&w->array, __ATOMIC_ACQUIRE);
+    ntrt_task* task = get(array, top);
+    if (__atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      return task;
+    }
+  }
+  return NULL;
+}
+
+/* tasks on our own deque were spawned by this thread */
+static void run_own(ntrt_task* task) {
+  ntrt_task_group* group = task->group;
+  task->run(task);
+  ++group->finished;
+}
+
+static void run_stolen(ntrt_task* task) {
+  /* the spawning frame may return as soon as the count is complete */
+  ntrt_task_group* group = task->group;
+  task->run(task);
+  __atomic_fetch_add(&group->stolen, 1, __ATOMIC_RELEASE);
+}
+
+/* one pass over the other workers starting at a random victim */
+static ntrt_task* steal_any(worker* thief) {
+  int count = __atomic_load_n(&worker_count, __ATOMIC_ACQUIRE);
+  int start;
+  int i;
+  thief->seed = thief->seed * 1103515245u + 12345u;
+  start = (int)((thief->seed >> 16) % (uint32_t)count);
+  for (i = 0; i < count; ++i) {
+    worker* victim = &workers[(start + i) % count];
+    ntrt_task* task;
+    if (victim == thief) {
+      continue;
+    }
+    task = steal(victim);
+    if (task != NULL) {
+      return task;
+    }
+  }
+  return NULL;
+}
+
+static void* worker_main(void* argument) {
+  int idle = 0;
+  self = argument;
+  for (;;) {
+    ntrt_task* task = steal_any(self);
+    if (task != NULL) {
+      idle = 0;
+      run_stolen(task);
+    } else if (++idle < IDLE_ROUNDS) {
+      sched_yield();
+    } else {
+      /* spawns wake sleepers, the timeout covers a wakeup racing the
+       * decision to sleep */
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += 1000000;
+      if (until.tv_nsec >= 1000000000) {
+        until.tv_sec += 1;
+        until.tv_nsec -= 1000000000;
+      }
+      pthread_mutex_lock(&pool_mutex);
+      ++sleepers;
+      pthread_cond_timedwait(&work_ready, &pool_mutex, &until);
+      --sleepers;
+      pthread_mutex_unlock(&pool_mutex);
+      idle = 0;
+    }
+  }
+  return NULL;
+}
+
+static void init_worker(worker* w, int index) {
+  w->top = 0;
+  w->bottom = 0;
+  w->array = new_array(INITIAL_CAPACITY, NULL);
+  w->seed = (uint32_t)index * 2654435761u + 1;
+}
+
+/* the first thread to spawn owns worker 0, the others are started here */
+static void start_pool(void) {
+  int threads = ntrt_thread_count();
+  int i;
+  if (threads > MAX_WORKERS) {
+    threads = MAX_WORKERS;
+  }
+  for (i = 0; i < threads; ++i) {
+    init_worker(&workers[i], i);
+  }
+  self = &workers[0];
+  /* a worker that fails to start just leaves an empty deque behind */
+  __atomic_store_n(&worker_count, threads, __ATOMIC_RELEASE);
+  for (i = 1; i < threads; ++i) {
+    pthread_t handle;
+    if (pthread_create(&handle, NULL, worker_main, &workers[i]) == 0) {
+      pthread_detach(handle);
+    }
+  }
+}
+
+void ntrt_spawn(ntrt_task* task, ntrt_task_group* group) {
+  task->group = group;
+  if (self == NULL) {
+    int owner = 0;
+    pthread_mutex_lock(&pool_mutex);
+    if (worker_count == 0) {
+      start_pool();
+      owner = 1;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    if (!owner) {
+      /* threads outside the pool run their spawns serially */
+      task->run(task);
+      return;
+    }
+  }
+  ++group->spawned;
+  push(self, task);
+  if (__atomic_load_n(&sleepers, __ATOMIC_RELAXED) != 0) {
+    pthread_cond_signal(&work_ready);
+  }
+}
+
+void ntrt_sync(ntrt_task_group* group) {
+  while (group->finished +
+             __atomic_load_n(&group->stolen, __ATOMIC_ACQUIRE) !=
+         group->spawned) {
+    /* unstolen spawns are still on top of our own deque, anything else
+     * helps a thief that holds one of ours */
+    ntrt_task* task = pop(self);
+    if (task != NULL) {
+      run_own(task);
+    } else if ((task = steal_any(self)) != NULL) {
+      run_stolen(task);
+    } else {
+      sched_yield();
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ntrt.h"
+
+/* spins before a waiting thread gives up its time slice */
+#define LOCK_SPINS 64
+
+typedef struct thread {
+  pthread_t handle;
+  /* set if the thread could not be started and the body already ran */
+  int finished;
+  ntrt_thread_body body;
+  char record[];
+} thread;
+
+static void* thread_main(void* argument) {
+  thread* t = argument;
+  t->body(t->record);
+  return NULL;
+}
+
+int64_t ntrt_thread_spawn(ntrt_thread_body body, const void* record,
+                          int64_t size) {
+  thread* t = malloc(sizeof(thread) + (size_t)size);
+  if (t == NULL) {
+    abort();
+  }
+  t->finished = 0;
+  t->body = body;
+  memcpy(t->record, record, (size_t)size);
+  if (pthread_create(&t->handle, NULL, thread_main, t) != 0) {
+    /* out of threads, run it here so that the program still completes */
+    body(t->record);
+    t->finished = 1;
+  }
+  return (int64_t)(intptr_t)t;
+}
+
+void ntrt_thread_join(int64_t handle) {
+  thread* t = (thread*)(intptr_t)handle;
+  if (!t->finished) {
+    pthread_join(t->handle, NULL);
+  }
+  free(t);
+}
+
+void ntrt_lock(int32_t* word) {
+  int spins = 0;
+  for (;;) {
+    int32_t unlocked = 0;
+    if (__atomic_load_n(word, __ATOMIC_RELAXED) == 0 &&
+        __atomic_compare_exchange_n(word, &unlocked, 1, 0, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_RELAXED)) {
+      return;
+    }
+    if (++spins >= LOCK_SPINS) {
+      spins = 0;
+      sched_yield();
+    }
+  }
+}
+
+void ntrt_unlock(int32_t* word) {
+  __atomic_store_n(word, 0, __ATOMIC_RELEASE);
+}
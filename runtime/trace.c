@@ -0,0 +1,316 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ntrt.h"
+
+#define DEFAULT_FILE "ntc.trace.json"
+#define DEFAULT_EVENTS (1 << 16)
+
+enum { TRACE_VALUE, TRACE_BEGIN, TRACE_END };
+
+typedef struct trace_event {
+  uint64_t ticks;
+  int64_t value;
+  /* trace id, or the site index of a span */
+  int32_t id;
+  uint32_t kind;
+} trace_event;
+
+/* written by its thread only, flushes drain it from any thread; head and
+ * tail are the only shared words, so neither side ever waits */
+typedef struct trace_ring {
+  trace_event* events;
+  uint64_t capacity;
+  uint64_t head;
+  uint64_t tail;
+  uint64_t dropped;
+  /* spans open since the first begin that did not fit, their events are
+   * dropped as well so that every recorded end has its begin */
+  uint32_t suppressed;
+  uint32_t thread;
+  struct trace_ring* next;
+} trace_ring;
+
+/* the on-disk layout of a binary trace record */
+typedef struct binary_event {
+  uint64_t nanoseconds;
+  int64_t value;
+  int32_t id;
+  uint16_t thread;
+  uint16_t kind;
+} binary_event;
+
+static ntrt_trace_site* registered_sites = NULL;
+static int32_t num_sites = 0;
+static trace_ring* rings = NULL;
+static uint32_t num_threads = 0;
+static uint64_t ring_capacity = DEFAULT_EVENTS;
+static pthread_once_t started = PTHREAD_ONCE_INIT;
+/* ticks and monotonic time at start, the tick rate is measured against
+ * the clock on every flush */
+static uint64_t base_ticks;
+static uint64_t base_nanoseconds;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* out = NULL;
+static int is_json = 0;
+static uint64_t written = 0;
+/* the trace is closed at exit, threads still running lose their events */
+static int finished = 0;
+static __thread trace_ring* current = NULL;
+/* set once allocating a thread's ring failed, it records nothing */
+static __thread int disabled = 0;
+
+static uint64_t monotonic_nanoseconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return monotonic_nanoseconds();
+#endif
+}
+
+static void finish(void);
+
+static void start(void) {
+  const char* env = getenv("NTRT_TRACE_EVENTS");
+  if (env != NULL && atoll(env) > 0) {
+    ring_capacity = 1;
+    while (ring_capacity < (uint64_t)atoll(env)) {
+      ring_capacity *= 2;
+    }
+  }
+  base_nanoseconds = monotonic_nanoseconds();
+  base_ticks = read_ticks();
+  atexit(finish);
+}
+
+static trace_ring* start_thread(void) {
+  trace_ring* ring = calloc(1, sizeof(trace_ring));
+  pthread_once(&started, start);
+  if (ring != NULL) {
+    ring->events = malloc(ring_capacity * sizeof(trace_event));
+  }
+  if (ring == NULL || ring->events == NULL) {
+    free(ring);
+    disabled = 1;
+    return NULL;
+  }
+  ring->capacity = ring_capacity;
+  ring->thread = __atomic_add_fetch(&num_threads, 1, __ATOMIC_RELAXED);
+  ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 0,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  current = ring;
+  return ring;
+}
+
+static void drop(trace_ring* ring) {
+  __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+}
+
+static void record(uint32_t kind, int32_t id, int64_t value) {
+  trace_ring* ring = current;
+  trace_event* event;
+  uint64_t head;
+  if (ring == NULL) {
+    if (disabled || (ring = start_thread()) == NULL) {
+      return;
+    }
+  }
+  if (ring->suppressed != 0 && kind != TRACE_VALUE) {
+    if (kind == TRACE_BEGIN) {
+      ++ring->suppressed;
+    } else {
+      --ring->suppressed;
+    }
+    drop(ring);
+    return;
+  }
+  head = ring->head;
+  /* an end that does not fit leaves its span open to the end of the trace */
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+      ring->capacity) {
+    if (kind == TRACE_BEGIN) {
+      ring->suppressed = 1;
+    }
+    drop(ring);
+    return;
+  }
+  event = &ring->events[head & (ring->capacity - 1)];
+  event->ticks = read_ticks();
+  event->value = value;
+  event->id = id;
+  event->kind = kind;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void ntrt_trace(int32_t id, int64_t value) {
+  record(TRACE_VALUE, id, value);
+}
+
+void ntrt_trace_begin(ntrt_trace_site* site) {
+  record(TRACE_BEGIN, site->index, 0);
+}
+
+void ntrt_trace_end(ntrt_trace_site* site) {
+  record(TRACE_END, site->index, 0);
+}
+
+static void write_json_string(const char* text) {
+  fputc('"', out);
+  for (; *text != '\0'; ++text) {
+    unsigned char c = (unsigned char)*text;
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void write_json(const trace_event* event, uint32_t thread,
+                       const char** names, double microseconds) {
+  static const char* phases[] = {"C", "B", "E"};
+  fprintf(out, "%s\n{\"name\": ", written == 0 ? "" : ",");
+  if (event->kind == TRACE_VALUE) {
+    fprintf(out, "\"trace %d\"", event->id);
+  } else {
+    write_json_string(names[event->id]);
+  }
+  fprintf(out, ", \"ph\": \"%s\", \"ts\": %.3f, \"pid\": %d, \"tid\": %u",
+          phases[event->kind], microseconds, (int)getpid(), thread);
+  if (event->kind == TRACE_VALUE) {
+    fprintf(out, ", \"args\": {\"value\": %lld}", (long long)event->value);
+  }
+  fputc('}', out);
+}
+
+/* the JSON array form of the Chrome trace format, which may be read
+ * before the closing bracket is written at exit */
+static int open_trace(const char** names) {
+  const char* filename = getenv("NTRT_TRACE_FILE");
+  size_t length;
+  int32_t i;
+  if (filename == NULL || filename[0] == '\0') {
+    filename = DEFAULT_FILE;
+  }
+  out = fopen(filename, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "ntrt: cannot write trace %s\n", filename);
+    return 0;
+  }
+  length = strlen(filename);
+  is_json = length > 5 && strcmp(filename + length - 5, ".json") == 0;
+  if (is_json) {
+    fputc('[', out);
+    return 1;
+  }
+  fwrite("NTRTRACE", 1, 8, out);
+  fwrite(&num_sites, sizeof(int32_t), 1, out);
+  for (i = 0; i < num_sites; ++i) {
+    uint32_t name_length = strlen(names[i]);
+    fwrite(&name_length, sizeof(uint32_t), 1, out);
+    fwrite(names[i], 1, name_length, out);
+  }
+  return 1;
+}
+
+void ntrt_trace_flush(void) {
+  const char** names = calloc(num_sites + 1, sizeof(const char*));
+  ntrt_trace_site* site;
+  trace_ring* ring;
+  double nanoseconds_per_tick;
+  uint64_t ticks;
+  if (names == NULL) {
+    return;
+  }
+  for (site = registered_sites; site != NULL; site = site->next) {
+    names[site->index] = site->name;
+  }
+  pthread_once(&started, start);
+  pthread_mutex_lock(&flush_lock);
+  if (!finished && out == NULL && !open_trace(names)) {
+    finished = 1;
+  }
+  if (finished) {
+    pthread_mutex_unlock(&flush_lock);
+    free(names);
+    return;
+  }
+  ticks = read_ticks() - base_ticks;
+  nanoseconds_per_tick =
+      ticks == 0 ? 1.0
+                 : (double)(monotonic_nanoseconds() - base_nanoseconds) / ticks;
+  for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL;
+       ring = ring->next) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    for (; tail != head; ++tail) {
+      const trace_event* event = &ring->events[tail & (ring->capacity - 1)];
+      double nanoseconds =
+          (double)(event->ticks - base_ticks) * nanoseconds_per_tick;
+      if (is_json) {
+        write_json(event, ring->thread, names, nanoseconds / 1000.0);
+      } else {
+        binary_event record;
+        record.nanoseconds = (uint64_t)nanoseconds;
+        record.value = event->value;
+        record.id = event->id;
+        record.thread = (uint16_t)ring->thread;
+        record.kind = (uint16_t)event->kind;
+        fwrite(&record, sizeof(record), 1, out);
+      }
+      ++written;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+  fflush(out);
+  pthread_mutex_unlock(&flush_lock);
+  free(names);
+}
+
+static void finish(void) {
+  trace_ring* ring;
+  uint64_t dropped = 0;
+  ntrt_trace_flush();
+  pthread_mutex_lock(&flush_lock);
+  if (out != NULL) {
+    if (is_json) {
+      fprintf(out, "\n]\n");
+    }
+    fclose(out);
+    out = NULL;
+  }
+  finished = 1;
+  pthread_mutex_unlock(&flush_lock);
+  for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL;
+       ring = ring->next) {
+    dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+  }
+  if (dropped != 0) {
+    fprintf(stderr,
+            "ntrt: %llu trace events dropped, flush more often or raise "
+            "NTRT_TRACE_EVENTS\n",
+            (unsigned long long)dropped);
+  }
+}
+
+void ntrt_trace_register(ntrt_trace_site* site) {
+  pthread_once(&started, start);
+  site->index = num_sites++;
+  site->next = registered_sites;
+  registered_sites = site;
+}
@@ -5,6 +5,7 @@
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <vector>
 #include "type.hpp"
 #include "visitor.hpp"
@@ -15,6 +16,7 @@ class BlockItem;
 class ExternalDeclaration;
 class TranslationUnit;
 class FunctionDefinition;
+class FunctionDeclaration;
 class DeclarationSpecifier;
 class Identifier;
 class ParameterDeclaration;
@@ -26,15 +28,20 @@ class Declarator;
 class Statement;
 class CompoundStatement;
 class ExpressionStatement;
+class SyncStatement;
+class TraceSpanStatement;
 class JumpStatement;
 class ReturnStatement;
 class BreakStatement;
 class ContinueStatement;
+class BecomeStatement;
 class SelectionStatement;
 class IfStatement;
+class SwitchStatement;
 class IterationStatement;
 class WhileStatement;
 class ForStatement;
+class ParallelForStatement;
 
 // Expression
 class Expression;
@@ -48,13 +55,32 @@ class BinaryOperationExpression;
 class UnaryOperationExpression;
 class ConditionalExpression;
 class FunctionCall;
+class SpawnExpression;
 class ArrayReference;
 
+// lines and columns of a node in its source file, counted from 1; nodes
+// made by later passes have line 0
+struct SourceRange {
+  int begin_line = 0;
+  int begin_column = 0;
+  int end_line = 0;
+  int end_column = 0;
+};
+
 class AST {
  public:
   virtual ~AST() noexcept = default;
   virtual void accept(ASTVisitor& vistior) = 0;
   virtual llvm::Value* accept(IRVisitor& visitor) = 0;
+
+  // set by the parser on statements, declarations, functions, parameters,
+  // full expressions and calls
+  const SourceRange& get_range() const { return range_; }
+
+  void set_range(const SourceRange& range) { range_ = range; }
+
+ private:
+  SourceRange range_;
 };
 
 class BlockItem : public AST {
@@ -186,19 +212,74 @@ class FunctionDefinition final : public ExternalDeclaration {
 
   auto& get_compound_statement() { return compound_statement_; }
 
+  void add_qualifier(type::FunctionQualifier qualifier) {
+    qualifiers_.insert(qualifier);
+  }
+
+  bool has_qualifier(type::FunctionQualifier qualifier) const {
+    return qualifiers_.count(qualifier) != 0;
+  }
+
+  auto& get_qualifiers() { return qualifiers_; }
+
  protected:
   std::unique_ptr<DeclarationSpecifier> declaration_specifier_;
   std::unique_ptr<Identifier> identifier_;
   std::vector<std::unique_ptr<ParameterDeclaration>> parameter_list_;
   std::unique_ptr<CompoundStatement> compound_statement_;
+  std::set<type::FunctionQualifier> qualifiers_;
+};
+
+// a prototype, for functions defined later or in another file
+class FunctionDeclaration final : public ExternalDeclaration {
+ public:
+  explicit FunctionDeclaration(
+      std::unique_ptr<DeclarationSpecifier>&& declaration_specifier,
+      std::unique_ptr<Identifier>&& identifier,
+      std::unique_ptr<ParameterList>&& parameter_list)
+      : declaration_specifier_(std::move(declaration_specifier)),
+        identifier_(std::move(identifier)),
+        is_extern_c_(false) {
+    if (parameter_list != nullptr) {
+      parameter_list_ = std::move(parameter_list->get_item_list());
+    }
+  }
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  auto& get_declaration_specifier() { return declaration_specifier_; }
+
+  auto& get_identifier() { return identifier_; }
+
+  auto& get_parameter_list() { return parameter_list_; }
+
+  // extern "C": a native function or the export function of another file,
+  // called with the length after every array
+  void set_extern_c(bool is_extern_c) { is_extern_c_ = is_extern_c; }
+
+  bool get_is_extern_c() const { return is_extern_c_; }
+
+ protected:
+  std::unique_ptr<DeclarationSpecifier> declaration_specifier_;
+  std::unique_ptr<Identifier> identifier_;
+  std::vector<std::unique_ptr<ParameterDeclaration>> parameter_list_;
+  bool is_extern_c_;
 };
 
 class DeclarationSpecifier final : public AST {
  public:
   explicit DeclarationSpecifier(std::unique_ptr<TypeSpecifier>&& type_specifer)
-      : is_const_(false), type_specifier_(std::move(type_specifer)) {}
+      : type_specifier_(std::move(type_specifer)),
+        is_const_(false),
+        is_constexpr_(false),
+        is_atomic_(false) {}
 
-  explicit DeclarationSpecifier(bool is_const) : is_const_(true) {
+  explicit DeclarationSpecifier(bool is_const)
+      : is_const_(true), is_constexpr_(false), is_atomic_(false) {
     assert(is_const == true);
   }
 
@@ -214,9 +295,22 @@ class DeclarationSpecifier final : public AST {
 
   bool get_is_const() const { return is_const_; }
 
+  // constexpr implies const, the initializer must evaluate at compile time
+  void set_constexpr(bool is_constexpr) { is_constexpr_ = is_constexpr; }
+
+  bool get_is_constexpr() const { return is_constexpr_; }
+
+  // plain reads and writes are sequentially consistent, the atomic builtins
+  // take an explicit memory order
+  void set_atomic(bool is_atomic) { is_atomic_ = is_atomic; }
+
+  bool get_is_atomic() const { return is_atomic_; }
+
  protected:
   std::unique_ptr<TypeSpecifier> type_specifier_;
   bool is_const_;
+  bool is_constexpr_;
+  bool is_atomic_;
 };
 
 class Identifier final : public Expression {
@@ -298,10 +392,11 @@ class Initializer final : public AST {
 class Declarator final : public AST {
  public:
   Declarator(std::unique_ptr<Identifier>&& identifier, bool is_array,
-             int array_length)
+             int array_length, bool is_restrict = false)
       : identifier_(std::move(identifier)),
         is_array_(is_array),
-        array_length_(array_length) {}
+        array_length_(array_length),
+        is_restrict_(is_restrict) {}
 
   virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
 
@@ -315,10 +410,13 @@ class Declarator final : public AST {
 
   int get_array_length() { return array_length_; }
 
+  bool get_is_restrict() { return is_restrict_; }
+
  protected:
   std::unique_ptr<Identifier> identifier_;
   bool is_array_;
   int array_length_;
+  bool is_restrict_;
 };
 
 // statement
@@ -359,6 +457,41 @@ class ExpressionStatement final : public Statement {
   std::unique_ptr<Expression> expression_;
 };
 
+// sync; waits for every call spawned by the current function so far
+class SyncStatement final : public Statement {
+ public:
+  SyncStatement() = default;
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+};
+
+// trace_span("name") { ... } records the time spent in the block as a span
+// of the event trace, whichever way control leaves it
+class TraceSpanStatement final : public Statement {
+ public:
+  TraceSpanStatement(const std::string& name,
+                     std::unique_ptr<CompoundStatement>&& body)
+      : name_(name), body_(std::move(body)) {}
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  const std::string& get_name() const { return name_; }
+
+  auto& get_body() { return body_; }
+
+ protected:
+  std::string name_;
+  std::unique_ptr<CompoundStatement> body_;
+};
+
 class JumpStatement : public Statement {
  public:
   virtual ~JumpStatement() {}
@@ -406,6 +539,25 @@ class ContinueStatement final : public JumpStatement {
  protected:
 };
 
+// become f(args); leaves the current function through a guaranteed tail
+// call, the callee must have the same signature as the caller
+class BecomeStatement final : public JumpStatement {
+ public:
+  BecomeStatement(std::unique_ptr<FunctionCall>&& function_call)
+      : function_call_(std::move(function_call)) {}
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  auto& get_function_call() { return function_call_; }
+
+ protected:
+  std::unique_ptr<FunctionCall> function_call_;
+};
+
 class SelectionStatement : public Statement {
  public:
   virtual ~SelectionStatement() {}
@@ -438,6 +590,40 @@ class IfStatement final : public SelectionStatement {
   std::unique_ptr<Statement> else_statement_;
 };
 
+// statements run from the first clause whose case matches, or the default,
+// and fall through into the following clauses until a break
+class SwitchStatement final : public SelectionStatement {
+ public:
+  struct Clause {
+    // constant values, folded to literals before code generation
+    std::vector<std::unique_ptr<Expression>> values;
+    bool is_default = false;
+    std::vector<std::unique_ptr<BlockItem>> block_items;
+  };
+
+  SwitchStatement() = default;
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  void set_expression(std::unique_ptr<Expression>&& expression) {
+    expression_ = std::move(expression);
+  }
+
+  void add_clause(Clause&& clause) { clauses_.push_back(std::move(clause)); }
+
+  auto& get_expression() { return expression_; }
+
+  auto& get_clauses() { return clauses_; }
+
+ protected:
+  std::unique_ptr<Expression> expression_;
+  std::vector<Clause> clauses_;
+};
+
 class IterationStatement : public Statement {
  public:
   virtual ~IterationStatement() {}
@@ -497,6 +683,65 @@ class ForStatement final : public IterationStatement {
   std::unique_ptr<Statement> loop_statement_;
 };
 
+// parallel [schedule(kind[, chunk])] [reduce(op: names)] for (...), the
+// clauses are collected before the loop itself is attached
+class ParallelForStatement final : public IterationStatement {
+ public:
+  struct Reduction {
+    type::BinaryOp op;
+    std::string name;
+  };
+
+  ParallelForStatement() : schedule_(type::Schedule::STATIC), min_count_(0) {}
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  void set_for_statement(std::unique_ptr<ForStatement>&& for_statement) {
+    for_statement_ = std::move(for_statement);
+  }
+
+  auto& get_for_statement() { return for_statement_; }
+
+  void set_schedule(type::Schedule schedule,
+                    std::unique_ptr<Expression>&& chunk = nullptr) {
+    schedule_ = schedule;
+    chunk_ = std::move(chunk);
+  }
+
+  type::Schedule get_schedule() const { return schedule_; }
+
+  // nullptr selects the default chunking of the schedule
+  auto& get_chunk() { return chunk_; }
+
+  void add_reduction(type::BinaryOp op, const std::string& name) {
+    reductions_.push_back({op, name});
+  }
+
+  auto& get_reductions() { return reductions_; }
+
+  // variables every iteration sets before reading, one copy per thread
+  void add_private(const std::string& name) { privates_.push_back(name); }
+
+  auto& get_privates() { return privates_; }
+
+  // loops with fewer iterations run serially, 0 always goes parallel
+  void set_min_count(int min_count) { min_count_ = min_count; }
+
+  int get_min_count() const { return min_count_; }
+
+ protected:
+  std::unique_ptr<ForStatement> for_statement_;
+  type::Schedule schedule_;
+  std::unique_ptr<Expression> chunk_;
+  std::vector<Reduction> reductions_;
+  std::vector<std::string> privates_;
+  int min_count_;
+};
+
 /* Expression */
 class ConstantExpression : public Expression {
  public:
@@ -686,6 +931,25 @@ class FunctionCall final : public Expression {
   std::vector<std::unique_ptr<Expression>> argument_list_;
 };
 
+// spawn f(args) may run the call on another thread, only allowed as a
+// statement or as the value of an assignment that becomes visible at sync
+class SpawnExpression final : public Expression {
+ public:
+  SpawnExpression(std::unique_ptr<FunctionCall>&& function_call)
+      : function_call_(std::move(function_call)) {}
+
+  virtual void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+
+  virtual llvm::Value* accept(IRVisitor& visitor) override {
+    return visitor.visit(*this);
+  }
+
+  auto& get_function_call() { return function_call_; }
+
+ protected:
+  std::unique_ptr<FunctionCall> function_call_;
+};
+
 class ArrayReference final : public Expression {
  public:
   ArrayReference(std::unique_ptr<Expression>&& target,
@@ -1,18 +1,208 @@
 #include "codegen.hpp"
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constant.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instruction.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/YAMLTraits.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+#include <algorithm>
+#include <climits>
+#include <set>
+#include "dependence.hpp"
+#include "jit.hpp"
+#include "linker.hpp"
 #include "type.hpp"
+#include "walker.hpp"
 namespace ntc {
+llvm::LLVMContext llvm_context;
+
+namespace {
+// direct-indexed memo entries for int and long arguments, keys outside of
+// [0, kMemoDirectEntries) fall back to the runtime hash table
+const uint64_t kMemoDirectEntries = 4096;
+
+// states of a direct memo entry: a thread claims an empty one, writes the
+// value and then publishes it
+const uint8_t kMemoEmpty = 0;
+const uint8_t kMemoPublished = 1;
+const uint8_t kMemoClaimed = 2;
+
+// marks C entry points, which internalize and -shared leave visible
+const char* const kExportAttribute = "ntc-export";
+
+// branch weights of likely and unlikely, the ones __builtin_expect uses
+const uint32_t kLikelyWeight = 2000;
+const uint32_t kUnlikelyWeight = 1;
+
+// FNV-1a over the counter counts of the branches of a function
+const uint64_t kProfileSeed = 0xcbf29ce484222325ull;
+const uint64_t kProfilePrime = 0x100000001b3ull;
+
+// fields of ntrt_profile_data
+enum ProfileField {
+  PROFILE_NAME,
+  PROFILE_CHECKSUM,
+  PROFILE_COUNTERS,
+  PROFILE_NUM_COUNTERS,
+};
+
+// fields of ntrt_memo_table
+enum MemoField {
+  MEMO_NAME,
+  MEMO_KEY_WORDS,
+  MEMO_MAX_ENTRIES,
+  MEMO_HITS,
+  MEMO_MISSES,
+};
+
+// names a parallel for body refers to, and the first statement that cannot
+// leave an outlined body
+class ParallelBodyScan final : public ASTWalker {
+ public:
+  ParallelBodyScan() : loops_(0), switches_(0) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(Identifier& identifier) override {
+    names_.insert(identifier.get_name());
+  }
+
+  virtual void visit(ReturnStatement& return_statement) override {
+    reject("return");
+    ASTWalker::visit(return_statement);
+  }
+
+  virtual void visit(BecomeStatement& become_statement) override {
+    reject("become");
+    ASTWalker::visit(become_statement);
+  }
+
+  virtual void visit(SpawnExpression& spawn_expression) override {
+    reject("spawn");
+    ASTWalker::visit(spawn_expression);
+  }
+
+  virtual void visit(SyncStatement&) override { reject("sync"); }
+
+  virtual void visit(BreakStatement&) override {
+    if (loops_ == 0 && switches_ == 0) {
+      reject("break");
+    }
+  }
+
+  virtual void visit(ContinueStatement&) override {
+    if (loops_ == 0) {
+      reject("continue");
+    }
+  }
+
+  virtual void visit(WhileStatement& while_statement) override {
+    ++loops_;
+    ASTWalker::visit(while_statement);
+    --loops_;
+  }
+
+  virtual void visit(ForStatement& for_statement) override {
+    ++loops_;
+    ASTWalker::visit(for_statement);
+    --loops_;
+  }
+
+  virtual void visit(SwitchStatement& switch_statement) override {
+    ++switches_;
+    ASTWalker::visit(switch_statement);
+    --switches_;
+  }
+
+  const std::set<std::string>& get_names() const { return names_; }
+
+  const std::string& get_rejected() const { return rejected_; }
+
+ private:
+  void reject(const std::string& statement) {
+    if (rejected_.empty()) {
+      rejected_ = statement;
+    }
+  }
+
+  std::set<std::string> names_;
+  std::string rejected_;
+  int loops_;
+  int switches_;
+};
+
+// vector types the language has a specifier for, nullptr otherwise
+llvm::VectorType* get_vector_type(llvm::Type* element, unsigned lanes) {
+  if (element == nullptr ||
+      !((element->isIntegerTy(32) && (lanes == 4 || lanes == 8)) ||
+        (element->isIntegerTy(64) && (lanes == 2 || lanes == 4)) ||
+        (element->isFloatTy() && (lanes == 4 || lanes == 8)) ||
+        (element->isDoubleTy() && (lanes == 2 || lanes == 4)))) {
+    return nullptr;
+  }
+  return llvm::VectorType::get(element, lanes);
+}
+
+// glibc's libmvec variants of the math intrinsics, for SSE and AVX2
+const llvm::VecDesc libmvec_sse[] = {
+    {"llvm.sin.f64", "_ZGVbN2v_sin", 2},
+    {"llvm.cos.f64", "_ZGVbN2v_cos", 2},
+    {"llvm.exp.f64", "_ZGVbN2v_exp", 2},
+    {"llvm.log.f64", "_ZGVbN2v_log", 2},
+    {"llvm.pow.f64", "_ZGVbN2vv_pow", 2},
+    {"llvm.sin.f32", "_ZGVbN4v_sinf", 4},
+    {"llvm.cos.f32", "_ZGVbN4v_cosf", 4},
+    {"llvm.exp.f32", "_ZGVbN4v_expf", 4},
+    {"llvm.log.f32", "_ZGVbN4v_logf", 4},
+    {"llvm.pow.f32", "_ZGVbN4vv_powf", 4}};
+const llvm::VecDesc libmvec_avx2[] = {
+    {"llvm.sin.f64", "_ZGVdN4v_sin", 4},
+    {"llvm.cos.f64", "_ZGVdN4v_cos", 4},
+    {"llvm.exp.f64", "_ZGVdN4v_exp", 4},
+    {"llvm.log.f64", "_ZGVdN4v_log", 4},
+    {"llvm.pow.f64", "_ZGVdN4vv_pow", 4},
+    {"llvm.sin.f32", "_ZGVdN8v_sinf", 8},
+    {"llvm.cos.f32", "_ZGVdN8v_cosf", 8},
+    {"llvm.exp.f32", "_ZGVdN8v_expf", 8},
+    {"llvm.log.f32", "_ZGVdN8v_logf", 8},
+    {"llvm.pow.f32", "_ZGVdN8vv_powf", 8}};
+
+class SpawnFinder final : public ASTWalker {
+ public:
+  SpawnFinder() : found_(false) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(SpawnExpression&) override { found_ = true; }
+
+  bool get_found() const { return found_; }
+
+ private:
+  bool found_;
+};
+}  // namespace
 
 void SymbolTable::push_table() {
   table_stack_.push_back(std::map<std::string, SymbolRecord>());
@@ -46,10 +236,12 @@ bool SymbolTable::find_symbol_local(const std::string& name) {
 }
 
 void SymbolTable::add_symbol(const std::string& name, llvm::Value* val,
-                             llvm::Type* type, bool is_const, bool is_array) {
+                             llvm::Type* type, bool is_const, bool is_array,
+                             bool is_atomic, bool is_unsigned) {
   assert(find_symbol_local(name) == false);
   auto& cur_table = table_stack_.back();
-  SymbolRecord to_be_add(val, type, is_const, is_array);
+  SymbolRecord to_be_add(val, type, is_const, is_array, is_atomic,
+                         is_unsigned);
   cur_table[name] = to_be_add;
 }
 
@@ -64,10 +256,59 @@ SymbolRecord* SymbolTable::get_symbol(const std::string& name) {
   return nullptr;
 }
 
-CodeGenerator::CodeGenerator(const std::string& module_id)
+CodeGenerator::CodeGenerator(const std::string& module_id,
+                             const ProgramConfig& config)
     : module_id_(module_id),
       module_(std::make_unique<llvm::Module>(module_id, llvm_context)),
-      builder_(llvm::IRBuilder<>(llvm_context)) {}
+      builder_(llvm::IRBuilder<>(llvm_context)),
+      config_(config),
+      memo_type_(nullptr),
+      tail_calls_(0),
+      parallel_loops_(0),
+      spawns_(0),
+      threads_(0),
+      removed_functions_(0),
+      link_microseconds_(0),
+      loop_depth_(0),
+      profile_type_(nullptr),
+      profiled_functions_(0),
+      cur_call_site_(nullptr),
+      cur_perf_site_(nullptr),
+      debug_file_(nullptr),
+      debug_scope_(nullptr),
+      remarks_(nullptr) {
+  create_target_machine();
+  if (!config_.profile_use.empty()) {
+    profile_data_.load(config_.profile_use);
+  }
+  bool has_remarks =
+      !config_.remarks_passed.empty() || !config_.remarks_missed.empty() ||
+      !config_.remarks_analysis.empty() || !config_.remarks_file.empty() ||
+      config_.remarks_summary;
+  if (has_remarks) {
+    auto remarks = std::make_unique<RemarkHandler>(config_);
+    remarks_ = remarks.get();
+    llvm_context.setDiagnosticHandler(std::move(remarks));
+  }
+  // remarks point at source lines, so they keep the line table without
+  // emitting it
+  if (config_.debug_info || has_remarks) {
+    // an absolute path lets gdb and perf find the source from anywhere
+    llvm::SmallString<128> path(module_id);
+    llvm::sys::fs::make_absolute(path);
+    debug_builder_ = std::make_unique<llvm::DIBuilder>(*module_);
+    debug_file_ = debug_builder_->createFile(
+        llvm::sys::path::filename(path), llvm::sys::path::parent_path(path));
+    debug_builder_->createCompileUnit(
+        llvm::dwarf::DW_LANG_C, debug_file_, "ntc", config_.opt_level > 0, "",
+        0, "",
+        config_.debug_info ? llvm::DICompileUnit::FullDebug
+                           : llvm::DICompileUnit::NoDebug);
+    module_->addModuleFlag(llvm::Module::Warning, "Debug Info Version",
+                           llvm::DEBUG_METADATA_VERSION);
+    module_->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+  }
+}
 
 llvm::Value* CodeGenerator::visit(AST& ast) { return ast.accept(*this); }
 
@@ -80,10 +321,46 @@ llvm::Value* CodeGenerator::visit(ExternalDeclaration& external_declaration) {
 }
 
 llvm::Value* CodeGenerator::visit(TranslationUnit& translation_unit) {
+  translation_unit.accept(purity_);
   auto& decls = translation_unit.get_declarations();
   for (auto& decl : decls) {
     visit(*decl);
   }
+  if (config_.show_stats && !memo_tables_.empty()) {
+    emit_memo_registration();
+  }
+  if (!config_.profile_generate.empty()) {
+    emit_profile_registration();
+  } else if (!config_.profile_use.empty()) {
+    apply_profile();
+  }
+  if (!call_sites_.empty()) {
+    emit_site_registration("ntc.calls.init", "ntrt_func_register",
+                           call_sites_);
+  }
+  if (!trace_sites_.empty()) {
+    std::vector<llvm::GlobalVariable*> sites;
+    for (auto& site : trace_sites_) {
+      sites.push_back(site.second);
+    }
+    emit_site_registration("ntc.trace.init", "ntrt_trace_register", sites);
+  }
+  for (auto& name : config_.perf_functions) {
+    if (module_->getFunction(name) == nullptr) {
+      codegen_error("--perf-counters: no function \'" + name + "\'");
+    }
+  }
+  for (auto& export_function : exports_) {
+    emit_c_entry(export_function);
+  }
+  if (!perf_sites_.empty()) {
+    emit_site_registration("ntc.perf.init", "ntrt_perf_register",
+                           perf_sites_);
+  }
+  if (debug_builder_ != nullptr) {
+    debug_builder_->finalize();
+  }
+  removed_functions_ = finish_linkage();
   return nullptr;
 }
 
@@ -97,54 +374,161 @@ llvm::Value* CodeGenerator::visit(FunctionDefinition& function_definition) {
   llvm::Type* return_type = get_llvm_type(*declaration_specifier);
   std::vector<llvm::Type*> parameter_types;
   std::vector<bool> parameter_consts;
+  std::vector<bool> parameter_arrays;
+  std::vector<bool> parameter_atomics;
+  std::vector<bool> parameter_unsigneds;
   std::vector<std::string> parameter_names;
   for (auto& parameter : parameter_list) {
     auto& parameter_specifier = parameter->get_declaration_specifier();
     auto& declarator = parameter->get_declarator();
 
-    if (declarator->get_is_array()) {
-      auto* type = get_llvm_type(*parameter_specifier);
-      auto* arr_type = llvm::PointerType::get(type, 0);
-      parameter_types.push_back(arr_type);
-      // codegen_error("no support for array as function parameter");
-    } else {
-      auto* type = get_llvm_type(*parameter_specifier);
-      parameter_types.push_back(type);
-    }
+    parameter_types.push_back(get_parameter_type(*parameter));
     parameter_consts.push_back(get_const(*parameter_specifier));
+    parameter_arrays.push_back(declarator->get_is_array());
+    parameter_atomics.push_back(parameter_specifier->get_is_atomic());
+    parameter_unsigneds.push_back(get_unsigned(*parameter_specifier));
+    auto* element_type = get_llvm_type(*parameter_specifier);
+    if (parameter_specifier->get_is_atomic() &&
+        !(element_type->isIntegerTy(32) || element_type->isIntegerTy(64))) {
+      codegen_error("atomic needs int or long: \'" +
+                    declarator->get_identifier()->get_name() + "\'");
+    }
     parameter_names.push_back(
         parameter->get_declarator()->get_identifier()->get_name());
   }
   auto* function_type =
       llvm::FunctionType::get(return_type, parameter_types, false);
-  auto* function =
-      llvm::Function::Create(function_type, llvm::Function::ExternalLinkage,
-                             identifier->get_name(), module_.get());
+  auto* function = declare_function(identifier->get_name(), function_type);
+  if (!function->isDeclaration()) {
+    codegen_error("redefinition of function \'" + identifier->get_name() +
+                  "\'");
+  }
+  function->setLinkage(get_linkage(function_definition));
+  if (function_definition.has_qualifier(type::FunctionQualifier::INLINE)) {
+    function->addFnAttr(llvm::Attribute::InlineHint);
+  }
+  if (function_definition.has_qualifier(type::FunctionQualifier::EXPORT)) {
+    ExportFunction export_function;
+    export_function.function = function;
+    export_function.unsigneds = parameter_unsigneds;
+    export_function.return_unsigned = get_unsigned(*declaration_specifier);
+    check_c_type(return_type, identifier->get_name());
+    for (size_t i = 0; i < parameter_list.size(); ++i) {
+      auto& declarator = parameter_list[i]->get_declarator();
+      check_c_type(parameter_types[i], identifier->get_name());
+      export_function.array_lengths.push_back(
+          declarator->get_is_array() ? declarator->get_array_length() : -1);
+    }
+    exports_.push_back(export_function);
+  }
+  set_hotness(function, function_definition);
+  if (debug_builder_ != nullptr) {
+    std::vector<llvm::Metadata*> debug_types = {
+        return_type->isVoidTy()
+            ? nullptr
+            : get_debug_type(return_type,
+                             get_unsigned(*declaration_specifier))};
+    for (size_t i = 0; i < parameter_types.size(); ++i) {
+      debug_types.push_back(
+          get_debug_type(parameter_types[i], parameter_unsigneds[i]));
+    }
+    begin_debug_function(
+        function, function_definition.get_range().begin_line,
+        debug_builder_->createSubroutineType(
+            debug_builder_->getOrCreateTypeArray(debug_types)),
+        false);
+  }
+  for (size_t i = 0; i < parameter_list.size(); ++i) {
+    auto& declarator = parameter_list[i]->get_declarator();
+    if (declarator->get_is_array()) {
+      add_array_parameter_attributes(
+          function, i, parameter_types[i]->getPointerElementType(),
+          declarator->get_array_length(), declarator->get_is_restrict());
+    }
+  }
   auto* block =
       llvm::BasicBlock::Create(module_->getContext(), "entry", function);
   auto* return_block =
       llvm::BasicBlock::Create(module_->getContext(), "return");
 
   builder_.SetInsertPoint(block);
+  cur_tail_ = TailLoop();
   size_t index = 0;
   for (auto& arg : function->args()) {
-    auto* local = builder_.CreateAlloca(arg.getType());
-    if (local->getType()->isPointerTy()) {
-      symbol_table_.add_symbol(parameter_names[index], local,
+    arg.setName(parameter_names[index]);
+    if (parameter_arrays[index]) {
+      // array parameters cannot be reassigned, so the incoming pointer is
+      // indexed directly instead of being spilled to a stack slot
+      symbol_table_.add_symbol(parameter_names[index], &arg,
                                parameter_types[index], parameter_consts[index],
-                               true);
+                               true, parameter_atomics[index],
+                               parameter_unsigneds[index]);
+      cur_tail_.parameters.push_back(nullptr);
     } else {
+      auto* local = builder_.CreateAlloca(arg.getType());
       symbol_table_.add_symbol(parameter_names[index], local,
                                parameter_types[index], parameter_consts[index],
-                               false);
+                               false, parameter_atomics[index],
+                               parameter_unsigneds[index]);
+      builder_.CreateStore(&arg, local);
+      cur_tail_.parameters.push_back(local);
+    }
+    if (debug_builder_ != nullptr) {
+      auto* record = symbol_table_.get_symbol(parameter_names[index]);
+      emit_debug_variable(parameter_names[index], record->val,
+                          get_debug_type(arg.getType(),
+                                         parameter_unsigneds[index]),
+                          parameter_list[index]->get_range().begin_line,
+                          index + 1);
     }
-    builder_.CreateStore(&arg, local);
     ++index;
   }
   if (!return_type->isVoidTy()) {
     auto* ret = builder_.CreateAlloca(return_type);
+    bool is_unsigned = get_unsigned(*declaration_specifier);
     symbol_table_.add_symbol(identifier->get_name(), ret, return_type, false,
-                             false);
+                             false, false, is_unsigned);
+    if (is_unsigned) {
+      unsigned_functions_.insert(identifier->get_name());
+    }
+  }
+  // counts every call, also the ones a memo table answers
+  get_profile_state();
+  cur_call_site_ = nullptr;
+  if (config_.call_profile) {
+    emit_call_enter(function);
+  }
+  cur_perf_site_ = nullptr;
+  if (std::find(config_.perf_functions.begin(), config_.perf_functions.end(),
+                identifier->get_name()) != config_.perf_functions.end()) {
+    emit_perf_begin(function);
+  }
+  cur_memo_ = MemoCache();
+  if (is_memoized(function_definition, function)) {
+    emit_memo_lookup(function);
+  }
+  SpawnFinder spawn_finder;
+  function_definition.accept(spawn_finder);
+  cur_task_group_ = nullptr;
+  cur_task_stack_ = nullptr;
+  if (spawn_finder.get_found()) {
+    // ntrt_task_group, three counters
+    auto* group_type = llvm::ArrayType::get(builder_.getInt64Ty(), 3);
+    cur_task_group_ = builder_.CreateAlloca(group_type);
+    builder_.CreateStore(llvm::ConstantAggregateZero::get(group_type),
+                         cur_task_group_);
+    cur_task_stack_ = builder_.CreateAlloca(builder_.getInt8PtrTy());
+    builder_.CreateStore(
+        llvm::ConstantPointerNull::get(builder_.getInt8PtrTy()),
+        cur_task_stack_);
+  }
+  // a loop back to the entry would reuse frames that spawned calls may
+  // still write to
+  if (config_.opt_level > 0 && cur_task_group_ == nullptr) {
+    cur_tail_.shape = analyze_tail_recursion(function_definition);
+  }
+  if (cur_tail_.shape.enabled) {
+    emit_tail_header(function);
   }
   cur_return_block = return_block;
   cur_function_name_ = identifier->get_name();
@@ -152,18 +536,32 @@ llvm::Value* CodeGenerator::visit(FunctionDefinition& function_definition) {
   is_func_def = true;
   is_return_happened = false;
   visit(*compound_statment);
+  if (!is_return_happened) {
+    // control reaching the end of the body
+    builder_.CreateBr(return_block);
+  }
 
   function->getBasicBlockList().push_back(return_block);
   builder_.SetInsertPoint(return_block);
+  // the closing brace
+  set_debug_location(function_definition.get_range().end_line, 0);
+  // every function syncs before it returns
+  emit_sync();
+  emit_call_exit();
   if (!return_type->isVoidTy()) {
     auto* val = symbol_table_.get_symbol(identifier->get_name())->val;
     auto* load = builder_.CreateLoad(val);
+    if (cur_memo_.table != nullptr) {
+      emit_memo_store(load);
+    }
     builder_.CreateRet(load);
   } else {
     builder_.CreateRetVoid();
   }
   llvm::verifyFunction(*function);
   symbol_table_.pop_table();
+  builder_.SetCurrentDebugLocation(llvm::DebugLoc());
+  debug_scope_ = nullptr;
 
   cur_return_block = nullptr;
   cur_function_name_ = "";
@@ -171,13 +569,79 @@ llvm::Value* CodeGenerator::visit(FunctionDefinition& function_definition) {
   return nullptr;
 }
 
+llvm::Value* CodeGenerator::visit(FunctionDeclaration& function_declaration) {
+  auto& declaration_specifier =
+      function_declaration.get_declaration_specifier();
+  auto& name = function_declaration.get_identifier()->get_name();
+  bool is_extern_c = function_declaration.get_is_extern_c();
+  std::vector<llvm::Type*> parameter_types;
+  std::vector<bool> parameter_arrays;
+  std::vector<bool> parameter_unsigneds;
+  for (auto& parameter : function_declaration.get_parameter_list()) {
+    parameter_types.push_back(get_parameter_type(*parameter));
+    parameter_unsigneds.push_back(
+        get_unsigned(*parameter->get_declaration_specifier()));
+    parameter_arrays.push_back(parameter->get_declarator()->get_is_array());
+    if (is_extern_c) {
+      check_c_type(parameter_types.back(), name);
+    }
+    if (is_extern_c && parameter_arrays.back()) {
+      parameter_types.push_back(
+          module_->getDataLayout().getIntPtrType(module_->getContext()));
+      parameter_unsigneds.push_back(true);
+    }
+  }
+  auto* return_type = get_llvm_type(*declaration_specifier);
+  bool return_unsigned = get_unsigned(*declaration_specifier);
+  auto* function = declare_function(
+      name, llvm::FunctionType::get(return_type, parameter_types, false));
+  if (is_extern_c) {
+    check_c_type(return_type, name);
+    add_c_attributes(function, parameter_unsigneds, return_unsigned);
+    c_functions_[name] = parameter_arrays;
+  }
+  if (!return_type->isVoidTy() && return_unsigned) {
+    unsigned_functions_.insert(name);
+  }
+  return nullptr;
+}
+
+llvm::Function* CodeGenerator::declare_function(const std::string& name,
+                                                llvm::FunctionType* type) {
+  auto* function = module_->getFunction(name);
+  if (function == nullptr) {
+    return llvm::Function::Create(type, llvm::Function::ExternalLinkage, name,
+                                  module_.get());
+  }
+  if (function->getFunctionType() != type) {
+    codegen_error("conflicting types for function \'" + name + "\'");
+  }
+  return function;
+}
+
+llvm::Type* CodeGenerator::get_parameter_type(
+    ParameterDeclaration& parameter_declaration) {
+  auto* type =
+      get_llvm_type(*parameter_declaration.get_declaration_specifier());
+  // arrays are passed as a pointer to their first element
+  if (parameter_declaration.get_declarator()->get_is_array()) {
+    return llvm::PointerType::get(type, 0);
+  }
+  return type;
+}
+
 llvm::Value* CodeGenerator::visit(DeclarationSpecifier&) {
   assert(false);
   return nullptr;
 }
 
 llvm::Value* CodeGenerator::visit(Identifier& identifier) {
-  return builder_.CreateLoad(get_identifier_ptr(&identifier));
+  auto* ptr = get_identifier_ptr(&identifier);
+  auto* record = symbol_table_.get_symbol(identifier.get_name());
+  if (record->is_unsigned) {
+    unsigned_.insert(&identifier);
+  }
+  return load_symbol(ptr, *record);
 }
 
 llvm::Value* CodeGenerator::visit(ParameterDeclaration&) {
@@ -191,6 +655,7 @@ llvm::Value* CodeGenerator::visit(TypeSpecifier&) {
 }
 
 llvm::Value* CodeGenerator::visit(Declaration& declaration) {
+  set_debug_location(declaration);
   auto& declaration_speicifer = declaration.get_declaration_specifier();
   auto& declarator = declaration.get_declarator();
   auto& initializer = declaration.get_initializer();
@@ -200,22 +665,43 @@ llvm::Value* CodeGenerator::visit(Declaration& declaration) {
 
   auto* type = get_llvm_type(*declaration_speicifer);
   bool is_const = get_const(*declaration_speicifer);
+  bool is_atomic = declaration_speicifer->get_is_atomic();
+  bool unsigned_variable = get_unsigned(*declaration_speicifer);
 
   if (symbol_table_.find_symbol_local(identifier->get_name())) {
     codegen_error("varaible \'" + identifier->get_name() + "\' redeclared");
   }
+  if (declarator->get_is_restrict()) {
+    codegen_error("restrict is only allowed on array parameters: \'" +
+                  identifier->get_name() + "\'");
+  }
+  if (is_atomic && !(type->isIntegerTy(32) || type->isIntegerTy(64))) {
+    codegen_error("atomic needs int or long: \'" + identifier->get_name() +
+                  "\'");
+  }
   llvm::AllocaInst* local;
   if (is_array) {
     if (type->isPointerTy()) {
       codegen_error("does not support complex array");
     }
-    local = builder_.CreateAlloca(llvm::ArrayType::get(type, array_size));
+    local = create_entry_alloca(llvm::ArrayType::get(type, array_size));
     symbol_table_.add_symbol(identifier->get_name(), local, type, is_const,
-                             true);
+                             true, is_atomic, unsigned_variable);
   } else {
-    local = builder_.CreateAlloca(type);
+    local = create_entry_alloca(type);
     symbol_table_.add_symbol(identifier->get_name(), local, type, is_const,
-                             false);
+                             false, is_atomic, unsigned_variable);
+  }
+  if (type->isVectorTy()) {
+    // full width aligned loads and stores
+    unsigned alignment = module_->getDataLayout().getPrefTypeAlignment(type);
+    local->setAlignment(alignment);
+  }
+  if (debug_builder_ != nullptr) {
+    emit_debug_variable(
+        identifier->get_name(), local,
+        get_debug_type(local->getAllocatedType(), unsigned_variable),
+        declaration.get_range().begin_line);
   }
 
   if (initializer != nullptr) {
@@ -223,12 +709,8 @@ llvm::Value* CodeGenerator::visit(Declaration& declaration) {
     assert(expression != nullptr);
     auto* value = expression->accept(*this);
     auto* lhs_type = local->getType()->getPointerElementType();
-    auto* rhs_type = value->getType();
-    if (lhs_type->isDoubleTy() && rhs_type->isIntegerTy(32)) {
-      value = builder_.CreateSIToFP(value, builder_.getDoubleTy());
-      rhs_type = value->getType();
-    }
-    assignment_type_check(lhs_type, rhs_type, &value);
+    assignment_type_check(lhs_type, value->getType(), &value,
+                          is_unsigned(*expression));
     builder_.CreateStore(value, local);
   }
   return nullptr;
@@ -250,8 +732,14 @@ llvm::Value* CodeGenerator::visit(CompoundStatement& compound_statement) {
   if (is_func_def_ori) {
     is_func_def = false;
   }
+  auto* outer_scope = debug_scope_;
   if (!is_func_def_ori) {
     symbol_table_.push_table();
+    auto& range = compound_statement.get_range();
+    if (debug_builder_ != nullptr && range.begin_line != 0) {
+      debug_scope_ = debug_builder_->createLexicalBlock(
+          debug_scope_, debug_file_, range.begin_line, range.begin_column);
+    }
   }
   auto& block_item_list = compound_statement.get_block_item_list();
   for (auto& block_item : block_item_list) {
@@ -262,18 +750,34 @@ llvm::Value* CodeGenerator::visit(CompoundStatement& compound_statement) {
   if (!is_func_def_ori) {
     symbol_table_.pop_table();
   }
+  debug_scope_ = outer_scope;
   return nullptr;
 }
 
 llvm::Value* CodeGenerator::visit(ExpressionStatement& expression_statement) {
+  set_debug_location(expression_statement);
   auto& expr = expression_statement.get_expression();
-  if (expr != nullptr) {
+  auto* assignment = dynamic_cast<BinaryOperationExpression*>(expr.get());
+  if (auto* spawn = dynamic_cast<SpawnExpression*>(expr.get())) {
+    emit_spawn(*spawn, nullptr);
+  } else if (assignment != nullptr &&
+             assignment->get_op_type() == type::BinaryOp::ASSIGN &&
+             dynamic_cast<SpawnExpression*>(assignment->get_rhs().get())) {
+    auto* identifier =
+        dynamic_cast<Identifier*>(assignment->get_lhs().get());
+    if (identifier == nullptr) {
+      codegen_error("spawn can only assign to a variable");
+    }
+    emit_spawn(static_cast<SpawnExpression&>(*(assignment->get_rhs())),
+               identifier);
+  } else if (expr != nullptr) {
     expr->accept(*this);
   }
   return nullptr;
 }
 
 llvm::Value* CodeGenerator::visit(ReturnStatement& return_statement) {
+  set_debug_location(return_statement);
   if (cur_function_return_type_ == nullptr) {
     codegen_error("invalid return statement");
   }
@@ -284,37 +788,143 @@ llvm::Value* CodeGenerator::visit(ReturnStatement& return_statement) {
   } else if (expr != nullptr && record == nullptr) {
     codegen_error("return value in a void function");
   }
+  // the tail loop would jump back into the open spans
+  if (expr != nullptr && cur_tail_.header != nullptr &&
+      trace_spans_.empty() && emit_tail_call(*expr)) {
+    is_return_happened = true;
+    return nullptr;
+  }
   if (expr != nullptr) {
     auto* value = expr->accept(*this);
     auto* local = record->val;
     auto* lhs_type = local->getType()->getPointerElementType();
-    auto* rhs_type = value->getType();
-    if (lhs_type->isDoubleTy() && rhs_type->isIntegerTy(32)) {
-      value = builder_.CreateSIToFP(value, builder_.getDoubleTy());
-      rhs_type = value->getType();
-    }
-    assignment_type_check(lhs_type, rhs_type, &value);
-    builder_.CreateStore(value, local);
+    assignment_type_check(lhs_type, value->getType(), &value,
+                          is_unsigned(*expr));
+    builder_.CreateStore(accumulate(value), local);
   }
   if (cur_return_block == nullptr) {
     codegen_error("invalid return statement");
   }
+  emit_trace_ends(0);
   builder_.CreateBr(cur_return_block);
   is_return_happened = true;
   return nullptr;
 }
 
-llvm::Value* CodeGenerator::visit(BreakStatement&) {
-  assert(false);
+llvm::Value* CodeGenerator::visit(BreakStatement& break_statement) {
+  set_debug_location(break_statement);
+  if (break_blocks_.empty()) {
+    codegen_error("break outside of a loop or switch");
+  }
+  emit_trace_ends(break_spans_.back());
+  builder_.CreateBr(break_blocks_.back());
+  is_return_happened = true;
   return nullptr;
 }
 
-llvm::Value* CodeGenerator::visit(ContinueStatement&) {
-  assert(false);
+llvm::Value* CodeGenerator::visit(ContinueStatement& continue_statement) {
+  set_debug_location(continue_statement);
+  if (continue_blocks_.empty()) {
+    codegen_error("continue outside of a loop");
+  }
+  emit_trace_ends(continue_spans_.back());
+  builder_.CreateBr(continue_blocks_.back());
+  is_return_happened = true;
+  return nullptr;
+}
+
+llvm::Value* CodeGenerator::visit(SyncStatement& sync_statement) {
+  set_debug_location(sync_statement);
+  emit_sync();
+  return nullptr;
+}
+
+llvm::Value* CodeGenerator::visit(TraceSpanStatement& trace_span_statement) {
+  set_debug_location(trace_span_statement);
+  auto& body = trace_span_statement.get_body();
+  if (!config_.trace) {
+    return body->accept(*this);
+  }
+  auto& site = trace_sites_[trace_span_statement.get_name()];
+  if (site == nullptr) {
+    site = create_site(trace_span_statement.get_name(), "trace.site");
+  }
+  emit_site_call("ntrt_trace_begin", site);
+  trace_spans_.push_back(site);
+  body->accept(*this);
+  trace_spans_.pop_back();
+  // jumps out of the body have ended the span already
+  if (!is_return_happened) {
+    auto& range = trace_span_statement.get_range();
+    if (range.end_line != 0) {
+      set_debug_location(range.end_line, range.end_column);
+    }
+    emit_site_call("ntrt_trace_end", site);
+  }
+  return nullptr;
+}
+
+llvm::Value* CodeGenerator::visit(BecomeStatement& become_statement) {
+  set_debug_location(become_statement);
+  if (cur_function_return_type_ == nullptr) {
+    codegen_error("invalid become statement");
+  }
+  auto& function_call = become_statement.get_function_call();
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call->get_target().get());
+  if (identifier == nullptr) {
+    codegen_error("cannot call on rvalue");
+  }
+  auto* caller = builder_.GetInsertBlock()->getParent();
+  auto* callee = module_->getFunction(identifier->get_name());
+  if (callee == nullptr) {
+    codegen_error("invalid function: " + identifier->get_name());
+  }
+  if (callee->getFunctionType() != caller->getFunctionType()) {
+    codegen_error("become: \'" + identifier->get_name() +
+                  "\' does not have the signature of \'" +
+                  cur_function_name_ + "\'");
+  }
+  if (cur_memo_.table != nullptr) {
+    codegen_error("become: memo function \'" + cur_function_name_ +
+                  "\' must store its result");
+  }
+  // the frame is gone once the callee runs, local arrays cannot outlive it
+  for (auto& argument : function_call->get_argument_list()) {
+    auto* argument_identifier = dynamic_cast<Identifier*>(argument.get());
+    if (argument_identifier == nullptr) {
+      continue;
+    }
+    auto* record = symbol_table_.get_symbol(argument_identifier->get_name());
+    if (record != nullptr && record->is_array &&
+        llvm::isa<llvm::AllocaInst>(record->val)) {
+      codegen_error("become: local array \'" +
+                    argument_identifier->get_name() +
+                    "\' cannot be passed to a tail call");
+    }
+  }
+  if (callee == caller && cur_tail_.header != nullptr &&
+      trace_spans_.empty() && emit_tail_call(*function_call)) {
+    is_return_happened = true;
+    return nullptr;
+  }
+  emit_sync();
+  emit_trace_ends(0);
+  // the callee replaces this frame, also in the call profile
+  emit_call_exit();
+  auto* call = llvm::cast<llvm::CallInst>(function_call->accept(*this));
+  call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+  if (caller->getReturnType()->isVoidTy()) {
+    builder_.CreateRetVoid();
+  } else {
+    builder_.CreateRet(call);
+  }
+  is_return_happened = true;
   return nullptr;
 }
 
 llvm::Value* CodeGenerator::visit(IfStatement& statement) {
+  set_debug_location(statement);
   auto& if_cond = statement.get_if_expression();
   auto& then_statement = statement.get_then_statment();
   auto& else_statement = statement.get_else_statement();
@@ -332,7 +942,7 @@ llvm::Value* CodeGenerator::visit(IfStatement& statement) {
   auto* else_block = llvm::BasicBlock::Create(module_->getContext(), "else");
   auto* continue_block =
       llvm::BasicBlock::Create(module_->getContext(), "continue");
-  builder_.CreateCondBr(cond_val, then_block, else_block);
+  create_cond_br(*if_cond, cond_val, then_block, else_block);
   builder_.SetInsertPoint(then_block);
 
   bool old_is_return_happened = is_return_happened;
@@ -357,7 +967,110 @@ llvm::Value* CodeGenerator::visit(IfStatement& statement) {
   return nullptr;
 }
 
+llvm::Value* CodeGenerator::visit(SwitchStatement& statement) {
+  set_debug_location(statement);
+  auto* value = statement.get_expression()->accept(*this);
+  auto* type = value->getType();
+  if (!(type->isIntegerTy(8) || type->isIntegerTy(16) ||
+        type->isIntegerTy(32) || type->isIntegerTy(64))) {
+    codegen_error("type error: switch needs an integer or char value");
+  }
+  // short values are promoted like in arithmetic, case values are converted
+  // to the promoted type
+  if (type->isIntegerTy(16)) {
+    value = builder_.CreateSExt(value, builder_.getInt32Ty());
+    type = value->getType();
+  }
+  auto* function = builder_.GetInsertBlock()->getParent();
+  auto* continue_block =
+      llvm::BasicBlock::Create(module_->getContext(), "continue");
+  auto& clauses = statement.get_clauses();
+  std::vector<llvm::BasicBlock*> clause_blocks;
+  llvm::BasicBlock* default_block = nullptr;
+  for (auto& clause : clauses) {
+    clause_blocks.push_back(llvm::BasicBlock::Create(
+        module_->getContext(), clause.is_default ? "default" : "case"));
+    if (clause.is_default) {
+      if (default_block != nullptr) {
+        codegen_error("multiple default labels in one switch");
+      }
+      default_block = clause_blocks.back();
+    }
+  }
+  size_t num_cases = 0;
+  for (auto& clause : clauses) {
+    num_cases += clause.values.size();
+  }
+  // the default edge takes the first counter, the cases the following ones
+  auto* profile = get_profile_state();
+  int counter = profile != nullptr
+                    ? add_profile_counters(*profile, num_cases + 1)
+                    : 0;
+  auto* switch_inst = builder_.CreateSwitch(
+      value,
+      profile_edge(profile, counter,
+                   default_block != nullptr ? default_block : continue_block));
+  if (profile != nullptr && profile->counters == nullptr) {
+    profile->branches.emplace_back(switch_inst, counter);
+  }
+  std::set<int64_t> seen;
+  for (size_t i = 0; i < clauses.size(); ++i) {
+    for (auto& case_value : clauses[i].values) {
+      int64_t constant = 0;
+      if (auto* integer = dynamic_cast<IntegerExpression*>(case_value.get())) {
+        constant = integer->get_val();
+      } else if (auto* character =
+                     dynamic_cast<CharacterExpression*>(case_value.get())) {
+        constant = character->get_val();
+      } else {
+        codegen_error("case value must be an integer or char constant");
+      }
+      if (type->isIntegerTy(8) !=
+          (dynamic_cast<CharacterExpression*>(case_value.get()) != nullptr)) {
+        codegen_error("type error: case value does not match the switch");
+      }
+      auto* case_constant = llvm::cast<llvm::ConstantInt>(
+          llvm::ConstantInt::get(type, constant, true));
+      if (!seen.insert(case_constant->getSExtValue()).second) {
+        codegen_error("duplicate case value " + std::to_string(constant));
+      }
+      switch_inst->addCase(case_constant,
+                           profile_edge(profile, ++counter, clause_blocks[i]));
+    }
+  }
+
+  // one scope for the whole body, clauses fall through in order
+  bool old_is_return_happened = is_return_happened;
+  symbol_table_.push_table();
+  break_blocks_.push_back(continue_block);
+  break_spans_.push_back(trace_spans_.size());
+  for (size_t i = 0; i < clauses.size(); ++i) {
+    if (i > 0 && !is_return_happened) {
+      builder_.CreateBr(clause_blocks[i]);
+    }
+    function->getBasicBlockList().push_back(clause_blocks[i]);
+    builder_.SetInsertPoint(clause_blocks[i]);
+    is_return_happened = false;
+    for (auto& block_item : clauses[i].block_items) {
+      if (!is_return_happened) {
+        block_item->accept(*this);
+      }
+    }
+  }
+  if (!is_return_happened) {
+    builder_.CreateBr(continue_block);
+  }
+  break_blocks_.pop_back();
+  break_spans_.pop_back();
+  symbol_table_.pop_table();
+  is_return_happened = old_is_return_happened;
+  function->getBasicBlockList().push_back(continue_block);
+  builder_.SetInsertPoint(continue_block);
+  return nullptr;
+}
+
 llvm::Value* CodeGenerator::visit(WhileStatement& statement) {
+  set_debug_location(statement);
   auto& cond = statement.get_while_expression();
   auto& loop_statement = statement.get_loop_statement();
 
@@ -375,12 +1088,22 @@ llvm::Value* CodeGenerator::visit(WhileStatement& statement) {
     codegen_error(
         "type error: while statement needs boolean condition expression");
   }
-  builder_.CreateCondBr(cond_val, loop_block, continue_block);
+  create_cond_br(*cond, cond_val, loop_block, continue_block);
 
   builder_.SetInsertPoint(loop_block);
   bool old_is_return_happened = is_return_happened;
   is_return_happened = false;
+  ++loop_depth_;
+  break_blocks_.push_back(continue_block);
+  continue_blocks_.push_back(while_block);
+  break_spans_.push_back(trace_spans_.size());
+  continue_spans_.push_back(trace_spans_.size());
   loop_statement->accept(*this);
+  break_blocks_.pop_back();
+  continue_blocks_.pop_back();
+  break_spans_.pop_back();
+  continue_spans_.pop_back();
+  --loop_depth_;
   if (!is_return_happened) {
     builder_.CreateBr(while_block);
   }
@@ -391,6 +1114,7 @@ llvm::Value* CodeGenerator::visit(WhileStatement& statement) {
 }
 
 llvm::Value* CodeGenerator::visit(ForStatement& statement) {
+  set_debug_location(statement);
   auto& init = statement.get_init_clause();
   auto& cond = statement.get_cond_expression();
   auto& iter = statement.get_iteration_expression();
@@ -400,6 +1124,8 @@ llvm::Value* CodeGenerator::visit(ForStatement& statement) {
       llvm::BasicBlock::Create(module_->getContext(), "for", function);
   auto* loop_block =
       llvm::BasicBlock::Create(module_->getContext(), "loop", function);
+  // continue runs the iteration expression before the condition
+  auto* step_block = llvm::BasicBlock::Create(module_->getContext(), "step");
   auto* continue_block =
       llvm::BasicBlock::Create(module_->getContext(), "continue");
 
@@ -417,55 +1143,536 @@ llvm::Value* CodeGenerator::visit(ForStatement& statement) {
     codegen_error(
         "type error: for statement needs boolean condition expression");
   }
-  builder_.CreateCondBr(cond_val, loop_block, continue_block);
+  create_cond_br(*(cond->get_expression()), cond_val, loop_block,
+                 continue_block);
   builder_.SetInsertPoint(loop_block);
   bool old_is_return_happened = is_return_happened;
   is_return_happened = false;
+  ++loop_depth_;
+  break_blocks_.push_back(continue_block);
+  continue_blocks_.push_back(step_block);
+  break_spans_.push_back(trace_spans_.size());
+  continue_spans_.push_back(trace_spans_.size());
   loop_statement->accept(*this);
-  if (iter != nullptr && !is_return_happened) {
-    iter->accept(*this);
-  }
+  break_blocks_.pop_back();
+  continue_blocks_.pop_back();
+  break_spans_.pop_back();
+  continue_spans_.pop_back();
+  --loop_depth_;
   if (!is_return_happened) {
-    builder_.CreateBr(for_block);
+    builder_.CreateBr(step_block);
   }
+  function->getBasicBlockList().push_back(step_block);
+  builder_.SetInsertPoint(step_block);
+  if (iter != nullptr) {
+    iter->accept(*this);
+  }
+  builder_.CreateBr(for_block);
   is_return_happened = old_is_return_happened;
   function->getBasicBlockList().push_back(continue_block);
   builder_.SetInsertPoint(continue_block);
   return nullptr;
 }
 
-llvm::Value* CodeGenerator::visit(Expression& expression) {
-  return llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 10);
-}
+llvm::Value* CodeGenerator::visit(ParallelForStatement& statement) {
+  set_debug_location(statement);
+  auto& for_statement = statement.get_for_statement();
+  auto* init = for_statement->get_init_clause()->get_expression().get();
+  auto* cond = dynamic_cast<BinaryOperationExpression*>(
+      for_statement->get_cond_expression()->get_expression().get());
+  auto* iter = for_statement->get_iteration_expression().get();
+  auto variable = assigned_variable(init);
+  auto* record = symbol_table_.get_symbol(variable);
+  if (variable.empty() || cond == nullptr ||
+      (cond->get_op_type() != type::BinaryOp::LESS &&
+       cond->get_op_type() != type::BinaryOp::LESS_EQUAL) ||
+      dynamic_cast<Identifier*>(cond->get_lhs().get()) == nullptr ||
+      static_cast<Identifier*>(cond->get_lhs().get())->get_name() !=
+          variable ||
+      loop_step(iter, variable) == 0) {
+    codegen_error(
+        "parallel for needs the form for (i = lo; i < hi; i = i + step)");
+  }
+  if (record == nullptr || record->is_array || record->is_const ||
+      !(record->type->isIntegerTy(16) || record->type->isIntegerTy(32) ||
+        record->type->isIntegerTy(64))) {
+    codegen_error("parallel for: \'" + variable +
+                  "\' must be an integer variable");
+  }
+  ParallelBodyScan scan;
+  for_statement->get_loop_statement()->accept(scan);
+  if (!scan.get_rejected().empty()) {
+    codegen_error(scan.get_rejected() +
+                  " is not allowed inside parallel for");
+  }
 
-llvm::Value* CodeGenerator::visit(IntegerExpression& expr) {
-  return llvm::ConstantInt::getSigned(builder_.getInt32Ty(), expr.get_val());
-}
+  // bounds and step are fixed before the first iteration, which runs the
+  // loop over [0, count) and maps k to lo + k * step
+  auto* int64_type = builder_.getInt64Ty();
+  for_statement->get_init_clause()->accept(*this);
+  auto* lo = builder_.CreateSExt(builder_.CreateLoad(record->val), int64_type);
+  auto* bound = cond->get_rhs()->accept(*this);
+  if (!(bound->getType()->isIntegerTy(16) ||
+        bound->getType()->isIntegerTy(32) ||
+        bound->getType()->isIntegerTy(64))) {
+    codegen_error("parallel for: bound of \'" + variable +
+                  "\' must be an integer");
+  }
+  bound = builder_.CreateSExt(bound, int64_type);
+  int step_value = loop_step(iter, variable);
+  auto* step = builder_.getInt64(step_value);
+  auto* span = builder_.CreateSub(bound, lo);
+  if (cond->get_op_type() == type::BinaryOp::LESS_EQUAL) {
+    span = builder_.CreateAdd(span, builder_.getInt64(1));
+  }
+  auto* count = builder_.CreateSelect(
+      builder_.CreateICmpSGT(span, builder_.getInt64(0)),
+      builder_.CreateSDiv(
+          builder_.CreateAdd(span, builder_.getInt64(step_value - 1)), step),
+      builder_.getInt64(0));
+  llvm::Value* chunk = builder_.getInt64(0);
+  if (statement.get_chunk() != nullptr) {
+    chunk = statement.get_chunk()->accept(*this);
+    if (!chunk->getType()->isIntegerTy() || chunk->getType()->isIntegerTy(1)) {
+      codegen_error("parallel for: chunk size must be an integer");
+    }
+    chunk = builder_.CreateSExt(chunk, int64_type);
+  }
 
-llvm::Value* CodeGenerator::visit(FloatExpression& expr) {
-  return llvm::ConstantFP::get(builder_.getDoubleTy(), expr.get_val());
-}
+  // everything else the body names is shared through pointers in a context
+  // record, reductions get a private copy merged back at the end
+  std::vector<std::string> captures;
+  std::vector<llvm::Type*> context_fields = {int64_type, int64_type};
+  for (auto& name : scan.get_names()) {
+    auto* capture = symbol_table_.get_symbol(name);
+    auto& privates = statement.get_privates();
+    if (capture == nullptr || name == variable ||
+        std::find(privates.begin(), privates.end(), name) != privates.end()) {
+      continue;
+    }
+    captures.push_back(name);
+    context_fields.push_back(capture->val->getType());
+  }
+  for (auto& reduction : statement.get_reductions()) {
+    auto* shared = symbol_table_.get_symbol(reduction.name);
+    if (shared == nullptr) {
+      codegen_error("variable \'" + reduction.name +
+                    "\' used before declared");
+    }
+    if (shared->is_array || shared->is_const || reduction.name == variable ||
+        !(shared->type->isIntegerTy(16) || shared->type->isIntegerTy(32) ||
+          shared->type->isIntegerTy(64) || shared->type->isDoubleTy())) {
+      codegen_error("parallel for: cannot reduce \'" + reduction.name + "\'");
+    }
+    if (std::find(captures.begin(), captures.end(), reduction.name) ==
+        captures.end()) {
+      captures.push_back(reduction.name);
+      context_fields.push_back(shared->val->getType());
+    }
+  }
+  auto* context_type = llvm::StructType::get(llvm_context, context_fields);
+  auto* context = create_entry_alloca(context_type);
+  builder_.CreateStore(lo, builder_.CreateStructGEP(context_type, context, 0));
+  builder_.CreateStore(step,
+                       builder_.CreateStructGEP(context_type, context, 1));
+  for (unsigned i = 0; i < captures.size(); ++i) {
+    builder_.CreateStore(
+        symbol_table_.get_symbol(captures[i])->val,
+        builder_.CreateStructGEP(context_type, context, i + 2));
+  }
 
-llvm::Value* CodeGenerator::visit(BooleanExpression& expr) {
-  return expr.get_val() ? builder_.getInt1(1) : builder_.getInt1(0);
+  auto* body = emit_parallel_body(statement, variable, captures, context_type);
+  auto* body_type = body->getFunctionType();
+  auto* parallel_for = module_->getOrInsertFunction(
+      "ntrt_parallel_for",
+      llvm::FunctionType::get(builder_.getVoidTy(),
+                              {int64_type, builder_.getInt32Ty(), int64_type,
+                               body_type->getPointerTo(),
+                               builder_.getInt8PtrTy()},
+                              false));
+  auto* context_pointer =
+      builder_.CreateBitCast(context, builder_.getInt8PtrTy());
+  llvm::BasicBlock* merge_block = nullptr;
+  if (statement.get_min_count() > 0) {
+    // short loops are not worth waking the pool for
+    auto* function = builder_.GetInsertBlock()->getParent();
+    auto* serial_block =
+        llvm::BasicBlock::Create(llvm_context, "serial", function);
+    auto* parallel_block = llvm::BasicBlock::Create(llvm_context, "parallel");
+    merge_block = llvm::BasicBlock::Create(llvm_context, "merge");
+    builder_.CreateCondBr(
+        builder_.CreateICmpSLT(count,
+                               builder_.getInt64(statement.get_min_count())),
+        serial_block, parallel_block);
+    builder_.SetInsertPoint(serial_block);
+    auto* serial_for = module_->getOrInsertFunction(
+        "ntrt_serial_for",
+        llvm::FunctionType::get(builder_.getVoidTy(),
+                                {int64_type, body_type->getPointerTo(),
+                                 builder_.getInt8PtrTy()},
+                                false));
+    builder_.CreateCall(serial_for, {count, body, context_pointer});
+    builder_.CreateBr(merge_block);
+    function->getBasicBlockList().push_back(parallel_block);
+    builder_.SetInsertPoint(parallel_block);
+  }
+  builder_.CreateCall(
+      parallel_for,
+      {count, builder_.getInt32(static_cast<int>(statement.get_schedule())),
+       chunk, body, context_pointer});
+  if (merge_block != nullptr) {
+    builder_.CreateBr(merge_block);
+    builder_.GetInsertBlock()->getParent()->getBasicBlockList().push_back(
+        merge_block);
+    builder_.SetInsertPoint(merge_block);
+  }
+  // the variable ends where the sequential loop would have left it
+  auto* last = builder_.CreateAdd(lo, builder_.CreateMul(count, step));
+  builder_.CreateStore(builder_.CreateTrunc(last, record->type), record->val);
+  return nullptr;
 }
 
-llvm::Value* CodeGenerator::visit(CharacterExpression& expr) {
-  return builder_.getInt8(static_cast<uint8_t>(expr.get_val()));
-}
+llvm::Function* CodeGenerator::emit_parallel_body(
+    ParallelForStatement& statement, const std::string& variable,
+    const std::vector<std::string>& captures, llvm::StructType* context_type) {
+  auto* int64_type = builder_.getInt64Ty();
+  auto* variable_type = symbol_table_.get_symbol(variable)->type;
+  std::vector<SymbolRecord> records;
+  for (auto& name : captures) {
+    records.push_back(*symbol_table_.get_symbol(name));
+  }
+  auto* function = llvm::Function::Create(
+      llvm::FunctionType::get(
+          builder_.getVoidTy(),
+          {builder_.getInt8PtrTy(), builder_.getInt8PtrTy()}, false),
+      llvm::Function::InternalLinkage,
+      cur_function_name_ + ".parallel." + std::to_string(parallel_loops_++),
+      module_.get());
+  function->addFnAttr(llvm::Attribute::NoUnwind);
+  auto* saved_block = builder_.GetInsertBlock();
+  auto saved_tail = cur_tail_;
+  auto* saved_return_block = cur_return_block;
+  bool saved_is_return_happened = is_return_happened;
+  auto* saved_scope = debug_scope_;
+  auto saved_location = builder_.getCurrentDebugLocation();
+  cur_tail_ = TailLoop();
+  cur_return_block = nullptr;
+  begin_debug_thunk(function);
 
-llvm::Value* CodeGenerator::visit(StringLiteralExpression& expr) {
-  return builder_.CreateGlobalStringPtr(expr.get_val());
+  auto* entry = llvm::BasicBlock::Create(llvm_context, "entry", function);
+  auto* next_block = llvm::BasicBlock::Create(llvm_context, "next", function);
+  auto* range_block = llvm::BasicBlock::Create(llvm_context, "range");
+  auto* loop_block = llvm::BasicBlock::Create(llvm_context, "loop");
+  auto* done_block = llvm::BasicBlock::Create(llvm_context, "done");
+  builder_.SetInsertPoint(entry);
+  auto* context = builder_.CreateBitCast(function->arg_begin(),
+                                         context_type->getPointerTo());
+  auto* loop = function->arg_begin() + 1;
+  symbol_table_.push_table();
+  auto* lo =
+      builder_.CreateLoad(builder_.CreateStructGEP(context_type, context, 0));
+  auto* step =
+      builder_.CreateLoad(builder_.CreateStructGEP(context_type, context, 1));
+  for (unsigned i = 0; i < captures.size(); ++i) {
+    auto* shared = builder_.CreateLoad(
+        builder_.CreateStructGEP(context_type, context, i + 2));
+    symbol_table_.add_symbol(captures[i], shared, records[i].type,
+                             records[i].is_const, records[i].is_array,
+                             records[i].is_atomic, records[i].is_unsigned);
+  }
+  std::vector<llvm::Value*> partials;
+  std::vector<bool> partials_unsigned;
+  for (auto& reduction : statement.get_reductions()) {
+    auto* record = symbol_table_.get_symbol(reduction.name);
+    partials_unsigned.push_back(record->is_unsigned);
+    auto* partial = builder_.CreateAlloca(record->type);
+    int identity = reduction.op == type::BinaryOp::ADD ? 0 : 1;
+    builder_.CreateStore(record->type->isDoubleTy()
+                             ? llvm::ConstantFP::get(record->type, identity)
+                             : llvm::ConstantInt::get(record->type, identity),
+                         partial);
+    partials.push_back(partial);
+  }
+  // the private copies shadow the shared variables inside the body
+  symbol_table_.push_table();
+  for (unsigned i = 0; i < partials.size(); ++i) {
+    auto& reduction = statement.get_reductions()[i];
+    symbol_table_.add_symbol(reduction.name, partials[i],
+                             partials[i]->getType()->getPointerElementType(),
+                             false, false, false, partials_unsigned[i]);
+  }
+  for (auto& name : statement.get_privates()) {
+    auto* shared = symbol_table_.get_symbol(name);
+    auto* type = shared->type;
+    symbol_table_.add_symbol(name, builder_.CreateAlloca(type), type, false,
+                             false, false, shared->is_unsigned);
+  }
+  auto* induction = builder_.CreateAlloca(variable_type);
+  symbol_table_.add_symbol(variable, induction, variable_type, false, false);
+  if (debug_builder_ != nullptr) {
+    emit_debug_variable(variable, induction,
+                        get_debug_type(variable_type, false),
+                        statement.get_range().begin_line);
+  }
+  auto* begin = builder_.CreateAlloca(int64_type);
+  auto* end = builder_.CreateAlloca(int64_type);
+  auto* index = builder_.CreateAlloca(int64_type);
+  builder_.CreateBr(next_block);
+
+  builder_.SetInsertPoint(next_block);
+  auto* loop_next = module_->getOrInsertFunction(
+      "ntrt_loop_next",
+      llvm::FunctionType::get(builder_.getInt32Ty(),
+                              {builder_.getInt8PtrTy(),
+                               int64_type->getPointerTo(),
+                               int64_type->getPointerTo()},
+                              false));
+  auto* more = builder_.CreateCall(loop_next, {loop, begin, end});
+  builder_.CreateCondBr(builder_.CreateICmpNE(more, builder_.getInt32(0)),
+                        range_block, done_block);
+
+  function->getBasicBlockList().push_back(range_block);
+  builder_.SetInsertPoint(range_block);
+  auto* first = builder_.CreateLoad(begin);
+  builder_.CreateStore(first, index);
+  builder_.CreateCondBr(
+      builder_.CreateICmpSLT(first, builder_.CreateLoad(end)), loop_block,
+      next_block);
+
+  function->getBasicBlockList().push_back(loop_block);
+  builder_.SetInsertPoint(loop_block);
+  auto* k = builder_.CreateLoad(index);
+  builder_.CreateStore(
+      builder_.CreateTrunc(
+          builder_.CreateAdd(lo, builder_.CreateMul(k, step)), variable_type),
+      induction);
+  is_return_happened = false;
+  statement.get_for_statement()->get_loop_statement()->accept(*this);
+  auto* k_next = builder_.CreateAdd(k, builder_.getInt64(1));
+  builder_.CreateStore(k_next, index);
+  builder_.CreateCondBr(
+      builder_.CreateICmpSLT(k_next, builder_.CreateLoad(end)), loop_block,
+      next_block);
+  symbol_table_.pop_table();
+
+  function->getBasicBlockList().push_back(done_block);
+  builder_.SetInsertPoint(done_block);
+  if (!partials.empty()) {
+    auto* void_function =
+        llvm::FunctionType::get(builder_.getVoidTy(), false);
+    builder_.CreateCall(
+        module_->getOrInsertFunction("ntrt_parallel_lock", void_function));
+    for (unsigned i = 0; i < partials.size(); ++i) {
+      auto& reduction = statement.get_reductions()[i];
+      auto* shared = symbol_table_.get_symbol(reduction.name)->val;
+      llvm::Value* total = builder_.CreateLoad(shared);
+      auto* partial = builder_.CreateLoad(partials[i]);
+      bool is_double = total->getType()->isDoubleTy();
+      if (reduction.op == type::BinaryOp::ADD) {
+        total = is_double ? builder_.CreateFAdd(total, partial)
+                          : builder_.CreateAdd(total, partial);
+      } else {
+        total = is_double ? builder_.CreateFMul(total, partial)
+                          : builder_.CreateMul(total, partial);
+      }
+      builder_.CreateStore(total, shared);
+    }
+    builder_.CreateCall(
+        module_->getOrInsertFunction("ntrt_parallel_unlock", void_function));
+  }
+  builder_.CreateRetVoid();
+  symbol_table_.pop_table();
+  llvm::verifyFunction(*function);
+
+  builder_.SetInsertPoint(saved_block);
+  builder_.SetCurrentDebugLocation(saved_location);
+  debug_scope_ = saved_scope;
+  cur_tail_ = saved_tail;
+  cur_return_block = saved_return_block;
+  is_return_happened = saved_is_return_happened;
+  return function;
 }
 
-llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
-  auto& lhs = expr.get_lhs();
-  auto op = expr.get_op_type();
-  auto& rhs = expr.get_rhs();
-  auto* rhs_val = rhs->accept(*this);
-  // special handle assign
-  if (op == type::BinaryOp::ASSIGN) {
-    Identifier* identifier = dynamic_cast<Identifier*>(lhs.get());
+void CodeGenerator::emit_spawn(SpawnExpression& spawn_expression,
+                               Identifier* target) {
+  auto& function_call = spawn_expression.get_function_call();
+  auto& argument_list = function_call->get_argument_list();
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call->get_target().get());
+  if (identifier == nullptr) {
+    codegen_error("cannot call on rvalue");
+  }
+  auto* callee = module_->getFunction(identifier->get_name());
+  if (callee == nullptr) {
+    codegen_error("spawn: invalid function: " + identifier->get_name());
+  }
+  if (callee->arg_size() != argument_list.size()) {
+    codegen_error("invalid argument number: " + identifier->get_name());
+  }
+  SymbolRecord* result = nullptr;
+  if (target != nullptr) {
+    result = symbol_table_.get_symbol(target->get_name());
+    if (result == nullptr) {
+      codegen_error("variable \'" + target->get_name() +
+                    "\' used before declared");
+    }
+    if (result->is_const || result->is_array) {
+      codegen_error("spawn: cannot assign to \'" + target->get_name() +
+                    "\'");
+    }
+    if (callee->getReturnType()->isVoidTy()) {
+      codegen_error("spawn: \'" + identifier->get_name() +
+                    "\' does not return a value");
+    }
+  }
+  auto args = emit_arguments(argument_list);
+  check_array_arguments(callee, argument_list);
+
+  // the task record lives in the spawning frame, which outlives the task
+  // because the frame syncs before it returns; spawns inside loops need a
+  // record per iteration, the next sync gives their stack back
+  std::vector<llvm::Type*> fields = {builder_.getInt8PtrTy(),
+                                     builder_.getInt8PtrTy()};
+  for (auto* arg : args) {
+    fields.push_back(arg->getType());
+  }
+  if (result != nullptr) {
+    fields.push_back(result->val->getType());
+  }
+  auto* task_type = llvm::StructType::get(llvm_context, fields);
+  llvm::AllocaInst* task = nullptr;
+  if (loop_depth_ > 0) {
+    auto* saved = builder_.CreateLoad(cur_task_stack_);
+    auto* stack = builder_.CreateCall(llvm::Intrinsic::getDeclaration(
+        module_.get(), llvm::Intrinsic::stacksave));
+    builder_.CreateStore(
+        builder_.CreateSelect(builder_.CreateIsNull(saved), stack, saved),
+        cur_task_stack_);
+    task = builder_.CreateAlloca(task_type);
+  } else {
+    task = create_entry_alloca(task_type);
+  }
+  for (unsigned i = 0; i < args.size(); ++i) {
+    builder_.CreateStore(args[i],
+                         builder_.CreateStructGEP(task_type, task, i + 2));
+  }
+  if (result != nullptr) {
+    builder_.CreateStore(
+        result->val,
+        builder_.CreateStructGEP(task_type, task, args.size() + 2));
+  }
+
+  auto* saved_block = builder_.GetInsertBlock();
+  auto* thunk = llvm::Function::Create(
+      llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt8PtrTy()},
+                              false),
+      llvm::Function::InternalLinkage,
+      cur_function_name_ + ".spawn." + std::to_string(spawns_++),
+      module_.get());
+  thunk->addFnAttr(llvm::Attribute::NoUnwind);
+  auto* saved_scope = debug_scope_;
+  auto saved_location = builder_.getCurrentDebugLocation();
+  begin_debug_thunk(thunk);
+  builder_.SetInsertPoint(
+      llvm::BasicBlock::Create(llvm_context, "entry", thunk));
+  auto* record =
+      builder_.CreateBitCast(thunk->arg_begin(), task_type->getPointerTo());
+  std::vector<llvm::Value*> thunk_args;
+  for (unsigned i = 0; i < args.size(); ++i) {
+    thunk_args.push_back(builder_.CreateLoad(
+        builder_.CreateStructGEP(task_type, record, i + 2)));
+  }
+  llvm::Value* value = builder_.CreateCall(callee, thunk_args);
+  if (result != nullptr) {
+    auto* lhs_type = result->val->getType()->getPointerElementType();
+    bool is_unsigned = unsigned_functions_.count(callee->getName().str()) != 0;
+    assignment_type_check(lhs_type, value->getType(), &value, is_unsigned);
+    builder_.CreateStore(
+        value, builder_.CreateLoad(builder_.CreateStructGEP(
+                   task_type, record, args.size() + 2)));
+  }
+  builder_.CreateRetVoid();
+  llvm::verifyFunction(*thunk);
+  builder_.SetInsertPoint(saved_block);
+  builder_.SetCurrentDebugLocation(saved_location);
+  debug_scope_ = saved_scope;
+
+  builder_.CreateStore(
+      builder_.CreateBitCast(thunk, builder_.getInt8PtrTy()),
+      builder_.CreateStructGEP(task_type, task, 0));
+  auto* spawn = module_->getOrInsertFunction(
+      "ntrt_spawn",
+      llvm::FunctionType::get(
+          builder_.getVoidTy(),
+          {builder_.getInt8PtrTy(), builder_.getInt8PtrTy()}, false));
+  builder_.CreateCall(
+      spawn, {builder_.CreateBitCast(task, builder_.getInt8PtrTy()),
+              builder_.CreateBitCast(cur_task_group_,
+                                     builder_.getInt8PtrTy())});
+}
+
+void CodeGenerator::emit_sync() {
+  if (cur_task_group_ == nullptr) {
+    return;
+  }
+  auto* sync = module_->getOrInsertFunction(
+      "ntrt_sync", llvm::FunctionType::get(builder_.getVoidTy(),
+                                           {builder_.getInt8PtrTy()}, false));
+  builder_.CreateCall(
+      sync, {builder_.CreateBitCast(cur_task_group_, builder_.getInt8PtrTy())});
+  // every task has finished, so the records spawns in loops allocated are
+  // dead
+  auto* function = builder_.GetInsertBlock()->getParent();
+  auto* restore_block =
+      llvm::BasicBlock::Create(llvm_context, "sync.restore", function);
+  auto* done_block =
+      llvm::BasicBlock::Create(llvm_context, "sync.done", function);
+  auto* stack = builder_.CreateLoad(cur_task_stack_);
+  builder_.CreateCondBr(builder_.CreateIsNull(stack), done_block,
+                        restore_block);
+  builder_.SetInsertPoint(restore_block);
+  builder_.CreateCall(llvm::Intrinsic::getDeclaration(
+                          module_.get(), llvm::Intrinsic::stackrestore),
+                      {stack});
+  builder_.CreateStore(llvm::ConstantPointerNull::get(builder_.getInt8PtrTy()),
+                       cur_task_stack_);
+  builder_.CreateBr(done_block);
+  builder_.SetInsertPoint(done_block);
+}
+
+llvm::Value* CodeGenerator::visit(Expression& expression) {
+  return llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 10);
+}
+
+llvm::Value* CodeGenerator::visit(IntegerExpression& expr) {
+  return llvm::ConstantInt::getSigned(builder_.getInt32Ty(), expr.get_val());
+}
+
+llvm::Value* CodeGenerator::visit(FloatExpression& expr) {
+  return llvm::ConstantFP::get(builder_.getDoubleTy(), expr.get_val());
+}
+
+llvm::Value* CodeGenerator::visit(BooleanExpression& expr) {
+  return expr.get_val() ? builder_.getInt1(1) : builder_.getInt1(0);
+}
+
+llvm::Value* CodeGenerator::visit(CharacterExpression& expr) {
+  return builder_.getInt8(static_cast<uint8_t>(expr.get_val()));
+}
+
+llvm::Value* CodeGenerator::visit(StringLiteralExpression& expr) {
+  return builder_.CreateGlobalStringPtr(expr.get_val());
+}
+
+llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
+  set_debug_location(expr);
+  auto& lhs = expr.get_lhs();
+  auto op = expr.get_op_type();
+  auto& rhs = expr.get_rhs();
+  auto* rhs_val = rhs->accept(*this);
+  // special handle assign
+  if (op == type::BinaryOp::ASSIGN) {
+    Identifier* identifier = dynamic_cast<Identifier*>(lhs.get());
     ArrayReference* arr_ref = dynamic_cast<ArrayReference*>(lhs.get());
     if (identifier == nullptr && arr_ref == nullptr) {
       codegen_error("cannot assign value to rvalue");
@@ -476,14 +1683,17 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
         codegen_error("cannot assign to a const variable \'" +
                       identifier->get_name() + "\'");
       }
+      if (record->is_array) {
+        codegen_error("cannot assign to an array \'" +
+                      identifier->get_name() + "\'");
+      }
       auto* lhs_type = lhs_val->getType()->getPointerElementType();
-      auto* rhs_type = rhs_val->getType();
-      if (lhs_type->isDoubleTy() && rhs_type->isIntegerTy(32)) {
-        rhs_val = builder_.CreateSIToFP(rhs_val, builder_.getDoubleTy());
-        rhs_type = rhs_val->getType();
+      assignment_type_check(lhs_type, rhs_val->getType(), &rhs_val,
+                            is_unsigned(*rhs));
+      store_symbol(rhs_val, lhs_val, *record);
+      if (record->is_unsigned) {
+        unsigned_.insert(&expr);
       }
-      assignment_type_check(lhs_type, rhs_type, &rhs_val);
-      builder_.CreateStore(rhs_val, lhs_val);
       return rhs_val;
     } else if (arr_ref) {
       auto* lhs_val = get_array_reference_ptr(arr_ref);
@@ -497,13 +1707,12 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
                       "\'");
       }
       auto* lhs_type = lhs_val->getType()->getPointerElementType();
-      auto* rhs_type = rhs_val->getType();
-      if (lhs_type->isDoubleTy() && rhs_type->isIntegerTy(32)) {
-        rhs_val = builder_.CreateSIToFP(rhs_val, builder_.getDoubleTy());
-        rhs_type = rhs_val->getType();
+      assignment_type_check(lhs_type, rhs_val->getType(), &rhs_val,
+                            is_unsigned(*rhs));
+      store_symbol(rhs_val, lhs_val, *record);
+      if (record->is_unsigned) {
+        unsigned_.insert(&expr);
       }
-      assignment_type_check(lhs_type, rhs_type, &rhs_val);
-      builder_.CreateStore(rhs_val, lhs_val);
       return rhs_val;
     } else {
       codegen_error("fatal");
@@ -514,6 +1723,9 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
   auto* lhs_val = lhs->accept(*this);
   auto* lhs_type = lhs_val->getType();
   auto* rhs_type = rhs_val->getType();
+  if (lhs_type->isVectorTy() || rhs_type->isVectorTy()) {
+    return vector_binary_operation(op, lhs_val, rhs_val);
+  }
   // bool
   if (lhs_type->isIntegerTy(1) && rhs_type->isIntegerTy(1)) {
     llvm::CmpInst::Predicate cmp;
@@ -533,11 +1745,16 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
     llvm::Instruction::BinaryOps binop;
     switch (op) {
       case type::BinaryOp::LOGIC_AND:
+      case type::BinaryOp::BIT_AND:
         binop = llvm::Instruction::And;
         break;
       case type::BinaryOp::LOGIC_OR:
+      case type::BinaryOp::BIT_OR:
         binop = llvm::Instruction::Or;
         break;
+      case type::BinaryOp::BIT_XOR:
+        binop = llvm::Instruction::Xor;
+        break;
       default:
         codegen_error("type error: boolean " + to_string(op) + " boolean");
     }
@@ -586,7 +1803,10 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
       lhs_val_tmp = builder_.CreateFPCast(lhs_val, builder_.getDoubleTy());
     } else if (lhs_type->isIntegerTy(16) || lhs_type->isIntegerTy(32) ||
                lhs_type->isIntegerTy(64)) {
-      lhs_val_tmp = builder_.CreateSIToFP(lhs_val, builder_.getDoubleTy());
+      lhs_val_tmp =
+          is_unsigned(*lhs)
+              ? builder_.CreateUIToFP(lhs_val, builder_.getDoubleTy())
+              : builder_.CreateSIToFP(lhs_val, builder_.getDoubleTy());
     } else if (lhs_type->isDoubleTy()) {
       ;
     } else {
@@ -596,7 +1816,10 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
       rhs_val_tmp = builder_.CreateFPCast(rhs_val, builder_.getDoubleTy());
     } else if (rhs_type->isIntegerTy(16) || rhs_type->isIntegerTy(32) ||
                lhs_type->isIntegerTy(64)) {
-      rhs_val_tmp = builder_.CreateSIToFP(rhs_val, builder_.getDoubleTy());
+      rhs_val_tmp =
+          is_unsigned(*rhs)
+              ? builder_.CreateUIToFP(rhs_val, builder_.getDoubleTy())
+              : builder_.CreateSIToFP(rhs_val, builder_.getDoubleTy());
     } else if (rhs_type->isDoubleTy()) {
       ;
     } else {
@@ -654,32 +1877,61 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
        lhs_type->isIntegerTy(64)) &&
       (rhs_type->isIntegerTy(16) || rhs_type->isIntegerTy(32) ||
        rhs_type->isIntegerTy(64))) {
+    bool lhs_unsigned = is_unsigned(*lhs);
+    bool rhs_unsigned = is_unsigned(*rhs);
     llvm::Value* lhs_val_tmp = lhs_val;
     llvm::Value* rhs_val_tmp = rhs_val;
-    if (lhs_type->isIntegerTy(64) || rhs_type->isIntegerTy(64)) {
+    if (op == type::BinaryOp::SHIFT_LEFT || op == type::BinaryOp::SHIFT_RIGHT) {
+      // the result has the type of the promoted lhs, the shift amount is
+      // brought to the same width
+      auto* result_type = lhs_type->isIntegerTy(64) ? builder_.getInt64Ty()
+                                                     : builder_.getInt32Ty();
+      lhs_val_tmp = builder_.CreateIntCast(lhs_val, result_type, !lhs_unsigned);
+      rhs_val_tmp = builder_.CreateIntCast(rhs_val, result_type, !rhs_unsigned);
+      if (lhs_unsigned) {
+        unsigned_.insert(&expr);
+      }
+      if (op == type::BinaryOp::SHIFT_LEFT) {
+        return builder_.CreateShl(lhs_val_tmp, rhs_val_tmp);
+      }
+      return lhs_unsigned ? builder_.CreateLShr(lhs_val_tmp, rhs_val_tmp)
+                          : builder_.CreateAShr(lhs_val_tmp, rhs_val_tmp);
+    }
+    // C's usual arithmetic conversions: unsigned wins over a signed operand
+    // of the same width, long holds every unsigned int
+    unsigned lhs_width = lhs_type->getIntegerBitWidth();
+    unsigned rhs_width = rhs_type->getIntegerBitWidth();
+    unsigned width = std::max(std::max(lhs_width, rhs_width), 32u);
+    bool is_unsigned_op = (lhs_unsigned && lhs_width == width) ||
+                          (rhs_unsigned && rhs_width == width);
+    if (width == 64) {
       lhs_val_tmp =
-          builder_.CreateIntCast(lhs_val, builder_.getInt64Ty(), true);
+          builder_.CreateIntCast(lhs_val, builder_.getInt64Ty(), !lhs_unsigned);
       rhs_val_tmp =
-          builder_.CreateIntCast(rhs_val, builder_.getInt64Ty(), true);
+          builder_.CreateIntCast(rhs_val, builder_.getInt64Ty(), !rhs_unsigned);
     } else if (lhs_type->isIntegerTy(32) || rhs_type->isIntegerTy(32)) {
       lhs_val_tmp =
-          builder_.CreateIntCast(lhs_val, builder_.getInt32Ty(), true);
+          builder_.CreateIntCast(lhs_val, builder_.getInt32Ty(), !lhs_unsigned);
       rhs_val_tmp =
-          builder_.CreateIntCast(rhs_val, builder_.getInt32Ty(), true);
+          builder_.CreateIntCast(rhs_val, builder_.getInt32Ty(), !rhs_unsigned);
     }
     llvm::CmpInst::Predicate cmp;
     switch (op) {
       case type::BinaryOp::LESS:
-        cmp = llvm::CmpInst::ICMP_SLT;
+        cmp = is_unsigned_op ? llvm::CmpInst::ICMP_ULT
+                             : llvm::CmpInst::ICMP_SLT;
         break;
       case type::BinaryOp::GREATER:
-        cmp = llvm::CmpInst::ICMP_SGT;
+        cmp = is_unsigned_op ? llvm::CmpInst::ICMP_UGT
+                             : llvm::CmpInst::ICMP_SGT;
         break;
       case type::BinaryOp::LESS_EQUAL:
-        cmp = llvm::CmpInst::ICMP_SLE;
+        cmp = is_unsigned_op ? llvm::CmpInst::ICMP_ULE
+                             : llvm::CmpInst::ICMP_SLE;
         break;
       case type::BinaryOp::GREATER_EQUAL:
-        cmp = llvm::CmpInst::ICMP_SGE;
+        cmp = is_unsigned_op ? llvm::CmpInst::ICMP_UGE
+                             : llvm::CmpInst::ICMP_SGE;
         break;
       case type::BinaryOp::EQUAL:
         cmp = llvm::CmpInst::ICMP_EQ;
@@ -705,15 +1957,29 @@ llvm::Value* CodeGenerator::visit(BinaryOperationExpression& expr) {
         binop = llvm::Instruction::Mul;
         break;
       case type::BinaryOp::DIV:
-        binop = llvm::Instruction::SDiv;
+        binop = is_unsigned_op ? llvm::Instruction::UDiv
+                               : llvm::Instruction::SDiv;
         break;
       case type::BinaryOp::MOD:
-        binop = llvm::Instruction::SRem;
+        binop = is_unsigned_op ? llvm::Instruction::URem
+                               : llvm::Instruction::SRem;
+        break;
+      case type::BinaryOp::BIT_AND:
+        binop = llvm::Instruction::And;
+        break;
+      case type::BinaryOp::BIT_XOR:
+        binop = llvm::Instruction::Xor;
+        break;
+      case type::BinaryOp::BIT_OR:
+        binop = llvm::Instruction::Or;
         break;
       default:
         codegen_error("integer point arithmetic: unsupported op: " +
                       to_string(op));
     }
+    if (is_unsigned_op) {
+      unsigned_.insert(&expr);
+    }
     return builder_.CreateBinOp(binop, lhs_val_tmp, rhs_val_tmp);
   }
 
@@ -749,15 +2015,37 @@ llvm::Value* CodeGenerator::visit(UnaryOperationExpression& expr) {
     }
   } else if (type->isIntegerTy(16) || type->isIntegerTy(32) ||
              type->isIntegerTy(64)) {
+    if (is_unsigned(*operand)) {
+      unsigned_.insert(&expr);
+    }
     switch (op) {
       case type::UnaryOp::POSITIVIZE:
         return val;
       case type::UnaryOp::NEGATE:
         return builder_.CreateNeg(val);
+      case type::UnaryOp::BIT_NOT:
+        return builder_.CreateNot(val);
       default:
         codegen_error("unary operation: unsupported op: " + to_string(op) +
                       " for integer");
     }
+  } else if (type->isVectorTy()) {
+    switch (op) {
+      case type::UnaryOp::POSITIVIZE:
+        return val;
+      case type::UnaryOp::NEGATE:
+        return type->getScalarType()->isFloatingPointTy()
+                   ? builder_.CreateFNeg(val)
+                   : builder_.CreateNeg(val);
+      case type::UnaryOp::BIT_NOT:
+        if (type->getScalarType()->isFloatingPointTy()) {
+          codegen_error("unary operation: ~ needs integer lanes");
+        }
+        return builder_.CreateNot(val);
+      default:
+        codegen_error("unary operation: unsupported op: " + to_string(op) +
+                      " for vector");
+    }
   }
   codegen_error("unary operation: type incompatible");
   return nullptr;
@@ -769,29 +2057,26 @@ llvm::Value* CodeGenerator::visit(ConditionalExpression&) {
 }
 
 llvm::Value* CodeGenerator::visit(FunctionCall& function_call) {
+  set_debug_location(function_call);
   auto& target = function_call.get_target();
   auto& argument_list = function_call.get_argument_list();
   Identifier* identifier = dynamic_cast<Identifier*>(target.get());
-  std::vector<llvm::Value*> args;
-  for (auto& arg : argument_list) {
-    llvm::Value* val = nullptr;
-    Identifier* ident_tmp = dynamic_cast<Identifier*>(arg.get());
-    if (ident_tmp) {
-      auto* record = symbol_table_.get_symbol(ident_tmp->get_name());
-      auto* ptr = get_identifier_ptr(ident_tmp);
-      if (record->is_array) {
-        std::vector<llvm::Value*> idx;
-        idx.push_back(llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 0));
-        idx.push_back(llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 0));
-        val = builder_.CreateInBoundsGEP(ptr, idx);
-      } else {
-        val = builder_.CreateLoad(ptr);
-      }
-    } else {
-      val = arg->accept(*this);
+  // builtins whose arguments are not plain values
+  if (identifier != nullptr) {
+    if (auto* value = atomic_call(identifier->get_name(), argument_list)) {
+      return value;
+    }
+    if (identifier->get_name() == "thread_spawn") {
+      return thread_spawn_call(argument_list);
+    }
+    if (auto* value = hint_call(identifier->get_name(), argument_list)) {
+      return value;
+    }
+    if (auto* value = trace_call(identifier->get_name(), argument_list)) {
+      return value;
     }
-    args.push_back(val);
   }
+  auto args = emit_arguments(argument_list);
   if (identifier == nullptr) {
     codegen_error("cannot call on rvalue");
   }
@@ -802,7 +2087,7 @@ llvm::Value* CodeGenerator::visit(FunctionCall& function_call) {
     if (args.size() > 1) {
       codegen_error("print: too many arguments");
     }
-    return print_call(args[0], false);
+    return print_call(args[0], false, is_unsigned(*(argument_list[0])));
   };
   if (identifier->get_name() == "println") {
     if (args.size() < 1) {
@@ -811,7 +2096,7 @@ llvm::Value* CodeGenerator::visit(FunctionCall& function_call) {
     if (args.size() > 1) {
       codegen_error("println: too many arguments");
     }
-    return print_call(args[0], true);
+    return print_call(args[0], true, is_unsigned(*(argument_list[0])));
   };
   if (identifier->get_name() == "input") {
     if (args.size() < 1) {
@@ -822,36 +2107,176 @@ llvm::Value* CodeGenerator::visit(FunctionCall& function_call) {
     }
     return input_call(*(argument_list[0]));
   };
+  if (auto* value = vector_call(identifier->get_name(), args)) {
+    return value;
+  }
+  if (auto* value = math_call(identifier->get_name(), args)) {
+    return value;
+  }
+  if (auto* value = bit_call(identifier->get_name(), args)) {
+    if (!argument_list.empty() && is_unsigned(*(argument_list[0]))) {
+      unsigned_.insert(&function_call);
+    }
+    return value;
+  }
+  if (identifier->get_name() == "thread_join") {
+    if (args.size() != 1) {
+      codegen_error("thread_join: expects a thread");
+    }
+    if (!args[0]->getType()->isIntegerTy(64)) {
+      codegen_error("thread_join: the thread must be a long");
+    }
+    auto* join = module_->getOrInsertFunction(
+        "ntrt_thread_join",
+        llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt64Ty()},
+                                false));
+    return builder_.CreateCall(join, args);
+  }
 
   auto* function = module_->getFunction(identifier->get_name());
   if (function == nullptr) {
     codegen_error("invalid function: " + identifier->get_name());
   }
+  if (unsigned_functions_.count(identifier->get_name()) != 0) {
+    unsigned_.insert(&function_call);
+  }
+  auto c_function = c_functions_.find(identifier->get_name());
+  if (c_function != c_functions_.end()) {
+    if (c_function->second.size() != argument_list.size()) {
+      codegen_error("invalid argument number: " + identifier->get_name());
+    }
+    auto* call = builder_.CreateCall(
+        function, add_array_lengths(identifier->get_name(), c_function->second,
+                                    argument_list, args));
+    // the extensions the callee expects
+    call->setAttributes(function->getAttributes());
+    return call;
+  }
 
   if (function->arg_size() != argument_list.size()) {
     codegen_error("invalid argument number: " + identifier->get_name());
   }
+  check_array_arguments(function, argument_list);
   return builder_.CreateCall(function, args);
 }
 
+std::vector<llvm::Value*> CodeGenerator::emit_arguments(
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  std::vector<llvm::Value*> args;
+  for (auto& arg : arguments) {
+    llvm::Value* val = nullptr;
+    Identifier* ident_tmp = dynamic_cast<Identifier*>(arg.get());
+    if (ident_tmp) {
+      auto* record = symbol_table_.get_symbol(ident_tmp->get_name());
+      auto* ptr = get_identifier_ptr(ident_tmp);
+      if (record->is_array &&
+          ptr->getType()->getPointerElementType()->isArrayTy()) {
+        std::vector<llvm::Value*> idx;
+        idx.push_back(llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 0));
+        idx.push_back(llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 0));
+        val = builder_.CreateInBoundsGEP(ptr, idx);
+      } else if (record->is_array) {
+        val = ptr;
+      } else {
+        if (record->is_unsigned) {
+          unsigned_.insert(ident_tmp);
+        }
+        val = load_symbol(ptr, *record);
+      }
+    } else {
+      val = arg->accept(*this);
+    }
+    args.push_back(val);
+  }
+  return args;
+}
+
+llvm::Value* CodeGenerator::visit(SpawnExpression&) {
+  codegen_error("spawn must be a statement or the value of an assignment");
+  return nullptr;
+}
+
 llvm::Value* CodeGenerator::visit(ArrayReference& array_reference) {
-  return builder_.CreateLoad(get_array_reference_ptr(&array_reference));
+  auto* ptr = get_array_reference_ptr(&array_reference);
+  auto* identifier =
+      static_cast<Identifier*>(array_reference.get_target().get());
+  auto* record = symbol_table_.get_symbol(identifier->get_name());
+  if (record->is_unsigned) {
+    unsigned_.insert(&array_reference);
+  }
+  return load_symbol(ptr, *record);
 }
 
 void CodeGenerator::output(const std::string& filename, ProgramMode mode) {
+  if (!config_.remarks_file.empty()) {
+    open_remarks_file();
+  }
+  if (config_.shared_library) {
+    hide_functions();
+  }
+  optimize();
+  // --run leaves the module to run()
+  if (mode == ProgramMode::EMIT_EXECUTABLE) {
+    emit_executable(filename);
+  } else if (mode != ProgramMode::RUN) {
+    std::error_code ec;
+    llvm::raw_fd_ostream fd(filename, ec, llvm::sys::fs::F_None);
+    if (mode == ProgramMode::EMIT_LLVM_IR) {
+      module_->print(fd, nullptr);
+    } else if (mode == ProgramMode::EMIT_ASSEMBLY) {
+      emit_code(fd, llvm::TargetMachine::CGFT_AssemblyFile);
+    } else if (mode == ProgramMode::EMIT_OBJECT) {
+      emit_code(fd, llvm::TargetMachine::CGFT_ObjectFile);
+    } else if (mode == ProgramMode::EMIT_BITCODE) {
+      llvm::WriteBitcodeToFile(*module_, fd);
+    }
+  }
+  if (remarks_file_ != nullptr) {
+    close_remarks_file();
+  }
+}
+
+void CodeGenerator::emit_executable(const std::string& filename) {
+  llvm::SmallString<128> object_filename;
+  int fd;
+  auto ec = llvm::sys::fs::createTemporaryFile("ntc", "o", fd, object_filename);
+  if (ec) {
+    codegen_error("cannot create a temporary object file: " + ec.message());
+  }
+  // removed again however the link ends
+  llvm::FileRemover remover(object_filename);
+  {
+    llvm::raw_fd_ostream object(fd, true);
+    emit_code(object, llvm::TargetMachine::CGFT_ObjectFile);
+  }
+  link_microseconds_ =
+      link_executable(object_filename.str().str(), filename, config_);
+}
+
+int CodeGenerator::run() {
+  return run_module(std::move(module_), std::move(target_machine_), config_);
+}
+
+void CodeGenerator::open_remarks_file() {
   std::error_code ec;
-  llvm::raw_fd_ostream fd(filename, ec, llvm::sys::fs::F_None);
-  if (mode == ProgramMode::EMIT_LLVM_IR) {
-    module_->print(fd, nullptr);
-  } else if (mode == ProgramMode::EMIT_ASSEMBLY) {
-    emit_code(fd, llvm::TargetMachine::CGFT_AssemblyFile);
-  } else if (mode == ProgramMode::EMIT_OBJECT) {
-    emit_code(fd, llvm::TargetMachine::CGFT_ObjectFile);
+  remarks_file_ = std::make_unique<llvm::ToolOutputFile>(
+      config_.remarks_file, ec, llvm::sys::fs::F_None);
+  if (ec) {
+    codegen_error("cannot write remarks to \'" + config_.remarks_file +
+                  "\': " + ec.message());
   }
+  llvm_context.setDiagnosticsOutputFile(
+      std::make_unique<llvm::yaml::Output>(remarks_file_->os()));
 }
 
-void CodeGenerator::emit_code(llvm::raw_fd_ostream& fd,
-                              llvm::TargetMachine::CodeGenFileType type) {
+void CodeGenerator::close_remarks_file() {
+  // the context outlives the file
+  llvm_context.setDiagnosticsOutputFile(nullptr);
+  remarks_file_->keep();
+  remarks_file_.reset();
+}
+
+void CodeGenerator::create_target_machine() {
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargets();
   llvm::InitializeAllTargetMCs();
@@ -865,16 +2290,74 @@ void CodeGenerator::emit_code(llvm::raw_fd_ostream& fd,
   if (!target) {
     codegen_error(error);
   }
-  auto cpu = "generic";
-  auto features = "";
+  auto cpu = config_.target_cpu;
+  std::string features;
+  if (cpu == "native") {
+    cpu = llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> host_features;
+    if (llvm::sys::getHostCPUFeatures(host_features)) {
+      for (auto& feature : host_features) {
+        features += (feature.second ? "+" : "-") + feature.first().str() + ",";
+      }
+    }
+  }
   llvm::TargetOptions opt;
   auto rm = llvm::Optional<llvm::Reloc::Model>();
-  auto target_machine =
-      target->createTargetMachine(target_triple, cpu, features, opt, rm);
-  module_->setDataLayout(target_machine->createDataLayout());
+  if (config_.shared_library) {
+    rm = llvm::Reloc::PIC_;
+    module_->setPICLevel(llvm::PICLevel::BigPIC);
+  }
+  auto codegen_level = config_.opt_level == 3 ? llvm::CodeGenOpt::Aggressive
+                                              : llvm::CodeGenOpt::Default;
+  // the JIT picks a code model that reaches the runtime from anywhere
+  bool jit = config_.mode == ProgramMode::RUN;
+  target_machine_.reset(target->createTargetMachine(
+      target_triple, cpu, features, opt, rm, llvm::None, codegen_level, jit));
+  module_->setDataLayout(target_machine_->createDataLayout());
+}
+
+void CodeGenerator::optimize() {
+  if (config_.opt_level == 0) {
+    return;
+  }
+  llvm::PassManagerBuilder pass_builder;
+  pass_builder.OptLevel = config_.opt_level;
+  pass_builder.SizeLevel = 0;
+  pass_builder.Inliner =
+      llvm::createFunctionInliningPass(config_.opt_level, 0, false);
+  pass_builder.LoopVectorize = config_.opt_level > 1;
+  pass_builder.SLPVectorize = config_.opt_level > 1;
+  // the link optimizes again, across files
+  pass_builder.PrepareForLTO = config_.mode == ProgramMode::EMIT_BITCODE;
+  target_machine_->adjustPassManager(pass_builder);
+  // owned by pass_builder
+  pass_builder.LibraryInfo = new llvm::TargetLibraryInfoImpl(
+      llvm::Triple(module_->getTargetTriple()));
+  if (config_.opt_level == 3 && config_.target_cpu != "generic") {
+    add_vector_library(*pass_builder.LibraryInfo);
+  }
+
+  llvm::legacy::FunctionPassManager function_pass(module_.get());
+  llvm::legacy::PassManager module_pass;
+  function_pass.add(llvm::createTargetTransformInfoWrapperPass(
+      target_machine_->getTargetIRAnalysis()));
+  module_pass.add(llvm::createTargetTransformInfoWrapperPass(
+      target_machine_->getTargetIRAnalysis()));
+  pass_builder.populateFunctionPassManager(function_pass);
+  pass_builder.populateModulePassManager(module_pass);
+
+  function_pass.doInitialization();
+  for (auto& function : *module_) {
+    function_pass.run(function);
+  }
+  function_pass.doFinalization();
+  module_pass.run(*module_);
+}
 
+void CodeGenerator::emit_code(llvm::raw_fd_ostream& fd,
+                              llvm::TargetMachine::CodeGenFileType type) {
   llvm::legacy::PassManager pass;
-  if (target_machine->addPassesToEmitFile(pass, fd, nullptr, type)) {
+  if (target_machine_->addPassesToEmitFile(pass, fd, nullptr, type)) {
     codegen_error("codegeneration failed");
   }
   pass.run(*module_);
@@ -894,8 +2377,10 @@ llvm::Type* CodeGenerator::get_llvm_type(
     case type::Specifier::FLOAT:
       return builder_.getFloatTy();
     case type::Specifier::INT:
+    case type::Specifier::UINT:
       return builder_.getInt32Ty();
     case type::Specifier::LONG:
+    case type::Specifier::ULONG:
       return builder_.getInt64Ty();
     case type::Specifier::SHORT:
       return builder_.getInt16Ty();
@@ -903,12 +2388,36 @@ llvm::Type* CodeGenerator::get_llvm_type(
       return builder_.getVoidTy();
     case type::Specifier::STRING:
       return builder_.getInt8PtrTy();
+    case type::Specifier::INT4:
+      return llvm::VectorType::get(builder_.getInt32Ty(), 4);
+    case type::Specifier::INT8:
+      return llvm::VectorType::get(builder_.getInt32Ty(), 8);
+    case type::Specifier::LONG2:
+      return llvm::VectorType::get(builder_.getInt64Ty(), 2);
+    case type::Specifier::LONG4:
+      return llvm::VectorType::get(builder_.getInt64Ty(), 4);
+    case type::Specifier::FLOAT4:
+      return llvm::VectorType::get(builder_.getFloatTy(), 4);
+    case type::Specifier::FLOAT8:
+      return llvm::VectorType::get(builder_.getFloatTy(), 8);
+    case type::Specifier::DOUBLE2:
+      return llvm::VectorType::get(builder_.getDoubleTy(), 2);
+    case type::Specifier::DOUBLE4:
+      return llvm::VectorType::get(builder_.getDoubleTy(), 4);
     case type::Specifier::UNDEFINED:
     default:
       return nullptr;
   }
 }
 
+llvm::AllocaInst* CodeGenerator::create_entry_alloca(llvm::Type* type) {
+  // slots in the entry block are allocated once per call, also inside loops
+  // and tail recursion, and are what mem2reg promotes
+  auto& entry = builder_.GetInsertBlock()->getParent()->getEntryBlock();
+  llvm::IRBuilder<> builder(&entry, entry.begin());
+  return builder.CreateAlloca(type);
+}
+
 llvm::Value* CodeGenerator::get_identifier_ptr(Identifier* identifier) {
   if (symbol_table_.find_symbol(identifier->get_name())) {
     return symbol_table_.get_symbol(identifier->get_name())->val;
@@ -942,9 +2451,12 @@ llvm::Value* CodeGenerator::get_array_reference_ptr(
   }
 
   idx_value = builder_.CreateIntCast(idx_value, builder_.getInt32Ty(), true);
-  if (ptr_type->isArrayTy()) {
+  // lanes of a vector are indexed like array elements
+  if (ptr_type->isArrayTy() || ptr_type->isVectorTy()) {
     idx.push_back(llvm::ConstantInt::getSigned(builder_.getInt32Ty(), 0));
-  } else {
+  } else if (!symbol_table_.get_symbol(identifier->get_name())->is_array) {
+    // strings keep their pointer in a stack slot, array parameters are the
+    // pointer itself
     arr = builder_.CreateLoad(arr);
   }
   idx.push_back(idx_value);
@@ -952,17 +2464,87 @@ llvm::Value* CodeGenerator::get_array_reference_ptr(
   return builder_.CreateInBoundsGEP(arr, idx);
 }
 
+void CodeGenerator::add_array_parameter_attributes(llvm::Function* function,
+                                                   unsigned index,
+                                                   llvm::Type* element_type,
+                                                   int length,
+                                                   bool is_restrict) {
+  auto& data_layout = module_->getDataLayout();
+  auto& context = module_->getContext();
+  if (length > 0) {
+    uint64_t bytes = data_layout.getTypeAllocSize(element_type) * length;
+    function->addParamAttr(
+        index, llvm::Attribute::getWithDereferenceableBytes(context, bytes));
+  }
+  // callers only pass whole arrays, which are allocated with the natural
+  // alignment of their element type
+  function->addParamAttr(
+      index, llvm::Attribute::getWithAlignment(
+                 context, data_layout.getABITypeAlignment(element_type)));
+  if (is_restrict) {
+    function->addParamAttr(index, llvm::Attribute::NoAlias);
+  }
+}
+
+void CodeGenerator::check_array_arguments(
+    llvm::Function* function,
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  auto& data_layout = module_->getDataLayout();
+  for (unsigned i = 0; i < arguments.size(); ++i) {
+    Identifier* identifier = dynamic_cast<Identifier*>(arguments[i].get());
+    if (identifier == nullptr) {
+      continue;
+    }
+    auto* record = symbol_table_.get_symbol(identifier->get_name());
+    if (record == nullptr || !record->is_array) {
+      continue;
+    }
+    uint64_t required = function->getParamDereferenceableBytes(i);
+    uint64_t available = 0;
+    auto* pointee = record->val->getType()->getPointerElementType();
+    if (auto* argument = llvm::dyn_cast<llvm::Argument>(record->val)) {
+      available = argument->getDereferenceableBytes();
+    } else if (pointee->isArrayTy()) {
+      available = data_layout.getTypeAllocSize(pointee);
+    }
+    if (available != 0 && available < required) {
+      codegen_error("array \'" + identifier->get_name() +
+                    "\' is shorter than parameter " + std::to_string(i + 1) +
+                    " of \'" + function->getName().str() + "\'");
+    }
+    if (!function->hasParamAttribute(i, llvm::Attribute::NoAlias)) {
+      continue;
+    }
+    for (unsigned j = 0; j < arguments.size(); ++j) {
+      Identifier* other = dynamic_cast<Identifier*>(arguments[j].get());
+      if (j != i && other != nullptr &&
+          other->get_name() == identifier->get_name()) {
+        codegen_error("array \'" + identifier->get_name() +
+                      "\' is passed to restrict parameter " +
+                      std::to_string(i + 1) + " of \'" +
+                      function->getName().str() + "\' more than once");
+      }
+    }
+  }
+}
+
 bool CodeGenerator::get_const(DeclarationSpecifier& declaration_specifier) {
   return declaration_specifier.get_is_const();
 }
 
+bool CodeGenerator::get_unsigned(DeclarationSpecifier& declaration_specifier) {
+  return type::is_unsigned(
+      declaration_specifier.get_type_specifier()->get_specifier());
+}
+
 void CodeGenerator::codegen_error(const std::string& msg) {
   throw std::logic_error("Codegen: " + msg);
 }
 
 void CodeGenerator::assignment_type_check(llvm::Type* lhs_type,
                                           llvm::Type* rhs_type,
-                                          llvm::Value** rhs) {
+                                          llvm::Value** rhs,
+                                          bool rhs_unsigned) {
   // bool
   if (lhs_type->isIntegerTy(1) && rhs_type->isIntegerTy(1)) {
     return;
@@ -975,6 +2557,12 @@ void CodeGenerator::assignment_type_check(llvm::Type* lhs_type,
       *rhs = builder_.CreateFPCast(*rhs, builder_.getDoubleTy());
       return;
     }
+    if (rhs_type->isIntegerTy(32)) {
+      *rhs = rhs_unsigned
+                 ? builder_.CreateUIToFP(*rhs, builder_.getDoubleTy())
+                 : builder_.CreateSIToFP(*rhs, builder_.getDoubleTy());
+      return;
+    }
   } else if (lhs_type->isFloatTy()) {
     if (rhs_type->isDoubleTy() || rhs_type->isFloatTy()) {
       *rhs = builder_.CreateFPCast(*rhs, builder_.getFloatTy());
@@ -982,25 +2570,37 @@ void CodeGenerator::assignment_type_check(llvm::Type* lhs_type,
     }
   } else if (lhs_type->isIntegerTy(16)) {
     if (rhs_type->isIntegerTy(16) || rhs_type->isIntegerTy(32)) {
-      *rhs = builder_.CreateIntCast(*rhs, builder_.getInt16Ty(), true);
+      *rhs =
+          builder_.CreateIntCast(*rhs, builder_.getInt16Ty(), !rhs_unsigned);
       return;
     }
   } else if (lhs_type->isIntegerTy(32)) {
     if (rhs_type->isIntegerTy(16) || rhs_type->isIntegerTy(32)) {
-      *rhs = builder_.CreateIntCast(*rhs, builder_.getInt32Ty(), true);
+      *rhs =
+          builder_.CreateIntCast(*rhs, builder_.getInt32Ty(), !rhs_unsigned);
       return;
     }
   } else if (lhs_type->isIntegerTy(64)) {
     if (rhs_type->isIntegerTy(16) || rhs_type->isIntegerTy(32) ||
         rhs_type->isIntegerTy(64)) {
-      *rhs = builder_.CreateIntCast(*rhs, builder_.getInt64Ty(), true);
+      *rhs =
+          builder_.CreateIntCast(*rhs, builder_.getInt64Ty(), !rhs_unsigned);
+      return;
+    }
+  } else if (lhs_type->isVectorTy()) {
+    if (rhs_type == lhs_type) {
+      return;
+    }
+    if (!rhs_type->isVectorTy()) {
+      *rhs = broadcast(*rhs, llvm::cast<llvm::VectorType>(lhs_type));
       return;
     }
   }
   codegen_error("type incompatible");
 }
 
-llvm::Value* CodeGenerator::print_call(llvm::Value* arg, bool new_line) {
+llvm::Value* CodeGenerator::print_call(llvm::Value* arg, bool new_line,
+                                       bool is_unsigned) {
   auto* char_ptr = builder_.getInt8Ty()->getPointerTo();
   auto* printf_type =
       llvm::FunctionType::get(builder_.getInt32Ty(), char_ptr, true);
@@ -1012,9 +2612,11 @@ llvm::Value* CodeGenerator::print_call(llvm::Value* arg, bool new_line) {
   auto* type = arg->getType();
   if (type->isIntegerTy(8)) {
     format_string = "%c";
+  } else if (type->isIntegerTy(64)) {
+    format_string = is_unsigned ? "%lu" : "%ld";
   } else if (type->isIntegerTy(1) || type->isIntegerTy(16) ||
-             type->isIntegerTy(32) || type->isIntegerTy(64)) {
-    format_string = "%d";
+             type->isIntegerTy(32)) {
+    format_string = is_unsigned ? "%u" : "%d";
   } else if (type->isDoubleTy()) {
     format_string = "%lf";
   } else if (type->isFloatTy()) {
@@ -1049,11 +2651,16 @@ llvm::Value* CodeGenerator::input_call(Expression& expr) {
   parameters.resize(2);
   parameters[1] = identifier_ptr;
   auto* type = identifier_ptr->getType()->getPointerElementType();
+  bool is_unsigned =
+      symbol_table_.get_symbol(identifier->get_name())->is_unsigned;
   if (type->isIntegerTy(8)) {
     format_string = "%c";
-  } else if (type->isIntegerTy(1) || type->isIntegerTy(16) ||
-             type->isIntegerTy(32) || type->isIntegerTy(64)) {
-    format_string = "%d";
+  } else if (type->isIntegerTy(16)) {
+    format_string = "%hd";
+  } else if (type->isIntegerTy(64)) {
+    format_string = is_unsigned ? "%lu" : "%ld";
+  } else if (type->isIntegerTy(1) || type->isIntegerTy(32)) {
+    format_string = is_unsigned ? "%u" : "%d";
   } else if (type->isDoubleTy()) {
     format_string = "%lf";
   } else if (type->isFloatTy()) {
@@ -1066,4 +2673,1808 @@ llvm::Value* CodeGenerator::input_call(Expression& expr) {
   return builder_.CreateCall(scanf_func, parameters);
 }
 
+llvm::Value* CodeGenerator::load_symbol(llvm::Value* ptr,
+                                        const SymbolRecord& record) {
+  auto* type = ptr->getType()->getPointerElementType();
+  if (!record.is_atomic || !type->isIntegerTy()) {
+    return builder_.CreateLoad(ptr);
+  }
+  auto* load = builder_.CreateAlignedLoad(
+      ptr, module_->getDataLayout().getABITypeAlignment(type));
+  load->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+  return load;
+}
+
+void CodeGenerator::store_symbol(llvm::Value* value, llvm::Value* ptr,
+                                 const SymbolRecord& record) {
+  if (!record.is_atomic) {
+    builder_.CreateStore(value, ptr);
+    return;
+  }
+  auto* store = builder_.CreateAlignedStore(
+      value, ptr,
+      module_->getDataLayout().getABITypeAlignment(value->getType()));
+  store->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+}
+
+llvm::Value* CodeGenerator::get_atomic_ptr(Expression& expression,
+                                           const std::string& builtin) {
+  if (auto* identifier = dynamic_cast<Identifier*>(&expression)) {
+    auto* record = symbol_table_.get_symbol(identifier->get_name());
+    if (record != nullptr && record->is_atomic && !record->is_array) {
+      return record->val;
+    }
+  } else if (auto* array_reference =
+                 dynamic_cast<ArrayReference*>(&expression)) {
+    auto* identifier =
+        dynamic_cast<Identifier*>(array_reference->get_target().get());
+    auto* record = identifier != nullptr
+                       ? symbol_table_.get_symbol(identifier->get_name())
+                       : nullptr;
+    if (record != nullptr && record->is_atomic && record->is_array) {
+      return get_array_reference_ptr(array_reference);
+    }
+  }
+  codegen_error(builtin + ": needs an atomic variable or array element");
+  return nullptr;
+}
+
+llvm::Value* CodeGenerator::atomic_call(
+    const std::string& name,
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  static const std::map<std::string, size_t> operand_counts = {
+      {"load", 1},      {"store", 2},
+      {"fetch_add", 2}, {"fetch_sub", 2},
+      {"compare_exchange", 3},
+      {"lock", 1},      {"unlock", 1}};
+  static const std::map<std::string, llvm::AtomicOrdering> orders = {
+      {"relaxed", llvm::AtomicOrdering::Monotonic},
+      {"acquire", llvm::AtomicOrdering::Acquire},
+      {"release", llvm::AtomicOrdering::Release},
+      {"acq_rel", llvm::AtomicOrdering::AcquireRelease},
+      {"seq_cst", llvm::AtomicOrdering::SequentiallyConsistent}};
+  auto count = operand_counts.find(name);
+  // functions of the program shadow the builtins
+  if (count == operand_counts.end() || module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  bool takes_order = name != "lock" && name != "unlock";
+  auto ordering = llvm::AtomicOrdering::SequentiallyConsistent;
+  if (takes_order && arguments.size() == count->second + 1) {
+    auto* order = dynamic_cast<Identifier*>(arguments.back().get());
+    auto search =
+        order != nullptr ? orders.find(order->get_name()) : orders.end();
+    if (search == orders.end()) {
+      codegen_error(name +
+                    ": memory order must be relaxed, acquire, release, "
+                    "acq_rel or seq_cst");
+    }
+    ordering = search->second;
+  } else if (arguments.size() != count->second) {
+    codegen_error(name + ": expects " + std::to_string(count->second) +
+                  (count->second == 1 ? " argument" : " arguments") +
+                  (takes_order ? " and an optional memory order" : ""));
+  }
+  auto* ptr = get_atomic_ptr(*(arguments[0]), name);
+  auto* type = ptr->getType()->getPointerElementType();
+  unsigned alignment = module_->getDataLayout().getABITypeAlignment(type);
+  std::vector<llvm::Value*> operands;
+  for (size_t i = 1; i < count->second; ++i) {
+    auto* value = arguments[i]->accept(*this);
+    if (!value->getType()->isIntegerTy() ||
+        value->getType()->isIntegerTy(1)) {
+      codegen_error(name + ": operands must be integers");
+    }
+    operands.push_back(builder_.CreateIntCast(value, type, true));
+  }
+  bool acquires = ordering == llvm::AtomicOrdering::Acquire ||
+                  ordering == llvm::AtomicOrdering::AcquireRelease;
+  bool releases = ordering == llvm::AtomicOrdering::Release ||
+                  ordering == llvm::AtomicOrdering::AcquireRelease;
+  if (name == "load") {
+    if (releases) {
+      codegen_error("load: a load cannot release");
+    }
+    auto* load = builder_.CreateAlignedLoad(ptr, alignment);
+    load->setAtomic(ordering);
+    return load;
+  }
+  if (name == "store") {
+    if (acquires) {
+      codegen_error("store: a store cannot acquire");
+    }
+    auto* store = builder_.CreateAlignedStore(operands[0], ptr, alignment);
+    store->setAtomic(ordering);
+    return operands[0];
+  }
+  if (name == "fetch_add" || name == "fetch_sub") {
+    return builder_.CreateAtomicRMW(name == "fetch_add"
+                                        ? llvm::AtomicRMWInst::Add
+                                        : llvm::AtomicRMWInst::Sub,
+                                    ptr, operands[0], ordering);
+  }
+  if (name == "compare_exchange") {
+    // strong exchange, true if the variable held the expected value
+    auto* exchange = builder_.CreateAtomicCmpXchg(
+        ptr, operands[0], operands[1], ordering,
+        llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(ordering));
+    return builder_.CreateExtractValue(exchange, 1);
+  }
+  if (!type->isIntegerTy(32)) {
+    codegen_error(name + ": the lock must be an atomic int");
+  }
+  auto* lock = module_->getOrInsertFunction(
+      "ntrt_" + name,
+      llvm::FunctionType::get(builder_.getVoidTy(), {type->getPointerTo()},
+                              false));
+  return builder_.CreateCall(lock, {ptr});
+}
+
+void CodeGenerator::set_hotness(llvm::Function* function,
+                                FunctionDefinition& function_definition) {
+  bool is_hot = function_definition.has_qualifier(type::FunctionQualifier::HOT);
+  bool is_cold =
+      function_definition.has_qualifier(type::FunctionQualifier::COLD);
+  if (is_hot && is_cold) {
+    codegen_error("function '" + function->getName().str() +
+                  "' cannot be both hot and cold");
+  }
+  // the default linker script groups these sections, llvm 7 has no hot
+  // attribute, an inline hint is the closest
+  if (is_hot) {
+    function->addFnAttr(llvm::Attribute::InlineHint);
+    function->setSection(".text.hot." + function->getName().str());
+  } else if (is_cold) {
+    function->addFnAttr(llvm::Attribute::Cold);
+    function->addFnAttr(llvm::Attribute::OptimizeForSize);
+    function->addFnAttr(llvm::Attribute::NoInline);
+    function->setSection(".text.unlikely." + function->getName().str());
+  }
+}
+
+llvm::GlobalValue::LinkageTypes CodeGenerator::get_linkage(
+    FunctionDefinition& function_definition) {
+  auto& name = function_definition.get_identifier()->get_name();
+  bool is_static =
+      function_definition.has_qualifier(type::FunctionQualifier::STATIC);
+  if (is_static && name == "main") {
+    codegen_error("main cannot be static");
+  }
+  if (is_static &&
+      function_definition.has_qualifier(type::FunctionQualifier::EXPORT)) {
+    codegen_error("export function \'" + name + "\' cannot be static");
+  }
+  if (is_static || (config_.whole_program && name != "main")) {
+    return llvm::GlobalValue::InternalLinkage;
+  }
+  if (function_definition.has_qualifier(type::FunctionQualifier::INLINE)) {
+    return llvm::GlobalValue::LinkOnceODRLinkage;
+  }
+  return llvm::GlobalValue::ExternalLinkage;
+}
+
+int CodeGenerator::finish_linkage() {
+  // also at -O0, the backend need not compile what is never called
+  auto count_definitions = [this]() {
+    return std::count_if(
+        module_->begin(), module_->end(),
+        [](llvm::Function& function) { return !function.isDeclaration(); });
+  };
+  auto defined = count_definitions();
+  llvm::legacy::PassManager pass;
+  pass.add(llvm::createGlobalDCEPass());
+  pass.run(*module_);
+  int removed = defined - count_definitions();
+  // musttail needs the same convention on both sides, so become keeps the
+  // C one for its caller and callee
+  std::set<llvm::Function*> tail_called;
+  for (auto& function : *module_) {
+    for (auto& instruction : llvm::instructions(function)) {
+      auto* call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+      if (call != nullptr && call->isMustTailCall()) {
+        tail_called.insert(&function);
+        tail_called.insert(call->getCalledFunction());
+      }
+    }
+  }
+  // functions whose address escapes, to the runtime or a constructor list,
+  // are called with the C convention
+  for (auto& function : *module_) {
+    if (function.isDeclaration() || !function.hasLocalLinkage() ||
+        function.hasAddressTaken() || tail_called.count(&function) != 0) {
+      continue;
+    }
+    function.setCallingConv(llvm::CallingConv::Fast);
+    for (auto* user : function.users()) {
+      llvm::cast<llvm::CallInst>(user)->setCallingConv(
+          llvm::CallingConv::Fast);
+    }
+  }
+  return removed;
+}
+
+int CodeGenerator::get_fast_functions() const {
+  return std::count_if(module_->begin(), module_->end(),
+                       [](llvm::Function& function) {
+                         return !function.isDeclaration() &&
+                                function.getCallingConv() ==
+                                    llvm::CallingConv::Fast;
+                       });
+}
+
+void CodeGenerator::link(std::unique_ptr<llvm::Module> module) {
+  auto name = module->getModuleIdentifier();
+  // the reason is reported through the diagnostic handler
+  if (llvm::Linker::linkModules(*module_, std::move(module))) {
+    codegen_error("cannot link \'" + name + "\'");
+  }
+}
+
+int CodeGenerator::internalize() {
+  for (auto& function : *module_) {
+    if (!function.isDeclaration() && function.getName() != "main" &&
+        !function.hasFnAttribute(kExportAttribute)) {
+      function.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+  return finish_linkage();
+}
+
+void CodeGenerator::emit_c_entry(ExportFunction& export_function) {
+  auto* body = export_function.function;
+  auto name = body->getName().str();
+  auto& context = module_->getContext();
+  auto* length_type = module_->getDataLayout().getIntPtrType(context);
+  std::vector<llvm::Type*> parameter_types;
+  std::vector<bool> parameter_unsigneds;
+  for (unsigned i = 0; i < body->arg_size(); ++i) {
+    parameter_types.push_back(body->getFunctionType()->getParamType(i));
+    parameter_unsigneds.push_back(export_function.unsigneds[i]);
+    if (export_function.array_lengths[i] >= 0) {
+      parameter_types.push_back(length_type);
+      parameter_unsigneds.push_back(true);
+    }
+  }
+  // calls within the file stay on the body
+  body->setName(name + ".body");
+  body->setLinkage(llvm::GlobalValue::InternalLinkage);
+  auto* function = llvm::Function::Create(
+      llvm::FunctionType::get(body->getReturnType(), parameter_types, false),
+      llvm::GlobalValue::ExternalLinkage, name, module_.get());
+  function->addFnAttr(kExportAttribute);
+  add_c_attributes(function, parameter_unsigneds,
+                   export_function.return_unsigned);
+
+  builder_.SetCurrentDebugLocation(llvm::DebugLoc());
+  builder_.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", function));
+  llvm::MDBuilder md_builder(context);
+  std::vector<llvm::Value*> args;
+  auto arg = function->arg_begin();
+  for (unsigned i = 0; i < body->arg_size(); ++i) {
+    auto parameter_name = (body->arg_begin() + i)->getName();
+    arg->setName(parameter_name);
+    args.push_back(&*arg++);
+    int declared = export_function.array_lengths[i];
+    if (declared < 0) {
+      continue;
+    }
+    auto* length = &*arg++;
+    length->setName(parameter_name + ".length");
+    if (declared == 0) {
+      continue;
+    }
+    // the body takes the declared elements as dereferenceable
+    auto* required = llvm::ConstantInt::get(length_type, declared);
+    auto* short_block = llvm::BasicBlock::Create(context, "short", function);
+    auto* next_block = llvm::BasicBlock::Create(context, "next", function);
+    builder_.CreateCondBr(
+        builder_.CreateICmpULT(length, required), short_block, next_block,
+        md_builder.createBranchWeights(kUnlikelyWeight, kLikelyWeight));
+    builder_.SetInsertPoint(short_block);
+    auto* report = module_->getOrInsertFunction(
+        "ntrt_export_length_error",
+        llvm::FunctionType::get(builder_.getVoidTy(),
+                                {builder_.getInt8PtrTy(),
+                                 builder_.getInt32Ty(), builder_.getInt64Ty(),
+                                 builder_.getInt64Ty()},
+                                false));
+    builder_.CreateCall(
+        report, {builder_.CreateGlobalStringPtr(name), builder_.getInt32(i + 1),
+                 builder_.CreateZExtOrBitCast(length, builder_.getInt64Ty()),
+                 builder_.getInt64(declared)});
+    builder_.CreateUnreachable();
+    builder_.SetInsertPoint(next_block);
+  }
+  auto* call = builder_.CreateCall(body, args);
+  if (body->getReturnType()->isVoidTy()) {
+    builder_.CreateRetVoid();
+  } else {
+    builder_.CreateRet(call);
+  }
+}
+
+void CodeGenerator::add_c_attributes(llvm::Function* function,
+                                     const std::vector<bool>& unsigneds,
+                                     bool return_unsigned) {
+  auto extension = [](llvm::Type* type, bool is_unsigned) {
+    if (type->isIntegerTy(1) || (is_unsigned && type->isIntegerTy() &&
+                                 type->getIntegerBitWidth() < 32)) {
+      return llvm::Attribute::ZExt;
+    }
+    if (type->isIntegerTy() && type->getIntegerBitWidth() < 32) {
+      return llvm::Attribute::SExt;
+    }
+    return llvm::Attribute::None;
+  };
+  for (unsigned i = 0; i < function->arg_size(); ++i) {
+    auto kind = extension(function->getFunctionType()->getParamType(i),
+                          unsigneds[i]);
+    if (kind != llvm::Attribute::None) {
+      function->addParamAttr(i, kind);
+    }
+  }
+  auto kind = extension(function->getReturnType(), return_unsigned);
+  if (kind != llvm::Attribute::None) {
+    function->addAttribute(llvm::AttributeList::ReturnIndex, kind);
+  }
+}
+
+void CodeGenerator::check_c_type(llvm::Type* type, const std::string& name) {
+  if (type->isPointerTy()) {
+    type = type->getPointerElementType();
+  }
+  if (type->isVectorTy()) {
+    codegen_error("vectors have no C type: \'" + name + "\'");
+  }
+}
+
+std::vector<llvm::Value*> CodeGenerator::add_array_lengths(
+    const std::string& name, const std::vector<bool>& arrays,
+    std::vector<std::unique_ptr<Expression>>& arguments,
+    const std::vector<llvm::Value*>& args) {
+  auto& data_layout = module_->getDataLayout();
+  auto* length_type = data_layout.getIntPtrType(module_->getContext());
+  std::vector<llvm::Value*> result;
+  for (size_t i = 0; i < args.size(); ++i) {
+    result.push_back(args[i]);
+    if (!arrays[i]) {
+      continue;
+    }
+    Identifier* identifier = dynamic_cast<Identifier*>(arguments[i].get());
+    auto* record = identifier == nullptr
+                       ? nullptr
+                       : symbol_table_.get_symbol(identifier->get_name());
+    if (record == nullptr || !record->is_array) {
+      codegen_error("parameter " + std::to_string(i + 1) + " of \'" + name +
+                    "\' needs an array");
+    }
+    // whole arrays, or array parameters with a declared length
+    uint64_t length = 0;
+    auto* pointee = record->val->getType()->getPointerElementType();
+    if (pointee->isArrayTy()) {
+      length = pointee->getArrayNumElements();
+    } else if (auto* argument = llvm::dyn_cast<llvm::Argument>(record->val)) {
+      length = argument->getDereferenceableBytes() /
+               data_layout.getTypeAllocSize(pointee);
+    }
+    if (length == 0) {
+      codegen_error("length of array \'" + identifier->get_name() +
+                    "\' passed to \'" + name + "\' is unknown");
+    }
+    result.push_back(llvm::ConstantInt::get(length_type, length));
+  }
+  return result;
+}
+
+void CodeGenerator::hide_functions() {
+  for (auto& function : *module_) {
+    if (!function.isDeclaration() && !function.hasLocalLinkage() &&
+        !function.hasFnAttribute(kExportAttribute)) {
+      function.setVisibility(llvm::GlobalValue::HiddenVisibility);
+      function.setDSOLocal(true);
+    }
+  }
+  for (auto& global : module_->globals()) {
+    if (!global.isDeclaration() && !global.hasLocalLinkage()) {
+      global.setVisibility(llvm::GlobalValue::HiddenVisibility);
+      global.setDSOLocal(true);
+    }
+  }
+}
+
+llvm::Value* CodeGenerator::hint_call(
+    const std::string& name,
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  // functions of the program shadow the builtins
+  if ((name != "likely" && name != "unlikely" && name != "prefetch") ||
+      module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  if (name != "prefetch") {
+    if (arguments.size() != 1) {
+      codegen_error(name + ": expects 1 argument");
+    }
+    auto* value = arguments[0]->accept(*this);
+    if (!value->getType()->isIntegerTy(1)) {
+      codegen_error(name + ": needs a boolean");
+    }
+    // conditions get their weights from create_cond_br, llvm.expect carries
+    // the hint to branches and selects built from other uses
+    auto* expect = llvm::Intrinsic::getDeclaration(
+        module_.get(), llvm::Intrinsic::expect, {builder_.getInt1Ty()});
+    return builder_.CreateCall(
+        expect, {value, builder_.getInt1(name == "likely")});
+  }
+  if (arguments.empty() || arguments.size() > 3) {
+    codegen_error("prefetch: expects an array element, rw and locality");
+  }
+  auto* array_reference = dynamic_cast<ArrayReference*>(arguments[0].get());
+  if (array_reference == nullptr) {
+    codegen_error("prefetch: needs an array element");
+  }
+  // read and keep in all cache levels by default, like __builtin_prefetch
+  int operands[2] = {0, 3};
+  const int limits[2] = {1, 3};
+  for (size_t i = 1; i < arguments.size(); ++i) {
+    auto* constant = dynamic_cast<IntegerExpression*>(arguments[i].get());
+    if (constant == nullptr || constant->get_val() < 0 ||
+        constant->get_val() > limits[i - 1]) {
+      codegen_error(std::string("prefetch: ") +
+                    (i == 1 ? "rw must be 0 or 1"
+                            : "locality must be a constant from 0 to 3"));
+    }
+    operands[i - 1] = constant->get_val();
+  }
+  auto* ptr = builder_.CreateBitCast(get_array_reference_ptr(array_reference),
+                                     builder_.getInt8PtrTy());
+  auto* prefetch =
+      llvm::Intrinsic::getDeclaration(module_.get(), llvm::Intrinsic::prefetch);
+  // the last operand selects the data cache
+  return builder_.CreateCall(
+      prefetch, {ptr, builder_.getInt32(operands[0]),
+                 builder_.getInt32(operands[1]), builder_.getInt32(1)});
+}
+
+void CodeGenerator::create_cond_br(Expression& condition,
+                                   llvm::Value* cond_val,
+                                   llvm::BasicBlock* true_block,
+                                   llvm::BasicBlock* false_block) {
+  auto* profile = get_profile_state();
+  int counter = 0;
+  if (profile != nullptr) {
+    counter = add_profile_counters(*profile, 2);
+    if (profile->counters != nullptr) {
+      // the second counter when the condition holds
+      emit_profile_increment(
+          builder_, *profile,
+          builder_.CreateAdd(
+              builder_.getInt64(counter),
+              builder_.CreateZExt(cond_val, builder_.getInt64Ty())));
+    }
+  }
+  auto* branch = builder_.CreateCondBr(cond_val, true_block, false_block);
+  if (profile != nullptr && profile->counters == nullptr) {
+    profile->branches.emplace_back(branch, counter);
+  }
+  auto* function_call = dynamic_cast<FunctionCall*>(&condition);
+  auto* identifier =
+      function_call != nullptr
+          ? dynamic_cast<Identifier*>(function_call->get_target().get())
+          : nullptr;
+  if (identifier == nullptr ||
+      (identifier->get_name() != "likely" &&
+       identifier->get_name() != "unlikely") ||
+      module_->getFunction(identifier->get_name()) != nullptr) {
+    return;
+  }
+  bool is_likely = identifier->get_name() == "likely";
+  llvm::MDBuilder md_builder(module_->getContext());
+  branch->setMetadata(
+      llvm::LLVMContext::MD_prof,
+      md_builder.createBranchWeights(
+          is_likely ? kLikelyWeight : kUnlikelyWeight,
+          is_likely ? kUnlikelyWeight : kLikelyWeight));
+}
+
+CodeGenerator::ProfileState* CodeGenerator::get_profile_state() {
+  if (config_.profile_generate.empty() && config_.profile_use.empty()) {
+    return nullptr;
+  }
+  auto* function = builder_.GetInsertBlock()->getParent();
+  for (auto& state : profiles_) {
+    if (state.function == function) {
+      return &state;
+    }
+  }
+  profiles_.emplace_back();
+  auto& state = profiles_.back();
+  state.function = function;
+  state.checksum = kProfileSeed;
+  if (!config_.profile_generate.empty()) {
+    state.counters = new llvm::GlobalVariable(
+        *module_, llvm::ArrayType::get(builder_.getInt64Ty(), 0), false,
+        llvm::GlobalValue::ExternalLinkage, nullptr,
+        function->getName() + ".prof.pending");
+    auto& entry = function->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.getFirstInsertionPt());
+    emit_profile_increment(entry_builder, state, entry_builder.getInt64(0));
+  }
+  return &state;
+}
+
+int CodeGenerator::add_profile_counters(ProfileState& state, int count) {
+  state.checksum = (state.checksum ^ count) * kProfilePrime;
+  state.num_counters += count;
+  return state.num_counters - count;
+}
+
+void CodeGenerator::emit_profile_increment(llvm::IRBuilder<>& builder,
+                                           ProfileState& state,
+                                           llvm::Value* index) {
+  // plain increments, threads racing on a counter may lose counts
+  auto* counter = builder.CreateInBoundsGEP(state.counters,
+                                            {builder.getInt64(0), index});
+  builder.CreateStore(
+      builder.CreateAdd(builder.CreateLoad(counter), builder.getInt64(1)),
+      counter);
+}
+
+llvm::BasicBlock* CodeGenerator::profile_edge(ProfileState* state,
+                                              int counter,
+                                              llvm::BasicBlock* target) {
+  if (state == nullptr || state->counters == nullptr) {
+    return target;
+  }
+  auto* block =
+      llvm::BasicBlock::Create(module_->getContext(), "prof.edge",
+                               builder_.GetInsertBlock()->getParent());
+  llvm::IRBuilder<> edge_builder(block);
+  emit_profile_increment(edge_builder, *state, edge_builder.getInt64(counter));
+  edge_builder.CreateBr(target);
+  return block;
+}
+
+llvm::StructType* CodeGenerator::get_profile_type() {
+  if (profile_type_ == nullptr) {
+    // layout of ntrt_profile_data in runtime/ntrt.h
+    auto* i8_ptr = builder_.getInt8Ty()->getPointerTo();
+    profile_type_ = llvm::StructType::create(
+        module_->getContext(),
+        {i8_ptr, builder_.getInt64Ty(), builder_.getInt64Ty()->getPointerTo(),
+         builder_.getInt32Ty(), i8_ptr},
+        "ntrt_profile_data");
+  }
+  return profile_type_;
+}
+
+void CodeGenerator::emit_profile_registration() {
+  auto& context = module_->getContext();
+  auto* init = llvm::Function::Create(
+      llvm::FunctionType::get(builder_.getVoidTy(), false),
+      llvm::GlobalValue::InternalLinkage, "ntc.profile.init", module_.get());
+  builder_.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", init));
+  auto* profile_type = get_profile_type();
+  auto* register_data = module_->getOrInsertFunction(
+      "ntrt_profile_register",
+      llvm::FunctionType::get(
+          builder_.getVoidTy(),
+          {profile_type->getPointerTo(), builder_.getInt8PtrTy()}, false));
+  auto* filename =
+      builder_.CreateGlobalStringPtr(config_.profile_generate, "ntc.profile");
+  for (auto& state : profiles_) {
+    auto name = state.function->getName().str();
+    auto* counters_type =
+        llvm::ArrayType::get(builder_.getInt64Ty(), state.num_counters);
+    auto* counters = new llvm::GlobalVariable(
+        *module_, counters_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantAggregateZero::get(counters_type), name + ".prof");
+    state.counters->replaceAllUsesWith(
+        llvm::ConstantExpr::getBitCast(counters, state.counters->getType()));
+    state.counters->eraseFromParent();
+    state.counters = counters;
+
+    auto* name_init = llvm::ConstantDataArray::getString(context, name);
+    auto* name_global = new llvm::GlobalVariable(
+        *module_, name_init->getType(), true,
+        llvm::GlobalValue::PrivateLinkage, name_init, name + ".prof.name");
+    std::vector<llvm::Constant*> fields;
+    for (auto* field_type : profile_type->elements()) {
+      fields.push_back(llvm::Constant::getNullValue(field_type));
+    }
+    fields[PROFILE_NAME] = llvm::ConstantExpr::getPointerCast(
+        name_global, builder_.getInt8PtrTy());
+    fields[PROFILE_CHECKSUM] = builder_.getInt64(state.checksum);
+    fields[PROFILE_COUNTERS] = llvm::ConstantExpr::getPointerCast(
+        counters, builder_.getInt64Ty()->getPointerTo());
+    fields[PROFILE_NUM_COUNTERS] = builder_.getInt32(state.num_counters);
+    auto* data = new llvm::GlobalVariable(
+        *module_, profile_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantStruct::get(profile_type, fields), name + ".prof.data");
+    builder_.CreateCall(register_data, {data, filename});
+    ++profiled_functions_;
+  }
+  builder_.CreateRetVoid();
+  llvm::appendToGlobalCtors(*module_, init, 65535);
+}
+
+void CodeGenerator::apply_profile() {
+  // the summary tells the inliner and the code layout which counts are hot
+  llvm::InstrProfSummaryBuilder summary_builder(
+      llvm::ProfileSummaryBuilder::DefaultCutoffs);
+  for (auto& record : profile_data_.get_records()) {
+    summary_builder.addRecord(llvm::InstrProfRecord(record.second.counters));
+  }
+  module_->setProfileSummary(
+      summary_builder.getSummary()->getMD(module_->getContext()));
+
+  llvm::MDBuilder md_builder(module_->getContext());
+  for (auto& state : profiles_) {
+    auto name = state.function->getName().str();
+    auto* record = profile_data_.find(name);
+    if (record == nullptr) {
+      continue;
+    }
+    auto& counters = record->counters;
+    if (record->checksum != state.checksum ||
+        counters.size() != static_cast<size_t>(state.num_counters)) {
+      stale_profiles_.push_back(name);
+      continue;
+    }
+    state.function->setEntryCount(counters[0]);
+    for (auto& branch : state.branches) {
+      auto* instruction =
+          llvm::dyn_cast_or_null<llvm::Instruction>(branch.first);
+      if (instruction == nullptr) {
+        continue;
+      }
+      std::vector<uint64_t> counts;
+      if (llvm::isa<llvm::BranchInst>(instruction)) {
+        counts = {counters[branch.second + 1], counters[branch.second]};
+      } else {
+        for (unsigned i = 0; i < instruction->getNumSuccessors(); ++i) {
+          counts.push_back(counters[branch.second + i]);
+        }
+      }
+      // weights are 32 bits wide, a branch that never ran keeps its hints
+      uint64_t max_count = *std::max_element(counts.begin(), counts.end());
+      if (max_count == 0) {
+        continue;
+      }
+      uint64_t scale = max_count / UINT32_MAX + 1;
+      std::vector<uint32_t> weights;
+      for (auto count : counts) {
+        weights.push_back(count / scale + 1);
+      }
+      instruction->setMetadata(llvm::LLVMContext::MD_prof,
+                               md_builder.createBranchWeights(weights));
+    }
+    ++profiled_functions_;
+  }
+}
+
+void CodeGenerator::emit_call_enter(llvm::Function* function) {
+  auto name = function->getName().str();
+  cur_call_site_ = create_site(name, name + ".site");
+  call_sites_.push_back(cur_call_site_);
+  auto* enter = module_->getOrInsertFunction(
+      "ntrt_func_enter",
+      llvm::FunctionType::get(builder_.getVoidTy(),
+                              {cur_call_site_->getType(),
+                               builder_.getInt64Ty()},
+                              false));
+  // llvm.readcyclecounter is rdtsc on x86
+  builder_.CreateCall(
+      enter, {cur_call_site_,
+              builder_.CreateCall(llvm::Intrinsic::getDeclaration(
+                  module_.get(), llvm::Intrinsic::readcyclecounter))});
+}
+
+void CodeGenerator::emit_call_exit() {
+  if (cur_perf_site_ != nullptr) {
+    emit_site_call("ntrt_perf_end", cur_perf_site_);
+  }
+  if (cur_call_site_ == nullptr) {
+    return;
+  }
+  auto* exit = module_->getOrInsertFunction(
+      "ntrt_func_exit",
+      llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt64Ty()},
+                              false));
+  builder_.CreateCall(
+      exit, {builder_.CreateCall(llvm::Intrinsic::getDeclaration(
+                module_.get(), llvm::Intrinsic::readcyclecounter))});
+}
+
+void CodeGenerator::emit_perf_begin(llvm::Function* function) {
+  auto name = function->getName().str();
+  cur_perf_site_ = create_site(name, name + ".perf");
+  perf_sites_.push_back(cur_perf_site_);
+  emit_site_call("ntrt_perf_begin", cur_perf_site_);
+}
+
+llvm::GlobalVariable* CodeGenerator::create_site(
+    const std::string& name, const std::string& global_name) {
+  auto& context = module_->getContext();
+  auto* site_type = llvm::StructType::get(
+      context, {builder_.getInt8PtrTy(), builder_.getInt32Ty(),
+                builder_.getInt8PtrTy()});
+  auto* name_init = llvm::ConstantDataArray::getString(context, name);
+  auto* name_global = new llvm::GlobalVariable(
+      *module_, name_init->getType(), true, llvm::GlobalValue::PrivateLinkage,
+      name_init, global_name + ".name");
+  return new llvm::GlobalVariable(
+      *module_, site_type, false, llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantStruct::get(
+          site_type,
+          {llvm::ConstantExpr::getPointerCast(name_global,
+                                              builder_.getInt8PtrTy()),
+           builder_.getInt32(0),
+           llvm::Constant::getNullValue(builder_.getInt8PtrTy())}),
+      global_name);
+}
+
+void CodeGenerator::emit_site_call(const std::string& function,
+                                   llvm::GlobalVariable* site) {
+  builder_.CreateCall(
+      module_->getOrInsertFunction(
+          function, llvm::FunctionType::get(builder_.getVoidTy(),
+                                            {site->getType()}, false)),
+      {site});
+}
+
+void CodeGenerator::emit_site_registration(
+    const std::string& init_name, const std::string& function,
+    const std::vector<llvm::GlobalVariable*>& sites) {
+  auto* init = llvm::Function::Create(
+      llvm::FunctionType::get(builder_.getVoidTy(), false),
+      llvm::GlobalValue::InternalLinkage, init_name, module_.get());
+  builder_.SetInsertPoint(
+      llvm::BasicBlock::Create(module_->getContext(), "entry", init));
+  for (auto* site : sites) {
+    emit_site_call(function, site);
+  }
+  builder_.CreateRetVoid();
+  llvm::appendToGlobalCtors(*module_, init, 65535);
+}
+
+llvm::Value* CodeGenerator::trace_call(
+    const std::string& name,
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  // functions of the program shadow the builtins
+  if ((name != "trace" && name != "trace_flush") ||
+      module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  if (name == "trace_flush" && !arguments.empty()) {
+    codegen_error("trace_flush: expects no arguments");
+  }
+  if (name == "trace" && arguments.size() != 2) {
+    codegen_error("trace: expects an id and a value");
+  }
+  // like assert under NDEBUG, nothing of the call is left; the value is
+  // never used since both builtins return void
+  if (!config_.trace) {
+    return llvm::UndefValue::get(builder_.getVoidTy());
+  }
+  if (name == "trace_flush") {
+    return builder_.CreateCall(module_->getOrInsertFunction(
+        "ntrt_trace_flush",
+        llvm::FunctionType::get(builder_.getVoidTy(), false)));
+  }
+  std::vector<llvm::Value*> args;
+  llvm::Type* types[] = {builder_.getInt32Ty(), builder_.getInt64Ty()};
+  for (int i = 0; i < 2; ++i) {
+    auto* value = arguments[i]->accept(*this);
+    if (!value->getType()->isIntegerTy()) {
+      codegen_error("trace: the id and the value must be integers");
+    }
+    bool is_signed = !is_unsigned(*(arguments[i])) &&
+                     !value->getType()->isIntegerTy(1);
+    args.push_back(builder_.CreateIntCast(value, types[i], is_signed));
+  }
+  return builder_.CreateCall(
+      module_->getOrInsertFunction(
+          "ntrt_trace",
+          llvm::FunctionType::get(builder_.getVoidTy(), types, false)),
+      args);
+}
+
+void CodeGenerator::emit_trace_ends(size_t depth) {
+  for (size_t i = trace_spans_.size(); i > depth; --i) {
+    emit_site_call("ntrt_trace_end", trace_spans_[i - 1]);
+  }
+}
+
+void CodeGenerator::set_debug_location(const AST& node) {
+  auto& range = node.get_range();
+  if (range.begin_line != 0) {
+    set_debug_location(range.begin_line, range.begin_column);
+  }
+}
+
+void CodeGenerator::set_debug_location(int line, int column) {
+  if (debug_builder_ == nullptr || debug_scope_ == nullptr) {
+    return;
+  }
+  builder_.SetCurrentDebugLocation(
+      llvm::DILocation::get(module_->getContext(), line, column, debug_scope_));
+}
+
+llvm::DIType* CodeGenerator::get_debug_type(llvm::Type* type,
+                                            bool is_unsigned) {
+  auto& layout = module_->getDataLayout();
+  auto size = layout.getTypeAllocSizeInBits(type);
+  if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+    auto* subrange =
+        debug_builder_->getOrCreateSubrange(0, array_type->getNumElements());
+    return debug_builder_->createArrayType(
+        size, 0, get_debug_type(array_type->getElementType(), is_unsigned),
+        debug_builder_->getOrCreateArray({subrange}));
+  }
+  if (auto* vector_type = llvm::dyn_cast<llvm::VectorType>(type)) {
+    auto* subrange =
+        debug_builder_->getOrCreateSubrange(0, vector_type->getNumElements());
+    return debug_builder_->createVectorType(
+        size, layout.getPrefTypeAlignment(type) * 8,
+        get_debug_type(vector_type->getElementType(), is_unsigned),
+        debug_builder_->getOrCreateArray({subrange}));
+  }
+  if (type->isPointerTy()) {
+    // strings and array parameters
+    return debug_builder_->createPointerType(
+        get_debug_type(type->getPointerElementType(), is_unsigned),
+        layout.getPointerSizeInBits());
+  }
+  if (type->isIntegerTy(1)) {
+    return debug_builder_->createBasicType("bool", size,
+                                           llvm::dwarf::DW_ATE_boolean);
+  }
+  if (type->isIntegerTy(8)) {
+    return debug_builder_->createBasicType("char", size,
+                                           llvm::dwarf::DW_ATE_signed_char);
+  }
+  if (type->isIntegerTy()) {
+    std::string name = type->isIntegerTy(16)   ? "short"
+                       : type->isIntegerTy(32) ? "int"
+                                               : "long";
+    return debug_builder_->createBasicType(
+        is_unsigned ? "unsigned " + name : name, size,
+        is_unsigned ? llvm::dwarf::DW_ATE_unsigned
+                    : llvm::dwarf::DW_ATE_signed);
+  }
+  return debug_builder_->createBasicType(
+      type->isFloatTy() ? "float" : "double", size, llvm::dwarf::DW_ATE_float);
+}
+
+void CodeGenerator::begin_debug_function(llvm::Function* function, int line,
+                                         llvm::DISubroutineType* type,
+                                         bool is_artificial) {
+  auto flags = llvm::DINode::FlagPrototyped;
+  if (is_artificial) {
+    flags |= llvm::DINode::FlagArtificial;
+  }
+  auto* subprogram = debug_builder_->createFunction(
+      debug_file_, function->getName(), function->getName(), debug_file_, line,
+      type, function->hasLocalLinkage(), true, line, flags,
+      config_.opt_level > 0);
+  function->setSubprogram(subprogram);
+  debug_scope_ = subprogram;
+  set_debug_location(line, 0);
+}
+
+void CodeGenerator::begin_debug_thunk(llvm::Function* function) {
+  if (debug_builder_ == nullptr) {
+    return;
+  }
+  auto location = builder_.getCurrentDebugLocation();
+  begin_debug_function(function, location ? location.getLine() : 0,
+                       debug_builder_->createSubroutineType(
+                           debug_builder_->getOrCreateTypeArray({nullptr})),
+                       true);
+}
+
+void CodeGenerator::emit_debug_variable(const std::string& name,
+                                        llvm::Value* storage,
+                                        llvm::DIType* type, int line,
+                                        unsigned argument) {
+  // only the line table is kept for remarks without -g
+  if (!config_.debug_info) {
+    return;
+  }
+  llvm::DILocalVariable* variable;
+  if (argument > 0) {
+    variable = debug_builder_->createParameterVariable(
+        debug_scope_, name, argument, debug_file_, line, type, true);
+  } else {
+    variable = debug_builder_->createAutoVariable(
+        debug_scope_, name, debug_file_, line, type, true);
+  }
+  auto* location =
+      llvm::DILocation::get(module_->getContext(), line, 0, debug_scope_);
+  if (llvm::isa<llvm::AllocaInst>(storage)) {
+    debug_builder_->insertDeclare(storage, variable,
+                                  debug_builder_->createExpression(), location,
+                                  builder_.GetInsertBlock());
+  } else {
+    debug_builder_->insertDbgValueIntrinsic(
+        storage, variable, debug_builder_->createExpression(), location,
+        builder_.GetInsertBlock());
+  }
+}
+
+llvm::Value* CodeGenerator::thread_spawn_call(
+    std::vector<std::unique_ptr<Expression>>& arguments) {
+  auto* identifier = arguments.empty()
+                         ? nullptr
+                         : dynamic_cast<Identifier*>(arguments[0].get());
+  auto* callee = identifier != nullptr
+                     ? module_->getFunction(identifier->get_name())
+                     : nullptr;
+  if (callee == nullptr) {
+    codegen_error("thread_spawn: the first argument must name a function");
+  }
+  if (callee->arg_size() != arguments.size() - 1) {
+    codegen_error("invalid argument number: " + identifier->get_name());
+  }
+  // the arguments after the function name, borrowed from the call
+  std::vector<std::unique_ptr<Expression>> call_arguments;
+  for (size_t i = 1; i < arguments.size(); ++i) {
+    call_arguments.push_back(std::move(arguments[i]));
+  }
+  auto args = emit_arguments(call_arguments);
+  check_array_arguments(callee, call_arguments);
+  for (size_t i = 1; i < arguments.size(); ++i) {
+    arguments[i] = std::move(call_arguments[i - 1]);
+  }
+
+  // the runtime copies the record before the call returns, so one slot
+  // serves every thread started here
+  std::vector<llvm::Type*> fields;
+  for (auto* arg : args) {
+    fields.push_back(arg->getType());
+  }
+  auto* record_type = llvm::StructType::get(llvm_context, fields);
+  auto* record = create_entry_alloca(record_type);
+  for (unsigned i = 0; i < args.size(); ++i) {
+    builder_.CreateStore(args[i],
+                         builder_.CreateStructGEP(record_type, record, i));
+  }
+
+  auto* saved_block = builder_.GetInsertBlock();
+  auto* thunk = llvm::Function::Create(
+      llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt8PtrTy()},
+                              false),
+      llvm::Function::InternalLinkage,
+      cur_function_name_ + ".thread." + std::to_string(threads_++),
+      module_.get());
+  auto* saved_scope = debug_scope_;
+  auto saved_location = builder_.getCurrentDebugLocation();
+  begin_debug_thunk(thunk);
+  builder_.SetInsertPoint(
+      llvm::BasicBlock::Create(llvm_context, "entry", thunk));
+  auto* copy =
+      builder_.CreateBitCast(thunk->arg_begin(), record_type->getPointerTo());
+  std::vector<llvm::Value*> thunk_args;
+  for (unsigned i = 0; i < args.size(); ++i) {
+    thunk_args.push_back(
+        builder_.CreateLoad(builder_.CreateStructGEP(record_type, copy, i)));
+  }
+  builder_.CreateCall(callee, thunk_args);
+  builder_.CreateRetVoid();
+  llvm::verifyFunction(*thunk);
+  builder_.SetInsertPoint(saved_block);
+  builder_.SetCurrentDebugLocation(saved_location);
+  debug_scope_ = saved_scope;
+
+  auto* int64_type = builder_.getInt64Ty();
+  auto* thread_spawn = module_->getOrInsertFunction(
+      "ntrt_thread_spawn",
+      llvm::FunctionType::get(int64_type,
+                              {thunk->getType(), builder_.getInt8PtrTy(),
+                               int64_type},
+                              false));
+  return builder_.CreateCall(
+      thread_spawn,
+      {thunk, builder_.CreateBitCast(record, builder_.getInt8PtrTy()),
+       builder_.getInt64(
+           module_->getDataLayout().getTypeAllocSize(record_type))});
+}
+
+llvm::Value* CodeGenerator::broadcast(llvm::Value* scalar,
+                                      llvm::VectorType* type) {
+  auto* element = type->getElementType();
+  auto* scalar_type = scalar->getType();
+  if (scalar_type->isIntegerTy(16) || scalar_type->isIntegerTy(32) ||
+      scalar_type->isIntegerTy(64)) {
+    scalar = element->isIntegerTy()
+                 ? builder_.CreateIntCast(scalar, element, true)
+                 : builder_.CreateSIToFP(scalar, element);
+  } else if (scalar_type->isFloatingPointTy() &&
+             element->isFloatingPointTy()) {
+    scalar = builder_.CreateFPCast(scalar, element);
+  } else {
+    codegen_error("vector: cannot broadcast a scalar of this type");
+  }
+  return builder_.CreateVectorSplat(type->getNumElements(), scalar);
+}
+
+llvm::Value* CodeGenerator::vector_binary_operation(type::BinaryOp op,
+                                                    llvm::Value* lhs,
+                                                    llvm::Value* rhs) {
+  auto* vector_type = llvm::dyn_cast<llvm::VectorType>(lhs->getType());
+  if (vector_type == nullptr) {
+    vector_type = llvm::cast<llvm::VectorType>(rhs->getType());
+    lhs = broadcast(lhs, vector_type);
+  } else if (!rhs->getType()->isVectorTy()) {
+    rhs = broadcast(rhs, vector_type);
+  }
+  if (lhs->getType() != rhs->getType()) {
+    codegen_error("vector operation: operands have different vector types");
+  }
+  auto* element = vector_type->getElementType();
+  bool is_fp = element->isFloatingPointTy();
+  llvm::CmpInst::Predicate cmp;
+  switch (op) {
+    case type::BinaryOp::LESS:
+      cmp = is_fp ? llvm::CmpInst::FCMP_OLT : llvm::CmpInst::ICMP_SLT;
+      break;
+    case type::BinaryOp::GREATER:
+      cmp = is_fp ? llvm::CmpInst::FCMP_OGT : llvm::CmpInst::ICMP_SGT;
+      break;
+    case type::BinaryOp::LESS_EQUAL:
+      cmp = is_fp ? llvm::CmpInst::FCMP_OLE : llvm::CmpInst::ICMP_SLE;
+      break;
+    case type::BinaryOp::GREATER_EQUAL:
+      cmp = is_fp ? llvm::CmpInst::FCMP_OGE : llvm::CmpInst::ICMP_SGE;
+      break;
+    case type::BinaryOp::EQUAL:
+      cmp = is_fp ? llvm::CmpInst::FCMP_OEQ : llvm::CmpInst::ICMP_EQ;
+      break;
+    case type::BinaryOp::NOT_EQUAL:
+      cmp = is_fp ? llvm::CmpInst::FCMP_ONE : llvm::CmpInst::ICMP_NE;
+      break;
+    default:
+      cmp = llvm::CmpInst::BAD_ICMP_PREDICATE;
+  }
+  if (cmp != llvm::CmpInst::BAD_ICMP_PREDICATE) {
+    // lanes become -1 where the comparison holds and 0 elsewhere, in
+    // integers as wide as the operand lanes
+    auto* mask = is_fp ? builder_.CreateFCmp(cmp, lhs, rhs)
+                       : builder_.CreateICmp(cmp, lhs, rhs);
+    return builder_.CreateSExt(
+        mask, llvm::VectorType::get(
+                  builder_.getIntNTy(element->getScalarSizeInBits()),
+                  vector_type->getNumElements()));
+  }
+  llvm::Instruction::BinaryOps binop;
+  switch (op) {
+    case type::BinaryOp::ADD:
+      binop = is_fp ? llvm::Instruction::FAdd : llvm::Instruction::Add;
+      break;
+    case type::BinaryOp::SUB:
+      binop = is_fp ? llvm::Instruction::FSub : llvm::Instruction::Sub;
+      break;
+    case type::BinaryOp::MUL:
+      binop = is_fp ? llvm::Instruction::FMul : llvm::Instruction::Mul;
+      break;
+    case type::BinaryOp::DIV:
+      binop = is_fp ? llvm::Instruction::FDiv : llvm::Instruction::SDiv;
+      break;
+    case type::BinaryOp::MOD:
+      binop = llvm::Instruction::SRem;
+      break;
+    case type::BinaryOp::SHIFT_LEFT:
+      binop = llvm::Instruction::Shl;
+      break;
+    case type::BinaryOp::SHIFT_RIGHT:
+      binop = llvm::Instruction::AShr;
+      break;
+    case type::BinaryOp::BIT_AND:
+      binop = llvm::Instruction::And;
+      break;
+    case type::BinaryOp::BIT_XOR:
+      binop = llvm::Instruction::Xor;
+      break;
+    case type::BinaryOp::BIT_OR:
+      binop = llvm::Instruction::Or;
+      break;
+    default:
+      codegen_error("vector operation: unsupported op: " + to_string(op));
+  }
+  if (is_fp && !(binop == llvm::Instruction::FAdd ||
+                 binop == llvm::Instruction::FSub ||
+                 binop == llvm::Instruction::FMul ||
+                 binop == llvm::Instruction::FDiv)) {
+    codegen_error("vector operation: " + to_string(op) +
+                  " needs integer lanes");
+  }
+  return builder_.CreateBinOp(binop, lhs, rhs);
+}
+
+llvm::Value* CodeGenerator::vector_call(const std::string& name,
+                                        std::vector<llvm::Value*>& args) {
+  static const std::set<std::string> builtins = {
+      "vload2",     "vload4",     "vload8",     "vstore",
+      "broadcast2", "broadcast4", "broadcast8", "shuffle",
+      "reduce_add", "reduce_mul", "reduce_min", "reduce_max"};
+  // functions of the program shadow the builtins
+  if (builtins.count(name) == 0 || module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  auto expect = [&](size_t count) {
+    if (args.size() != count) {
+      codegen_error(name + ": expects " + std::to_string(count) +
+                    (count == 1 ? " argument" : " arguments"));
+    }
+  };
+  auto* vector_type =
+      args.empty() ? nullptr
+                   : llvm::dyn_cast<llvm::VectorType>(args[0]->getType());
+  auto& data_layout = module_->getDataLayout();
+
+  // vloadN(a, i) reads a[i] to a[i + N - 1], vstore(v, a, i) writes them
+  if (name.compare(0, 5, "vload") == 0 || name == "vstore") {
+    bool is_load = name != "vstore";
+    expect(is_load ? 2 : 3);
+    auto* array = args[is_load ? 0 : 1];
+    auto* index = args[is_load ? 1 : 2];
+    auto* element = array->getType()->isPointerTy()
+                        ? array->getType()->getPointerElementType()
+                        : nullptr;
+    if (is_load) {
+      vector_type = get_vector_type(element, name.back() - '0');
+    }
+    if (vector_type == nullptr || vector_type->getElementType() != element) {
+      codegen_error(name + ": no vector type for these array elements");
+    }
+    if (!index->getType()->isIntegerTy() || index->getType()->isIntegerTy(1)) {
+      codegen_error(name + ": index must be an integer");
+    }
+    // arrays only guarantee the alignment of their elements
+    unsigned alignment = data_layout.getABITypeAlignment(element);
+    auto* ptr = builder_.CreateBitCast(
+        builder_.CreateInBoundsGEP(
+            array, builder_.CreateIntCast(index, builder_.getInt64Ty(), true)),
+        vector_type->getPointerTo());
+    if (is_load) {
+      return builder_.CreateAlignedLoad(ptr, alignment);
+    }
+    builder_.CreateAlignedStore(args[0], ptr, alignment);
+    return args[0];
+  }
+  if (name.compare(0, 9, "broadcast") == 0) {
+    expect(1);
+    auto* element = args[0]->getType();
+    if (element->isIntegerTy(16)) {
+      element = builder_.getInt32Ty();
+    }
+    vector_type = get_vector_type(element, name.back() - '0');
+    if (vector_type == nullptr) {
+      codegen_error(name + ": no vector type for this scalar");
+    }
+    return broadcast(args[0], vector_type);
+  }
+  if (vector_type == nullptr) {
+    codegen_error(name + ": needs a vector");
+  }
+  unsigned lanes = vector_type->getNumElements();
+  if (name == "shuffle") {
+    // shuffle(v, lanes...) picks lanes of v, shuffle(v, w, lanes...) of
+    // both with the lanes of w numbered after those of v
+    llvm::Value* second = llvm::UndefValue::get(vector_type);
+    size_t first = 1;
+    if (args.size() > 1 && args[1]->getType()->isVectorTy()) {
+      if (args[1]->getType() != vector_type) {
+        codegen_error("shuffle: operands have different vector types");
+      }
+      second = args[1];
+      first = 2;
+    }
+    unsigned limit = first == 2 ? 2 * lanes : lanes;
+    std::vector<llvm::Constant*> mask;
+    for (size_t i = first; i < args.size(); ++i) {
+      auto* lane = llvm::dyn_cast<llvm::ConstantInt>(args[i]);
+      if (lane == nullptr || lane->isNegative() ||
+          lane->getZExtValue() >= limit) {
+        codegen_error("shuffle: lanes must be constants below " +
+                      std::to_string(limit));
+      }
+      mask.push_back(builder_.getInt32(lane->getZExtValue()));
+    }
+    if (get_vector_type(vector_type->getElementType(), mask.size()) ==
+        nullptr) {
+      codegen_error("shuffle: no vector type with " +
+                    std::to_string(mask.size()) + " lanes");
+    }
+    return builder_.CreateShuffleVector(args[0], second,
+                                        llvm::ConstantVector::get(mask));
+  }
+
+  // horizontal reductions fold the upper half of the lanes onto the lower
+  // half until one is left
+  expect(1);
+  bool is_fp = vector_type->getElementType()->isFloatingPointTy();
+  llvm::Value* value = args[0];
+  for (unsigned width = lanes / 2; width >= 1; width /= 2) {
+    std::vector<llvm::Constant*> mask;
+    for (unsigned i = 0; i < lanes; ++i) {
+      mask.push_back(builder_.getInt32((i + width) % lanes));
+    }
+    auto* upper = builder_.CreateShuffleVector(
+        value, llvm::UndefValue::get(vector_type),
+        llvm::ConstantVector::get(mask));
+    if (name == "reduce_add") {
+      value = is_fp ? builder_.CreateFAdd(value, upper)
+                    : builder_.CreateAdd(value, upper);
+    } else if (name == "reduce_mul") {
+      value = is_fp ? builder_.CreateFMul(value, upper)
+                    : builder_.CreateMul(value, upper);
+    } else {
+      bool is_min = name == "reduce_min";
+      auto* less = is_fp ? builder_.CreateFCmpOLT(value, upper)
+                         : builder_.CreateICmpSLT(value, upper);
+      value = builder_.CreateSelect(less, is_min ? value : upper,
+                                    is_min ? upper : value);
+    }
+  }
+  return builder_.CreateExtractElement(value, static_cast<uint64_t>(0));
+}
+
+llvm::Value* CodeGenerator::bit_call(const std::string& name,
+                                     std::vector<llvm::Value*>& args) {
+  static const std::map<std::string, std::pair<llvm::Intrinsic::ID, size_t>>
+      intrinsics = {{"popcount", {llvm::Intrinsic::ctpop, 1}},
+                    {"clz", {llvm::Intrinsic::ctlz, 1}},
+                    {"ctz", {llvm::Intrinsic::cttz, 1}},
+                    {"rotl", {llvm::Intrinsic::fshl, 2}},
+                    {"rotr", {llvm::Intrinsic::fshr, 2}},
+                    {"bswap", {llvm::Intrinsic::bswap, 1}}};
+  auto search = intrinsics.find(name);
+  // functions of the program shadow the builtins
+  if (search == intrinsics.end() || module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  auto id = search->second.first;
+  auto count = search->second.second;
+  if (args.size() != count) {
+    codegen_error(name + ": expects " + std::to_string(count) +
+                  (count == 1 ? " argument" : " arguments"));
+  }
+  // results have the type of the first operand
+  auto* type = args[0]->getType();
+  auto* scalar_type = type->getScalarType();
+  if (!(scalar_type->isIntegerTy(16) || scalar_type->isIntegerTy(32) ||
+        scalar_type->isIntegerTy(64))) {
+    codegen_error(name + ": needs an integer");
+  }
+  auto* intrinsic = llvm::Intrinsic::getDeclaration(module_.get(), id, {type});
+  if (id == llvm::Intrinsic::ctlz || id == llvm::Intrinsic::cttz) {
+    // zero gives the bit width, not poison
+    return builder_.CreateCall(intrinsic, {args[0], builder_.getFalse()});
+  }
+  if (count == 1) {
+    return builder_.CreateCall(intrinsic, args);
+  }
+  // a funnel shift of a value with itself is a rotate, the amount is taken
+  // modulo the bit width
+  auto* amount = args[1];
+  auto* vector_type = llvm::dyn_cast<llvm::VectorType>(type);
+  if (amount->getType()->isVectorTy()) {
+    if (amount->getType() != type) {
+      codegen_error(name + ": vector amounts need the type of the value");
+    }
+  } else if (!amount->getType()->isIntegerTy() ||
+             amount->getType()->isIntegerTy(1)) {
+    codegen_error(name + ": the amount must be an integer");
+  } else if (vector_type != nullptr) {
+    amount = builder_.CreateVectorSplat(
+        vector_type->getNumElements(),
+        builder_.CreateIntCast(amount, scalar_type, false));
+  } else {
+    amount = builder_.CreateIntCast(amount, type, false);
+  }
+  return builder_.CreateCall(intrinsic, {args[0], args[0], amount});
+}
+
+llvm::Value* CodeGenerator::math_call(const std::string& name,
+                                      std::vector<llvm::Value*>& args) {
+  static const std::map<std::string, std::pair<llvm::Intrinsic::ID, size_t>>
+      intrinsics = {{"sqrt", {llvm::Intrinsic::sqrt, 1}},
+                    {"fabs", {llvm::Intrinsic::fabs, 1}},
+                    {"floor", {llvm::Intrinsic::floor, 1}},
+                    {"ceil", {llvm::Intrinsic::ceil, 1}},
+                    {"trunc", {llvm::Intrinsic::trunc, 1}},
+                    {"round", {llvm::Intrinsic::round, 1}},
+                    {"exp", {llvm::Intrinsic::exp, 1}},
+                    {"exp2", {llvm::Intrinsic::exp2, 1}},
+                    {"log", {llvm::Intrinsic::log, 1}},
+                    {"log2", {llvm::Intrinsic::log2, 1}},
+                    {"log10", {llvm::Intrinsic::log10, 1}},
+                    {"sin", {llvm::Intrinsic::sin, 1}},
+                    {"cos", {llvm::Intrinsic::cos, 1}},
+                    {"pow", {llvm::Intrinsic::pow, 2}},
+                    {"fma", {llvm::Intrinsic::fma, 3}},
+                    {"min", {llvm::Intrinsic::minnum, 2}},
+                    {"max", {llvm::Intrinsic::maxnum, 2}},
+                    {"abs", {llvm::Intrinsic::fabs, 1}}};
+  auto search = intrinsics.find(name);
+  // functions of the program shadow the builtins
+  if (search == intrinsics.end() || module_->getFunction(name) != nullptr) {
+    return nullptr;
+  }
+  auto id = search->second.first;
+  auto count = search->second.second;
+  if (args.size() != count) {
+    codegen_error(name + ": expects " + std::to_string(count) +
+                  (count == 1 ? " argument" : " arguments"));
+  }
+  // operands are brought to one type: the vector operand if there is one,
+  // else the widest integer for min, max and abs on integers, else double
+  // unless all of them are float
+  llvm::Type* type = nullptr;
+  bool is_integer = true;
+  bool is_float = true;
+  for (auto* arg : args) {
+    auto* arg_type = arg->getType();
+    auto* scalar_type = arg_type->getScalarType();
+    if (!(scalar_type->isFloatingPointTy() || scalar_type->isIntegerTy(16) ||
+          scalar_type->isIntegerTy(32) || scalar_type->isIntegerTy(64))) {
+      codegen_error(name + ": needs numeric arguments");
+    }
+    is_integer = is_integer && scalar_type->isIntegerTy();
+    is_float = is_float && scalar_type->isFloatTy();
+    if (arg_type->isVectorTy()) {
+      if (type != nullptr && type->isVectorTy() && type != arg_type) {
+        codegen_error(name + ": operands have different vector types");
+      }
+      type = arg_type;
+    } else if (type == nullptr || (!type->isVectorTy() &&
+                                   type->getScalarSizeInBits() <
+                                       arg_type->getScalarSizeInBits())) {
+      type = arg_type;
+    }
+  }
+  bool is_integer_op = is_integer && (id == llvm::Intrinsic::minnum ||
+                                      id == llvm::Intrinsic::maxnum ||
+                                      name == "abs");
+  if (!type->isVectorTy()) {
+    if (!is_integer_op) {
+      type = is_float ? builder_.getFloatTy() : builder_.getDoubleTy();
+    }
+  } else if (type->getScalarType()->isIntegerTy() && !is_integer_op) {
+    codegen_error(name + ": needs floating point lanes");
+  }
+  for (auto*& arg : args) {
+    if (type->isVectorTy()) {
+      if (!arg->getType()->isVectorTy()) {
+        arg = broadcast(arg, llvm::cast<llvm::VectorType>(type));
+      }
+    } else if (is_integer_op) {
+      arg = builder_.CreateIntCast(arg, type, true);
+    } else if (arg->getType()->isIntegerTy()) {
+      arg = builder_.CreateSIToFP(arg, type);
+    } else {
+      arg = builder_.CreateFPCast(arg, type);
+    }
+  }
+  if (is_integer_op) {
+    // compare and select, the form the vectorizer recognizes as integer
+    // min, max and abs
+    if (name == "abs") {
+      auto* zero = llvm::Constant::getNullValue(type);
+      return builder_.CreateSelect(builder_.CreateICmpSLT(args[0], zero),
+                                   builder_.CreateNeg(args[0]), args[0]);
+    }
+    auto* less = builder_.CreateICmpSLT(args[0], args[1]);
+    return id == llvm::Intrinsic::minnum
+               ? builder_.CreateSelect(less, args[0], args[1])
+               : builder_.CreateSelect(less, args[1], args[0]);
+  }
+  auto* intrinsic = llvm::Intrinsic::getDeclaration(module_.get(), id, {type});
+  return builder_.CreateCall(intrinsic, args);
+}
+
+void CodeGenerator::add_vector_library(
+    llvm::TargetLibraryInfoImpl& library_info) {
+  llvm::Triple triple(module_->getTargetTriple());
+  if (triple.getArch() != llvm::Triple::x86_64 || !triple.isOSLinux()) {
+    return;
+  }
+  if (target_machine_->getMCSubtargetInfo()->checkFeatures("+avx2")) {
+    library_info.addVectorizableFunctions(libmvec_avx2);
+  } else {
+    library_info.addVectorizableFunctions(libmvec_sse);
+  }
+}
+
+bool CodeGenerator::is_memoized(FunctionDefinition& function_definition,
+                                llvm::Function* function) {
+  auto& name = function_definition.get_identifier()->get_name();
+  bool requested =
+      function_definition.has_qualifier(type::FunctionQualifier::MEMO);
+  // the automatic mode only pays off for tree recursion
+  if (!requested &&
+      !(config_.auto_memo &&
+        count_calls(*(function_definition.get_compound_statement()), name) >=
+            2)) {
+    return false;
+  }
+  auto is_scalar = [](llvm::Type* type) {
+    return type->isIntegerTy() || type->isFloatTy() || type->isDoubleTy();
+  };
+  bool memoizable =
+      !function->arg_empty() && is_scalar(function->getReturnType());
+  for (auto& arg : function->args()) {
+    memoizable = memoizable && is_scalar(arg.getType());
+  }
+  if (!requested) {
+    return memoizable && purity_.is_pure(name);
+  }
+  if (!memoizable) {
+    codegen_error("memo function \'" + name +
+                  "\' needs scalar parameters and a scalar result");
+  }
+  if (!purity_.is_pure(name)) {
+    codegen_error("memo function \'" + name + "\' is not pure");
+  }
+  return true;
+}
+
+llvm::StructType* CodeGenerator::get_memo_type() {
+  if (memo_type_ == nullptr) {
+    // layout of ntrt_memo_table in runtime/ntrt.h
+    auto* i8_ptr = builder_.getInt8Ty()->getPointerTo();
+    memo_type_ = llvm::StructType::create(
+        module_->getContext(),
+        {i8_ptr, builder_.getInt32Ty(), builder_.getInt32Ty(),
+         builder_.getInt64Ty(), builder_.getInt64Ty(), builder_.getInt32Ty(),
+         builder_.getInt32Ty(), builder_.getInt32Ty(),
+         builder_.getInt64Ty()->getPointerTo(), i8_ptr},
+        "ntrt_memo_table");
+  }
+  return memo_type_;
+}
+
+llvm::Value* CodeGenerator::memo_encode(llvm::Value* value) {
+  auto* type = value->getType();
+  auto* word_type = builder_.getInt64Ty();
+  if (type->isFloatTy()) {
+    value = builder_.CreateFPExt(value, builder_.getDoubleTy());
+    type = value->getType();
+  }
+  if (type->isDoubleTy()) {
+    return builder_.CreateBitCast(value, word_type);
+  }
+  // bool and char are unsigned so that they index the direct table as is
+  bool is_signed = !type->isIntegerTy(1) && !type->isIntegerTy(8);
+  return builder_.CreateIntCast(value, word_type, is_signed);
+}
+
+llvm::Value* CodeGenerator::memo_decode(llvm::Value* word, llvm::Type* type) {
+  if (type->isFloatTy() || type->isDoubleTy()) {
+    auto* value = builder_.CreateBitCast(word, builder_.getDoubleTy());
+    return builder_.CreateFPCast(value, type);
+  }
+  return builder_.CreateIntCast(word, type, false);
+}
+
+void CodeGenerator::emit_memo_lookup(llvm::Function* function) {
+  auto& context = module_->getContext();
+  auto* word_type = builder_.getInt64Ty();
+  auto* return_type = function->getReturnType();
+  auto name = function->getName().str();
+
+  auto* name_init = llvm::ConstantDataArray::getString(context, name);
+  auto* name_global = new llvm::GlobalVariable(
+      *module_, name_init->getType(), true, llvm::GlobalValue::PrivateLinkage,
+      name_init, name + ".memo.name");
+  auto* memo_type = get_memo_type();
+  std::vector<llvm::Constant*> fields;
+  for (auto* field_type : memo_type->elements()) {
+    fields.push_back(llvm::Constant::getNullValue(field_type));
+  }
+  fields[MEMO_NAME] = llvm::ConstantExpr::getPointerCast(
+      name_global, builder_.getInt8Ty()->getPointerTo());
+  fields[MEMO_KEY_WORDS] = builder_.getInt32(function->arg_size());
+  fields[MEMO_MAX_ENTRIES] = builder_.getInt32(config_.memo_entries);
+  cur_memo_.table = new llvm::GlobalVariable(
+      *module_, memo_type, false, llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantStruct::get(memo_type, fields), name + ".memo");
+  memo_tables_.push_back(cur_memo_.table);
+
+  // arguments are saved as the key before the body can reassign them
+  auto* key_type = llvm::ArrayType::get(word_type, function->arg_size());
+  auto* key = builder_.CreateAlloca(key_type, nullptr, "memo.key");
+  unsigned index = 0;
+  for (auto& arg : function->args()) {
+    builder_.CreateStore(memo_encode(&arg),
+                         builder_.CreateConstInBoundsGEP2_32(key_type, key, 0,
+                                                             index++));
+  }
+  cur_memo_.key = builder_.CreateConstInBoundsGEP2_32(key_type, key, 0, 0);
+
+  auto* hit_block = llvm::BasicBlock::Create(context, "memo.hit", function);
+  auto* miss_block = llvm::BasicBlock::Create(context, "memo.miss", function);
+  std::vector<std::pair<llvm::Value*, llvm::BasicBlock*>> hits;
+
+  auto* first = &*(function->arg_begin());
+  if (function->arg_size() == 1 && first->getType()->isIntegerTy()) {
+    // small integer domains are cached in a table indexed by the argument
+    auto bits = first->getType()->getIntegerBitWidth();
+    cur_memo_.full_domain = bits <= 16;
+    cur_memo_.direct_entries =
+        cur_memo_.full_domain ? (uint64_t(1) << bits) : kMemoDirectEntries;
+    cur_memo_.index = cur_memo_.full_domain
+                          ? builder_.CreateZExt(first, word_type)
+                          : builder_.CreateLoad(cur_memo_.key);
+    auto* values_type =
+        llvm::ArrayType::get(return_type, cur_memo_.direct_entries);
+    auto* valid_type =
+        llvm::ArrayType::get(builder_.getInt8Ty(), cur_memo_.direct_entries);
+    cur_memo_.values = new llvm::GlobalVariable(
+        *module_, values_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::Constant::getNullValue(values_type), name + ".memo.values");
+    cur_memo_.valid = new llvm::GlobalVariable(
+        *module_, valid_type, false, llvm::GlobalValue::InternalLinkage,
+        llvm::Constant::getNullValue(valid_type), name + ".memo.valid");
+  }
+
+  llvm::BasicBlock* hash_block = nullptr;
+  llvm::Value* cached = nullptr;
+  if (!cur_memo_.full_domain) {
+    hash_block = llvm::BasicBlock::Create(context, "memo.hash", function);
+    cached = builder_.CreateAlloca(word_type, nullptr, "memo.value");
+  }
+  if (cur_memo_.values != nullptr) {
+    auto* direct_block =
+        llvm::BasicBlock::Create(context, "memo.direct", function);
+    auto* direct_hit_block =
+        llvm::BasicBlock::Create(context, "memo.direct.hit", function);
+    if (hash_block != nullptr) {
+      auto* in_range = builder_.CreateICmpULT(
+          cur_memo_.index, builder_.getInt64(cur_memo_.direct_entries));
+      builder_.CreateCondBr(in_range, direct_block, hash_block);
+    } else {
+      builder_.CreateBr(direct_block);
+    }
+    builder_.SetInsertPoint(direct_block);
+    // the value of a published entry is never written again
+    auto* valid = builder_.CreateLoad(builder_.CreateInBoundsGEP(
+        cur_memo_.valid, {builder_.getInt64(0), cur_memo_.index}));
+    valid->setAtomic(llvm::AtomicOrdering::Acquire);
+    valid->setAlignment(1);
+    builder_.CreateCondBr(
+        builder_.CreateICmpEQ(valid, builder_.getInt8(kMemoPublished)),
+        direct_hit_block, miss_block);
+    builder_.SetInsertPoint(direct_hit_block);
+    hits.emplace_back(
+        builder_.CreateLoad(builder_.CreateInBoundsGEP(
+            cur_memo_.values, {builder_.getInt64(0), cur_memo_.index})),
+        direct_hit_block);
+    builder_.CreateBr(hit_block);
+  } else {
+    builder_.CreateBr(hash_block);
+  }
+
+  if (hash_block != nullptr) {
+    builder_.SetInsertPoint(hash_block);
+    auto* lookup = module_->getOrInsertFunction(
+        "ntrt_memo_lookup",
+        llvm::FunctionType::get(
+            builder_.getInt32Ty(),
+            {memo_type->getPointerTo(), word_type->getPointerTo(),
+             word_type->getPointerTo()},
+            false));
+    auto* found =
+        builder_.CreateCall(lookup, {cur_memo_.table, cur_memo_.key, cached});
+    auto* hash_hit_block =
+        llvm::BasicBlock::Create(context, "memo.hash.hit", function);
+    builder_.CreateCondBr(builder_.CreateIsNotNull(found), hash_hit_block,
+                          miss_block);
+    builder_.SetInsertPoint(hash_hit_block);
+    hits.emplace_back(memo_decode(builder_.CreateLoad(cached), return_type),
+                      hash_hit_block);
+    builder_.CreateBr(hit_block);
+  }
+
+  builder_.SetInsertPoint(hit_block);
+  auto* result = builder_.CreatePHI(return_type, hits.size());
+  for (auto& hit : hits) {
+    result->addIncoming(hit.first, hit.second);
+  }
+  if (config_.show_stats) {
+    emit_memo_count(MEMO_HITS);
+  }
+  emit_call_exit();
+  builder_.CreateRet(result);
+
+  builder_.SetInsertPoint(miss_block);
+  if (config_.show_stats) {
+    emit_memo_count(MEMO_MISSES);
+  }
+}
+
+void CodeGenerator::emit_memo_store(llvm::Value* result) {
+  auto& context = module_->getContext();
+  auto* function = builder_.GetInsertBlock()->getParent();
+  auto* done_block = llvm::BasicBlock::Create(context, "memo.done", function);
+  llvm::BasicBlock* hash_block = nullptr;
+  if (!cur_memo_.full_domain) {
+    hash_block =
+        llvm::BasicBlock::Create(context, "memo.store.hash", function);
+  }
+  if (cur_memo_.values != nullptr) {
+    auto* direct_block =
+        llvm::BasicBlock::Create(context, "memo.store.direct", function);
+    if (hash_block != nullptr) {
+      auto* in_range = builder_.CreateICmpULT(
+          cur_memo_.index, builder_.getInt64(cur_memo_.direct_entries));
+      builder_.CreateCondBr(in_range, direct_block, hash_block);
+    } else {
+      builder_.CreateBr(direct_block);
+    }
+    builder_.SetInsertPoint(direct_block);
+    // the first thread to claim an entry writes and publishes it, the others
+    // computed the same value and leave it
+    auto* valid = builder_.CreateInBoundsGEP(
+        cur_memo_.valid, {builder_.getInt64(0), cur_memo_.index});
+    auto* claim = builder_.CreateAtomicCmpXchg(
+        valid, builder_.getInt8(kMemoEmpty), builder_.getInt8(kMemoClaimed),
+        llvm::AtomicOrdering::Monotonic, llvm::AtomicOrdering::Monotonic);
+    auto* write_block =
+        llvm::BasicBlock::Create(context, "memo.store.write", function);
+    builder_.CreateCondBr(builder_.CreateExtractValue(claim, 1), write_block,
+                          done_block);
+    builder_.SetInsertPoint(write_block);
+    builder_.CreateStore(
+        result, builder_.CreateInBoundsGEP(
+                    cur_memo_.values, {builder_.getInt64(0), cur_memo_.index}));
+    auto* publish =
+        builder_.CreateStore(builder_.getInt8(kMemoPublished), valid);
+    publish->setAtomic(llvm::AtomicOrdering::Release);
+    publish->setAlignment(1);
+    builder_.CreateBr(done_block);
+  } else {
+    builder_.CreateBr(hash_block);
+  }
+  if (hash_block != nullptr) {
+    builder_.SetInsertPoint(hash_block);
+    auto* word_type = builder_.getInt64Ty();
+    auto* insert = module_->getOrInsertFunction(
+        "ntrt_memo_insert",
+        llvm::FunctionType::get(builder_.getVoidTy(),
+                                {get_memo_type()->getPointerTo(),
+                                 word_type->getPointerTo(), word_type},
+                                false));
+    builder_.CreateCall(insert,
+                        {cur_memo_.table, cur_memo_.key, memo_encode(result)});
+    builder_.CreateBr(done_block);
+  }
+  builder_.SetInsertPoint(done_block);
+}
+
+void CodeGenerator::emit_memo_count(int field) {
+  auto* counter =
+      builder_.CreateStructGEP(get_memo_type(), cur_memo_.table, field);
+  // several threads may count at once
+  builder_.CreateAtomicRMW(llvm::AtomicRMWInst::Add, counter,
+                           builder_.getInt64(1),
+                           llvm::AtomicOrdering::Monotonic);
+}
+
+void CodeGenerator::emit_memo_registration() {
+  // a constructor hands every table to the runtime, which prints the
+  // counters at exit
+  auto* init = llvm::Function::Create(
+      llvm::FunctionType::get(builder_.getVoidTy(), false),
+      llvm::GlobalValue::InternalLinkage, "ntc.memo.init", module_.get());
+  builder_.SetInsertPoint(
+      llvm::BasicBlock::Create(module_->getContext(), "entry", init));
+  auto* register_table = module_->getOrInsertFunction(
+      "ntrt_memo_register",
+      llvm::FunctionType::get(builder_.getVoidTy(),
+                              {get_memo_type()->getPointerTo()}, false));
+  for (auto* table : memo_tables_) {
+    builder_.CreateCall(register_table, {table});
+  }
+  builder_.CreateRetVoid();
+  llvm::appendToGlobalCtors(*module_, init, 65535);
+}
+
+void CodeGenerator::emit_tail_header(llvm::Function* function) {
+  if (cur_tail_.shape.accumulator != type::BinaryOp::ASSIGN) {
+    auto* return_type = function->getReturnType();
+    int identity = cur_tail_.shape.accumulator == type::BinaryOp::ADD ? 0 : 1;
+    cur_tail_.accumulator = create_entry_alloca(return_type);
+    builder_.CreateStore(llvm::ConstantInt::get(return_type, identity),
+                         cur_tail_.accumulator);
+  }
+  cur_tail_.header =
+      llvm::BasicBlock::Create(module_->getContext(), "tailrecurse", function);
+  builder_.CreateBr(cur_tail_.header);
+  builder_.SetInsertPoint(cur_tail_.header);
+}
+
+bool CodeGenerator::emit_tail_call(Expression& expression) {
+  Expression* operand = nullptr;
+  auto* function_call = match_tail_call(expression, cur_function_name_,
+                                        cur_tail_.shape.accumulator, &operand);
+  if (function_call == nullptr) {
+    return false;
+  }
+  auto* function = builder_.GetInsertBlock()->getParent();
+  auto& argument_list = function_call->get_argument_list();
+  if (argument_list.size() != cur_tail_.parameters.size()) {
+    return false;
+  }
+  // array parameters are never reassigned, only the incoming array itself
+  // may be passed on
+  size_t index = 0;
+  for (auto& arg : function->args()) {
+    if (cur_tail_.parameters[index] == nullptr) {
+      auto* identifier = dynamic_cast<Identifier*>(argument_list[index].get());
+      auto* record = identifier == nullptr
+                         ? nullptr
+                         : symbol_table_.get_symbol(identifier->get_name());
+      if (record == nullptr || record->val != &arg) {
+        return false;
+      }
+    }
+    ++index;
+  }
+
+  llvm::Value* operand_value = nullptr;
+  if (operand != nullptr) {
+    // e op f(...) computes in the wider of both types before it is stored
+    // to the return type, which wrapping arithmetic can do up front unless
+    // e is too wide to be returned at all
+    auto* return_type = function->getReturnType();
+    operand_value = operand->accept(*this);
+    auto* operand_type = operand_value->getType();
+    if (!(operand_type->isIntegerTy(16) || operand_type->isIntegerTy(32) ||
+          operand_type->isIntegerTy(64)) ||
+        (operand_type->isIntegerTy(64) && !return_type->isIntegerTy(64))) {
+      return false;
+    }
+    operand_value = builder_.CreateIntCast(operand_value, return_type,
+                                           !is_unsigned(*operand));
+  }
+
+  // every argument is evaluated before the first parameter is overwritten
+  std::vector<llvm::Value*> values;
+  for (size_t i = 0; i < argument_list.size(); ++i) {
+    auto* parameter = cur_tail_.parameters[i];
+    if (parameter == nullptr) {
+      values.push_back(nullptr);
+      continue;
+    }
+    auto* value = argument_list[i]->accept(*this);
+    if (value->getType() != parameter->getType()->getPointerElementType()) {
+      codegen_error("invalid argument type: " + cur_function_name_);
+    }
+    values.push_back(value);
+  }
+  if (operand_value != nullptr) {
+    builder_.CreateStore(accumulate(operand_value), cur_tail_.accumulator);
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i] != nullptr) {
+      builder_.CreateStore(values[i], cur_tail_.parameters[i]);
+    }
+  }
+  builder_.CreateBr(cur_tail_.header);
+  ++tail_calls_;
+  return true;
+}
+
+llvm::Value* CodeGenerator::accumulate(llvm::Value* value) {
+  if (cur_tail_.accumulator == nullptr) {
+    return value;
+  }
+  auto* accumulator = builder_.CreateLoad(cur_tail_.accumulator);
+  if (cur_tail_.shape.accumulator == type::BinaryOp::ADD) {
+    return builder_.CreateAdd(accumulator, value);
+  }
+  return builder_.CreateMul(accumulator, value);
+}
 }  // namespace ntc
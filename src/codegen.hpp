@@ -1,30 +1,50 @@
 #pragma once
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
+#include <llvm/IR/ValueHandle.h>
+#include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Target/TargetMachine.h>
 #include <deque>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include "ast.hpp"
 #include "config.hpp"
+#include "profile.hpp"
+#include "purity.hpp"
+#include "recursion.hpp"
+#include "remarks.hpp"
 #include "visitor.hpp"
 
 namespace ntc {
-static llvm::LLVMContext llvm_context;
+// shared by every module, modules of several files are linked together
+extern llvm::LLVMContext llvm_context;
 
 struct SymbolRecord {
   SymbolRecord(){};
 
-  SymbolRecord(llvm::Value* _val, llvm::Type* _type, bool _is_const, bool _is_array)
-      : val(_val), is_const(_is_const), type(_type), is_array(_is_array) {}
+  SymbolRecord(llvm::Value* _val, llvm::Type* _type, bool _is_const, bool _is_array,
+               bool _is_atomic = false, bool _is_unsigned = false)
+      : val(_val),
+        is_const(_is_const),
+        type(_type),
+        is_array(_is_array),
+        is_atomic(_is_atomic),
+        is_unsigned(_is_unsigned) {}
   llvm::Value* val;
   llvm::Type* type;
   bool is_const;
   bool is_array;
+  // elements of atomic arrays are atomic
+  bool is_atomic;
+  // llvm integers are signless, unsigned int and long are tracked here
+  bool is_unsigned;
 };
 
 class SymbolTable {
@@ -38,7 +58,8 @@ class SymbolTable {
   bool find_symbol_local(const std::string& name);
 
   void add_symbol(const std::string& name, llvm::Value* val, llvm::Type* type,
-                  bool is_const, bool is_array);
+                  bool is_const, bool is_array, bool is_atomic = false,
+                  bool is_unsigned = false);
 
   SymbolRecord* get_symbol(const std::string& name);
 
@@ -48,13 +69,14 @@ class SymbolTable {
 
 class CodeGenerator final : public IRVisitor {
  public:
-  CodeGenerator(const std::string& module_id);
+  CodeGenerator(const std::string& module_id, const ProgramConfig& config);
 
   virtual llvm::Value* visit(AST&) override;
   virtual llvm::Value* visit(BlockItem&) override;
   virtual llvm::Value* visit(ExternalDeclaration&) override;
   virtual llvm::Value* visit(TranslationUnit&) override;
   virtual llvm::Value* visit(FunctionDefinition&) override;
+  virtual llvm::Value* visit(FunctionDeclaration&) override;
   virtual llvm::Value* visit(DeclarationSpecifier&) override;
   virtual llvm::Value* visit(Identifier&) override;
   virtual llvm::Value* visit(ParameterDeclaration&) override;
@@ -68,9 +90,14 @@ class CodeGenerator final : public IRVisitor {
   virtual llvm::Value* visit(ReturnStatement&) override;
   virtual llvm::Value* visit(BreakStatement&) override;
   virtual llvm::Value* visit(ContinueStatement&) override;
+  virtual llvm::Value* visit(BecomeStatement&) override;
+  virtual llvm::Value* visit(SyncStatement&) override;
+  virtual llvm::Value* visit(TraceSpanStatement&) override;
   virtual llvm::Value* visit(IfStatement&) override;
+  virtual llvm::Value* visit(SwitchStatement&) override;
   virtual llvm::Value* visit(WhileStatement&) override;
   virtual llvm::Value* visit(ForStatement&) override;
+  virtual llvm::Value* visit(ParallelForStatement&) override;
   virtual llvm::Value* visit(Expression&) override;
   virtual llvm::Value* visit(IntegerExpression&) override;
   virtual llvm::Value* visit(FloatExpression&) override;
@@ -81,12 +108,56 @@ class CodeGenerator final : public IRVisitor {
   virtual llvm::Value* visit(UnaryOperationExpression&) override;
   virtual llvm::Value* visit(ConditionalExpression&) override;
   virtual llvm::Value* visit(FunctionCall&) override;
+  virtual llvm::Value* visit(SpawnExpression&) override;
   virtual llvm::Value* visit(ArrayReference&) override;
 
   void output(const std::string& filename, ProgramMode mode);
 
+  // links a module of another file or bitcode into this one
+  void link(std::unique_ptr<llvm::Module> module);
+
+  // -fwhole-program over linked modules: every function but main becomes
+  // internal, returns the functions removed as unreferenced
+  int internalize();
+
+  // the module of a further input, before it is linked
+  std::unique_ptr<llvm::Module> release_module() { return std::move(module_); }
+
+  // --run: JIT compiles the output module and runs main, returning its exit
+  // status; ntc has to exit with it, see run_module
+  int run();
+
+  int get_memoized_functions() const { return memo_tables_.size(); }
+
+  int get_tail_calls() const { return tail_calls_; }
+
+  int get_parallel_loops() const { return parallel_loops_; }
+
+  // in the module as it is now, after a link or internalize
+  int get_fast_functions() const;
+
+  int get_removed_functions() const { return removed_functions_; }
+
+  // time lld took to link the executable of the last output, 0 for the
+  // other modes
+  long long get_link_microseconds() const { return link_microseconds_; }
+
+  // functions given counters by -fprofile-generate, or weighted by the
+  // profile of -fprofile-use
+  int get_profiled_functions() const { return profiled_functions_; }
+
+  // functions whose -fprofile-use record no longer matches their code
+  const std::vector<std::string>& get_stale_profiles() const {
+    return stale_profiles_;
+  }
+
+  // remarks of the last output, nullptr if none were asked for
+  const RemarkHandler* get_remarks() const { return remarks_; }
+
  protected:
   std::unique_ptr<llvm::Module> module_;
+  std::unique_ptr<llvm::TargetMachine> target_machine_;
+  ProgramConfig config_;
   std::map<std::string, llvm::Value*> locals_;
   llvm::IRBuilder<> builder_;
   std::string module_id_;
@@ -98,24 +169,375 @@ class CodeGenerator final : public IRVisitor {
   bool is_return_happened;
   llvm::BasicBlock* cur_return_block;
 
+  // cache in front of the current function, table is null if the function
+  // is not memoized
+  struct MemoCache {
+    llvm::GlobalVariable* table = nullptr;
+    llvm::Value* key = nullptr;
+    // direct-indexed part for a single integer argument
+    llvm::GlobalVariable* values = nullptr;
+    llvm::GlobalVariable* valid = nullptr;
+    llvm::Value* index = nullptr;
+    uint64_t direct_entries = 0;
+    bool full_domain = false;
+  };
+  PurityAnalysis purity_;
+  MemoCache cur_memo_;
+  std::vector<llvm::GlobalVariable*> memo_tables_;
+  llvm::StructType* memo_type_;
+
+  // self tail calls of the current function branch back to header, in
+  // accumulator mode every return yields accumulator op value
+  struct TailLoop {
+    TailRecursion shape;
+    llvm::BasicBlock* header = nullptr;
+    llvm::Value* accumulator = nullptr;
+    // stack slots of the parameters, nullptr for array parameters
+    std::vector<llvm::Value*> parameters;
+  };
+  TailLoop cur_tail_;
+  int tail_calls_;
+  // outlined parallel for bodies, numbers their functions
+  int parallel_loops_;
+  // ntrt_task_group of the current function, nullptr if it never spawns
+  llvm::Value* cur_task_group_;
+  // stack pointer before the first task record a loop allocated since the
+  // last sync, null when there is none
+  llvm::Value* cur_task_stack_;
+  int spawns_;
+  // thread_spawn records, numbers their thunks
+  int threads_;
+  int removed_functions_;
+  long long link_microseconds_;
+  // export functions, whose C entry points are emitted once the whole file
+  // is compiled
+  struct ExportFunction {
+    llvm::Function* function;
+    // declared length of every parameter, 0 if it has none and -1 if the
+    // parameter is no array
+    std::vector<int> array_lengths;
+    std::vector<bool> unsigneds;
+    bool return_unsigned;
+  };
+  std::vector<ExportFunction> exports_;
+  // extern "C" functions, whether each of their parameters is an array
+  std::map<std::string, std::vector<bool>> c_functions_;
+  // while and for statements around the current statement
+  int loop_depth_;
+  // where break leaves the innermost loop or switch, and where continue
+  // starts the next iteration of the innermost loop
+  std::vector<llvm::BasicBlock*> break_blocks_;
+  std::vector<llvm::BasicBlock*> continue_blocks_;
+  // trace spans open where each break and continue block was pushed
+  std::vector<size_t> break_spans_;
+  std::vector<size_t> continue_spans_;
+  // integer expressions of unsigned type and functions returning one
+  std::set<const Expression*> unsigned_;
+  std::set<std::string> unsigned_functions_;
+
+  // counters of one function under -fprofile-generate, or the branches to
+  // weight under -fprofile-use; counter 0 counts calls, conditional
+  // branches take a false and a true counter and switches one per edge
+  struct ProfileState {
+    llvm::Function* function = nullptr;
+    // [0 x i64] stand-in for the counter array until its size is known,
+    // nullptr under -fprofile-use
+    llvm::GlobalVariable* counters = nullptr;
+    int num_counters = 1;
+    // hash of the branch shapes, a function edited since its profile was
+    // written does not match it anymore
+    uint64_t checksum = 0;
+    // branches with their first counter, weighted once the whole function
+    // matched its profile
+    std::vector<std::pair<llvm::WeakTrackingVH, int>> branches;
+  };
+  std::deque<ProfileState> profiles_;
+  ProfileData profile_data_;
+  llvm::StructType* profile_type_;
+  int profiled_functions_;
+  std::vector<std::string> stale_profiles_;
+  // ntrt_func_site records of -finstrument-functions=profile
+  llvm::GlobalVariable* cur_call_site_;
+  std::vector<llvm::GlobalVariable*> call_sites_;
+  // ntrt_perf_site records of --perf-counters
+  llvm::GlobalVariable* cur_perf_site_;
+  std::vector<llvm::GlobalVariable*> perf_sites_;
+  // ntrt_trace_site records by span name, and the spans open around the
+  // current statement, innermost last
+  std::map<std::string, llvm::GlobalVariable*> trace_sites_;
+  std::vector<llvm::GlobalVariable*> trace_spans_;
+  // -g: null without it; the scope is the subprogram or lexical block of
+  // the code being generated
+  std::unique_ptr<llvm::DIBuilder> debug_builder_;
+  llvm::DIFile* debug_file_;
+  llvm::DIScope* debug_scope_;
+  // owned by llvm_context
+  RemarkHandler* remarks_;
+  std::unique_ptr<llvm::ToolOutputFile> remarks_file_;
+
   llvm::Type* get_llvm_type(DeclarationSpecifier& declaration_specifier);
 
+  llvm::AllocaInst* create_entry_alloca(llvm::Type* type);
+
   llvm::Value* get_identifier_ptr(Identifier* identifier);
 
   bool get_const(DeclarationSpecifier& declaration_specifier);
 
+  bool get_unsigned(DeclarationSpecifier& declaration_specifier);
+
+  bool is_unsigned(const Expression& expression) const {
+    return unsigned_.count(&expression) != 0;
+  }
+
   void codegen_error(const std::string& msg);
 
+  // converts *rhs to lhs_type, rhs_unsigned picks zero over sign extension
   void assignment_type_check(llvm::Type* lhs_type, llvm::Type* rhs_type,
-                             llvm::Value** rhs);
+                             llvm::Value** rhs, bool rhs_unsigned = false);
 
-  llvm::Value* print_call(llvm::Value* arg, bool newline);
+  llvm::Value* print_call(llvm::Value* arg, bool newline,
+                          bool is_unsigned = false);
 
   llvm::Value* input_call(Expression& expr);
 
+  // loads and stores of atomic variables are sequentially consistent
+  llvm::Value* load_symbol(llvm::Value* ptr, const SymbolRecord& record);
+
+  void store_symbol(llvm::Value* value, llvm::Value* ptr,
+                    const SymbolRecord& record);
+
+  // address of the atomic variable or array element expression names
+  llvm::Value* get_atomic_ptr(Expression& expression,
+                              const std::string& builtin);
+
+  // load, store, fetch_add, fetch_sub, compare_exchange, lock and unlock,
+  // nullptr if name is none of them
+  llvm::Value* atomic_call(const std::string& name,
+                           std::vector<std::unique_ptr<Expression>>& arguments);
+
+  // scalar converted to the lane type and repeated in every lane
+  llvm::Value* broadcast(llvm::Value* scalar, llvm::VectorType* type);
+
+  // lane-wise arithmetic and comparisons, scalar operands are broadcast
+  llvm::Value* vector_binary_operation(type::BinaryOp op, llvm::Value* lhs,
+                                       llvm::Value* rhs);
+
+  // vloadN, vstore, broadcastN, shuffle and reduce_add/mul/min/max,
+  // nullptr if name is none of them
+  llvm::Value* vector_call(const std::string& name,
+                           std::vector<llvm::Value*>& args);
+
+  // popcount, clz, ctz, rotl, rotr and bswap, nullptr if name is none of
+  // them
+  llvm::Value* bit_call(const std::string& name,
+                        std::vector<llvm::Value*>& args);
+
+  // math functions as LLVM intrinsics the vectorizer can widen, nullptr if
+  // name is none of them
+  llvm::Value* math_call(const std::string& name,
+                         std::vector<llvm::Value*>& args);
+
+  // likely, unlikely and prefetch(arr[i], rw, locality), nullptr if name
+  // is none of them
+  llvm::Value* hint_call(const std::string& name,
+                         std::vector<std::unique_ptr<Expression>>& arguments);
+
+  // hot and cold functions go to .text.hot and .text.unlikely, cold ones
+  // stay out of line, are optimized for size and make the paths calling
+  // them unlikely
+  void set_hotness(llvm::Function* function,
+                   FunctionDefinition& function_definition);
+
+  // the function a prototype created, or a new external declaration
+  llvm::Function* declare_function(const std::string& name,
+                                   llvm::FunctionType* type);
+
+  llvm::Type* get_parameter_type(ParameterDeclaration& parameter_declaration);
+
+  // static functions and, with -fwhole-program, all but main are internal;
+  // inline ones may be dropped when unused
+  llvm::GlobalValue::LinkageTypes get_linkage(
+      FunctionDefinition& function_definition);
+
+  // the C entry point of an export function takes the length after every
+  // array and checks it against the declared one, then calls the function,
+  // which becomes internal under a .body suffix
+  void emit_c_entry(ExportFunction& export_function);
+
+  // bool, char and short arguments and results are extended as the C
+  // calling convention has it, one unsigned flag per parameter
+  void add_c_attributes(llvm::Function* function,
+                        const std::vector<bool>& unsigneds,
+                        bool return_unsigned);
+
+  // vectors have no C type, name is the function for the error
+  void check_c_type(llvm::Type* type, const std::string& name);
+
+  // arguments of a call to an extern "C" function, with the length of every
+  // array argument after it
+  std::vector<llvm::Value*> add_array_lengths(
+      const std::string& name, const std::vector<bool>& arrays,
+      std::vector<std::unique_ptr<Expression>>& arguments,
+      const std::vector<llvm::Value*>& args);
+
+  // -shared: only the C entry points are visible outside the library, calls
+  // to the other functions stay direct in position independent code
+  void hide_functions();
+
+  // removes unreferenced functions and globals, then internal functions
+  // only ever called directly get the fast calling convention; returns the
+  // functions removed
+  int finish_linkage();
+
+  // a likely(c) or unlikely(c) condition weights the branch
+  void create_cond_br(Expression& condition, llvm::Value* cond_val,
+                      llvm::BasicBlock* true_block,
+                      llvm::BasicBlock* false_block);
+
+  // profile state of the function being generated, created and counted on
+  // entry the first time; nullptr if profiles are off
+  ProfileState* get_profile_state();
+
+  // first of count new counters of state
+  int add_profile_counters(ProfileState& state, int count);
+
+  void emit_profile_increment(llvm::IRBuilder<>& builder, ProfileState& state,
+                              llvm::Value* index);
+
+  // target, reached through a block bumping counter when instrumenting
+  llvm::BasicBlock* profile_edge(ProfileState* state, int counter,
+                                 llvm::BasicBlock* target);
+
+  llvm::StructType* get_profile_type();
+
+  // sizes the counter arrays and hands them to the runtime
+  void emit_profile_registration();
+
+  // entry counts, branch weights and the profile summary of -fprofile-use
+  void apply_profile();
+
+  // -finstrument-functions=profile and --perf-counters hooks, exit runs
+  // before every return and tail call of the current function
+  void emit_call_enter(llvm::Function* function);
+
+  void emit_perf_begin(llvm::Function* function);
+
+  void emit_call_exit();
+
+  // {name, index, next} record of ntrt_func_site, ntrt_trace_site and
+  // ntrt_perf_site, the runtime fills in the rest
+  llvm::GlobalVariable* create_site(const std::string& name,
+                                    const std::string& global_name);
+
+  void emit_site_call(const std::string& function,
+                      llvm::GlobalVariable* site);
+
+  // a constructor hands every site to the register function of the runtime
+  void emit_site_registration(const std::string& init_name,
+                              const std::string& function,
+                              const std::vector<llvm::GlobalVariable*>& sites);
+
+  // trace(id, value) and trace_flush(), nullptr if name is neither
+  llvm::Value* trace_call(const std::string& name,
+                          std::vector<std::unique_ptr<Expression>>& arguments);
+
+  // ends the spans opened since depth of them were open, innermost first,
+  // before a jump leaves them
+  void emit_trace_ends(size_t depth);
+
+  // -g: location of node for the instructions that follow, nodes without a
+  // range keep the location around them
+  void set_debug_location(const AST& node);
+
+  void set_debug_location(int line, int column);
+
+  llvm::DIType* get_debug_type(llvm::Type* type, bool is_unsigned);
+
+  // subprogram of function at line, the scope of the locations that follow
+  void begin_debug_function(llvm::Function* function, int line,
+                            llvm::DISubroutineType* type, bool is_artificial);
+
+  // artificial subprogram for a thunk or outlined body made at the current
+  // location, callers restore debug_scope_ and the location afterwards
+  void begin_debug_thunk(llvm::Function* function);
+
+  // storage is a stack slot, or the value itself for array parameters;
+  // argument counts from 1, 0 for locals
+  void emit_debug_variable(const std::string& name, llvm::Value* storage,
+                           llvm::DIType* type, int line,
+                           unsigned argument = 0);
+
+  // thread_spawn(f, args...) copies the arguments into a record the new
+  // thread passes to f
+  llvm::Value* thread_spawn_call(
+      std::vector<std::unique_ptr<Expression>>& arguments);
+
+  void create_target_machine();
+
+  // --remarks-file, open while the passes run
+  void open_remarks_file();
+
+  void close_remarks_file();
+
+  void optimize();
+
+  // -O3 with -march maps math intrinsics to glibc's libmvec so loops
+  // calling them can still be vectorized
+  void add_vector_library(llvm::TargetLibraryInfoImpl& library_info);
+
   void emit_code(llvm::raw_fd_ostream& fd,
                  llvm::TargetMachine::CodeGenFileType type);
 
+  // the object goes to a temporary file that lld links into filename
+  void emit_executable(const std::string& filename);
+
+  void add_array_parameter_attributes(llvm::Function* function, unsigned index,
+                                      llvm::Type* element_type, int length,
+                                      bool is_restrict);
+
+  std::vector<llvm::Value*> emit_arguments(
+      std::vector<std::unique_ptr<Expression>>& arguments);
+
+  void check_array_arguments(
+      llvm::Function* function,
+      std::vector<std::unique_ptr<Expression>>& arguments);
+
   llvm::Value* get_array_reference_ptr(ArrayReference* array_reference);
+
+  bool is_memoized(FunctionDefinition& function_definition,
+                   llvm::Function* function);
+
+  llvm::StructType* get_memo_type();
+
+  llvm::Value* memo_encode(llvm::Value* value);
+
+  llvm::Value* memo_decode(llvm::Value* word, llvm::Type* type);
+
+  void emit_memo_lookup(llvm::Function* function);
+
+  void emit_memo_store(llvm::Value* result);
+
+  void emit_memo_count(int field);
+
+  void emit_memo_registration();
+
+  void emit_tail_header(llvm::Function* function);
+
+  bool emit_tail_call(Expression& expression);
+
+  llvm::Value* accumulate(llvm::Value* value);
+
+  // body of a parallel for as a function run by every pool thread,
+  // captures are passed as pointers after lo and step in context_type
+  llvm::Function* emit_parallel_body(ParallelForStatement& statement,
+                                     const std::string& variable,
+                                     const std::vector<std::string>& captures,
+                                     llvm::StructType* context_type);
+
+  // target receives the result of the call once the function syncs
+  void emit_spawn(SpawnExpression& spawn_expression, Identifier* target);
+
+  // waits for the calls spawned by the current function, if any
+  void emit_sync();
 };
 }  // namespace ntc
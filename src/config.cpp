@@ -1,17 +1,88 @@
 #include "config.hpp"
+#include <regex>
+#include <sstream>
+namespace {
+// profile of -fprofile-generate and -fprofile-use without a file name
+const char* const kDefaultProfile = "ntc.prof";
+
+// gcc style -f<feature>, -R<remark>, -march=<cpu>, -static and -shared
+// flags are not expressible in cxxopts, so they are taken out of argv before
+// it is parsed
+std::vector<std::string> extract_feature_flags(
+    int& argc, char* argv[], std::string& target_cpu,
+    std::vector<std::string>& remark_flags, bool& static_link,
+    bool& shared_library) {
+  std::vector<std::string> flags;
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg.size() > 2 && arg.compare(0, 2, "-f") == 0) {
+      flags.push_back(arg.substr(2));
+    } else if (arg.size() > 2 && arg.compare(0, 2, "-R") == 0) {
+      remark_flags.push_back(arg.substr(2));
+    } else if (arg.compare(0, 7, "-march=") == 0) {
+      target_cpu = arg.substr(7);
+    } else if (arg == "-static") {
+      static_link = true;
+    } else if (arg == "-shared") {
+      shared_library = true;
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+  return flags;
+}
+}  // namespace
+
 ProgramConfig parse_program_options(int argc, char* argv[]) {
   using namespace cxxopts;
+  std::string target_cpu = "generic";
+  std::vector<std::string> remark_flags;
+  bool static_link = false;
+  bool shared_library = false;
+  auto feature_flags = extract_feature_flags(
+      argc, argv, target_cpu, remark_flags, static_link, shared_library);
   try {
     cxxopts::Options options(argv[0], "- ntc: No-Tiger Lang Compiler`");
     options.positional_help("[optional args]").show_positional_help();
-    options.add_options()("i, input", "Input file",
-                          cxxopts::value<std::string>(),
+    options.add_options()("i, input",
+                          "Input file, more source or bitcode files are "
+                          "linked into it",
+                          cxxopts::value<std::vector<std::string>>(),
                           "FILE")("l", "Emit llvm IR")(
         "s", "Emit assembly code")("c", "Emit object code")(
-        "o, output", "Output file",
+        "emit-bitcode", "Emit LLVM bitcode for a later link")(
+        "emit-header", "Emit a C/C++ header of the export functions")(
+        "o, output", "Output file, an executable without a mode option",
         cxxopts::value<std::string>()->default_value("[same-as-input]"),
-        "FILE")("d, dump-ast", "Dump AST in XML format")("h, help",
-                                                         "Show help");
+        "FILE")("d, dump-ast", "Dump AST in XML format")(
+        "O, opt-level", "Optimization level (0-3)",
+        cxxopts::value<int>()->default_value("0"), "LEVEL")(
+        "g", "Emit debug information")(
+        "stats", "Print compilation statistics")(
+        "ctfe-steps", "Step budget of each compile time evaluation",
+        cxxopts::value<int>()->default_value("10000000"), "N")(
+        "ctfe-memory", "Memory budget of each compile time evaluation",
+        cxxopts::value<int>()->default_value("64"), "MIB")(
+        "memo-entries", "Capacity limit of each memo hash table",
+        cxxopts::value<int>()->default_value("65536"), "N")(
+        "parallel-threshold",
+        "Trip count below which -fauto-parallel keeps loops serial",
+        cxxopts::value<int>()->default_value("1000"), "N")(
+        "parallel-report", "Report the loops -fauto-parallel looked at")(
+        "remarks-file", "Write the optimization remarks as YAML",
+        cxxopts::value<std::string>(), "FILE")(
+        "remarks-summary",
+        "Summarize inlining and vectorization per function")(
+        "perf-counters",
+        "Count cycles, instructions, branch and cache misses around main "
+        "or the functions listed",
+        cxxopts::value<std::string>()->implicit_value("main"), "F,G")(
+        "run", "JIT compile and run main")(
+        "perf-map", "Write /tmp/perf-<pid>.map for code run by --run")(
+        "jitdump", "Write jitdump files for code run by --run")(
+        "h, help", "Show help");
     auto parse_result = options.parse(argc, argv);
     if (parse_result.count("h")) {
       std::cout << options.help({"", "Group"}) << std::endl;
@@ -19,8 +90,9 @@ ProgramConfig parse_program_options(int argc, char* argv[]) {
     }
     ProgramConfig config_result;
     if (parse_result.count("i")) {
-      std::string input_filename = parse_result["i"].as<std::string>();
-      config_result.input_filename = input_filename;
+      auto inputs = parse_result["i"].as<std::vector<std::string>>();
+      config_result.input_filename = inputs[0];
+      config_result.link_inputs.assign(inputs.begin() + 1, inputs.end());
     } else {
       std::cerr << argv[0] << ": fatal no input file" << std::endl;
       exit(4);
@@ -31,14 +103,174 @@ ProgramConfig parse_program_options(int argc, char* argv[]) {
     if (parse_result.count("c")) {
       config_result.mode = ProgramMode::EMIT_OBJECT;
     }
+    if (parse_result.count("emit-bitcode")) {
+      config_result.mode = ProgramMode::EMIT_BITCODE;
+    }
+    if (parse_result.count("emit-header")) {
+      config_result.mode = ProgramMode::EMIT_HEADER;
+    }
     if (parse_result.count("l")) {
       config_result.mode = ProgramMode::EMIT_LLVM_IR;
     }
     if (parse_result.count("d")) {
       config_result.mode = ProgramMode::DUMP_AST;
     }
+    if (parse_result.count("run")) {
+      config_result.mode = ProgramMode::RUN;
+    }
+    if (parse_result.count("o") &&
+        !(parse_result.count("l") || parse_result.count("s") ||
+          parse_result.count("c") || parse_result.count("emit-bitcode") ||
+          parse_result.count("emit-header") || parse_result.count("d") ||
+          parse_result.count("run"))) {
+      config_result.mode = ProgramMode::EMIT_EXECUTABLE;
+    }
+    config_result.static_link = static_link;
+    if (config_result.static_link &&
+        config_result.mode != ProgramMode::EMIT_EXECUTABLE) {
+      std::cerr << argv[0] << ": -static needs an executable output with -o"
+                << std::endl;
+      exit(2);
+    }
+    config_result.shared_library = shared_library;
+    if (config_result.static_link && config_result.shared_library) {
+      std::cerr << argv[0] << ": -static and -shared exclude each other"
+                << std::endl;
+      exit(2);
+    }
+    config_result.opt_level = parse_result["O"].as<int>();
+    if (config_result.opt_level < 0 || config_result.opt_level > 3) {
+      std::cerr << argv[0] << ": invalid optimization level "
+                << config_result.opt_level << std::endl;
+      exit(2);
+    }
+    if (parse_result.count("g")) {
+      config_result.debug_info = true;
+    }
+    if (target_cpu.empty()) {
+      std::cerr << argv[0] << ": missing cpu after -march=" << std::endl;
+      exit(2);
+    }
+    config_result.target_cpu = target_cpu;
+    if (parse_result.count("stats")) {
+      config_result.show_stats = true;
+    }
+    config_result.ctfe_steps = parse_result["ctfe-steps"].as<int>();
+    config_result.ctfe_memory = parse_result["ctfe-memory"].as<int>();
+    if (config_result.ctfe_steps < 0 || config_result.ctfe_memory < 0) {
+      std::cerr << argv[0] << ": invalid compile time evaluation budget"
+                << std::endl;
+      exit(2);
+    }
+    config_result.memo_entries = parse_result["memo-entries"].as<int>();
+    if (config_result.memo_entries < 0) {
+      std::cerr << argv[0] << ": invalid memo table capacity" << std::endl;
+      exit(2);
+    }
+    config_result.parallel_threshold =
+        parse_result["parallel-threshold"].as<int>();
+    if (config_result.parallel_threshold < 0) {
+      std::cerr << argv[0] << ": invalid parallel threshold" << std::endl;
+      exit(2);
+    }
+    if (parse_result.count("parallel-report")) {
+      config_result.parallel_report = true;
+    }
+    for (auto& flag : feature_flags) {
+      if (flag == "auto-memo") {
+        config_result.auto_memo = true;
+      } else if (flag == "auto-parallel") {
+        config_result.auto_parallel = true;
+      } else if (flag == "if-to-switch") {
+        config_result.if_to_switch = true;
+      } else if (flag == "whole-program") {
+        config_result.whole_program = true;
+      } else if (flag == "profile-generate") {
+        config_result.profile_generate = kDefaultProfile;
+      } else if (flag.compare(0, 17, "profile-generate=") == 0 &&
+                 flag.size() > 17) {
+        config_result.profile_generate = flag.substr(17);
+      } else if (flag == "instrument-functions=profile") {
+        config_result.call_profile = true;
+      } else if (flag == "no-trace") {
+        config_result.trace = false;
+      } else if (flag == "profile-use") {
+        config_result.profile_use = kDefaultProfile;
+      } else if (flag.compare(0, 12, "profile-use=") == 0 &&
+                 flag.size() > 12) {
+        config_result.profile_use = flag.substr(12);
+      } else {
+        std::cerr << argv[0] << ": unknown flag -f" << flag << std::endl;
+        exit(2);
+      }
+    }
+    for (auto& flag : remark_flags) {
+      std::string* pattern = nullptr;
+      auto equals = flag.find('=');
+      auto name = flag.substr(0, equals);
+      if (name == "pass") {
+        pattern = &config_result.remarks_passed;
+      } else if (name == "pass-missed") {
+        pattern = &config_result.remarks_missed;
+      } else if (name == "pass-analysis") {
+        pattern = &config_result.remarks_analysis;
+      }
+      if (pattern == nullptr || equals == std::string::npos ||
+          equals + 1 == flag.size()) {
+        std::cerr << argv[0] << ": unknown flag -R" << flag << std::endl;
+        exit(2);
+      }
+      *pattern = flag.substr(equals + 1);
+      try {
+        std::regex check(*pattern);
+      } catch (const std::regex_error&) {
+        std::cerr << argv[0] << ": invalid regex in -R" << flag << std::endl;
+        exit(2);
+      }
+    }
+    if (parse_result.count("remarks-file")) {
+      config_result.remarks_file =
+          parse_result["remarks-file"].as<std::string>();
+    }
+    if (parse_result.count("remarks-summary")) {
+      config_result.remarks_summary = true;
+    }
+    if (parse_result.count("perf-counters")) {
+      std::stringstream functions(
+          parse_result["perf-counters"].as<std::string>());
+      std::string function;
+      while (std::getline(functions, function, ',')) {
+        if (!function.empty()) {
+          config_result.perf_functions.push_back(function);
+        }
+      }
+      if (config_result.perf_functions.empty()) {
+        std::cerr << argv[0] << ": --perf-counters needs a function"
+                  << std::endl;
+        exit(2);
+      }
+    }
+    if (parse_result.count("perf-map")) {
+      config_result.perf_map = true;
+    }
+    if (parse_result.count("jitdump")) {
+      config_result.jitdump = true;
+    }
+    if ((config_result.perf_map || config_result.jitdump) &&
+        config_result.mode != ProgramMode::RUN) {
+      std::cerr << argv[0] << ": --perf-map and --jitdump need --run"
+                << std::endl;
+      exit(2);
+    }
+    if (!config_result.profile_generate.empty() &&
+        !config_result.profile_use.empty()) {
+      std::cerr << argv[0]
+                << ": -fprofile-generate and -fprofile-use exclude each other"
+                << std::endl;
+      exit(2);
+    }
     if (parse_result.count("o")) {
-      std::string output_filename = parse_result["i"].as<std::string>();
+      std::string output_filename = parse_result["o"].as<std::string>();
       config_result.output_filename = output_filename;
     } else {
       std::string output_filename = config_result.input_filename;
@@ -53,6 +285,12 @@ ProgramConfig parse_program_options(int argc, char* argv[]) {
         case ProgramMode::EMIT_OBJECT: {
           config_result.output_filename = output_filename + ".o";
         } break;
+        case ProgramMode::EMIT_BITCODE: {
+          config_result.output_filename = output_filename + ".bc";
+        } break;
+        case ProgramMode::EMIT_HEADER: {
+          config_result.output_filename = output_filename + ".h";
+        } break;
         case ProgramMode::EMIT_LLVM_IR: {
           config_result.output_filename = output_filename + ".ll";
         }
@@ -5,14 +5,102 @@ enum class ProgramMode {
   EMIT_LLVM_IR,
   EMIT_ASSEMBLY,
   EMIT_OBJECT,
+  // --emit-bitcode: for a later link with other files
+  EMIT_BITCODE,
   DUMP_AST,
+  // --run: JIT compile and run main in process
+  RUN,
+  // -o without any of the above: an executable linked in process, or a
+  // shared library with -shared
+  EMIT_EXECUTABLE,
+  // --emit-header: C and C++ declarations of the export functions
+  EMIT_HEADER,
 };
 
 struct ProgramConfig {
-  ProgramConfig() : mode(ProgramMode::EMIT_LLVM_IR) {}
+  ProgramConfig()
+      : mode(ProgramMode::EMIT_LLVM_IR),
+        opt_level(0),
+        debug_info(false),
+        target_cpu("generic"),
+        show_stats(false),
+        ctfe_steps(0),
+        ctfe_memory(0),
+        auto_memo(false),
+        memo_entries(0),
+        auto_parallel(false),
+        parallel_threshold(0),
+        parallel_report(false),
+        if_to_switch(false),
+        whole_program(false),
+        call_profile(false),
+        trace(true),
+        remarks_summary(false),
+        perf_map(false),
+        jitdump(false),
+        static_link(false),
+        shared_library(false) {}
   std::string input_filename;
+  // further -i inputs, sources or bitcode, linked into the first one
+  std::vector<std::string> link_inputs;
   std::string output_filename;
   ProgramMode mode;
+  int opt_level;
+  // -g: DWARF line tables, functions and variables for gdb and perf
+  bool debug_info;
+  // -march=<cpu>, native for the host
+  std::string target_cpu;
+  bool show_stats;
+  // budgets for compile time function evaluation
+  int ctfe_steps;
+  int ctfe_memory;
+  // -fauto-memo: memoize pure tree recursive functions without `memo`
+  bool auto_memo;
+  // capacity limit of each runtime memo hash table
+  int memo_entries;
+  // -fauto-parallel: run for loops without dependences on the thread pool
+  bool auto_parallel;
+  // trip count below which such loops stay serial
+  int parallel_threshold;
+  // print which loops -fauto-parallel took and why it left the others
+  bool parallel_report;
+  // -fif-to-switch: turn if / else if chains over one variable into switch
+  bool if_to_switch;
+  // -fwhole-program: the file is the whole program, every function but
+  // main gets internal linkage
+  bool whole_program;
+  // -fprofile-generate[=file]: count calls and branches, the program
+  // writes them to this file at exit; empty if not instrumenting
+  std::string profile_generate;
+  // -fprofile-use[=file]: weight branches and functions by such a profile
+  std::string profile_use;
+  // -finstrument-functions=profile: time every call with the cycle counter
+  bool call_profile;
+  // -fno-trace compiles trace, trace_span and trace_flush out, the
+  // arguments of trace are not evaluated
+  bool trace;
+  // --perf-counters[=f,g]: hardware counters around every call of these
+  // functions, main without a list
+  std::vector<std::string> perf_functions;
+  // -Rpass=, -Rpass-missed= and -Rpass-analysis=: regexes of the passes
+  // whose passed, missed and analysis remarks are printed, empty for none
+  std::string remarks_passed;
+  std::string remarks_missed;
+  std::string remarks_analysis;
+  // --remarks-file: every remark of the pipeline as YAML
+  std::string remarks_file;
+  // --remarks-summary: inlining and vectorization per function
+  bool remarks_summary;
+  // --perf-map: /tmp/perf-<pid>.map entries for the functions --run JIT
+  // compiles, --jitdump: jitdump files with code and line tables for perf
+  // inject; gdb is told about them either way
+  bool perf_map;
+  bool jitdump;
+  // -static: an executable without dynamic dependencies
+  bool static_link;
+  // -shared: position independent code, linked into a shared library whose
+  // only visible functions are the export ones
+  bool shared_library;
 };
 
 ProgramConfig parse_program_options(int argc, char* argv[]);
\ No newline at end of file
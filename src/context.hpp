@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include "ast.hpp"
+#include "statistics.hpp"
 namespace ntc {
 
 class ProgramContext {
@@ -13,8 +14,11 @@ class ProgramContext {
 
   const std::string& get_name() const { return name_; }
 
+  Statistics& get_statistics() { return statistics_; }
+
  private:
   std::unique_ptr<TranslationUnit> program_;
   std::string name_;
+  Statistics statistics_;
 };
 }  // namespace ntc
@@ -0,0 +1,755 @@
+#include "dependence.hpp"
+#include <cstdlib>
+#include <set>
+#include <utility>
+namespace ntc {
+namespace {
+bool is_integer_type(type::Specifier specifier) {
+  return specifier == type::Specifier::SHORT ||
+         specifier == type::Specifier::INT ||
+         specifier == type::Specifier::LONG;
+}
+
+class NameCounter final : public ASTWalker {
+ public:
+  explicit NameCounter(const std::string& name) : name_(name), count_(0) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(Identifier& identifier) override {
+    if (identifier.get_name() == name_) {
+      ++count_;
+    }
+  }
+
+  int get_count() const { return count_; }
+
+ private:
+  std::string name_;
+  int count_;
+};
+
+int count_mentions(AST& ast, const std::string& name) {
+  NameCounter counter(name);
+  ast.accept(counter);
+  return counter.get_count();
+}
+
+// what a loop body reads and writes, and the first construct that keeps it
+// from running iterations in any order
+class LoopBodyScan final : public ASTWalker {
+ public:
+  struct Access {
+    std::string array;
+    Expression* index;
+    bool write;
+  };
+
+  explicit LoopBodyScan(const PurityAnalysis& purity)
+      : purity_(purity), loops_(0), switches_(0) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(Declaration& declaration) override {
+    auto& declarator = declaration.get_declarator();
+    declared_.insert(declarator->get_identifier()->get_name());
+    auto& initializer = declaration.get_initializer();
+    if (initializer != nullptr) {
+      visit(*initializer);
+    }
+  }
+
+  virtual void visit(Identifier& identifier) override {
+    ++reads_[identifier.get_name()];
+  }
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override {
+    if (binary_operation_expression.get_op_type() != type::BinaryOp::ASSIGN) {
+      ASTWalker::visit(binary_operation_expression);
+      return;
+    }
+    auto& lhs = binary_operation_expression.get_lhs();
+    auto& rhs = binary_operation_expression.get_rhs();
+    if (auto* identifier = dynamic_cast<Identifier*>(lhs.get())) {
+      auto& name = identifier->get_name();
+      ++writes_[name];
+      // s = s op e with e free of s
+      auto* update = dynamic_cast<BinaryOperationExpression*>(rhs.get());
+      if (update != nullptr &&
+          (update->get_op_type() == type::BinaryOp::ADD ||
+           update->get_op_type() == type::BinaryOp::MUL) &&
+          (count_mentions(*rhs, name) == 1) &&
+          (is_name(*(update->get_lhs()), name) ||
+           is_name(*(update->get_rhs()), name))) {
+        reductions_[name].insert(update->get_op_type());
+      } else {
+        reductions_[name].insert(type::BinaryOp::ASSIGN);
+      }
+    } else if (auto* array_reference =
+                   dynamic_cast<ArrayReference*>(lhs.get())) {
+      add_access(*array_reference, true);
+      visit(*(array_reference->get_index()));
+    } else {
+      visit(*lhs);
+    }
+    visit(*rhs);
+  }
+
+  virtual void visit(ArrayReference& array_reference) override {
+    add_access(array_reference, false);
+    visit(*(array_reference.get_index()));
+  }
+
+  virtual void visit(FunctionCall& function_call) override {
+    auto* identifier =
+        dynamic_cast<Identifier*>(function_call.get_target().get());
+    if (identifier == nullptr || !purity_.is_pure(identifier->get_name())) {
+      reject("it calls '" +
+             (identifier != nullptr ? identifier->get_name() : "?") +
+             "', which is not pure");
+    }
+    for (auto& argument : function_call.get_argument_list()) {
+      if (auto* name = dynamic_cast<Identifier*>(argument.get())) {
+        passed_.insert(name->get_name());
+      }
+      visit(*argument);
+    }
+  }
+
+  virtual void visit(ReturnStatement& return_statement) override {
+    reject("it contains return");
+    ASTWalker::visit(return_statement);
+  }
+
+  virtual void visit(BecomeStatement& become_statement) override {
+    reject("it contains become");
+    ASTWalker::visit(become_statement);
+  }
+
+  virtual void visit(SpawnExpression& spawn_expression) override {
+    reject("it spawns");
+    ASTWalker::visit(spawn_expression);
+  }
+
+  virtual void visit(SyncStatement&) override { reject("it contains sync"); }
+
+  virtual void visit(BreakStatement&) override {
+    if (loops_ == 0 && switches_ == 0) {
+      reject("it contains break");
+    }
+  }
+
+  virtual void visit(ContinueStatement&) override {
+    if (loops_ == 0) {
+      reject("it contains continue");
+    }
+  }
+
+  virtual void visit(WhileStatement& while_statement) override {
+    ++loops_;
+    ASTWalker::visit(while_statement);
+    --loops_;
+  }
+
+  virtual void visit(ForStatement& for_statement) override {
+    ++loops_;
+    ASTWalker::visit(for_statement);
+    --loops_;
+  }
+
+  virtual void visit(SwitchStatement& switch_statement) override {
+    ++switches_;
+    ASTWalker::visit(switch_statement);
+    --switches_;
+  }
+
+  virtual void visit(ParallelForStatement&) override {
+    reject("it contains a parallel for");
+  }
+
+  const std::string& get_rejected() const { return rejected_; }
+
+  const std::set<std::string>& get_declared() const { return declared_; }
+
+  const std::map<std::string, int>& get_writes() const { return writes_; }
+
+  int get_reads(const std::string& name) const {
+    auto search = reads_.find(name);
+    return search != reads_.end() ? search->second : 0;
+  }
+
+  // ADD or MUL if every write of name is a reduction with that operator
+  // and name is read nowhere else, ASSIGN otherwise
+  type::BinaryOp get_reduction(const std::string& name) const {
+    auto search = reductions_.find(name);
+    if (search == reductions_.end() || search->second.size() != 1 ||
+        get_reads(name) != writes_.at(name)) {
+      return type::BinaryOp::ASSIGN;
+    }
+    return *(search->second.begin());
+  }
+
+  const std::vector<Access>& get_accesses() const { return accesses_; }
+
+  bool is_passed(const std::string& name) const {
+    return passed_.count(name) != 0;
+  }
+
+ private:
+  static bool is_name(Expression& expression, const std::string& name) {
+    auto* identifier = dynamic_cast<Identifier*>(&expression);
+    return identifier != nullptr && identifier->get_name() == name;
+  }
+
+  void add_access(ArrayReference& array_reference, bool write) {
+    auto* target =
+        dynamic_cast<Identifier*>(array_reference.get_target().get());
+    if (target == nullptr) {
+      reject("it indexes an expression");
+      return;
+    }
+    accesses_.push_back(
+        {target->get_name(), array_reference.get_index().get(), write});
+  }
+
+  void reject(const std::string& reason) {
+    if (rejected_.empty()) {
+      rejected_ = reason;
+    }
+  }
+
+  const PurityAnalysis& purity_;
+  int loops_;
+  int switches_;
+  std::string rejected_;
+  std::set<std::string> declared_;
+  std::map<std::string, int> reads_;
+  std::map<std::string, int> writes_;
+  std::map<std::string, std::set<type::BinaryOp>> reductions_;
+  std::vector<Access> accesses_;
+  std::set<std::string> passed_;
+};
+
+// subscript as coefficient * i + constant + sum of invariant symbols
+struct Affine {
+  bool valid = true;
+  long coefficient = 0;
+  long constant = 0;
+  std::map<std::string, long> symbols;
+};
+
+Affine scale(Affine affine, long factor) {
+  affine.coefficient *= factor;
+  affine.constant *= factor;
+  for (auto& symbol : affine.symbols) {
+    symbol.second *= factor;
+  }
+  return affine;
+}
+
+Affine combine(const Affine& lhs, const Affine& rhs, long sign) {
+  Affine result = lhs;
+  result.valid = lhs.valid && rhs.valid;
+  result.coefficient += sign * rhs.coefficient;
+  result.constant += sign * rhs.constant;
+  for (auto& symbol : rhs.symbols) {
+    result.symbols[symbol.first] += sign * symbol.second;
+    if (result.symbols[symbol.first] == 0) {
+      result.symbols.erase(symbol.first);
+    }
+  }
+  return result;
+}
+
+bool is_constant(const Affine& affine) {
+  return affine.valid && affine.coefficient == 0 && affine.symbols.empty();
+}
+
+Affine to_affine(Expression& expression, const std::string& variable,
+                 const LoopBodyScan& scan) {
+  Affine result;
+  if (auto* integer = dynamic_cast<IntegerExpression*>(&expression)) {
+    result.constant = integer->get_val();
+  } else if (auto* identifier = dynamic_cast<Identifier*>(&expression)) {
+    auto& name = identifier->get_name();
+    if (name == variable) {
+      result.coefficient = 1;
+    } else if (scan.get_writes().count(name) != 0 ||
+               scan.get_declared().count(name) != 0) {
+      result.valid = false;
+    } else {
+      result.symbols[name] = 1;
+    }
+  } else if (auto* unary =
+                 dynamic_cast<UnaryOperationExpression*>(&expression)) {
+    result = to_affine(*(unary->get_operand()), variable, scan);
+    if (unary->get_op_type() == type::UnaryOp::NEGATE) {
+      result = scale(result, -1);
+    } else if (unary->get_op_type() != type::UnaryOp::POSITIVIZE) {
+      result.valid = false;
+    }
+  } else if (auto* binary =
+                 dynamic_cast<BinaryOperationExpression*>(&expression)) {
+    auto lhs = to_affine(*(binary->get_lhs()), variable, scan);
+    auto rhs = to_affine(*(binary->get_rhs()), variable, scan);
+    switch (binary->get_op_type()) {
+      case type::BinaryOp::ADD:
+        result = combine(lhs, rhs, 1);
+        break;
+      case type::BinaryOp::SUB:
+        result = combine(lhs, rhs, -1);
+        break;
+      case type::BinaryOp::MUL:
+        if (is_constant(lhs) && rhs.valid) {
+          result = scale(rhs, lhs.constant);
+        } else if (is_constant(rhs) && lhs.valid) {
+          result = scale(lhs, rhs.constant);
+        } else {
+          result.valid = false;
+        }
+        break;
+      default:
+        result.valid = false;
+        break;
+    }
+  } else {
+    result.valid = false;
+  }
+  return result;
+}
+
+long gcd(long a, long b) {
+  a = std::labs(a);
+  b = std::labs(b);
+  while (b != 0) {
+    long t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// why two accesses to array, at least one a write, may touch the same
+// element in different iterations of a loop with the given step, empty
+// if they cannot
+std::string depends(const std::string& array, const Affine& x,
+                    const Affine& y, long step) {
+  if (!x.valid || !y.valid) {
+    return "the subscript of '" + array + "' is not affine";
+  }
+  if (x.symbols != y.symbols) {
+    return "subscripts of '" + array + "' differ by a symbolic offset";
+  }
+  // x.coefficient * i1 - y.coefficient * i2 = distance
+  long distance = y.constant - x.constant;
+  long a = x.coefficient;
+  long b = y.coefficient;
+  if (a == 0 && b == 0) {
+    return distance == 0
+               ? "every iteration accesses the same element of '" + array + "'"
+               : "";
+  }
+  if (distance % gcd(a, b) != 0) {
+    return "";
+  }
+  if (a != b) {
+    return "subscripts of '" + array + "' have different strides";
+  }
+  // i1 - i2 = distance / a is a multiple of step between iterations
+  if (distance == 0 || (distance / a) % step != 0) {
+    return "";
+  }
+  return "'" + array + "' is carried at distance " +
+         std::to_string(std::labs(distance / a) / step);
+}
+
+// whether a read of name outside of loop sees a value set inside it, reads
+// inside other for loops over name see their own initialization
+class OutsideReadFinder final : public ASTWalker {
+ public:
+  OutsideReadFinder(const std::string& name, ForStatement* loop)
+      : name_(name), loop_(loop), found_(false) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(Declaration& declaration) override {
+    auto& initializer = declaration.get_initializer();
+    if (initializer != nullptr) {
+      visit(*initializer);
+    }
+  }
+
+  virtual void visit(Identifier& identifier) override {
+    if (identifier.get_name() == name_ && loops_over_name_ == 0) {
+      found_ = true;
+    }
+  }
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override {
+    auto* identifier = dynamic_cast<Identifier*>(
+        binary_operation_expression.get_lhs().get());
+    if (binary_operation_expression.get_op_type() == type::BinaryOp::ASSIGN &&
+        identifier != nullptr) {
+      visit(*(binary_operation_expression.get_rhs()));
+    } else {
+      ASTWalker::visit(binary_operation_expression);
+    }
+  }
+
+  virtual void visit(ForStatement& for_statement) override {
+    if (&for_statement == loop_) {
+      return;
+    }
+    bool over_name = assigned_variable(for_statement.get_init_clause()
+                                           ->get_expression()
+                                           .get()) == name_;
+    loops_over_name_ += over_name;
+    ASTWalker::visit(for_statement);
+    loops_over_name_ -= over_name;
+  }
+
+  bool get_found() const { return found_; }
+
+ private:
+  std::string name_;
+  ForStatement* loop_;
+  bool found_;
+  int loops_over_name_ = 0;
+};
+
+class VariableCollector final : public ASTWalker {
+ public:
+  using ASTWalker::visit;
+
+  virtual void visit(Declaration& declaration) override {
+    auto& declarator = declaration.get_declarator();
+    declarations_.push_back(
+        {declarator->get_identifier()->get_name(),
+         declaration.get_declaration_specifier()
+             ->get_type_specifier()
+             ->get_specifier(),
+         declarator->get_is_array()});
+    ASTWalker::visit(declaration);
+  }
+
+  struct Entry {
+    std::string name;
+    type::Specifier specifier;
+    bool is_array;
+  };
+
+  const std::vector<Entry>& get_declarations() const { return declarations_; }
+
+ private:
+  std::vector<Entry> declarations_;
+};
+}  // namespace
+
+std::string assigned_variable(Expression* expression) {
+  auto* assignment = dynamic_cast<BinaryOperationExpression*>(expression);
+  if (assignment == nullptr ||
+      assignment->get_op_type() != type::BinaryOp::ASSIGN) {
+    return "";
+  }
+  auto* identifier = dynamic_cast<Identifier*>(assignment->get_lhs().get());
+  return identifier != nullptr ? identifier->get_name() : "";
+}
+
+int loop_step(Expression* iteration, const std::string& variable) {
+  if (assigned_variable(iteration) != variable) {
+    return 0;
+  }
+  auto* sum = dynamic_cast<BinaryOperationExpression*>(
+      static_cast<BinaryOperationExpression*>(iteration)->get_rhs().get());
+  if (sum == nullptr || sum->get_op_type() != type::BinaryOp::ADD) {
+    return 0;
+  }
+  auto* lhs = sum->get_lhs().get();
+  auto* rhs = sum->get_rhs().get();
+  if (dynamic_cast<IntegerExpression*>(lhs) != nullptr) {
+    std::swap(lhs, rhs);
+  }
+  auto* identifier = dynamic_cast<Identifier*>(lhs);
+  auto* step = dynamic_cast<IntegerExpression*>(rhs);
+  if (identifier == nullptr || identifier->get_name() != variable ||
+      step == nullptr || step->get_val() <= 0) {
+    return 0;
+  }
+  return step->get_val();
+}
+
+AutoParallelizer::AutoParallelizer(int threshold)
+    : threshold_(threshold),
+      parallelized_(0),
+      cur_function_(nullptr),
+      cur_loop_(0) {}
+
+void AutoParallelizer::visit(TranslationUnit& translation_unit) {
+  translation_unit.accept(purity_);
+  ASTWalker::visit(translation_unit);
+}
+
+void AutoParallelizer::visit(FunctionDefinition& function_definition) {
+  cur_function_ = &function_definition;
+  cur_loop_ = 0;
+  variables_.clear();
+  auto add = [this](const std::string& name, type::Specifier specifier,
+                    bool is_array, bool is_parameter, bool is_restrict) {
+    auto search = variables_.find(name);
+    if (search == variables_.end()) {
+      variables_[name].reset(
+          new Variable{specifier, is_array, is_parameter, is_restrict});
+    } else if (search->second != nullptr &&
+               (search->second->specifier != specifier ||
+                search->second->is_array != is_array ||
+                search->second->is_parameter || is_parameter)) {
+      search->second.reset();
+    }
+  };
+  for (auto& parameter : function_definition.get_parameter_list()) {
+    auto& declarator = parameter->get_declarator();
+    add(declarator->get_identifier()->get_name(),
+        parameter->get_declaration_specifier()
+            ->get_type_specifier()
+            ->get_specifier(),
+        declarator->get_is_array(), true, declarator->get_is_restrict());
+  }
+  VariableCollector collector;
+  function_definition.get_compound_statement()->accept(collector);
+  for (auto& entry : collector.get_declarations()) {
+    add(entry.name, entry.specifier, entry.is_array, false, false);
+  }
+  ASTWalker::visit(function_definition);
+  cur_function_ = nullptr;
+}
+
+void AutoParallelizer::visit(CompoundStatement& compound_statement) {
+  for (auto& item : compound_statement.get_block_item_list()) {
+    auto* for_statement = dynamic_cast<ForStatement*>(item.get());
+    if (for_statement == nullptr) {
+      item->accept(*this);
+      continue;
+    }
+    auto prefix = cur_function_->get_identifier()->get_name() + ": loop " +
+                  std::to_string(++cur_loop_) + ": ";
+    auto parallel_for_statement = make_ast<ParallelForStatement>();
+    auto reason = analyze(*for_statement, *parallel_for_statement);
+    if (!reason.empty()) {
+      report_.push_back(prefix + "serial, " + reason);
+      for_statement->accept(*this);
+      continue;
+    }
+    auto line = prefix + "parallel over '" +
+                assigned_variable(
+                    for_statement->get_init_clause()->get_expression().get()) +
+                "'";
+    for (auto& reduction : parallel_for_statement->get_reductions()) {
+      line += ", reduce " +
+              std::string(reduction.op == type::BinaryOp::ADD ? "+" : "*") +
+              ": " + reduction.name;
+    }
+    for (auto& name : parallel_for_statement->get_privates()) {
+      line += ", private " + name;
+    }
+    if (parallel_for_statement->get_min_count() > 0) {
+      line += ", serial below " +
+              std::to_string(parallel_for_statement->get_min_count()) +
+              " iterations";
+    }
+    report_.push_back(line);
+    ++parallelized_;
+    parallel_for_statement->set_for_statement(std::unique_ptr<ForStatement>(
+        static_cast<ForStatement*>(item.release())));
+    item = std::move(parallel_for_statement);
+  }
+}
+
+void AutoParallelizer::visit(ParallelForStatement&) {
+  // already parallel, loops inside run on one thread each
+}
+
+std::string AutoParallelizer::analyze(
+    ForStatement& for_statement,
+    ParallelForStatement& parallel_for_statement) {
+  auto* init = for_statement.get_init_clause()->get_expression().get();
+  auto* cond = dynamic_cast<BinaryOperationExpression*>(
+      for_statement.get_cond_expression()->get_expression().get());
+  auto* iter = for_statement.get_iteration_expression().get();
+  auto variable = assigned_variable(init);
+  if (variable.empty() || cond == nullptr ||
+      (cond->get_op_type() != type::BinaryOp::LESS &&
+       cond->get_op_type() != type::BinaryOp::LESS_EQUAL) ||
+      count_mentions(*(cond->get_lhs()), variable) != 1 ||
+      dynamic_cast<Identifier*>(cond->get_lhs().get()) == nullptr ||
+      loop_step(iter, variable) == 0) {
+    return "it is not of the form for (i = lo; i < hi; i = i + step)";
+  }
+  long step = loop_step(iter, variable);
+  auto search = variables_.find(variable);
+  if (search == variables_.end() || search->second == nullptr ||
+      search->second->is_array ||
+      !is_integer_type(search->second->specifier)) {
+    return "'" + variable + "' is not an integer variable";
+  }
+
+  LoopBodyScan scan(purity_);
+  for_statement.get_loop_statement()->accept(scan);
+  if (!scan.get_rejected().empty()) {
+    return scan.get_rejected();
+  }
+  if (scan.get_writes().count(variable) != 0) {
+    return "the body assigns '" + variable + "'";
+  }
+  // the bound is evaluated once instead of before every iteration
+  LoopBodyScan bound(purity_);
+  cond->get_rhs()->accept(bound);
+  if (!bound.get_rejected().empty()) {
+    return "in the bound " + bound.get_rejected();
+  }
+  if (count_mentions(*(cond->get_rhs()), variable) != 0) {
+    return "the bound depends on '" + variable + "'";
+  }
+  for (auto& name : scan.get_writes()) {
+    if (count_mentions(*(cond->get_rhs()), name.first) != 0) {
+      return "the bound depends on '" + name.first + "'";
+    }
+  }
+  for (auto& access : bound.get_accesses()) {
+    for (auto& other : scan.get_accesses()) {
+      if (other.write && other.array == access.array) {
+        return "the bound reads '" + access.array + "', which the body writes";
+      }
+    }
+  }
+
+  // scalars written by the body
+  for (auto& write : scan.get_writes()) {
+    auto& name = write.first;
+    if (scan.get_declared().count(name) != 0) {
+      continue;
+    }
+    auto variable_search = variables_.find(name);
+    if (variable_search == variables_.end() ||
+        variable_search->second == nullptr) {
+      return "the type of '" + name + "' is unknown";
+    }
+    auto op = scan.get_reduction(name);
+    if (op != type::BinaryOp::ASSIGN &&
+        is_integer_type(variable_search->second->specifier)) {
+      parallel_for_statement.add_reduction(op, name);
+    } else if (is_privatizable(name, for_statement)) {
+      parallel_for_statement.add_private(name);
+    } else if (op != type::BinaryOp::ASSIGN) {
+      return "reducing '" + name + "' would reorder floating point operations";
+    } else {
+      return "'" + name + "' is carried from one iteration to the next";
+    }
+  }
+
+  // arrays written by the body
+  std::set<std::string> checked;
+  for (auto& access : scan.get_accesses()) {
+    auto& name = access.array;
+    if (!access.write || scan.get_declared().count(name) != 0 ||
+        !checked.insert(name).second) {
+      continue;
+    }
+    auto array_search = variables_.find(name);
+    if (array_search == variables_.end() || array_search->second == nullptr ||
+        !array_search->second->is_array) {
+      return "'" + name + "' is written through an unknown pointer";
+    }
+    if (scan.is_passed(name)) {
+      return "'" + name + "' is written and passed to a function";
+    }
+    auto& array = *(array_search->second);
+    // array parameters may point to the same memory unless one is restrict
+    for (auto& other_access : scan.get_accesses()) {
+      auto other_search = variables_.find(other_access.array);
+      if (other_access.array != name && other_search != variables_.end() &&
+          other_search->second != nullptr &&
+          other_search->second->is_parameter && array.is_parameter &&
+          !other_search->second->is_restrict && !array.is_restrict) {
+        return "'" + name + "' and '" + other_access.array +
+               "' may alias, declare them restrict";
+      }
+    }
+    for (auto& x : scan.get_accesses()) {
+      if (x.array != name || !x.write) {
+        continue;
+      }
+      auto x_affine = to_affine(*(x.index), variable, scan);
+      for (auto& y : scan.get_accesses()) {
+        if (y.array != name) {
+          continue;
+        }
+        auto reason =
+            depends(name, x_affine, to_affine(*(y.index), variable, scan),
+                    step);
+        if (!reason.empty()) {
+          return reason;
+        }
+      }
+    }
+  }
+
+  // iterations below the threshold are not worth waking the pool for
+  auto* lo = dynamic_cast<IntegerExpression*>(
+      static_cast<BinaryOperationExpression*>(init)->get_rhs().get());
+  auto* hi = dynamic_cast<IntegerExpression*>(cond->get_rhs().get());
+  if (lo != nullptr && hi != nullptr) {
+    long span = static_cast<long>(hi->get_val()) - lo->get_val() +
+                (cond->get_op_type() == type::BinaryOp::LESS_EQUAL);
+    long trip_count = span > 0 ? (span + step - 1) / step : 0;
+    if (trip_count < threshold_) {
+      return "its " + std::to_string(trip_count) +
+             " iterations are below the threshold of " +
+             std::to_string(threshold_);
+    }
+  } else {
+    parallel_for_statement.set_min_count(threshold_);
+  }
+  return "";
+}
+
+bool AutoParallelizer::is_privatizable(const std::string& name,
+                                       ForStatement& for_statement) {
+  // every iteration has to set the variable before reading it ...
+  auto& body = for_statement.get_loop_statement();
+  std::vector<BlockItem*> items;
+  if (auto* compound = dynamic_cast<CompoundStatement*>(body.get())) {
+    for (auto& item : compound->get_block_item_list()) {
+      items.push_back(item.get());
+    }
+  } else {
+    items.push_back(body.get());
+  }
+  bool killed = false;
+  for (auto* item : items) {
+    if (count_mentions(*item, name) == 0) {
+      continue;
+    }
+    Expression* assignment = nullptr;
+    if (auto* statement = dynamic_cast<ExpressionStatement*>(item)) {
+      assignment = statement->get_expression().get();
+    } else if (auto* loop = dynamic_cast<ForStatement*>(item)) {
+      assignment = loop->get_init_clause()->get_expression().get();
+    }
+    killed = assigned_variable(assignment) == name &&
+             count_mentions(*(static_cast<BinaryOperationExpression*>(
+                                  assignment)
+                                  ->get_rhs()),
+                            name) == 0;
+    break;
+  }
+  if (!killed) {
+    return false;
+  }
+  // ... and nothing after the loop may read the value it leaves behind
+  OutsideReadFinder finder(name, &for_statement);
+  cur_function_->get_compound_statement()->accept(finder);
+  return !finder.get_found();
+}
+}  // namespace ntc
@@ -0,0 +1,62 @@
+// Array dependence analysis of canonical for loops: -fauto-parallel turns
+// loops whose iterations are provably independent into parallel for and
+// reports why the others were left alone
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "purity.hpp"
+#include "walker.hpp"
+namespace ntc {
+// name of the variable expression assigns to, empty if it is no assignment
+std::string assigned_variable(Expression* expression);
+
+// step c of i = i + c or i = c + i, 0 if iteration has another form
+int loop_step(Expression* iteration, const std::string& variable);
+
+class AutoParallelizer final : public ASTWalker {
+ public:
+  // loops with a known trip count below threshold stay serial, unknown
+  // trip counts are compared at run time
+  explicit AutoParallelizer(int threshold);
+
+  using ASTWalker::visit;
+
+  virtual void visit(TranslationUnit& translation_unit) override;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  virtual void visit(CompoundStatement& compound_statement) override;
+
+  virtual void visit(ParallelForStatement& parallel_for_statement) override;
+
+  // one line per for loop, in source order
+  const std::vector<std::string>& get_report() const { return report_; }
+
+  int get_parallelized() const { return parallelized_; }
+
+ private:
+  struct Variable {
+    type::Specifier specifier;
+    bool is_array;
+    bool is_parameter;
+    bool is_restrict;
+  };
+
+  // reason the loop has to stay serial, empty if it was set up on parallel
+  std::string analyze(ForStatement& for_statement,
+                      ParallelForStatement& parallel_for_statement);
+
+  bool is_privatizable(const std::string& name, ForStatement& for_statement);
+
+  PurityAnalysis purity_;
+  int threshold_;
+  std::vector<std::string> report_;
+  int parallelized_;
+  FunctionDefinition* cur_function_;
+  int cur_loop_;
+  // variables of the current function, nullptr entries are declared more
+  // than once with different types
+  std::map<std::string, std::unique_ptr<Variable>> variables_;
+};
+}  // namespace ntc
@@ -0,0 +1,766 @@
+#include "folder.hpp"
+#include <cstdint>
+#include <limits>
+namespace ntc {
+namespace {
+// integer arithmetic follows the 32 bit wrap around of the generated code
+int wrap_int(int64_t val) {
+  return static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint64_t>(val)));
+}
+
+bool is_arithmetic(type::Specifier specifier) {
+  switch (specifier) {
+    case type::Specifier::SHORT:
+    case type::Specifier::INT:
+    case type::Specifier::LONG:
+    case type::Specifier::UINT:
+    case type::Specifier::ULONG:
+    case type::Specifier::FLOAT:
+    case type::Specifier::DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool is_boolean_op(type::BinaryOp op) {
+  switch (op) {
+    case type::BinaryOp::LESS:
+    case type::BinaryOp::GREATER:
+    case type::BinaryOp::LESS_EQUAL:
+    case type::BinaryOp::GREATER_EQUAL:
+    case type::BinaryOp::EQUAL:
+    case type::BinaryOp::NOT_EQUAL:
+    case type::BinaryOp::LOGIC_AND:
+    case type::BinaryOp::LOGIC_OR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool is_integer(Expression& expression, int val) {
+  auto* integer = dynamic_cast<IntegerExpression*>(&expression);
+  return integer != nullptr && integer->get_val() == val;
+}
+
+bool is_boolean(Expression& expression, bool val) {
+  auto* boolean = dynamic_cast<BooleanExpression*>(&expression);
+  return boolean != nullptr && boolean->get_val() == val;
+}
+
+template <typename T>
+std::unique_ptr<Expression> compare(type::BinaryOp op, T lhs, T rhs) {
+  switch (op) {
+    case type::BinaryOp::LESS:
+      return make_ast<BooleanExpression>(lhs < rhs);
+    case type::BinaryOp::GREATER:
+      return make_ast<BooleanExpression>(lhs > rhs);
+    case type::BinaryOp::LESS_EQUAL:
+      return make_ast<BooleanExpression>(lhs <= rhs);
+    case type::BinaryOp::GREATER_EQUAL:
+      return make_ast<BooleanExpression>(lhs >= rhs);
+    case type::BinaryOp::EQUAL:
+      return make_ast<BooleanExpression>(lhs == rhs);
+    case type::BinaryOp::NOT_EQUAL:
+      // ordered compare, NaN is neither less nor greater
+      return make_ast<BooleanExpression>(lhs < rhs || lhs > rhs);
+    default:
+      return nullptr;
+  }
+}
+}  // namespace
+
+ConstantFolder::ConstantFolder(Interpreter* interpreter, bool evaluate_calls)
+    : interpreter_(interpreter),
+      evaluate_calls_(evaluate_calls),
+      removed_nodes_(0),
+      evaluated_calls_(0) {}
+
+void ConstantFolder::visit(TranslationUnit& translation_unit) {
+  for (auto& decl : translation_unit.get_declarations()) {
+    auto* function = dynamic_cast<FunctionDefinition*>(decl.get());
+    auto* prototype = dynamic_cast<FunctionDeclaration*>(decl.get());
+    if (function != nullptr) {
+      function_types_[function->get_identifier()->get_name()] =
+          function->get_declaration_specifier()
+              ->get_type_specifier()
+              ->get_specifier();
+    } else if (prototype != nullptr) {
+      function_types_[prototype->get_identifier()->get_name()] =
+          prototype->get_declaration_specifier()
+              ->get_type_specifier()
+              ->get_specifier();
+    }
+  }
+  for (auto& decl : translation_unit.get_declarations()) {
+    visit(*decl);
+  }
+}
+
+void ConstantFolder::visit(FunctionDefinition& function_definition) {
+  push_scope();
+  for (auto& parameter : function_definition.get_parameter_list()) {
+    auto& declarator = parameter->get_declarator();
+    if (parameter->get_declaration_specifier()->get_is_constexpr()) {
+      throw std::logic_error("Folder: parameter '" +
+                             declarator->get_identifier()->get_name() +
+                             "' cannot be constexpr");
+    }
+    bind(declarator->get_identifier()->get_name(),
+         parameter->get_declaration_specifier()
+             ->get_type_specifier()
+             ->get_specifier(),
+         declarator->get_is_array());
+  }
+  visit(*(function_definition.get_compound_statement()));
+  pop_scope();
+}
+
+void ConstantFolder::visit(Declaration& declaration) {
+  auto& declaration_specifier = declaration.get_declaration_specifier();
+  auto& declarator = declaration.get_declarator();
+  auto& initializer = declaration.get_initializer();
+  auto& name = declarator->get_identifier()->get_name();
+  auto specifier = declaration_specifier->get_type_specifier()->get_specifier();
+  if (declaration_specifier->get_is_constexpr() &&
+      (initializer == nullptr || declarator->get_is_array())) {
+    throw std::logic_error("Folder: constexpr '" + name +
+                           "' needs a scalar initializer");
+  }
+  std::unique_ptr<Expression> constant;
+  if (initializer != nullptr) {
+    auto& expression = initializer->get_expression();
+    fold(expression);
+    if (declaration_specifier->get_is_constexpr() && !is_literal(*expression)) {
+      if (interpreter_ == nullptr) {
+        throw std::logic_error("Folder: constexpr '" + name +
+                               "' needs compile time evaluation");
+      }
+      try {
+        int original_nodes = count_nodes(*expression);
+        expression = interpreter_->evaluate(*expression);
+        removed_nodes_ += original_nodes - count_nodes(*expression);
+      } catch (EvaluationError& e) {
+        throw std::logic_error("Folder: constexpr initializer of '" + name +
+                               "' is not a constant expression: " + e.what());
+      }
+    }
+    // only propagate literals whose type is exactly the declared one, other
+    // combinations get converted on store
+    if (declaration_specifier->get_is_const() && !declarator->get_is_array()) {
+      if ((specifier == type::Specifier::INT &&
+           dynamic_cast<IntegerExpression*>(expression.get())) ||
+          (specifier == type::Specifier::DOUBLE &&
+           dynamic_cast<FloatExpression*>(expression.get())) ||
+          (specifier == type::Specifier::BOOL &&
+           dynamic_cast<BooleanExpression*>(expression.get())) ||
+          (specifier == type::Specifier::CHAR &&
+           dynamic_cast<CharacterExpression*>(expression.get()))) {
+        constant = clone_literal(*expression);
+      } else if (specifier == type::Specifier::DOUBLE) {
+        auto* integer = dynamic_cast<IntegerExpression*>(expression.get());
+        if (integer != nullptr) {
+          constant = make_ast<FloatExpression>(integer->get_val());
+        }
+      }
+    }
+  }
+  bind(name, specifier, declarator->get_is_array(), std::move(constant));
+}
+
+void ConstantFolder::visit(CompoundStatement& compound_statement) {
+  push_scope();
+  auto& block_item_list = compound_statement.get_block_item_list();
+  for (auto& block_item : block_item_list) {
+    fold(block_item);
+  }
+  pop_scope();
+
+  // drop empty statements left behind by pruning, and everything after a
+  // return since it can never run
+  std::vector<std::unique_ptr<BlockItem>> kept;
+  for (auto& block_item : block_item_list) {
+    auto* expression_statement =
+        dynamic_cast<ExpressionStatement*>(block_item.get());
+    if (expression_statement != nullptr &&
+        expression_statement->get_expression() == nullptr) {
+      removed_nodes_ += count_nodes(*block_item);
+      continue;
+    }
+    if (!kept.empty() &&
+        dynamic_cast<ReturnStatement*>(kept.back().get()) != nullptr) {
+      removed_nodes_ += count_nodes(*block_item);
+      continue;
+    }
+    kept.push_back(std::move(block_item));
+  }
+  block_item_list = std::move(kept);
+}
+
+void ConstantFolder::visit(ExpressionStatement& expression_statement) {
+  fold(expression_statement.get_expression());
+}
+
+void ConstantFolder::visit(ReturnStatement& return_statement) {
+  fold(return_statement.get_expression());
+}
+
+void ConstantFolder::visit(BecomeStatement& become_statement) {
+  // the call itself must survive, it is the point of the statement
+  auto& function_call = become_statement.get_function_call();
+  for (auto& argument : function_call->get_argument_list()) {
+    fold(argument);
+  }
+}
+
+void ConstantFolder::visit(IfStatement& if_statement) {
+  auto& if_expression = if_statement.get_if_expression();
+  auto& then_statement = if_statement.get_then_statment();
+  auto& else_statement = if_statement.get_else_statement();
+  fold(if_expression);
+  fold(then_statement);
+  fold(else_statement);
+  auto* condition = dynamic_cast<BooleanExpression*>(if_expression.get());
+  if (condition == nullptr) {
+    return;
+  }
+  int original_nodes = count_nodes(if_statement);
+  if (condition->get_val()) {
+    replace(original_nodes, std::move(then_statement));
+  } else if (else_statement != nullptr) {
+    replace(original_nodes, std::move(else_statement));
+  } else {
+    replace(original_nodes, make_ast<ExpressionStatement>(nullptr));
+  }
+}
+
+void ConstantFolder::visit(SwitchStatement& switch_statement) {
+  // case values fold down to the literals codegen requires
+  fold(switch_statement.get_expression());
+  for (auto& clause : switch_statement.get_clauses()) {
+    for (auto& value : clause.values) {
+      fold(value);
+    }
+  }
+  push_scope();
+  for (auto& clause : switch_statement.get_clauses()) {
+    for (auto& block_item : clause.block_items) {
+      fold(block_item);
+    }
+  }
+  pop_scope();
+}
+
+void ConstantFolder::visit(WhileStatement& while_statement) {
+  auto& while_expression = while_statement.get_while_expression();
+  fold(while_expression);
+  fold(while_statement.get_loop_statement());
+  if (is_boolean(*while_expression, false)) {
+    replace(count_nodes(while_statement),
+            make_ast<ExpressionStatement>(nullptr));
+  }
+}
+
+void ConstantFolder::visit(ForStatement& for_statement) {
+  auto& init_clause = for_statement.get_init_clause();
+  auto& cond_expression = for_statement.get_cond_expression();
+  fold(init_clause);
+  fold(cond_expression);
+  fold(for_statement.get_iteration_expression());
+  fold(for_statement.get_loop_statement());
+  auto& condition = cond_expression->get_expression();
+  if (condition != nullptr && is_boolean(*condition, false)) {
+    // the init clause still runs once
+    replace(count_nodes(for_statement), std::move(init_clause));
+  }
+}
+
+void ConstantFolder::visit(ParallelForStatement& parallel_for_statement) {
+  // the loop keeps its shape, codegen needs the canonical form to outline it
+  auto& for_statement = parallel_for_statement.get_for_statement();
+  fold(parallel_for_statement.get_chunk());
+  fold(for_statement->get_init_clause());
+  fold(for_statement->get_cond_expression());
+  fold(for_statement->get_iteration_expression());
+  fold(for_statement->get_loop_statement());
+}
+
+void ConstantFolder::visit(Identifier& identifier) {
+  auto* binding = lookup(identifier.get_name());
+  if (binding != nullptr && binding->constant != nullptr) {
+    replace(1, clone_literal(*(binding->constant)));
+  }
+}
+
+void ConstantFolder::visit(
+    BinaryOperationExpression& binary_operation_expression) {
+  auto& lhs = binary_operation_expression.get_lhs();
+  auto& rhs = binary_operation_expression.get_rhs();
+  if (binary_operation_expression.get_op_type() == type::BinaryOp::ASSIGN) {
+    // the target stays an lvalue, only its index may fold
+    auto* array_reference = dynamic_cast<ArrayReference*>(lhs.get());
+    if (array_reference != nullptr) {
+      fold(array_reference->get_index());
+    }
+    fold(rhs);
+    return;
+  }
+  fold(lhs);
+  fold(rhs);
+  int original_nodes = count_nodes(binary_operation_expression);
+  auto folded =
+      fold_binary(binary_operation_expression.get_op_type(), *lhs, *rhs);
+  if (folded == nullptr) {
+    folded = simplify(binary_operation_expression);
+  }
+  if (folded != nullptr) {
+    replace(original_nodes, std::move(folded));
+  }
+}
+
+void ConstantFolder::visit(
+    UnaryOperationExpression& unary_operation_expression) {
+  auto& operand = unary_operation_expression.get_operand();
+  fold(operand);
+  int original_nodes = count_nodes(unary_operation_expression);
+  auto folded = fold_unary(unary_operation_expression.get_op_type(), *operand);
+  if (folded == nullptr) {
+    folded = simplify(unary_operation_expression);
+  }
+  if (folded != nullptr) {
+    replace(original_nodes, std::move(folded));
+  }
+}
+
+void ConstantFolder::visit(ConditionalExpression& conditional_expression) {
+  fold(conditional_expression.get_cond_expression());
+  fold(conditional_expression.get_true_expression());
+  fold(conditional_expression.get_false_expression());
+}
+
+void ConstantFolder::visit(FunctionCall& function_call) {
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call.get_target().get());
+  if (identifier != nullptr && identifier->get_name() == "input") {
+    // input writes to its argument
+    return;
+  }
+  bool constant_arguments = true;
+  for (auto& argument : function_call.get_argument_list()) {
+    fold(argument);
+    constant_arguments = constant_arguments && is_literal(*argument);
+  }
+  if (interpreter_ == nullptr || !evaluate_calls_ || identifier == nullptr ||
+      !constant_arguments || !interpreter_->is_pure(identifier->get_name())) {
+    return;
+  }
+  try {
+    int original_nodes = count_nodes(function_call);
+    replace(original_nodes, interpreter_->evaluate(function_call));
+    ++evaluated_calls_;
+  } catch (EvaluationError&) {
+    // out of budget or not representable, the call stays
+  }
+}
+
+void ConstantFolder::visit(SpawnExpression& spawn_expression) {
+  // like become, the call has to stay a call
+  auto& function_call = spawn_expression.get_function_call();
+  for (auto& argument : function_call->get_argument_list()) {
+    fold(argument);
+  }
+}
+
+void ConstantFolder::visit(ArrayReference& array_reference) {
+  fold(array_reference.get_index());
+}
+
+void ConstantFolder::replace(int original_nodes,
+                             std::unique_ptr<BlockItem>&& replacement) {
+  removed_nodes_ += original_nodes - count_nodes(*replacement);
+  replacement_ = std::move(replacement);
+}
+
+void ConstantFolder::push_scope() {
+  scopes_.push_back(std::map<std::string, Binding>());
+}
+
+void ConstantFolder::pop_scope() { scopes_.pop_back(); }
+
+void ConstantFolder::bind(const std::string& name, type::Specifier specifier,
+                          bool is_array,
+                          std::unique_ptr<Expression>&& constant) {
+  auto& binding = scopes_.back()[name];
+  binding.specifier = specifier;
+  binding.is_array = is_array;
+  binding.constant = std::move(constant);
+}
+
+ConstantFolder::Binding* ConstantFolder::lookup(const std::string& name) {
+  for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+    auto search = scope->find(name);
+    if (search != scope->end()) {
+      return &(search->second);
+    }
+  }
+  return nullptr;
+}
+
+type::Specifier ConstantFolder::infer_type(Expression& expression) {
+  if (dynamic_cast<IntegerExpression*>(&expression)) {
+    return type::Specifier::INT;
+  } else if (dynamic_cast<FloatExpression*>(&expression)) {
+    return type::Specifier::DOUBLE;
+  } else if (dynamic_cast<BooleanExpression*>(&expression)) {
+    return type::Specifier::BOOL;
+  } else if (dynamic_cast<CharacterExpression*>(&expression)) {
+    return type::Specifier::CHAR;
+  } else if (dynamic_cast<StringLiteralExpression*>(&expression)) {
+    return type::Specifier::STRING;
+  } else if (auto* identifier = dynamic_cast<Identifier*>(&expression)) {
+    auto* binding = lookup(identifier->get_name());
+    if (binding != nullptr && !binding->is_array) {
+      return binding->specifier;
+    }
+  } else if (auto* array_reference =
+                 dynamic_cast<ArrayReference*>(&expression)) {
+    auto* identifier =
+        dynamic_cast<Identifier*>(array_reference->get_target().get());
+    auto* binding =
+        identifier != nullptr ? lookup(identifier->get_name()) : nullptr;
+    if (binding != nullptr && binding->is_array) {
+      return binding->specifier;
+    }
+  } else if (auto* unary = dynamic_cast<UnaryOperationExpression*>(&expression)) {
+    if (unary->get_op_type() == type::UnaryOp::LOGIC_NOT) {
+      return type::Specifier::BOOL;
+    }
+    // ~ and - keep the operand type
+    return infer_type(*(unary->get_operand()));
+  } else if (auto* binary =
+                 dynamic_cast<BinaryOperationExpression*>(&expression)) {
+    auto op = binary->get_op_type();
+    if (is_boolean_op(op)) {
+      return type::Specifier::BOOL;
+    }
+    auto lhs = infer_type(*(binary->get_lhs()));
+    if (op == type::BinaryOp::ASSIGN) {
+      return lhs;
+    }
+    auto rhs = infer_type(*(binary->get_rhs()));
+    if (lhs == type::Specifier::BOOL && rhs == type::Specifier::BOOL &&
+        (op == type::BinaryOp::BIT_AND || op == type::BinaryOp::BIT_XOR ||
+         op == type::BinaryOp::BIT_OR)) {
+      return type::Specifier::BOOL;
+    }
+    if (!is_arithmetic(lhs) || !is_arithmetic(rhs)) {
+      return type::Specifier::UNDEFINED;
+    }
+    if (op == type::BinaryOp::SHIFT_LEFT || op == type::BinaryOp::SHIFT_RIGHT) {
+      // shifts have the type of the promoted lhs
+      rhs = lhs;
+    }
+    if (lhs == type::Specifier::DOUBLE || lhs == type::Specifier::FLOAT ||
+        rhs == type::Specifier::DOUBLE || rhs == type::Specifier::FLOAT) {
+      return type::Specifier::DOUBLE;
+    } else if (lhs == type::Specifier::ULONG || rhs == type::Specifier::ULONG) {
+      return type::Specifier::ULONG;
+    } else if (lhs == type::Specifier::LONG || rhs == type::Specifier::LONG) {
+      return type::Specifier::LONG;
+    } else if (lhs == type::Specifier::UINT || rhs == type::Specifier::UINT) {
+      return type::Specifier::UINT;
+    } else if (lhs == type::Specifier::INT || rhs == type::Specifier::INT ||
+               op == type::BinaryOp::SHIFT_LEFT ||
+               op == type::BinaryOp::SHIFT_RIGHT) {
+      return type::Specifier::INT;
+    }
+    return type::Specifier::SHORT;
+  } else if (auto* function_call = dynamic_cast<FunctionCall*>(&expression)) {
+    auto* identifier =
+        dynamic_cast<Identifier*>(function_call->get_target().get());
+    if (identifier != nullptr) {
+      auto search = function_types_.find(identifier->get_name());
+      if (search != function_types_.end()) {
+        return search->second;
+      }
+    }
+  }
+  return type::Specifier::UNDEFINED;
+}
+
+std::unique_ptr<Expression> ConstantFolder::fold_binary(type::BinaryOp op,
+                                                        Expression& lhs,
+                                                        Expression& rhs) {
+  auto* lhs_bool = dynamic_cast<BooleanExpression*>(&lhs);
+  auto* rhs_bool = dynamic_cast<BooleanExpression*>(&rhs);
+  if (lhs_bool && rhs_bool) {
+    bool lhs_val = lhs_bool->get_val();
+    bool rhs_val = rhs_bool->get_val();
+    switch (op) {
+      case type::BinaryOp::EQUAL:
+        return make_ast<BooleanExpression>(lhs_val == rhs_val);
+      case type::BinaryOp::NOT_EQUAL:
+        return make_ast<BooleanExpression>(lhs_val != rhs_val);
+      case type::BinaryOp::LOGIC_AND:
+        return make_ast<BooleanExpression>(lhs_val && rhs_val);
+      case type::BinaryOp::LOGIC_OR:
+        return make_ast<BooleanExpression>(lhs_val || rhs_val);
+      case type::BinaryOp::BIT_AND:
+        return make_ast<BooleanExpression>(lhs_val & rhs_val);
+      case type::BinaryOp::BIT_XOR:
+        return make_ast<BooleanExpression>(lhs_val ^ rhs_val);
+      case type::BinaryOp::BIT_OR:
+        return make_ast<BooleanExpression>(lhs_val | rhs_val);
+      default:
+        return nullptr;
+    }
+  }
+
+  auto* lhs_char = dynamic_cast<CharacterExpression*>(&lhs);
+  auto* rhs_char = dynamic_cast<CharacterExpression*>(&rhs);
+  if (lhs_char && rhs_char) {
+    return compare(op, lhs_char->get_val(), rhs_char->get_val());
+  }
+
+  auto* lhs_int = dynamic_cast<IntegerExpression*>(&lhs);
+  auto* rhs_int = dynamic_cast<IntegerExpression*>(&rhs);
+  auto* lhs_float = dynamic_cast<FloatExpression*>(&lhs);
+  auto* rhs_float = dynamic_cast<FloatExpression*>(&rhs);
+  if ((lhs_int || lhs_float) && (rhs_int || rhs_float) &&
+      (lhs_float || rhs_float)) {
+    double lhs_val = lhs_float ? lhs_float->get_val() : lhs_int->get_val();
+    double rhs_val = rhs_float ? rhs_float->get_val() : rhs_int->get_val();
+    switch (op) {
+      case type::BinaryOp::ADD:
+        return make_ast<FloatExpression>(lhs_val + rhs_val);
+      case type::BinaryOp::SUB:
+        return make_ast<FloatExpression>(lhs_val - rhs_val);
+      case type::BinaryOp::MUL:
+        return make_ast<FloatExpression>(lhs_val * rhs_val);
+      case type::BinaryOp::DIV:
+        return make_ast<FloatExpression>(lhs_val / rhs_val);
+      default:
+        return compare(op, lhs_val, rhs_val);
+    }
+  }
+
+  if (lhs_int && rhs_int) {
+    int64_t lhs_val = lhs_int->get_val();
+    int64_t rhs_val = rhs_int->get_val();
+    switch (op) {
+      case type::BinaryOp::ADD:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val + rhs_val));
+      case type::BinaryOp::SUB:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val - rhs_val));
+      case type::BinaryOp::MUL:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val * rhs_val));
+      case type::BinaryOp::DIV:
+      case type::BinaryOp::MOD:
+        // leave undefined divisions to the runtime
+        if (rhs_val == 0 ||
+            (lhs_val == std::numeric_limits<int32_t>::min() && rhs_val == -1)) {
+          return nullptr;
+        }
+        return make_ast<IntegerExpression>(op == type::BinaryOp::DIV
+                                               ? wrap_int(lhs_val / rhs_val)
+                                               : wrap_int(lhs_val % rhs_val));
+      case type::BinaryOp::SHIFT_LEFT:
+      case type::BinaryOp::SHIFT_RIGHT:
+        // out of range shift amounts are poison, leave them alone
+        if (rhs_val < 0 || rhs_val >= 32) {
+          return nullptr;
+        }
+        return make_ast<IntegerExpression>(
+            op == type::BinaryOp::SHIFT_LEFT
+                ? wrap_int(static_cast<int64_t>(static_cast<uint32_t>(lhs_val)
+                                                << rhs_val))
+                : wrap_int(lhs_val >> rhs_val));
+      case type::BinaryOp::BIT_AND:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val & rhs_val));
+      case type::BinaryOp::BIT_XOR:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val ^ rhs_val));
+      case type::BinaryOp::BIT_OR:
+        return make_ast<IntegerExpression>(wrap_int(lhs_val | rhs_val));
+      default:
+        return compare(op, lhs_val, rhs_val);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<Expression> ConstantFolder::fold_unary(type::UnaryOp op,
+                                                       Expression& operand) {
+  if (auto* integer = dynamic_cast<IntegerExpression*>(&operand)) {
+    switch (op) {
+      case type::UnaryOp::POSITIVIZE:
+        return make_ast<IntegerExpression>(integer->get_val());
+      case type::UnaryOp::NEGATE:
+        return make_ast<IntegerExpression>(
+            wrap_int(-static_cast<int64_t>(integer->get_val())));
+      case type::UnaryOp::BIT_NOT:
+        return make_ast<IntegerExpression>(~integer->get_val());
+      default:
+        return nullptr;
+    }
+  } else if (auto* real = dynamic_cast<FloatExpression*>(&operand)) {
+    switch (op) {
+      case type::UnaryOp::POSITIVIZE:
+        return make_ast<FloatExpression>(real->get_val());
+      case type::UnaryOp::NEGATE:
+        return make_ast<FloatExpression>(-real->get_val());
+      default:
+        return nullptr;
+    }
+  } else if (auto* boolean = dynamic_cast<BooleanExpression*>(&operand)) {
+    if (op == type::UnaryOp::LOGIC_NOT) {
+      return make_ast<BooleanExpression>(!boolean->get_val());
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<Expression> ConstantFolder::simplify(
+    BinaryOperationExpression& expression) {
+  auto& lhs = expression.get_lhs();
+  auto& rhs = expression.get_rhs();
+  auto lhs_type = infer_type(*lhs);
+  auto rhs_type = infer_type(*rhs);
+  switch (expression.get_op_type()) {
+    case type::BinaryOp::ADD:
+      if (lhs_type == type::Specifier::INT && is_integer(*rhs, 0)) {
+        return std::move(lhs);
+      } else if (rhs_type == type::Specifier::INT && is_integer(*lhs, 0)) {
+        return std::move(rhs);
+      }
+      break;
+    case type::BinaryOp::SUB:
+      if (lhs_type == type::Specifier::INT && is_integer(*rhs, 0)) {
+        return std::move(lhs);
+      }
+      break;
+    case type::BinaryOp::MUL:
+      if (lhs_type == type::Specifier::INT && is_integer(*rhs, 1)) {
+        return std::move(lhs);
+      } else if (rhs_type == type::Specifier::INT && is_integer(*lhs, 1)) {
+        return std::move(rhs);
+      } else if (lhs_type == type::Specifier::INT && is_integer(*rhs, 0) &&
+                 !has_side_effects(*lhs)) {
+        return make_ast<IntegerExpression>(0);
+      } else if (rhs_type == type::Specifier::INT && is_integer(*lhs, 0) &&
+                 !has_side_effects(*rhs)) {
+        return make_ast<IntegerExpression>(0);
+      }
+      break;
+    case type::BinaryOp::DIV:
+      if (lhs_type == type::Specifier::INT && is_integer(*rhs, 1)) {
+        return std::move(lhs);
+      }
+      break;
+    case type::BinaryOp::LOGIC_AND:
+      // both sides are always evaluated, so a side may only be dropped when
+      // it has no side effects
+      if (lhs_type == type::Specifier::BOOL && is_boolean(*rhs, true)) {
+        return std::move(lhs);
+      } else if (rhs_type == type::Specifier::BOOL && is_boolean(*lhs, true)) {
+        return std::move(rhs);
+      } else if (lhs_type == type::Specifier::BOOL && is_boolean(*rhs, false) &&
+                 !has_side_effects(*lhs)) {
+        return make_ast<BooleanExpression>(false);
+      } else if (rhs_type == type::Specifier::BOOL &&
+                 is_boolean(*lhs, false) && !has_side_effects(*rhs)) {
+        return make_ast<BooleanExpression>(false);
+      }
+      break;
+    case type::BinaryOp::LOGIC_OR:
+      if (lhs_type == type::Specifier::BOOL && is_boolean(*rhs, false)) {
+        return std::move(lhs);
+      } else if (rhs_type == type::Specifier::BOOL &&
+                 is_boolean(*lhs, false)) {
+        return std::move(rhs);
+      } else if (lhs_type == type::Specifier::BOOL && is_boolean(*rhs, true) &&
+                 !has_side_effects(*lhs)) {
+        return make_ast<BooleanExpression>(true);
+      } else if (rhs_type == type::Specifier::BOOL && is_boolean(*lhs, true) &&
+                 !has_side_effects(*rhs)) {
+        return make_ast<BooleanExpression>(true);
+      }
+      break;
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+std::unique_ptr<Expression> ConstantFolder::simplify(
+    UnaryOperationExpression& expression) {
+  auto& operand = expression.get_operand();
+  auto op = expression.get_op_type();
+  auto operand_type = infer_type(*operand);
+  if (op == type::UnaryOp::POSITIVIZE && is_arithmetic(operand_type)) {
+    return std::move(operand);
+  }
+  // --x, ~~x and !!x
+  auto* inner = dynamic_cast<UnaryOperationExpression*>(operand.get());
+  if (inner == nullptr || inner->get_op_type() != op) {
+    return nullptr;
+  }
+  if ((op == type::UnaryOp::NEGATE &&
+       (operand_type == type::Specifier::INT ||
+        operand_type == type::Specifier::LONG ||
+        operand_type == type::Specifier::DOUBLE)) ||
+      (op == type::UnaryOp::BIT_NOT && is_arithmetic(operand_type) &&
+       operand_type != type::Specifier::FLOAT &&
+       operand_type != type::Specifier::DOUBLE) ||
+      (op == type::UnaryOp::LOGIC_NOT &&
+       infer_type(*(inner->get_operand())) == type::Specifier::BOOL)) {
+    return std::move(inner->get_operand());
+  }
+  return nullptr;
+}
+
+bool is_literal(Expression& expression) {
+  return dynamic_cast<ConstantExpression*>(&expression) != nullptr;
+}
+
+std::unique_ptr<Expression> clone_literal(Expression& expression) {
+  if (auto* integer = dynamic_cast<IntegerExpression*>(&expression)) {
+    return make_ast<IntegerExpression>(integer->get_val());
+  } else if (auto* real = dynamic_cast<FloatExpression*>(&expression)) {
+    return make_ast<FloatExpression>(real->get_val());
+  } else if (auto* boolean = dynamic_cast<BooleanExpression*>(&expression)) {
+    return make_ast<BooleanExpression>(boolean->get_val());
+  } else if (auto* character =
+                 dynamic_cast<CharacterExpression*>(&expression)) {
+    return make_ast<CharacterExpression>(character->get_val());
+  } else if (auto* string =
+                 dynamic_cast<StringLiteralExpression*>(&expression)) {
+    return make_ast<StringLiteralExpression>(string->get_val());
+  }
+  assert(false);
+  return nullptr;
+}
+
+bool has_side_effects(Expression& expression) {
+  if (dynamic_cast<FunctionCall*>(&expression) ||
+      dynamic_cast<SpawnExpression*>(&expression)) {
+    return true;
+  } else if (auto* binary =
+                 dynamic_cast<BinaryOperationExpression*>(&expression)) {
+    return binary->get_op_type() == type::BinaryOp::ASSIGN ||
+           has_side_effects(*(binary->get_lhs())) ||
+           has_side_effects(*(binary->get_rhs()));
+  } else if (auto* unary = dynamic_cast<UnaryOperationExpression*>(&expression)) {
+    return has_side_effects(*(unary->get_operand()));
+  } else if (auto* array_reference =
+                 dynamic_cast<ArrayReference*>(&expression)) {
+    return has_side_effects(*(array_reference->get_index()));
+  } else if (auto* conditional =
+                 dynamic_cast<ConditionalExpression*>(&expression)) {
+    return has_side_effects(*(conditional->get_cond_expression())) ||
+           has_side_effects(*(conditional->get_true_expression())) ||
+           has_side_effects(*(conditional->get_false_expression()));
+  }
+  return false;
+}
+}  // namespace ntc
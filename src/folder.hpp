@@ -0,0 +1,123 @@
+// AST level constant folding and algebraic simplification, runs between
+// parsing and codegen so that constant subtrees never reach LLVM
+#pragma once
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include "interpreter.hpp"
+#include "walker.hpp"
+namespace ntc {
+class ConstantFolder final : public ASTWalker {
+ public:
+  // with an interpreter, constexpr initializers are evaluated and, when
+  // evaluate_calls is set, so is every call to a pure function whose
+  // arguments folded to literals
+  explicit ConstantFolder(Interpreter* interpreter = nullptr,
+                          bool evaluate_calls = false);
+
+  using ASTWalker::visit;
+
+  virtual void visit(TranslationUnit& translation_unit) override;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  virtual void visit(Declaration& declaration) override;
+
+  virtual void visit(CompoundStatement& compound_statement) override;
+
+  virtual void visit(ExpressionStatement& expression_statement) override;
+
+  virtual void visit(ReturnStatement& return_statement) override;
+
+  virtual void visit(BecomeStatement& become_statement) override;
+
+  virtual void visit(IfStatement& if_statement) override;
+
+  virtual void visit(SwitchStatement& switch_statement) override;
+
+  virtual void visit(WhileStatement& while_statement) override;
+
+  virtual void visit(ForStatement& for_statement) override;
+
+  virtual void visit(ParallelForStatement& parallel_for_statement) override;
+
+  virtual void visit(Identifier& identifier) override;
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override;
+
+  virtual void visit(
+      UnaryOperationExpression& unary_operation_expression) override;
+
+  virtual void visit(ConditionalExpression& conditional_expression) override;
+
+  virtual void visit(FunctionCall& function_call) override;
+
+  virtual void visit(SpawnExpression& spawn_expression) override;
+
+  virtual void visit(ArrayReference& array_reference) override;
+
+  int get_removed_nodes() const { return removed_nodes_; }
+
+  int get_evaluated_calls() const { return evaluated_calls_; }
+
+ private:
+  struct Binding {
+    type::Specifier specifier;
+    bool is_array;
+    // literal value of a const local, nullptr if not known
+    std::unique_ptr<Expression> constant;
+  };
+
+  // visit node and swap in the replacement it produced, if any
+  template <typename T>
+  void fold(std::unique_ptr<T>& node) {
+    if (node == nullptr) {
+      return;
+    }
+    replacement_.reset();
+    node->accept(*this);
+    if (replacement_ != nullptr) {
+      node.reset(static_cast<T*>(replacement_.release()));
+    }
+  }
+
+  void replace(int original_nodes, std::unique_ptr<BlockItem>&& replacement);
+
+  void push_scope();
+
+  void pop_scope();
+
+  void bind(const std::string& name, type::Specifier specifier, bool is_array,
+            std::unique_ptr<Expression>&& constant = nullptr);
+
+  Binding* lookup(const std::string& name);
+
+  type::Specifier infer_type(Expression& expression);
+
+  std::unique_ptr<Expression> fold_binary(type::BinaryOp op, Expression& lhs,
+                                          Expression& rhs);
+
+  std::unique_ptr<Expression> fold_unary(type::UnaryOp op,
+                                         Expression& operand);
+
+  std::unique_ptr<Expression> simplify(BinaryOperationExpression& expression);
+
+  std::unique_ptr<Expression> simplify(UnaryOperationExpression& expression);
+
+  std::deque<std::map<std::string, Binding>> scopes_;
+  std::map<std::string, type::Specifier> function_types_;
+  std::unique_ptr<BlockItem> replacement_;
+  Interpreter* interpreter_;
+  bool evaluate_calls_;
+  int removed_nodes_;
+  int evaluated_calls_;
+};
+
+bool is_literal(Expression& expression);
+
+std::unique_ptr<Expression> clone_literal(Expression& expression);
+
+bool has_side_effects(Expression& expression);
+}  // namespace ntc
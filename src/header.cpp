@@ -0,0 +1,97 @@
+#include "header.hpp"
+#include <cctype>
+#include <stdexcept>
+namespace ntc {
+HeaderWriter::HeaderWriter(std::ostream& os, const std::string& filename)
+    : os_(os) {
+  auto slash = filename.find_last_of('/');
+  auto name =
+      slash == std::string::npos ? filename : filename.substr(slash + 1);
+  for (char c : name) {
+    guard_ += std::isalnum(static_cast<unsigned char>(c))
+                  ? static_cast<char>(std::toupper(c))
+                  : '_';
+  }
+  if (guard_.empty() || std::isdigit(static_cast<unsigned char>(guard_[0]))) {
+    guard_ = "NTC_" + guard_;
+  }
+  guard_ += "_";
+}
+
+void HeaderWriter::write(TranslationUnit& translation_unit) {
+  os_ << "// generated by ntc from " << translation_unit.get_name()
+      << ", do not edit\n";
+  os_ << "#ifndef " << guard_ << "\n#define " << guard_ << "\n";
+  os_ << "#include <stdbool.h>\n#include <stddef.h>\n#include <stdint.h>\n";
+  os_ << "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+  for (auto& decl : translation_unit.get_declarations()) {
+    auto* function = dynamic_cast<FunctionDefinition*>(decl.get());
+    if (function != nullptr &&
+        function->has_qualifier(type::FunctionQualifier::EXPORT)) {
+      write_function(*function);
+    }
+  }
+  os_ << "\n#ifdef __cplusplus\n}\n#endif\n#endif\n";
+}
+
+void HeaderWriter::write_function(FunctionDefinition& function_definition) {
+  auto& name = function_definition.get_identifier()->get_name();
+  os_ << get_c_type(function_definition.get_declaration_specifier()
+                        ->get_type_specifier()
+                        ->get_specifier(),
+                    name)
+      << " " << name << "(";
+  auto& parameter_list = function_definition.get_parameter_list();
+  if (parameter_list.empty()) {
+    os_ << "void";
+  }
+  std::string separator;
+  for (auto& parameter : parameter_list) {
+    auto& specifier = parameter->get_declaration_specifier();
+    auto& declarator = parameter->get_declarator();
+    auto& parameter_name = declarator->get_identifier()->get_name();
+    auto type =
+        get_c_type(specifier->get_type_specifier()->get_specifier(), name);
+    os_ << separator;
+    if (declarator->get_is_array()) {
+      os_ << (specifier->get_is_const() ? "const " : "") << type << "* "
+          << parameter_name << ", size_t " << parameter_name << "_length";
+    } else {
+      os_ << type << " " << parameter_name;
+    }
+    separator = ", ";
+  }
+  os_ << ");\n";
+}
+
+std::string HeaderWriter::get_c_type(type::Specifier specifier,
+                                     const std::string& function) const {
+  switch (specifier) {
+    case type::Specifier::BOOL:
+      return "bool";
+    case type::Specifier::CHAR:
+      return "char";
+    case type::Specifier::DOUBLE:
+      return "double";
+    case type::Specifier::FLOAT:
+      return "float";
+    case type::Specifier::INT:
+      return "int32_t";
+    case type::Specifier::UINT:
+      return "uint32_t";
+    case type::Specifier::LONG:
+      return "int64_t";
+    case type::Specifier::ULONG:
+      return "uint64_t";
+    case type::Specifier::SHORT:
+      return "int16_t";
+    case type::Specifier::VOID:
+      return "void";
+    case type::Specifier::STRING:
+      return "const char*";
+    default:
+      throw std::logic_error("Header: vectors have no C type: \'" + function +
+                             "\'");
+  }
+}
+}  // namespace ntc
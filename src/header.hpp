@@ -0,0 +1,26 @@
+// --emit-header: declarations of the export functions of a file for C and
+// C++ programs that link its object or -shared library, the array
+// parameters as a pointer and a length the way the C entry points take them
+#pragma once
+#include <ostream>
+#include <string>
+#include "ast.hpp"
+namespace ntc {
+class HeaderWriter {
+ public:
+  // the include guard is made of the file name of the header
+  HeaderWriter(std::ostream& os, const std::string& filename);
+
+  void write(TranslationUnit& translation_unit);
+
+ private:
+  // the C type of a value of specifier, throws for vectors
+  std::string get_c_type(type::Specifier specifier,
+                         const std::string& function) const;
+
+  void write_function(FunctionDefinition& function_definition);
+
+  std::ostream& os_;
+  std::string guard_;
+};
+}  // namespace ntc
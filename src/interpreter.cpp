@@ -0,0 +1,1033 @@
+#include "interpreter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+namespace ntc {
+namespace {
+// deeper recursion would exhaust the stack of the compiler itself
+const int kMaxCallDepth = 1000;
+
+bool is_integral(type::Specifier specifier) {
+  return specifier == type::Specifier::SHORT ||
+         specifier == type::Specifier::INT ||
+         specifier == type::Specifier::LONG || type::is_unsigned(specifier);
+}
+
+bool is_floating(type::Specifier specifier) {
+  return specifier == type::Specifier::FLOAT ||
+         specifier == type::Specifier::DOUBLE;
+}
+
+int64_t wrap(int64_t val, type::Specifier specifier) {
+  auto bits = static_cast<uint64_t>(val);
+  switch (specifier) {
+    case type::Specifier::SHORT:
+      return static_cast<int16_t>(static_cast<uint16_t>(bits));
+    case type::Specifier::INT:
+      return static_cast<int32_t>(static_cast<uint32_t>(bits));
+    case type::Specifier::UINT:
+      return static_cast<uint32_t>(bits);
+    default:
+      return val;
+  }
+}
+
+int bit_width(type::Specifier specifier) {
+  switch (specifier) {
+    case type::Specifier::SHORT:
+      return 16;
+    case type::Specifier::INT:
+    case type::Specifier::UINT:
+      return 32;
+    default:
+      return 64;
+  }
+}
+
+// the type both operands are brought to, like the generated code does it
+type::Specifier common_integral(type::Specifier lhs, type::Specifier rhs) {
+  int width = std::max(std::max(bit_width(lhs), bit_width(rhs)), 32);
+  bool is_unsigned =
+      (type::is_unsigned(lhs) && bit_width(lhs) == width) ||
+      (type::is_unsigned(rhs) && bit_width(rhs) == width);
+  if (bit_width(lhs) == 16 && bit_width(rhs) == 16) {
+    return type::Specifier::SHORT;
+  }
+  if (width == 64) {
+    return is_unsigned ? type::Specifier::ULONG : type::Specifier::LONG;
+  }
+  return is_unsigned ? type::Specifier::UINT : type::Specifier::INT;
+}
+
+template <typename T>
+T bit_function(const std::string& name, T x, T y) {
+  const int bits = sizeof(T) * 8;
+  if (name == "popcount" || name == "clz" || name == "ctz") {
+    int count = 0;
+    for (int i = 0; i < bits; ++i) {
+      bool set = (x >> (name == "clz" ? bits - 1 - i : i)) & 1;
+      if (name == "popcount") {
+        count += set;
+      } else if (set) {
+        break;
+      } else {
+        ++count;
+      }
+    }
+    return count;
+  }
+  if (name == "bswap") {
+    T swapped = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      swapped = (swapped << 8) | ((x >> (i * 8)) & 0xff);
+    }
+    return swapped;
+  }
+  int amount = static_cast<int>(y % bits);
+  if (amount == 0) {
+    return x;
+  }
+  return name == "rotl" ? (x << amount) | (x >> (bits - amount))
+                        : (x >> amount) | (x << (bits - amount));
+}
+
+template <typename T>
+T math_function(const std::string& name, T x, T y, T z) {
+  if (name == "sqrt") return std::sqrt(x);
+  if (name == "fabs" || name == "abs") return std::fabs(x);
+  if (name == "floor") return std::floor(x);
+  if (name == "ceil") return std::ceil(x);
+  if (name == "trunc") return std::trunc(x);
+  if (name == "round") return std::round(x);
+  if (name == "exp") return std::exp(x);
+  if (name == "exp2") return std::exp2(x);
+  if (name == "log") return std::log(x);
+  if (name == "log2") return std::log2(x);
+  if (name == "log10") return std::log10(x);
+  if (name == "sin") return std::sin(x);
+  if (name == "cos") return std::cos(x);
+  if (name == "pow") return std::pow(x, y);
+  if (name == "fma") return std::fma(x, y, z);
+  if (name == "min") return std::fmin(x, y);
+  return std::fmax(x, y);
+}
+
+int64_t min_value(type::Specifier specifier) {
+  switch (specifier) {
+    case type::Specifier::SHORT:
+      return std::numeric_limits<int16_t>::min();
+    case type::Specifier::INT:
+      return std::numeric_limits<int32_t>::min();
+    default:
+      return std::numeric_limits<int64_t>::min();
+  }
+}
+
+template <typename T>
+bool compare(type::BinaryOp op, T lhs, T rhs, bool* result) {
+  switch (op) {
+    case type::BinaryOp::LESS:
+      *result = lhs < rhs;
+      return true;
+    case type::BinaryOp::GREATER:
+      *result = lhs > rhs;
+      return true;
+    case type::BinaryOp::LESS_EQUAL:
+      *result = lhs <= rhs;
+      return true;
+    case type::BinaryOp::GREATER_EQUAL:
+      *result = lhs >= rhs;
+      return true;
+    case type::BinaryOp::EQUAL:
+      *result = lhs == rhs;
+      return true;
+    case type::BinaryOp::NOT_EQUAL:
+      // ordered compare, NaN is neither less nor greater
+      *result = lhs < rhs || lhs > rhs;
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+Interpreter::Interpreter(TranslationUnit& translation_unit,
+                         long long step_limit, long long memory_limit)
+    : frame_base_(0),
+      return_type_(type::Specifier::UNDEFINED),
+      flow_(Flow::NORMAL),
+      depth_(0),
+      steps_(0),
+      total_steps_(0),
+      memory_(0),
+      step_limit_(step_limit),
+      memory_limit_(memory_limit) {
+  translation_unit.accept(purity_);
+  for (auto& decl : translation_unit.get_declarations()) {
+    auto* function = dynamic_cast<FunctionDefinition*>(decl.get());
+    if (function != nullptr) {
+      functions_[function->get_identifier()->get_name()] = function;
+    }
+  }
+}
+
+bool Interpreter::is_pure(const std::string& name) const {
+  return purity_.is_pure(name);
+}
+
+std::unique_ptr<Expression> Interpreter::evaluate(Expression& expression) {
+  scopes_.clear();
+  frame_base_ = 0;
+  return_type_ = type::Specifier::UNDEFINED;
+  flow_ = Flow::NORMAL;
+  depth_ = 0;
+  steps_ = 0;
+  memory_ = 0;
+  push_scope();
+  auto value = eval(expression);
+  pop_scope();
+  switch (value.specifier) {
+    case type::Specifier::INT:
+      return make_ast<IntegerExpression>(static_cast<int>(value.integer));
+    case type::Specifier::DOUBLE:
+      return make_ast<FloatExpression>(value.real);
+    case type::Specifier::BOOL:
+      return make_ast<BooleanExpression>(value.integer != 0);
+    case type::Specifier::CHAR:
+      return make_ast<CharacterExpression>(static_cast<char>(value.integer));
+    default:
+      error("a result of type " + type::to_string(value.specifier) +
+            " has no literal form");
+  }
+}
+
+void Interpreter::visit(Declaration& declaration) {
+  tick();
+  auto& declarator = declaration.get_declarator();
+  auto& initializer = declaration.get_initializer();
+  auto& name = declarator->get_identifier()->get_name();
+  auto specifier = declaration.get_declaration_specifier()
+                       ->get_type_specifier()
+                       ->get_specifier();
+  if (specifier == type::Specifier::STRING ||
+      specifier == type::Specifier::VOID || type::is_vector(specifier)) {
+    error("cannot declare '" + name + "' of type " +
+          type::to_string(specifier));
+  }
+  auto& variable = declare(name, specifier);
+  if (declarator->get_is_array()) {
+    int length = declarator->get_array_length();
+    if (length <= 0 || initializer != nullptr) {
+      error("unsupported array declaration '" + name + "'");
+    }
+    allocate(static_cast<long long>(length) * sizeof(Value));
+    variable.is_array = true;
+    variable.elements = std::make_shared<std::vector<Value>>(length);
+    variable.bytes += static_cast<long long>(length) * sizeof(Value);
+  } else if (initializer != nullptr) {
+    // the variable is already in scope while its initializer runs
+    auto value = convert(eval(*(initializer->get_expression())), specifier);
+    lookup(name).value = value;
+  }
+}
+
+void Interpreter::visit(CompoundStatement& compound_statement) {
+  tick();
+  push_scope();
+  for (auto& block_item : compound_statement.get_block_item_list()) {
+    block_item->accept(*this);
+    if (flow_ != Flow::NORMAL) {
+      break;
+    }
+  }
+  pop_scope();
+}
+
+void Interpreter::visit(ExpressionStatement& expression_statement) {
+  tick();
+  auto& expression = expression_statement.get_expression();
+  if (expression != nullptr) {
+    eval(*expression);
+  }
+}
+
+void Interpreter::visit(ReturnStatement& return_statement) {
+  tick();
+  auto& expression = return_statement.get_expression();
+  if (expression == nullptr) {
+    if (return_type_ != type::Specifier::VOID) {
+      error("empty return");
+    }
+    result_ = Value();
+    result_.specifier = type::Specifier::VOID;
+  } else {
+    if (return_type_ == type::Specifier::VOID) {
+      error("return value in a void function");
+    }
+    result_ = convert(eval(*expression), return_type_);
+  }
+  flow_ = Flow::RETURN;
+}
+
+void Interpreter::visit(BreakStatement&) {
+  tick();
+  flow_ = Flow::BREAK;
+}
+
+void Interpreter::visit(ContinueStatement&) {
+  tick();
+  flow_ = Flow::CONTINUE;
+}
+
+void Interpreter::visit(SyncStatement&) {
+  // spawned calls have already run
+  tick();
+}
+
+void Interpreter::visit(BecomeStatement& become_statement) {
+  tick();
+  auto value = eval(*(become_statement.get_function_call()));
+  if (return_type_ == type::Specifier::VOID) {
+    result_ = Value();
+    result_.specifier = type::Specifier::VOID;
+  } else {
+    result_ = convert(value, return_type_);
+  }
+  flow_ = Flow::RETURN;
+}
+
+void Interpreter::visit(IfStatement& if_statement) {
+  tick();
+  if (condition(*(if_statement.get_if_expression()), "if")) {
+    if_statement.get_then_statment()->accept(*this);
+  } else if (if_statement.get_else_statement() != nullptr) {
+    if_statement.get_else_statement()->accept(*this);
+  }
+}
+
+void Interpreter::visit(SwitchStatement& switch_statement) {
+  tick();
+  auto value = eval(*(switch_statement.get_expression()));
+  if (!is_integral(value.specifier) &&
+      value.specifier != type::Specifier::CHAR) {
+    error("switch needs an integer or char value");
+  }
+  // case values are converted to the promoted type of the switch value
+  auto specifier = value.specifier == type::Specifier::SHORT
+                       ? type::Specifier::INT
+                       : value.specifier;
+  auto& clauses = switch_statement.get_clauses();
+  size_t target = clauses.size();
+  for (size_t i = 0; i < clauses.size() && target == clauses.size(); ++i) {
+    for (auto& case_value : clauses[i].values) {
+      auto constant = eval(*case_value);
+      if ((constant.specifier == type::Specifier::CHAR) !=
+          (specifier == type::Specifier::CHAR)) {
+        error("case value does not match the switch");
+      }
+      if (wrap(constant.integer, specifier) == value.integer) {
+        target = i;
+        break;
+      }
+    }
+  }
+  for (size_t i = 0; i < clauses.size() && target == clauses.size(); ++i) {
+    if (clauses[i].is_default) {
+      target = i;
+    }
+  }
+  push_scope();
+  for (size_t i = target; i < clauses.size() && flow_ == Flow::NORMAL; ++i) {
+    for (auto& block_item : clauses[i].block_items) {
+      block_item->accept(*this);
+      if (flow_ != Flow::NORMAL) {
+        break;
+      }
+    }
+  }
+  pop_scope();
+  if (flow_ == Flow::BREAK) {
+    flow_ = Flow::NORMAL;
+  }
+}
+
+void Interpreter::visit(WhileStatement& while_statement) {
+  tick();
+  while (condition(*(while_statement.get_while_expression()), "while")) {
+    while_statement.get_loop_statement()->accept(*this);
+    if (flow_ == Flow::BREAK) {
+      flow_ = Flow::NORMAL;
+      break;
+    } else if (flow_ == Flow::CONTINUE) {
+      flow_ = Flow::NORMAL;
+    } else if (flow_ == Flow::RETURN) {
+      return;
+    }
+  }
+}
+
+void Interpreter::visit(ForStatement& for_statement) {
+  tick();
+  auto& cond = for_statement.get_cond_expression()->get_expression();
+  auto& iter = for_statement.get_iteration_expression();
+  if (cond == nullptr) {
+    error("for statement without condition");
+  }
+  for_statement.get_init_clause()->accept(*this);
+  while (condition(*cond, "for")) {
+    for_statement.get_loop_statement()->accept(*this);
+    if (flow_ == Flow::BREAK) {
+      flow_ = Flow::NORMAL;
+      break;
+    } else if (flow_ == Flow::CONTINUE) {
+      flow_ = Flow::NORMAL;
+    } else if (flow_ == Flow::RETURN) {
+      return;
+    }
+    if (iter != nullptr) {
+      eval(*iter);
+    }
+  }
+}
+
+void Interpreter::visit(ParallelForStatement& parallel_for_statement) {
+  // iterations are independent by contract, running them in order is one of
+  // the schedules a parallel run may take
+  parallel_for_statement.get_for_statement()->accept(*this);
+}
+
+void Interpreter::visit(Identifier& identifier) {
+  auto& variable = lookup(identifier.get_name());
+  if (variable.is_array) {
+    error("array '" + identifier.get_name() + "' used as a value");
+  }
+  if (variable.value.specifier == type::Specifier::UNDEFINED) {
+    error("read of uninitialized variable '" + identifier.get_name() + "'");
+  }
+  result_ = variable.value;
+}
+
+void Interpreter::visit(IntegerExpression& integer_expression) {
+  result_ = Value();
+  result_.specifier = type::Specifier::INT;
+  result_.integer = integer_expression.get_val();
+}
+
+void Interpreter::visit(FloatExpression& float_expression) {
+  result_ = Value();
+  result_.specifier = type::Specifier::DOUBLE;
+  result_.real = float_expression.get_val();
+}
+
+void Interpreter::visit(BooleanExpression& boolean_expression) {
+  result_ = Value();
+  result_.specifier = type::Specifier::BOOL;
+  result_.integer = boolean_expression.get_val();
+}
+
+void Interpreter::visit(CharacterExpression& character_expression) {
+  result_ = Value();
+  result_.specifier = type::Specifier::CHAR;
+  result_.integer = character_expression.get_val();
+}
+
+void Interpreter::visit(StringLiteralExpression&) {
+  error("strings cannot be evaluated at compile time");
+}
+
+void Interpreter::visit(
+    BinaryOperationExpression& binary_operation_expression) {
+  auto& lhs = binary_operation_expression.get_lhs();
+  auto op = binary_operation_expression.get_op_type();
+  // the right hand side goes first, like in the generated code
+  auto rhs_val = eval(*(binary_operation_expression.get_rhs()));
+  if (op != type::BinaryOp::ASSIGN) {
+    auto lhs_val = eval(*lhs);
+    result_ = binary(op, lhs_val, rhs_val);
+    return;
+  }
+  if (auto* identifier = dynamic_cast<Identifier*>(lhs.get())) {
+    auto& variable = lookup(identifier->get_name());
+    if (variable.is_array) {
+      error("cannot assign to an array '" + identifier->get_name() + "'");
+    }
+    variable.value = convert(rhs_val, variable.specifier);
+    result_ = variable.value;
+  } else if (auto* array_reference = dynamic_cast<ArrayReference*>(lhs.get())) {
+    auto& slot = element(*array_reference);
+    auto& target = lookup(
+        static_cast<Identifier*>(array_reference->get_target().get())
+            ->get_name());
+    slot = convert(rhs_val, target.specifier);
+    result_ = slot;
+  } else {
+    error("cannot assign value to rvalue");
+  }
+}
+
+void Interpreter::visit(UnaryOperationExpression& unary_operation_expression) {
+  auto operand = eval(*(unary_operation_expression.get_operand()));
+  result_ = unary(unary_operation_expression.get_op_type(), operand);
+}
+
+void Interpreter::visit(ConditionalExpression&) {
+  error("conditional expressions are not supported");
+}
+
+void Interpreter::visit(FunctionCall& function_call) {
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call.get_target().get());
+  if (identifier == nullptr) {
+    error("cannot call on rvalue");
+  }
+  auto& name = identifier->get_name();
+  auto search = functions_.find(name);
+  if (search == functions_.end() && is_hint_builtin(name)) {
+    result_ = hint(name, function_call);
+    return;
+  }
+  if (search == functions_.end() && is_bit_builtin(name)) {
+    result_ = bits(name, function_call);
+    return;
+  }
+  if (search == functions_.end() && is_pure_builtin(name)) {
+    result_ = math(name, function_call);
+    return;
+  }
+  if (search == functions_.end()) {
+    error("'" + name + "' cannot be called at compile time");
+  }
+  call(*(search->second), function_call);
+}
+
+void Interpreter::visit(SpawnExpression& spawn_expression) {
+  // the serial elision of a spawn is the plain call
+  spawn_expression.get_function_call()->accept(*this);
+}
+
+void Interpreter::visit(ArrayReference& array_reference) {
+  auto value = element(array_reference);
+  if (value.specifier == type::Specifier::UNDEFINED) {
+    error("read of uninitialized array element");
+  }
+  result_ = value;
+}
+
+Interpreter::Value Interpreter::eval(Expression& expression) {
+  tick();
+  expression.accept(*this);
+  return result_;
+}
+
+void Interpreter::call(FunctionDefinition& function,
+                       FunctionCall& function_call) {
+  auto& name = function.get_identifier()->get_name();
+  auto& parameter_list = function.get_parameter_list();
+  auto& argument_list = function_call.get_argument_list();
+  if (parameter_list.size() != argument_list.size()) {
+    error("invalid argument number: " + name);
+  }
+
+  // arguments are evaluated in the caller's frame, left to right
+  std::vector<Variable> arguments;
+  for (size_t i = 0; i < argument_list.size(); ++i) {
+    auto& declarator = parameter_list[i]->get_declarator();
+    auto specifier = parameter_list[i]
+                         ->get_declaration_specifier()
+                         ->get_type_specifier()
+                         ->get_specifier();
+    Variable argument{specifier, declarator->get_is_array(), Value(), nullptr,
+                      0};
+    if (declarator->get_is_array()) {
+      auto* array = dynamic_cast<Identifier*>(argument_list[i].get());
+      auto* variable = array != nullptr ? &lookup(array->get_name()) : nullptr;
+      if (variable == nullptr || !variable->is_array ||
+          variable->specifier != specifier) {
+        error("argument " + std::to_string(i + 1) + " of '" + name +
+              "' must be a " + type::to_string(specifier) + " array");
+      }
+      if (static_cast<int>(variable->elements->size()) <
+          declarator->get_array_length()) {
+        error("array argument " + std::to_string(i + 1) + " of '" + name +
+              "' is too short");
+      }
+      argument.elements = variable->elements;
+    } else {
+      argument.value = eval(*(argument_list[i]));
+      // signed and unsigned integers of one width are passed as the same bits
+      if (is_integral(argument.value.specifier) && is_integral(specifier) &&
+          bit_width(argument.value.specifier) == bit_width(specifier)) {
+        argument.value = convert(argument.value, specifier);
+      }
+      if (argument.value.specifier != specifier) {
+        error("argument " + std::to_string(i + 1) + " of '" + name +
+              "' has type " + type::to_string(argument.value.specifier) +
+              ", expected " + type::to_string(specifier));
+      }
+    }
+    arguments.push_back(std::move(argument));
+  }
+
+  if (++depth_ > kMaxCallDepth) {
+    error("call depth limit of " + std::to_string(kMaxCallDepth) +
+          " exceeded");
+  }
+  auto saved_frame_base = frame_base_;
+  auto saved_return_type = return_type_;
+  frame_base_ = scopes_.size();
+  return_type_ = function.get_declaration_specifier()
+                     ->get_type_specifier()
+                     ->get_specifier();
+  push_scope();
+  for (size_t i = 0; i < arguments.size(); ++i) {
+    auto& parameter_name =
+        parameter_list[i]->get_declarator()->get_identifier()->get_name();
+    auto& variable = declare(parameter_name, arguments[i].specifier);
+    variable.is_array = arguments[i].is_array;
+    variable.value = arguments[i].value;
+    variable.elements = arguments[i].elements;
+  }
+  function.get_compound_statement()->accept(*this);
+  if (flow_ == Flow::RETURN) {
+    flow_ = Flow::NORMAL;
+  } else if (return_type_ != type::Specifier::VOID) {
+    error("'" + name + "' finished without returning a value");
+  } else {
+    result_ = Value();
+    result_.specifier = type::Specifier::VOID;
+  }
+  pop_scope();
+  frame_base_ = saved_frame_base;
+  return_type_ = saved_return_type;
+  --depth_;
+}
+
+void Interpreter::tick() {
+  ++total_steps_;
+  if (++steps_ > step_limit_) {
+    error("step limit of " + std::to_string(step_limit_) + " exceeded");
+  }
+}
+
+void Interpreter::allocate(long long bytes) {
+  memory_ += bytes;
+  if (memory_ > memory_limit_) {
+    error("memory limit of " + std::to_string(memory_limit_) +
+          " bytes exceeded");
+  }
+}
+
+void Interpreter::push_scope() {
+  scopes_.push_back(std::map<std::string, Variable>());
+}
+
+void Interpreter::pop_scope() {
+  for (auto& variable : scopes_.back()) {
+    memory_ -= variable.second.bytes;
+  }
+  scopes_.pop_back();
+}
+
+Interpreter::Variable& Interpreter::declare(const std::string& name,
+                                            type::Specifier specifier) {
+  allocate(sizeof(Variable));
+  auto& variable = scopes_.back()[name];
+  variable = Variable{specifier, false, Value(), nullptr, sizeof(Variable)};
+  return variable;
+}
+
+Interpreter::Variable& Interpreter::lookup(const std::string& name) {
+  for (size_t i = scopes_.size(); i > frame_base_; --i) {
+    auto search = scopes_[i - 1].find(name);
+    if (search != scopes_[i - 1].end()) {
+      return search->second;
+    }
+  }
+  error("'" + name + "' is not a compile time constant");
+}
+
+Interpreter::Value& Interpreter::element(ArrayReference& array_reference) {
+  auto* identifier =
+      dynamic_cast<Identifier*>(array_reference.get_target().get());
+  if (identifier == nullptr) {
+    error("invalid array reference");
+  }
+  auto& variable = lookup(identifier->get_name());
+  if (!variable.is_array) {
+    error("'" + identifier->get_name() + "' is not an array");
+  }
+  auto index = eval(*(array_reference.get_index()));
+  if (!is_integral(index.specifier)) {
+    error("array index must be an integer");
+  }
+  if (index.integer < 0 ||
+      index.integer >= static_cast<int64_t>(variable.elements->size())) {
+    error("index " + std::to_string(index.integer) + " is out of bounds of '" +
+          identifier->get_name() + "'");
+  }
+  return (*variable.elements)[index.integer];
+}
+
+bool Interpreter::condition(Expression& expression,
+                            const std::string& statement) {
+  auto value = eval(expression);
+  if (value.specifier != type::Specifier::BOOL) {
+    error(statement + " statement needs boolean condition expression");
+  }
+  return value.integer != 0;
+}
+
+Interpreter::Value Interpreter::convert(const Value& value,
+                                        type::Specifier specifier) {
+  Value converted;
+  converted.specifier = specifier;
+  switch (specifier) {
+    case type::Specifier::BOOL:
+    case type::Specifier::CHAR:
+      if (value.specifier == specifier) {
+        return value;
+      }
+      break;
+    case type::Specifier::DOUBLE:
+      if (value.specifier == type::Specifier::UINT) {
+        converted.real = static_cast<double>(value.integer);
+        return converted;
+      } else if (value.specifier == type::Specifier::INT) {
+        converted.real = static_cast<double>(value.integer);
+        return converted;
+      } else if (is_floating(value.specifier)) {
+        converted.real = value.real;
+        return converted;
+      }
+      break;
+    case type::Specifier::FLOAT:
+      if (is_floating(value.specifier)) {
+        converted.real = static_cast<float>(value.real);
+        return converted;
+      }
+      break;
+    case type::Specifier::SHORT:
+    case type::Specifier::INT:
+    case type::Specifier::UINT:
+      if (is_integral(value.specifier) && bit_width(value.specifier) <= 32) {
+        converted.integer = wrap(value.integer, specifier);
+        return converted;
+      }
+      break;
+    case type::Specifier::LONG:
+    case type::Specifier::ULONG:
+      if (is_integral(value.specifier)) {
+        converted.integer = value.integer;
+        return converted;
+      }
+      break;
+    default:
+      break;
+  }
+  error("type incompatible: cannot convert " +
+        type::to_string(value.specifier) + " to " +
+        type::to_string(specifier));
+}
+
+Interpreter::Value Interpreter::binary(type::BinaryOp op, const Value& lhs,
+                                       const Value& rhs) {
+  Value result;
+  bool truth;
+  if (lhs.specifier == type::Specifier::BOOL &&
+      rhs.specifier == type::Specifier::BOOL) {
+    result.specifier = type::Specifier::BOOL;
+    switch (op) {
+      case type::BinaryOp::EQUAL:
+        result.integer = lhs.integer == rhs.integer;
+        return result;
+      case type::BinaryOp::NOT_EQUAL:
+        result.integer = lhs.integer != rhs.integer;
+        return result;
+      case type::BinaryOp::LOGIC_AND:
+        result.integer = lhs.integer && rhs.integer;
+        return result;
+      case type::BinaryOp::LOGIC_OR:
+        result.integer = lhs.integer || rhs.integer;
+        return result;
+      default:
+        error("type error: boolean " + to_string(op) + " boolean");
+    }
+  }
+
+  if (lhs.specifier == type::Specifier::CHAR &&
+      rhs.specifier == type::Specifier::CHAR) {
+    if (!compare(op, lhs.integer, rhs.integer, &truth)) {
+      error("type error: char " + to_string(op) + " char");
+    }
+    result.specifier = type::Specifier::BOOL;
+    result.integer = truth;
+    return result;
+  }
+
+  if ((is_floating(lhs.specifier) || is_floating(rhs.specifier)) &&
+      (is_floating(lhs.specifier) || is_integral(lhs.specifier)) &&
+      (is_floating(rhs.specifier) || is_integral(rhs.specifier))) {
+    double lhs_val = is_floating(lhs.specifier) ? lhs.real : lhs.integer;
+    double rhs_val = is_floating(rhs.specifier) ? rhs.real : rhs.integer;
+    if (compare(op, lhs_val, rhs_val, &truth)) {
+      result.specifier = type::Specifier::BOOL;
+      result.integer = truth;
+      return result;
+    }
+    result.specifier = type::Specifier::DOUBLE;
+    switch (op) {
+      case type::BinaryOp::ADD:
+        result.real = lhs_val + rhs_val;
+        return result;
+      case type::BinaryOp::SUB:
+        result.real = lhs_val - rhs_val;
+        return result;
+      case type::BinaryOp::MUL:
+        result.real = lhs_val * rhs_val;
+        return result;
+      case type::BinaryOp::DIV:
+        result.real = lhs_val / rhs_val;
+        return result;
+      default:
+        error("floating point arithmetic: unsupported op: " + to_string(op));
+    }
+  }
+
+  if (is_integral(lhs.specifier) && is_integral(rhs.specifier)) {
+    if (op == type::BinaryOp::SHIFT_LEFT ||
+        op == type::BinaryOp::SHIFT_RIGHT) {
+      // the result has the type of the promoted lhs
+      result.specifier = common_integral(lhs.specifier, lhs.specifier);
+      if (result.specifier == type::Specifier::SHORT) {
+        result.specifier = type::Specifier::INT;
+      }
+      int width = bit_width(result.specifier);
+      if (rhs.integer < 0 || rhs.integer >= width) {
+        error("shift amount " + std::to_string(rhs.integer) +
+              " is out of range for " + type::to_string(result.specifier));
+      }
+      auto bits = static_cast<uint64_t>(lhs.integer);
+      if (op == type::BinaryOp::SHIFT_LEFT) {
+        result.integer = static_cast<int64_t>(bits << rhs.integer);
+      } else if (type::is_unsigned(result.specifier)) {
+        result.integer = static_cast<int64_t>(bits >> rhs.integer);
+      } else {
+        result.integer = lhs.integer >> rhs.integer;
+      }
+      result.integer = wrap(result.integer, result.specifier);
+      return result;
+    }
+    result.specifier = common_integral(lhs.specifier, rhs.specifier);
+    bool is_unsigned = type::is_unsigned(result.specifier);
+    auto lhs_val = wrap(lhs.integer, result.specifier);
+    auto rhs_val = wrap(rhs.integer, result.specifier);
+    // unsigned arithmetic wraps without undefined behaviour in the host
+    auto lhs_bits = static_cast<uint64_t>(lhs_val);
+    auto rhs_bits = static_cast<uint64_t>(rhs_val);
+    if (is_unsigned ? compare(op, lhs_bits, rhs_bits, &truth)
+                    : compare(op, lhs_val, rhs_val, &truth)) {
+      result.specifier = type::Specifier::BOOL;
+      result.integer = truth;
+      return result;
+    }
+    switch (op) {
+      case type::BinaryOp::ADD:
+        result.integer = static_cast<int64_t>(lhs_bits + rhs_bits);
+        break;
+      case type::BinaryOp::SUB:
+        result.integer = static_cast<int64_t>(lhs_bits - rhs_bits);
+        break;
+      case type::BinaryOp::MUL:
+        result.integer = static_cast<int64_t>(lhs_bits * rhs_bits);
+        break;
+      case type::BinaryOp::DIV:
+      case type::BinaryOp::MOD:
+        if (rhs_val == 0) {
+          error("division by zero");
+        }
+        if (is_unsigned) {
+          result.integer = static_cast<int64_t>(
+              op == type::BinaryOp::DIV ? lhs_bits / rhs_bits
+                                        : lhs_bits % rhs_bits);
+          break;
+        }
+        if (lhs_val == min_value(result.specifier) && rhs_val == -1) {
+          error("signed division overflow");
+        }
+        result.integer = op == type::BinaryOp::DIV ? lhs_val / rhs_val
+                                                   : lhs_val % rhs_val;
+        break;
+      case type::BinaryOp::BIT_AND:
+        result.integer = lhs_val & rhs_val;
+        break;
+      case type::BinaryOp::BIT_XOR:
+        result.integer = lhs_val ^ rhs_val;
+        break;
+      case type::BinaryOp::BIT_OR:
+        result.integer = lhs_val | rhs_val;
+        break;
+      default:
+        error("integer point arithmetic: unsupported op: " + to_string(op));
+    }
+    result.integer = wrap(result.integer, result.specifier);
+    return result;
+  }
+
+  error("binary operation: type incompatible");
+}
+
+Interpreter::Value Interpreter::unary(type::UnaryOp op, const Value& operand) {
+  Value result = operand;
+  if (operand.specifier == type::Specifier::BOOL &&
+      op == type::UnaryOp::LOGIC_NOT) {
+    result.integer = !operand.integer;
+    return result;
+  } else if (is_floating(operand.specifier) &&
+             (op == type::UnaryOp::POSITIVIZE ||
+              op == type::UnaryOp::NEGATE)) {
+    if (op == type::UnaryOp::NEGATE) {
+      result.real = -operand.real;
+    }
+    return result;
+  } else if (is_integral(operand.specifier) &&
+             op != type::UnaryOp::LOGIC_NOT) {
+    if (op == type::UnaryOp::NEGATE) {
+      result.integer = wrap(
+          static_cast<int64_t>(0 - static_cast<uint64_t>(operand.integer)),
+          operand.specifier);
+    } else if (op == type::UnaryOp::BIT_NOT) {
+      result.integer = wrap(~operand.integer, operand.specifier);
+    }
+    return result;
+  }
+  error("unary operation: unsupported op: " + to_string(op) + " for " +
+        type::to_string(operand.specifier));
+}
+
+Interpreter::Value Interpreter::math(const std::string& name,
+                                     FunctionCall& function_call) {
+  auto& argument_list = function_call.get_argument_list();
+  size_t count = name == "fma" ? 3
+                               : name == "pow" || name == "min" || name == "max"
+                                     ? 2
+                                     : 1;
+  if (argument_list.size() != count) {
+    error(name + ": expects " + std::to_string(count) +
+          (count == 1 ? " argument" : " arguments"));
+  }
+  std::vector<Value> args;
+  bool is_integer = true;
+  bool is_float = true;
+  auto widest = type::Specifier::SHORT;
+  for (auto& argument : argument_list) {
+    auto value = eval(*argument);
+    if (is_floating(value.specifier)) {
+      is_integer = false;
+      is_float = is_float && value.specifier == type::Specifier::FLOAT;
+    } else if (is_integral(value.specifier)) {
+      is_float = false;
+      if (value.specifier == type::Specifier::LONG ||
+          widest == type::Specifier::SHORT) {
+        widest = value.specifier;
+      }
+    } else {
+      error(name + ": needs numeric arguments");
+    }
+    args.push_back(value);
+  }
+  Value result;
+  if (is_integer && (name == "min" || name == "max" || name == "abs")) {
+    result.specifier = widest;
+    if (name == "abs") {
+      // negation wraps like the generated code
+      result.integer = wrap(
+          static_cast<int64_t>(args[0].integer < 0
+                                   ? 0 - static_cast<uint64_t>(args[0].integer)
+                                   : args[0].integer),
+          widest);
+    } else {
+      result.integer = name == "min"
+                           ? std::min(args[0].integer, args[1].integer)
+                           : std::max(args[0].integer, args[1].integer);
+    }
+    return result;
+  }
+  double x[3] = {0, 0, 0};
+  for (size_t i = 0; i < args.size(); ++i) {
+    x[i] = is_floating(args[i].specifier) ? args[i].real : args[i].integer;
+  }
+  if (is_float) {
+    result.specifier = type::Specifier::FLOAT;
+    result.real = math_function<float>(name, x[0], x[1], x[2]);
+  } else {
+    result.specifier = type::Specifier::DOUBLE;
+    result.real = math_function<double>(name, x[0], x[1], x[2]);
+  }
+  return result;
+}
+
+Interpreter::Value Interpreter::hint(const std::string& name,
+                                     FunctionCall& function_call) {
+  auto& argument_list = function_call.get_argument_list();
+  Value result;
+  if (name == "prefetch") {
+    if (argument_list.empty() || argument_list.size() > 3) {
+      error("prefetch: expects an array element, rw and locality");
+    }
+    result.specifier = type::Specifier::VOID;
+    return result;
+  }
+  if (argument_list.size() != 1) {
+    error(name + ": expects 1 argument");
+  }
+  result = eval(*argument_list[0]);
+  if (result.specifier != type::Specifier::BOOL) {
+    error(name + ": needs a boolean");
+  }
+  return result;
+}
+
+Interpreter::Value Interpreter::bits(const std::string& name,
+                                     FunctionCall& function_call) {
+  auto& argument_list = function_call.get_argument_list();
+  size_t count = name == "rotl" || name == "rotr" ? 2 : 1;
+  if (argument_list.size() != count) {
+    error(name + ": expects " + std::to_string(count) +
+          (count == 1 ? " argument" : " arguments"));
+  }
+  auto value = eval(*argument_list[0]);
+  if (!is_integral(value.specifier)) {
+    error(name + ": needs an integer");
+  }
+  // the amount is brought to the width of the value, unsigned
+  uint64_t amount = 0;
+  if (count == 2) {
+    auto amount_value = eval(*argument_list[1]);
+    if (!is_integral(amount_value.specifier)) {
+      error(name + ": the amount must be an integer");
+    }
+    amount = static_cast<uint64_t>(amount_value.integer);
+    if (bit_width(amount_value.specifier) < 64) {
+      amount &= (uint64_t{1} << bit_width(amount_value.specifier)) - 1;
+    }
+  }
+  auto x = static_cast<uint64_t>(value.integer);
+  Value result;
+  result.specifier = value.specifier;
+  switch (bit_width(value.specifier)) {
+    case 16:
+      x = bit_function<uint16_t>(name, x, amount);
+      break;
+    case 32:
+      x = bit_function<uint32_t>(name, x, amount);
+      break;
+    default:
+      x = bit_function<uint64_t>(name, x, amount);
+      break;
+  }
+  result.integer = wrap(static_cast<int64_t>(x), value.specifier);
+  return result;
+}
+
+void Interpreter::error(const std::string& msg) { throw EvaluationError(msg); }
+}  // namespace ntc
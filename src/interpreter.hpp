@@ -0,0 +1,159 @@
+// Tree walking interpreter used for compile time evaluation of calls to pure
+// functions, values follow the semantics of the generated code
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "purity.hpp"
+#include "walker.hpp"
+namespace ntc {
+class EvaluationError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+class Interpreter final : public ASTWalker {
+ public:
+  Interpreter(TranslationUnit& translation_unit, long long step_limit,
+              long long memory_limit);
+
+  bool is_pure(const std::string& name) const;
+
+  // evaluates expression in an empty environment and returns the result as
+  // a literal, throws EvaluationError if that is not possible
+  std::unique_ptr<Expression> evaluate(Expression& expression);
+
+  long long get_steps() const { return total_steps_; }
+
+  using ASTWalker::visit;
+
+  virtual void visit(Declaration& declaration) override;
+
+  virtual void visit(CompoundStatement& compound_statement) override;
+
+  virtual void visit(ExpressionStatement& expression_statement) override;
+
+  virtual void visit(ReturnStatement& return_statement) override;
+
+  virtual void visit(BreakStatement& break_statement) override;
+
+  virtual void visit(ContinueStatement& continue_statement) override;
+
+  virtual void visit(BecomeStatement& become_statement) override;
+
+  virtual void visit(SyncStatement& sync_statement) override;
+
+  virtual void visit(IfStatement& if_statement) override;
+
+  virtual void visit(SwitchStatement& switch_statement) override;
+
+  virtual void visit(WhileStatement& while_statement) override;
+
+  virtual void visit(ForStatement& for_statement) override;
+
+  virtual void visit(ParallelForStatement& parallel_for_statement) override;
+
+  virtual void visit(Identifier& identifier) override;
+
+  virtual void visit(IntegerExpression& integer_expression) override;
+
+  virtual void visit(FloatExpression& float_expression) override;
+
+  virtual void visit(BooleanExpression& boolean_expression) override;
+
+  virtual void visit(CharacterExpression& character_expression) override;
+
+  virtual void visit(
+      StringLiteralExpression& string_literal_expression) override;
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override;
+
+  virtual void visit(
+      UnaryOperationExpression& unary_operation_expression) override;
+
+  virtual void visit(ConditionalExpression& conditional_expression) override;
+
+  virtual void visit(FunctionCall& function_call) override;
+
+  virtual void visit(SpawnExpression& spawn_expression) override;
+
+  virtual void visit(ArrayReference& array_reference) override;
+
+ private:
+  // bool, char and the integer types live in integer, float and double in
+  // real, an UNDEFINED specifier marks an uninitialized value
+  struct Value {
+    type::Specifier specifier = type::Specifier::UNDEFINED;
+    int64_t integer = 0;
+    double real = 0;
+  };
+
+  struct Variable {
+    type::Specifier specifier;
+    bool is_array;
+    Value value;
+    std::shared_ptr<std::vector<Value>> elements;
+    // memory charged to the budget, arrays passed as arguments are shared
+    long long bytes;
+  };
+
+  enum class Flow { NORMAL, RETURN, BREAK, CONTINUE };
+
+  Value eval(Expression& expression);
+
+  void call(FunctionDefinition& function, FunctionCall& function_call);
+
+  void tick();
+
+  void allocate(long long bytes);
+
+  void push_scope();
+
+  void pop_scope();
+
+  Variable& declare(const std::string& name, type::Specifier specifier);
+
+  Variable& lookup(const std::string& name);
+
+  Value& element(ArrayReference& array_reference);
+
+  bool condition(Expression& expression, const std::string& statement);
+
+  Value convert(const Value& value, type::Specifier specifier);
+
+  Value binary(type::BinaryOp op, const Value& lhs, const Value& rhs);
+
+  Value unary(type::UnaryOp op, const Value& operand);
+
+  // the math builtins, with the operand types the code generator gives them
+  Value math(const std::string& name, FunctionCall& function_call);
+
+  // likely and unlikely give their argument, prefetch does nothing
+  Value hint(const std::string& name, FunctionCall& function_call);
+
+  // the bit builtins on the unsigned bits of their operand
+  Value bits(const std::string& name, FunctionCall& function_call);
+
+  [[noreturn]] void error(const std::string& msg);
+
+  PurityAnalysis purity_;
+  std::map<std::string, FunctionDefinition*> functions_;
+  std::deque<std::map<std::string, Variable>> scopes_;
+  // first scope visible from the function being executed
+  size_t frame_base_;
+  type::Specifier return_type_;
+  Value result_;
+  Flow flow_;
+  int depth_;
+  long long steps_;
+  long long total_steps_;
+  long long memory_;
+  long long step_limit_;
+  long long memory_limit_;
+};
+}  // namespace ntc
@@ -0,0 +1,108 @@
+#include "jit.hpp"
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <unistd.h>
+#include <iostream>
+#include <stdexcept>
+namespace ntc {
+namespace {
+template <typename T>
+bool get_value(llvm::Expected<T> expected, T& value) {
+  if (!expected) {
+    llvm::consumeError(expected.takeError());
+    return false;
+  }
+  value = *expected;
+  return true;
+}
+}  // namespace
+
+PerfMapListener::PerfMapListener() {
+  auto filename = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+  std::error_code ec;
+  map_ = std::make_unique<llvm::raw_fd_ostream>(filename, ec,
+                                                llvm::sys::fs::F_Append);
+  if (ec) {
+    std::cerr << "ntc: cannot write " << filename << ": " << ec.message()
+              << std::endl;
+    map_.reset();
+  }
+}
+
+void PerfMapListener::notifyObjectLoaded(
+    ObjectKey key, const llvm::object::ObjectFile& object,
+    const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+  if (map_ == nullptr) {
+    return;
+  }
+  // the copy for debuggers has its sections at their load addresses
+  auto loaded = info.getObjectForDebug(object);
+  if (loaded.getBinary() == nullptr) {
+    return;
+  }
+  for (auto& symbol_size :
+       llvm::object::computeSymbolSizes(*loaded.getBinary())) {
+    auto& symbol = symbol_size.first;
+    llvm::object::SymbolRef::Type type;
+    llvm::StringRef name;
+    uint64_t address;
+    if (!get_value(symbol.getType(), type) ||
+        type != llvm::object::SymbolRef::ST_Function ||
+        !get_value(symbol.getName(), name) ||
+        !get_value(symbol.getAddress(), address) || symbol_size.second == 0) {
+      continue;
+    }
+    *map_ << llvm::format("%llx %llx ", (unsigned long long)address,
+                          (unsigned long long)symbol_size.second)
+          << name << "\n";
+  }
+  // perf reads the map after the process is gone, possibly killed
+  map_->flush();
+}
+
+int run_module(std::unique_ptr<llvm::Module> module,
+               std::unique_ptr<llvm::TargetMachine> target_machine,
+               const ProgramConfig& config) {
+  auto* main_function = module->getFunction("main");
+  if (main_function == nullptr || main_function->isDeclaration()) {
+    throw std::logic_error("JIT: no main function to run");
+  }
+  // the runtime is linked into ntc and exported, a null library stands for
+  // the process itself
+  llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+  std::string error;
+  llvm::EngineBuilder builder(std::move(module));
+  builder.setEngineKind(llvm::EngineKind::JIT)
+      .setErrorStr(&error)
+      .setMCJITMemoryManager(std::make_unique<llvm::SectionMemoryManager>());
+  auto* engine = builder.create(target_machine.release());
+  if (engine == nullptr) {
+    throw std::logic_error("JIT: " + error);
+  }
+  engine->RegisterJITEventListener(
+      llvm::JITEventListener::createGDBRegistrationListener());
+  if (config.perf_map) {
+    engine->RegisterJITEventListener(new PerfMapListener());
+  }
+  if (config.jitdump) {
+    auto* listener = llvm::JITEventListener::createPerfJITEventListener();
+    if (listener == nullptr) {
+      std::cerr << "ntc: LLVM is built without perf support, no jitdump"
+                << std::endl;
+    } else {
+      engine->RegisterJITEventListener(listener);
+    }
+  }
+  engine->finalizeObject();
+  engine->runStaticConstructorsDestructors(false);
+  int status = engine->runFunctionAsMain(main_function,
+                                         {config.input_filename}, nullptr);
+  engine->runStaticConstructorsDestructors(true);
+  return status;
+}
+}  // namespace ntc
@@ -0,0 +1,33 @@
+// --run: the optimized module is compiled by MCJIT into ntc's own process,
+// whose exported copy of the ntrt runtime resolves the runtime calls. The
+// JIT registers its objects with gdb, and with perf through a perf map or
+// jitdump files, so that both see JIT compiled functions like native ones
+#pragma once
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <memory>
+#include "config.hpp"
+namespace ntc {
+// appends "start size name" lines of the functions of every object loaded
+// to /tmp/perf-<pid>.map, where perf looks up addresses of anonymous memory
+class PerfMapListener final : public llvm::JITEventListener {
+ public:
+  PerfMapListener();
+
+  virtual void notifyObjectLoaded(
+      ObjectKey key, const llvm::object::ObjectFile& object,
+      const llvm::RuntimeDyld::LoadedObjectInfo& info) override;
+
+ private:
+  std::unique_ptr<llvm::raw_fd_ostream> map_;
+};
+
+// runs the static constructors and main, returns the exit status of main.
+// The engine is never freed: the runtime reports from records in JIT memory
+// at exit, so the caller has to exit rather than return
+int run_module(std::unique_ptr<llvm::Module> module,
+               std::unique_ptr<llvm::TargetMachine> target_machine,
+               const ProgramConfig& config);
+}  // namespace ntc
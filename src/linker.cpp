@@ -0,0 +1,86 @@
+#include "linker.hpp"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#ifdef NTC_HAVE_LLD
+#include <lld/Common/Driver.h>
+#endif
+namespace ntc {
+namespace {
+std::string join_path(const char* directory, const char* filename) {
+  llvm::SmallString<128> path(directory);
+  llvm::sys::path::append(path, filename);
+  return path.str().str();
+}
+}  // namespace
+
+long long link_executable(const std::string& object_filename,
+                          const std::string& output_filename,
+                          const ProgramConfig& config) {
+#ifndef NTC_HAVE_LLD
+  throw std::logic_error(
+      "Linker: ntc is built without lld, emit an object with -c and link "
+      "it with cc");
+#else
+  // NTRT_LIBRARY points at another build of the runtime
+  const char* runtime = std::getenv("NTRT_LIBRARY");
+  if (runtime == nullptr || runtime[0] == '\0') {
+    runtime = NTRT_LIBRARY;
+  }
+  std::vector<std::string> args = {"ld.lld", "-o", output_filename,
+                                   "--eh-frame-hdr"};
+  // crtbeginT.o runs the constructors without a dynamic loader, the S
+  // variants are position independent
+  const char* crtbegin = "crtbegin.o";
+  const char* crtend = "crtend.o";
+  if (config.shared_library) {
+    args.insert(args.end(), {"-shared", "--exclude-libs", "ALL"});
+    crtbegin = "crtbeginS.o";
+    crtend = "crtendS.o";
+  } else if (config.static_link) {
+    args.push_back("-static");
+    crtbegin = "crtbeginT.o";
+  } else {
+    args.push_back("-dynamic-linker");
+    args.push_back(NTC_DYNAMIC_LINKER);
+  }
+  if (!config.shared_library) {
+    args.push_back(join_path(NTC_CRT_DIR, "crt1.o"));
+  }
+  args.push_back(join_path(NTC_CRT_DIR, "crti.o"));
+  args.push_back(join_path(NTC_GCC_LIB_DIR, crtbegin));
+  args.push_back(object_filename);
+  args.push_back(runtime);
+  args.push_back(std::string("-L") + NTC_GCC_LIB_DIR);
+  args.push_back(std::string("-L") + NTC_CRT_DIR);
+  args.push_back("-lpthread");
+  args.push_back("-lm");
+  if (config.static_link) {
+    args.insert(args.end(),
+                {"--start-group", "-lgcc", "-lgcc_eh", "-lc", "--end-group"});
+  } else {
+    args.insert(args.end(), {"-lc", "-lgcc", "--as-needed", "-lgcc_s",
+                             "--no-as-needed"});
+  }
+  args.push_back(join_path(NTC_GCC_LIB_DIR, crtend));
+  args.push_back(join_path(NTC_CRT_DIR, "crtn.o"));
+
+  std::vector<const char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.c_str());
+  }
+  auto start = std::chrono::steady_clock::now();
+  // lld reports its errors itself
+  if (!lld::elf::link(argv, false, llvm::errs())) {
+    throw std::logic_error("Linker: cannot link '" + output_filename + "'");
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+#endif
+}
+}  // namespace ntc
@@ -0,0 +1,15 @@
+// -o without -l, -s, -c or --emit-bitcode: the object of the program is
+// linked in process by lld with the static ntrt runtime and the C library
+// into an executable, -static leaves the C library out of the dynamic
+// dependencies and -shared makes a shared library, which keeps its copy of
+// the runtime to itself. The start files and library directories of the C
+// compiler ntc was built with are recorded by cmake
+#pragma once
+#include <string>
+#include "config.hpp"
+namespace ntc {
+// returns the microseconds lld took
+long long link_executable(const std::string& object_filename,
+                          const std::string& output_filename,
+                          const ProgramConfig& config);
+}  // namespace ntc
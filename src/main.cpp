@@ -1,9 +1,18 @@
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+#include <fstream>
 #include <iostream>
 #include "codegen.hpp"
 #include "context.hpp"
 #include "driver.hpp"
+#include "folder.hpp"
+#include "header.hpp"
+#include "interpreter.hpp"
 #include "printer.hpp"
+#include "recursion.hpp"
 #include "config.hpp"
+#include "dependence.hpp"
+#include "switch.hpp"
 using namespace ntc;
 
 void error_exit() {
@@ -11,26 +20,176 @@ void error_exit() {
   exit(1);
 }
 
-int main(int argc, char* argv[]) {
-  ProgramConfig config = parse_program_options(argc, argv);
+namespace {
+bool is_bitcode(const std::string& filename) {
+  return filename.size() > 3 &&
+         filename.compare(filename.size() - 3, 3, ".bc") == 0;
+}
+
+// the AST passes and code generation of one source file
+void generate(TranslationUnit& program, const ProgramConfig& config,
+              CodeGenerator& generator, Statistics& statistics) {
+  if (config.opt_level > 0) {
+    RecurrenceRewriter rewriter;
+    program.accept(rewriter);
+    statistics.add("recursion", "linear recurrences rewritten",
+                   rewriter.get_rewritten());
+  }
+  Interpreter interpreter(program, config.ctfe_steps,
+                          config.ctfe_memory * (1ll << 20));
+  ConstantFolder folder(&interpreter, config.opt_level > 0);
+  program.accept(folder);
+  statistics.add("folder", "AST nodes removed", folder.get_removed_nodes());
+  statistics.add("interpreter", "calls evaluated at compile time",
+                 folder.get_evaluated_calls());
+  statistics.add("interpreter", "evaluation steps", interpreter.get_steps());
+  if (config.if_to_switch) {
+    SwitchConverter converter;
+    program.accept(converter);
+    statistics.add("switch", "if chains turned into switch",
+                   converter.get_converted());
+  }
+  if (config.auto_parallel) {
+    AutoParallelizer parallelizer(config.parallel_threshold);
+    program.accept(parallelizer);
+    statistics.add("parallel", "loops parallelized automatically",
+                   parallelizer.get_parallelized());
+    if (config.parallel_report) {
+      for (auto& line : parallelizer.get_report()) {
+        std::cerr << config.input_filename << ": " << line << std::endl;
+      }
+    }
+  }
+  program.accept(generator);
+  statistics.add("memo", "functions memoized",
+                 generator.get_memoized_functions());
+  statistics.add("recursion", "tail calls turned into loops",
+                 generator.get_tail_calls());
+  statistics.add("parallel", "loops outlined", generator.get_parallel_loops());
+  statistics.add("linkage", "unreferenced functions removed",
+                 generator.get_removed_functions());
+  statistics.add("profile", "functions instrumented or weighted",
+                 generator.get_profiled_functions());
+  for (auto& function : generator.get_stale_profiles()) {
+    std::cerr << config.input_filename << ": profile of '" << function
+              << "' does not match its code, ignored" << std::endl;
+  }
+}
+
+// a further input of the link, bitcode is read as it is
+std::unique_ptr<llvm::Module> load_module(const ProgramConfig& config,
+                                          Statistics& statistics) {
+  if (is_bitcode(config.input_filename)) {
+    llvm::SMDiagnostic error;
+    auto module = llvm::parseIRFile(config.input_filename, error, llvm_context);
+    if (module == nullptr) {
+      throw std::logic_error("Linker: cannot read '" + config.input_filename +
+                             "': " + error.getMessage().str());
+    }
+    return module;
+  }
   ProgramContext context;
   Driver driver(context);
-  bool res = driver.parse_file(config.input_filename);
-  if (res == false) {
+  if (!driver.parse_file(config.input_filename)) {
     error_exit();
   }
+  CodeGenerator generator(config.input_filename, config);
+  generate(*(context.get_program()), config, generator, statistics);
+  return generator.release_module();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ProgramConfig config = parse_program_options(argc, argv);
   if (config.mode == ProgramMode::DUMP_AST) {
+    ProgramContext context;
+    Driver driver(context);
+    if (!driver.parse_file(config.input_filename)) {
+      error_exit();
+    }
     Printer printer(std::cout);
     context.get_program()->accept(printer);
-  } else {
-    CodeGenerator generator(config.input_filename);
+    return 0;
+  }
+  if (config.mode == ProgramMode::EMIT_HEADER) {
+    ProgramContext context;
+    Driver driver(context);
+    if (!driver.parse_file(config.input_filename)) {
+      error_exit();
+    }
+    std::ofstream header(config.output_filename);
+    if (!header) {
+      std::cerr << "cannot write \'" << config.output_filename << "\'"
+                << std::endl;
+      error_exit();
+    }
     try {
-      context.get_program()->accept(generator);
+      HeaderWriter writer(header, config.output_filename);
+      writer.write(*(context.get_program()));
     } catch (std::logic_error& e) {
       std::cerr << e.what() << std::endl;
       error_exit();
     }
+    return 0;
+  }
+  // a linked program is internalized as a whole after the link
+  ProgramConfig file_config = config;
+  if (!config.link_inputs.empty()) {
+    file_config.whole_program = false;
+  }
+  Statistics statistics;
+  try {
+    // before the first file, whose code generator keeps the remark handler
+    std::vector<std::unique_ptr<llvm::Module>> modules;
+    for (auto& filename : config.link_inputs) {
+      ProgramConfig link_config = file_config;
+      link_config.input_filename = filename;
+      modules.push_back(load_module(link_config, statistics));
+    }
+    CodeGenerator generator(config.input_filename, file_config);
+    if (is_bitcode(config.input_filename)) {
+      generator.link(load_module(file_config, statistics));
+    } else {
+      ProgramContext context;
+      Driver driver(context);
+      if (!driver.parse_file(config.input_filename)) {
+        error_exit();
+      }
+      generate(*(context.get_program()), file_config, generator, statistics);
+    }
+    for (auto& module : modules) {
+      generator.link(std::move(module));
+    }
+    if (!config.link_inputs.empty()) {
+      statistics.add("linkage", "modules linked", modules.size() + 1);
+      if (config.whole_program) {
+        statistics.add("linkage", "unreferenced functions removed",
+                       generator.internalize());
+      }
+    }
+    statistics.add("linkage", "functions called with fastcc",
+                   generator.get_fast_functions());
     generator.output(config.output_filename, config.mode);
+    if (config.mode == ProgramMode::EMIT_EXECUTABLE) {
+      statistics.add("link", "microseconds linking in process",
+                     generator.get_link_microseconds());
+    }
+    if (config.remarks_summary) {
+      generator.get_remarks()->print_summary(std::cerr);
+    }
+    if (config.mode == ProgramMode::RUN) {
+      if (config.show_stats) {
+        statistics.print(std::cerr);
+      }
+      // not returning keeps the JIT memory alive for the runtime at exit
+      exit(generator.run());
+    }
+  } catch (std::logic_error& e) {
+    std::cerr << e.what() << std::endl;
+    error_exit();
+  }
+  if (config.show_stats) {
+    statistics.print(std::cerr);
   }
   return 0;
-}
\ No newline at end of file
+}
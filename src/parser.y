@@ -23,6 +23,7 @@ namespace ntc{
   class ExternalDeclaration;
   class TranslationUnit;
   class FunctionDefinition;
+  class FunctionDeclaration;
   class DeclarationSpecifier;
   class Identifier;
   class ParameterDeclaration;
@@ -39,11 +40,14 @@ namespace ntc{
   class ReturnStatement;
   class BreakStatement;
   class ContinueStatement;
+  class BecomeStatement;
   class SelectionStatement;
   class IfStatement;
+  class SwitchStatement;
   class IterationStatement;
   class WhileStatement;
   class ForStatement;
+  class ParallelForStatement;
 
   // Expression
   class Expression;
@@ -57,6 +61,7 @@ namespace ntc{
   class UnaryOperationExpression;
   class ConditionalExpression;
   class FunctionCall;
+  class SpawnExpression;
   class ArrayReference;
 
   template <typename T> class ASTList;
@@ -85,6 +90,19 @@ namespace ntc{
 #undef yylex
 #define yylex scanner.yylex
 using namespace ntc;
+
+namespace {
+// source range of node for debug info
+template <typename T>
+void locate(T& node, const ntc::location& loc) {
+  SourceRange range;
+  range.begin_line = loc.begin.line;
+  range.begin_column = loc.begin.column;
+  range.end_line = loc.end.line;
+  range.end_column = loc.end.column;
+  node->set_range(range);
+}
+}
 }
 
 %define parse.error verbose
@@ -92,12 +110,15 @@ using namespace ntc;
 %define parse.assert
 
 %token IDENTIFIER
-%token INT FLOAT DOUBLE SHORT LONG CHAR VOID BOOL STRING
-%token CONST
+%token INT FLOAT DOUBLE SHORT LONG CHAR VOID BOOL STRING UNSIGNED
+%token INT4 INT8 LONG2 LONG4 FLOAT4 FLOAT8 DOUBLE2 DOUBLE4
+%token CONST CONSTEXPR RESTRICT MEMO HOT COLD STATIC INLINE EXPORT EXTERN
+%token ATOMIC
 %token INTEGER REAL BOOLEAN CHARACTER STRING_LITERAL
 %token END 0 "end of file"
-%token RETURN IF ELSE WHILE FOR BREAK CONTINUE
-%token AND_OP OR_OP LE_OP GE_OP NE_OP EQ_OP
+%token RETURN IF ELSE SWITCH CASE DEFAULT WHILE FOR BREAK CONTINUE BECOME
+%token PARALLEL SCHEDULE REDUCE SPAWN SYNC TRACE_SPAN
+%token AND_OP OR_OP LE_OP GE_OP NE_OP EQ_OP LEFT_OP RIGHT_OP
 
 %type <int> INTEGER
 %type <double> REAL
@@ -119,9 +140,17 @@ using namespace ntc;
 %type <std::unique_ptr<CompoundStatement>> compound_statement
 %type <std::unique_ptr<JumpStatement>> jump_statement
 %type <std::unique_ptr<SelectionStatement>> selection_statement
+%type <std::unique_ptr<SwitchStatement>> switch_body switch_clause_list
+%type <ntc::SwitchStatement::Clause> case_label_list
 %type <std::unique_ptr<IterationStatement>> iteration_statement
+%type <std::unique_ptr<ParallelForStatement>> parallel_clauses
+%type <ntc::type::Schedule> schedule_kind
+%type <ntc::type::BinaryOp> reduction_operator
+%type <std::vector<std::string>> identifier_list
 %type <std::unique_ptr<Statement>> statement
 %type <std::unique_ptr<FunctionDefinition>> function_definition
+%type <std::unique_ptr<FunctionDeclaration>> function_declaration
+%type <ntc::type::FunctionQualifier> function_qualifier
 %type <std::unique_ptr<ExternalDeclaration>> external_declaration
 %type <std::unique_ptr<TranslationUnit>> translation_unit
 %locations
@@ -171,6 +200,50 @@ type_specifier
       {
         $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::STRING);
       }
+      | UNSIGNED
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::UINT);
+      }
+      | UNSIGNED INT
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::UINT);
+      }
+      | UNSIGNED LONG
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::ULONG);
+      }
+      | INT4
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::INT4);
+      }
+      | INT8
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::INT8);
+      }
+      | LONG2
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::LONG2);
+      }
+      | LONG4
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::LONG4);
+      }
+      | FLOAT4
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::FLOAT4);
+      }
+      | FLOAT8
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::FLOAT8);
+      }
+      | DOUBLE2
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::DOUBLE2);
+      }
+      | DOUBLE4
+      {
+        $$ = make_ast<TypeSpecifier>(ntc::type::Specifier::DOUBLE4);
+      }
       ;
 
 declaration_specifiers
@@ -183,12 +256,24 @@ declaration_specifiers
         $$ = make_ast<DeclarationSpecifier>(std::move($2));
         $$->set_const(true);
       }
+      | CONSTEXPR type_specifier
+      {
+        $$ = make_ast<DeclarationSpecifier>(std::move($2));
+        $$->set_const(true);
+        $$->set_constexpr(true);
+      }
+      | ATOMIC type_specifier
+      {
+        $$ = make_ast<DeclarationSpecifier>(std::move($2));
+        $$->set_atomic(true);
+      }
       ;
 
 parameter_declaration
       : declaration_specifiers declarator
       {
         $$ = make_ast<ParameterDeclaration>(std::move($1), std::move($2));
+        locate($$, @$);
       }
       ;
 
@@ -271,10 +356,12 @@ postfix_expression
       | postfix_expression '(' ')'
       {
         $$ = make_ast<FunctionCall>(std::move($1), nullptr);
+        locate($$, @$);
       }
       | postfix_expression '(' argument_expression_list ')'
       {
         $$ = make_ast<FunctionCall>(std::move($1), std::move($3));
+        locate($$, @$);
       }
       | postfix_expression '[' assignment_expression ']'
       {
@@ -299,6 +386,19 @@ unary_expression
       {
         $$ = make_ast<UnaryOperationExpression>(ntc::type::UnaryOp::LOGIC_NOT, std::move($2));
       }
+      | '~' cast_expression
+      {
+        $$ = make_ast<UnaryOperationExpression>(ntc::type::UnaryOp::BIT_NOT, std::move($2));
+      }
+      | SPAWN postfix_expression
+      {
+        auto* function_call = dynamic_cast<FunctionCall*>($2.get());
+        if (function_call == nullptr) {
+          error(@2, "spawn needs a function call");
+        }
+        $2.release();
+        $$ = make_ast<SpawnExpression>(std::unique_ptr<FunctionCall>(function_call));
+      }
       ;
 
 cast_expression
@@ -348,7 +448,14 @@ shift_expression
       : additive_expression
       {
         $$ = std::move($1);
-        // TODO: no support for bitshift now
+      }
+      | shift_expression LEFT_OP additive_expression
+      {
+        $$ = make_ast<BinaryOperationExpression>(ntc::type::BinaryOp::SHIFT_LEFT, std::move($1), std::move($3));
+      }
+      | shift_expression RIGHT_OP additive_expression
+      {
+        $$ = make_ast<BinaryOperationExpression>(ntc::type::BinaryOp::SHIFT_RIGHT, std::move($1), std::move($3));
       }
       ;
 
@@ -395,6 +502,10 @@ and_expression
       {
         $$ = std::move($1);
       }
+      | and_expression '&' equality_expression
+      {
+        $$ = make_ast<BinaryOperationExpression>(ntc::type::BinaryOp::BIT_AND, std::move($1), std::move($3));
+      }
       ;
 
 exclusive_or_expression
@@ -402,6 +513,10 @@ exclusive_or_expression
       {
         $$ = std::move($1);
       }
+      | exclusive_or_expression '^' and_expression
+      {
+        $$ = make_ast<BinaryOperationExpression>(ntc::type::BinaryOp::BIT_XOR, std::move($1), std::move($3));
+      }
       ;
 
 inclusive_or_expression
@@ -409,6 +524,10 @@ inclusive_or_expression
       {
         $$ = std::move($1);
       }
+      | inclusive_or_expression '|' exclusive_or_expression
+      {
+        $$ = make_ast<BinaryOperationExpression>(ntc::type::BinaryOp::BIT_OR, std::move($1), std::move($3));
+      }
       ;
 
 logical_and_expression
@@ -458,6 +577,7 @@ expression
       : assignment_expression
       {
         $$ = std::move($1);
+        locate($$, @$);
       }
       ;
 
@@ -465,10 +585,12 @@ expression_statement
       : ';'
       {
         $$ = make_ast<ExpressionStatement>(nullptr);
+        locate($$, @$);
       }
       | expression ';'
       {
         $$ = make_ast<ExpressionStatement>(std::move($1));
+        locate($$, @$);
       }
       ;
 
@@ -489,16 +611,27 @@ jump_statement
       {
         $$ = make_ast<ContinueStatement>();
       }
+      | BECOME expression ';'
+      {
+        auto* function_call = dynamic_cast<FunctionCall*>($2.get());
+        if (function_call == nullptr) {
+          error(@2, "become needs a function call");
+        }
+        $2.release();
+        $$ = make_ast<BecomeStatement>(std::unique_ptr<FunctionCall>(function_call));
+      }
       ;
 
 compound_statement
       : '{' '}'
       {
         $$ = make_ast<CompoundStatement>(nullptr);
+        locate($$, @$);
       }
       | '{' block_item_list '}'
       {
         $$ = make_ast<CompoundStatement>(std::move($2)); 
+        locate($$, @$);
       }
       ;
 
@@ -511,6 +644,70 @@ selection_statement
       {
         $$ = make_ast<IfStatement>(std::move($3), std::move($5), std::move($7));
       }
+      | SWITCH '(' expression ')' '{' '}'
+      {
+        auto switch_statement = make_ast<SwitchStatement>();
+        switch_statement->set_expression(std::move($3));
+        $$ = std::move(switch_statement);
+      }
+      | SWITCH '(' expression ')' '{' switch_body '}'
+      {
+        $6->set_expression(std::move($3));
+        $$ = std::move($6);
+      }
+      ;
+
+switch_body
+      : switch_clause_list
+      {
+        $$ = std::move($1);
+      }
+      | switch_clause_list case_label_list
+      {
+        $$ = std::move($1);
+        $$->add_clause(std::move($2));
+      }
+      | case_label_list
+      {
+        $$ = make_ast<SwitchStatement>();
+        $$->add_clause(std::move($1));
+      }
+      ;
+
+switch_clause_list
+      : case_label_list block_item_list
+      {
+        $$ = make_ast<SwitchStatement>();
+        $1.block_items = std::move($2->get_item_list());
+        $$->add_clause(std::move($1));
+      }
+      | switch_clause_list case_label_list block_item_list
+      {
+        $$ = std::move($1);
+        $2.block_items = std::move($3->get_item_list());
+        $$->add_clause(std::move($2));
+      }
+      ;
+
+case_label_list
+      : CASE conditional_expression ':'
+      {
+        $$.values.push_back(std::move($2));
+      }
+      | DEFAULT ':'
+      {
+        $$.is_default = true;
+      }
+      | case_label_list CASE conditional_expression ':'
+      {
+        $$ = std::move($1);
+        $$.values.push_back(std::move($3));
+      }
+      | case_label_list DEFAULT ':'
+      {
+        $$ = std::move($1);
+        $$.is_default = true;
+      }
       ;
 
 iteration_statement
@@ -526,28 +723,117 @@ iteration_statement
       {
         $$ = make_ast<ForStatement>(std::move($3), std::move($4), std::move($7), std::move($5));
       }
+      | parallel_clauses FOR '(' expression_statement expression_statement ')' statement
+      {
+        $1->set_for_statement(make_ast<ForStatement>(std::move($4), std::move($5), std::move($7)));
+        $$ = std::move($1);
+      }
+      | parallel_clauses FOR '(' expression_statement expression_statement expression ')' statement
+      {
+        $1->set_for_statement(make_ast<ForStatement>(std::move($4), std::move($5), std::move($8), std::move($6)));
+        $$ = std::move($1);
+      }
+      ;
+
+parallel_clauses
+      : PARALLEL
+      {
+        $$ = make_ast<ParallelForStatement>();
+      }
+      | parallel_clauses SCHEDULE '(' schedule_kind ')'
+      {
+        $$ = std::move($1);
+        $$->set_schedule($4);
+      }
+      | parallel_clauses SCHEDULE '(' schedule_kind ',' assignment_expression ')'
+      {
+        $$ = std::move($1);
+        $$->set_schedule($4, std::move($6));
+      }
+      | parallel_clauses REDUCE '(' reduction_operator ':' identifier_list ')'
+      {
+        $$ = std::move($1);
+        for (auto& name : $6) {
+          $$->add_reduction($4, name);
+        }
+      }
+      ;
+
+schedule_kind
+      : STATIC
+      {
+        $$ = ntc::type::Schedule::STATIC;
+      }
+      | IDENTIFIER
+      {
+        if ($1 == "dynamic") {
+          $$ = ntc::type::Schedule::DYNAMIC;
+        } else if ($1 == "guided") {
+          $$ = ntc::type::Schedule::GUIDED;
+        } else {
+          error(@1, "unknown schedule '" + $1 + "'");
+        }
+      }
+      ;
+
+reduction_operator
+      : '+'
+      {
+        $$ = ntc::type::BinaryOp::ADD;
+      }
+      | '*'
+      {
+        $$ = ntc::type::BinaryOp::MUL;
+      }
+      ;
+
+identifier_list
+      : IDENTIFIER
+      {
+        $$.push_back($1);
+      }
+      | identifier_list ',' IDENTIFIER
+      {
+        $$ = std::move($1);
+        $$.push_back($3);
+      }
       ;
 
 statement
       : jump_statement
       {
         $$ = std::move($1);
+        locate($$, @$);
       }
       | compound_statement
       {
         $$ = std::move($1);
+        locate($$, @$);
       }
       | expression_statement
       {
         $$ = std::move($1);
+        locate($$, @$);
       }
       | selection_statement
       {
         $$ = std::move($1);
+        locate($$, @$);
       }
       | iteration_statement
       {
         $$ = std::move($1);
+        locate($$, @$);
+      }
+      | SYNC ';'
+      {
+        $$ = make_ast<SyncStatement>();
+        locate($$, @$);
+      }
+      | TRACE_SPAN '(' STRING_LITERAL ')' compound_statement
+      {
+        $$ = make_ast<TraceSpanStatement>($3, std::move($5));
+        locate($$, @$);
       }
       ;
 
@@ -570,18 +856,25 @@ declarator
         auto identifier = make_ast<Identifier>($1);
         $$ = make_ast<Declarator>(std::move(identifier), true, $3);
       }
+      | IDENTIFIER '[' RESTRICT INTEGER ']'
+      {
+        auto identifier = make_ast<Identifier>($1);
+        $$ = make_ast<Declarator>(std::move(identifier), true, $4, true);
+      }
       ;
 
 declaration
       : declaration_specifiers declarator ';'
       {
         $$ = make_ast<Declaration>(std::move($1), std::move($2));
+        locate($$, @$);
       }
       | declaration_specifiers IDENTIFIER '=' initializer ';'
       {
         auto identifier = make_ast<Identifier>($2);
         auto declarator = make_ast<Declarator>(std::move(identifier), false, 0);
         $$ = make_ast<Declaration>(std::move($1), std::move(declarator), std::move($4));
+        locate($$, @$);
       }
       ;
 
@@ -613,16 +906,81 @@ function_definition
       {
         auto identifier = make_ast<Identifier>($2);
         $$ = make_ast<FunctionDefinition>(std::move($1), std::move(identifier), nullptr, std::move($5));
+        locate($$, @$);
       }
       | declaration_specifiers IDENTIFIER '(' parameter_list ')' compound_statement
       {
         auto identifier = make_ast<Identifier>($2);
         $$ = make_ast<FunctionDefinition>(std::move($1), std::move(identifier), std::move($4), std::move($6));
+        locate($$, @$);
       }
       | declaration_specifiers IDENTIFIER '(' VOID ')' compound_statement
       {
         auto identifier = make_ast<Identifier>($2);
         $$ = make_ast<FunctionDefinition>(std::move($1), std::move(identifier), nullptr, std::move($6));
+        locate($$, @$);
+      }
+      | function_qualifier function_definition
+      {
+        $$ = std::move($2);
+        $$->add_qualifier($1);
+      }
+      ;
+
+function_qualifier
+      : MEMO
+      {
+        $$ = ntc::type::FunctionQualifier::MEMO;
+      }
+      | HOT
+      {
+        $$ = ntc::type::FunctionQualifier::HOT;
+      }
+      | COLD
+      {
+        $$ = ntc::type::FunctionQualifier::COLD;
+      }
+      | STATIC
+      {
+        $$ = ntc::type::FunctionQualifier::STATIC;
+      }
+      | INLINE
+      {
+        $$ = ntc::type::FunctionQualifier::INLINE;
+      }
+      | EXPORT
+      {
+        $$ = ntc::type::FunctionQualifier::EXPORT;
+      }
+      ;
+
+function_declaration
+      : declaration_specifiers IDENTIFIER '(' ')' ';'
+      {
+        auto identifier = make_ast<Identifier>($2);
+        $$ = make_ast<FunctionDeclaration>(std::move($1), std::move(identifier), nullptr);
+        locate($$, @$);
+      }
+      | declaration_specifiers IDENTIFIER '(' parameter_list ')' ';'
+      {
+        auto identifier = make_ast<Identifier>($2);
+        $$ = make_ast<FunctionDeclaration>(std::move($1), std::move(identifier), std::move($4));
+        locate($$, @$);
+      }
+      | declaration_specifiers IDENTIFIER '(' VOID ')' ';'
+      {
+        auto identifier = make_ast<Identifier>($2);
+        $$ = make_ast<FunctionDeclaration>(std::move($1), std::move(identifier), nullptr);
+        locate($$, @$);
+      }
+      | EXTERN STRING_LITERAL function_declaration
+      {
+        if ($2 != "C") {
+          error(@2, "unknown language linkage \"" + $2 + "\"");
+        }
+        $$ = std::move($3);
+        $$->set_extern_c(true);
+        locate($$, @$);
       }
       ;
 
@@ -631,6 +989,10 @@ external_declaration
       {
         $$ = std::move($1);
       }
+      | function_declaration
+      {
+        $$ = std::move($1);
+      }
       ;
 
 translation_unit
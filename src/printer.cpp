@@ -33,7 +33,13 @@ void Printer::visit(TranslationUnit& translation_unit) {
 
 void Printer::visit(FunctionDefinition& function_definition) {
   output_space();
-  os << "<FunctionDefinition>" << std::endl;
+  os << "<FunctionDefinition qualifiers=\"";
+  std::string separator;
+  for (auto qualifier : function_definition.get_qualifiers()) {
+    os << separator << type::to_string(qualifier);
+    separator = " ";
+  }
+  os << "\">" << std::endl;
   indent();
   visit(*(function_definition.get_declaration_specifier()));
   visit(*(function_definition.get_identifier()));
@@ -47,10 +53,27 @@ void Printer::visit(FunctionDefinition& function_definition) {
   os << "</FunctionDefinition>" << std::endl;
 }
 
+void Printer::visit(FunctionDeclaration& function_declaration) {
+  output_space();
+  os << "<FunctionDeclaration extern_c=\"" << std::boolalpha
+     << function_declaration.get_is_extern_c() << "\">" << std::endl;
+  indent();
+  visit(*(function_declaration.get_declaration_specifier()));
+  visit(*(function_declaration.get_identifier()));
+  for (auto& parameter : function_declaration.get_parameter_list()) {
+    visit(*parameter);
+  }
+  dedent();
+  output_space();
+  os << "</FunctionDeclaration>" << std::endl;
+}
+
 void Printer::visit(DeclarationSpecifier& declaration_specifier) {
   output_space();
   os << "<DeclarationSpecifier const=\"" << std::boolalpha
-     << declaration_specifier.get_is_const() << "\">" << std::endl;
+     << declaration_specifier.get_is_const() << "\" constexpr=\""
+     << declaration_specifier.get_is_constexpr() << "\" atomic=\""
+     << declaration_specifier.get_is_atomic() << "\">" << std::endl;
   indent();
   visit(*(declaration_specifier.get_type_specifier()));
   dedent();
@@ -113,7 +136,8 @@ void Printer::visit(Initializer& initializer) {
 void Printer::visit(Declarator& declarator) {
   output_space();
   os << "<Declarator is_array=\"" << std::boolalpha << declarator.get_is_array()
-     << "\" array_length=\"" << declarator.get_array_length() << "\">" << std::endl;
+     << "\" array_length=\"" << declarator.get_array_length()
+     << "\" restrict=\"" << declarator.get_is_restrict() << "\">" << std::endl;
   indent();
   visit(*(declarator.get_identifier()));
   dedent();
@@ -173,6 +197,31 @@ void Printer::visit(ContinueStatement& continue_statement) {
   output_space();
   os << "</ContinueStatement>" << std::endl;
 }
+void Printer::visit(BecomeStatement& become_statement) {
+  output_space();
+  os << "<BecomeStatement>" << std::endl;
+  indent();
+  visit(*(become_statement.get_function_call()));
+  dedent();
+  output_space();
+  os << "</BecomeStatement>" << std::endl;
+}
+void Printer::visit(SyncStatement& sync_statement) {
+  output_space();
+  os << "<SyncStatement>" << std::endl;
+  output_space();
+  os << "</SyncStatement>" << std::endl;
+}
+void Printer::visit(TraceSpanStatement& trace_span_statement) {
+  output_space();
+  os << "<TraceSpanStatement name=\"" << trace_span_statement.get_name()
+     << "\">" << std::endl;
+  indent();
+  visit(*(trace_span_statement.get_body()));
+  dedent();
+  output_space();
+  os << "</TraceSpanStatement>" << std::endl;
+}
 void Printer::visit(IfStatement& if_statement) {
   output_space();
   os << "<IfStatement>" << std::endl;
@@ -187,6 +236,30 @@ void Printer::visit(IfStatement& if_statement) {
   output_space();
   os << "</IfStatement>" << std::endl;
 }
+void Printer::visit(SwitchStatement& switch_statement) {
+  output_space();
+  os << "<SwitchStatement>" << std::endl;
+  indent();
+  visit(*(switch_statement.get_expression()));
+  for (auto& clause : switch_statement.get_clauses()) {
+    output_space();
+    os << "<SwitchClause default=\"" << clause.is_default << "\">"
+       << std::endl;
+    indent();
+    for (auto& value : clause.values) {
+      visit(*value);
+    }
+    for (auto& block_item : clause.block_items) {
+      visit(*block_item);
+    }
+    dedent();
+    output_space();
+    os << "</SwitchClause>" << std::endl;
+  }
+  dedent();
+  output_space();
+  os << "</SwitchStatement>" << std::endl;
+}
 void Printer::visit(WhileStatement& while_statement) {
   output_space();
   os << "<WhileStatement>" << std::endl;
@@ -212,6 +285,34 @@ void Printer::visit(ForStatement& for_statement) {
   output_space();
   os << "</ForStatement>" << std::endl;
 }
+void Printer::visit(ParallelForStatement& parallel_for_statement) {
+  output_space();
+  os << "<ParallelForStatement schedule=\""
+     << type::to_string(parallel_for_statement.get_schedule())
+     << "\" reduce=\"";
+  std::string separator;
+  for (auto& reduction : parallel_for_statement.get_reductions()) {
+    os << separator << type::to_string(reduction.op) << ":" << reduction.name;
+    separator = " ";
+  }
+  os << "\" private=\"";
+  separator.clear();
+  for (auto& name : parallel_for_statement.get_privates()) {
+    os << separator << name;
+    separator = " ";
+  }
+  os << "\" min_count=\"" << parallel_for_statement.get_min_count() << "\">"
+     << std::endl;
+  indent();
+  auto& chunk = parallel_for_statement.get_chunk();
+  if (chunk != nullptr) {
+    visit(*chunk);
+  }
+  visit(*(parallel_for_statement.get_for_statement()));
+  dedent();
+  output_space();
+  os << "</ParallelForStatement>" << std::endl;
+}
 
 void Printer::visit(Expression& expression) { expression.accept(*this); }
 
@@ -306,6 +407,16 @@ void Printer::visit(FunctionCall& function_call) {
   os << "</FunctionCall>" << std::endl;
 }
 
+void Printer::visit(SpawnExpression& spawn_expression) {
+  output_space();
+  os << "<SpawnExpression>" << std::endl;
+  indent();
+  visit(*(spawn_expression.get_function_call()));
+  dedent();
+  output_space();
+  os << "</SpawnExpression>" << std::endl;
+}
+
 void Printer::visit(ArrayReference& array_reference) {
   output_space();
   os << "<ArrayReference>" << std::endl;
@@ -17,6 +17,8 @@ class Printer final : public ASTVisitor {
 
   virtual void visit(FunctionDefinition& function_definition) override;
 
+  virtual void visit(FunctionDeclaration& function_declaration) override;
+
   virtual void visit(DeclarationSpecifier& declaration_specifier) override;
 
   virtual void visit(Identifier& identifier) override;
@@ -43,11 +45,21 @@ class Printer final : public ASTVisitor {
 
   virtual void visit(ContinueStatement& continue_statement) override;
 
+  virtual void visit(BecomeStatement& become_statement) override;
+
+  virtual void visit(SyncStatement& sync_statement) override;
+
+  virtual void visit(TraceSpanStatement& trace_span_statement) override;
+
   virtual void visit(IfStatement& if_statement) override;
 
+  virtual void visit(SwitchStatement& switch_statement) override;
+
   virtual void visit(WhileStatement& while_statement) override;
 
   virtual void visit(ForStatement& for_statement) override;
+
+  virtual void visit(ParallelForStatement& parallel_for_statement) override;
   
   virtual void visit(Expression& expression) override;
   
@@ -72,6 +84,8 @@ class Printer final : public ASTVisitor {
 
   virtual void visit(FunctionCall& function_call) override;
 
+  virtual void visit(SpawnExpression& spawn_expression) override;
+
   virtual void visit(ArrayReference& array_reference) override;
 
  private:
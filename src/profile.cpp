@@ -0,0 +1,36 @@
+#include "profile.hpp"
+#include <fstream>
+#include <stdexcept>
+namespace ntc {
+void ProfileData::load(const std::string& filename) {
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::logic_error("Profile: cannot read '" + filename + "'");
+  }
+  std::string name;
+  while (in >> name) {
+    Record record;
+    size_t size = 0;
+    if (!(in >> record.checksum >> size)) {
+      break;
+    }
+    record.counters.resize(size);
+    for (auto& counter : record.counters) {
+      in >> counter;
+    }
+    if (!in) {
+      break;
+    }
+    records_[name] = std::move(record);
+  }
+  if (!in.eof()) {
+    throw std::logic_error("Profile: '" + filename + "' is malformed");
+  }
+}
+
+const ProfileData::Record* ProfileData::find(
+    const std::string& function) const {
+  auto search = records_.find(function);
+  return search != records_.end() ? &(search->second) : nullptr;
+}
+}  // namespace ntc
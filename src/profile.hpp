@@ -0,0 +1,30 @@
+// Profiles written by programs built with -fprofile-generate, one line per
+// function: name, checksum, counter count and the counters. Counter 0
+// counts calls, the others belong to the branches in codegen order
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+namespace ntc {
+class ProfileData {
+ public:
+  struct Record {
+    uint64_t checksum;
+    std::vector<uint64_t> counters;
+  };
+
+  // throws std::logic_error if the file cannot be read or is malformed
+  void load(const std::string& filename);
+
+  // nullptr if the profile has no record of function
+  const Record* find(const std::string& function) const;
+
+  const std::map<std::string, Record>& get_records() const {
+    return records_;
+  }
+
+ private:
+  std::map<std::string, Record> records_;
+};
+}  // namespace ntc
@@ -0,0 +1,146 @@
+#include "purity.hpp"
+namespace ntc {
+namespace {
+class CallCounter final : public ASTWalker {
+ public:
+  explicit CallCounter(const std::string& name) : name_(name), count_(0) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(FunctionCall& function_call) override {
+    auto* identifier =
+        dynamic_cast<Identifier*>(function_call.get_target().get());
+    if (identifier != nullptr && identifier->get_name() == name_) {
+      ++count_;
+    }
+    ASTWalker::visit(function_call);
+  }
+
+  int get_count() const { return count_; }
+
+ private:
+  const std::string& name_;
+  int count_;
+};
+}  // namespace
+
+PurityAnalysis::PurityAnalysis() : cur_function_(nullptr) {}
+
+void PurityAnalysis::visit(TranslationUnit& translation_unit) {
+  ASTWalker::visit(translation_unit);
+
+  // start from every function without direct side effects and drop callers
+  // of impure functions until nothing changes, recursion stays pure
+  pure_functions_.clear();
+  for (auto& function : functions_) {
+    if (!function.second.has_side_effects) {
+      pure_functions_.insert(function.first);
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto& function : functions_) {
+      if (pure_functions_.count(function.first) == 0) {
+        continue;
+      }
+      for (auto& callee : function.second.callees) {
+        if (!is_pure(callee)) {
+          pure_functions_.erase(function.first);
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+void PurityAnalysis::visit(FunctionDefinition& function_definition) {
+  auto& info = functions_[function_definition.get_identifier()->get_name()];
+  info.has_side_effects = false;
+  cur_function_ = &info;
+  array_parameters_.clear();
+  for (auto& parameter : function_definition.get_parameter_list()) {
+    auto& declarator = parameter->get_declarator();
+    if (declarator->get_is_array()) {
+      array_parameters_.insert(declarator->get_identifier()->get_name());
+    }
+  }
+  visit(*(function_definition.get_compound_statement()));
+  cur_function_ = nullptr;
+}
+
+void PurityAnalysis::visit(FunctionDeclaration& function_declaration) {
+  // nothing is known of a body in another file, a definition in this one
+  // replaces the entry
+  FunctionInfo info;
+  info.has_side_effects = true;
+  functions_.emplace(function_declaration.get_identifier()->get_name(), info);
+}
+
+void PurityAnalysis::visit(
+    BinaryOperationExpression& binary_operation_expression) {
+  if (binary_operation_expression.get_op_type() == type::BinaryOp::ASSIGN) {
+    auto* array_reference = dynamic_cast<ArrayReference*>(
+        binary_operation_expression.get_lhs().get());
+    if (array_reference != nullptr) {
+      auto* identifier =
+          dynamic_cast<Identifier*>(array_reference->get_target().get());
+      if (identifier == nullptr ||
+          array_parameters_.count(identifier->get_name()) != 0) {
+        cur_function_->has_side_effects = true;
+      }
+    }
+  }
+  ASTWalker::visit(binary_operation_expression);
+}
+
+void PurityAnalysis::visit(FunctionCall& function_call) {
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call.get_target().get());
+  if (identifier == nullptr) {
+    cur_function_->has_side_effects = true;
+  } else {
+    cur_function_->callees.insert(identifier->get_name());
+  }
+  for (auto& argument : function_call.get_argument_list()) {
+    visit(*argument);
+  }
+}
+
+void PurityAnalysis::visit(TraceSpanStatement& trace_span_statement) {
+  // a memoized call would leave its spans out of the trace
+  cur_function_->has_side_effects = true;
+  ASTWalker::visit(trace_span_statement);
+}
+
+bool PurityAnalysis::is_pure(const std::string& name) const {
+  // functions of the program shadow the builtins
+  return pure_functions_.count(name) != 0 ||
+         (functions_.count(name) == 0 && is_pure_builtin(name));
+}
+
+bool is_pure_builtin(const std::string& name) {
+  static const std::set<std::string> math = {
+      "sqrt", "fabs", "floor", "ceil", "trunc", "round", "exp", "exp2", "log",
+      "log2", "log10", "sin", "cos", "pow", "fma", "min", "max", "abs"};
+  return math.count(name) != 0 || is_bit_builtin(name) ||
+         is_hint_builtin(name);
+}
+
+bool is_hint_builtin(const std::string& name) {
+  return name == "likely" || name == "unlikely" || name == "prefetch";
+}
+
+bool is_bit_builtin(const std::string& name) {
+  static const std::set<std::string> bits = {"popcount", "clz",  "ctz",
+                                             "rotl",     "rotr", "bswap"};
+  return bits.count(name) != 0;
+}
+
+int count_calls(AST& ast, const std::string& name) {
+  CallCounter counter(name);
+  ast.accept(counter);
+  return counter.get_count();
+}
+}  // namespace ntc
@@ -0,0 +1,53 @@
+// Interprocedural purity analysis: a function is pure when it does no I/O,
+// never writes through its array parameters and only calls pure functions
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include "walker.hpp"
+namespace ntc {
+class PurityAnalysis final : public ASTWalker {
+ public:
+  PurityAnalysis();
+
+  using ASTWalker::visit;
+
+  virtual void visit(TranslationUnit& translation_unit) override;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  virtual void visit(FunctionDeclaration& function_declaration) override;
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override;
+
+  virtual void visit(FunctionCall& function_call) override;
+
+  virtual void visit(TraceSpanStatement& trace_span_statement) override;
+
+  bool is_pure(const std::string& name) const;
+
+ private:
+  struct FunctionInfo {
+    bool has_side_effects;
+    std::set<std::string> callees;
+  };
+
+  std::map<std::string, FunctionInfo> functions_;
+  std::set<std::string> pure_functions_;
+  std::set<std::string> array_parameters_;
+  FunctionInfo* cur_function_;
+};
+
+// builtins that neither read nor write program state
+bool is_pure_builtin(const std::string& name);
+
+// popcount, clz, ctz, rotl, rotr and bswap
+bool is_bit_builtin(const std::string& name);
+
+// likely, unlikely and prefetch only guide the optimizer
+bool is_hint_builtin(const std::string& name);
+
+// number of call sites of function name inside ast
+int count_calls(AST& ast, const std::string& name);
+}  // namespace ntc
@@ -0,0 +1,383 @@
+#include "recursion.hpp"
+#include <algorithm>
+#include <climits>
+#include <set>
+#include "folder.hpp"
+namespace ntc {
+namespace {
+// names of the rewritten loop, '.' keeps them apart from user identifiers
+const std::string kWindow = "rec.w";
+const std::string kIndex = "rec.i";
+const std::string kNext = "rec.v";
+
+FunctionCall* self_call(Expression& expression, const std::string& function) {
+  auto* function_call = dynamic_cast<FunctionCall*>(&expression);
+  if (function_call == nullptr) {
+    return nullptr;
+  }
+  auto* identifier =
+      dynamic_cast<Identifier*>(function_call->get_target().get());
+  if (identifier == nullptr || identifier->get_name() != function) {
+    return nullptr;
+  }
+  return function_call;
+}
+
+class TailCallFinder final : public ASTWalker {
+ public:
+  explicit TailCallFinder(const std::string& function)
+      : function_(function), plain_(false), become_(false) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(ReturnStatement& return_statement) override {
+    auto& expression = return_statement.get_expression();
+    Expression* operand = nullptr;
+    if (expression != nullptr) {
+      if (match_tail_call(*expression, function_, type::BinaryOp::ASSIGN,
+                          &operand) != nullptr) {
+        plain_ = true;
+      }
+      for (auto op : {type::BinaryOp::ADD, type::BinaryOp::MUL}) {
+        if (match_tail_call(*expression, function_, op, &operand) != nullptr &&
+            operand != nullptr) {
+          accumulators_.insert(op);
+        }
+      }
+    }
+    ASTWalker::visit(return_statement);
+  }
+
+  virtual void visit(BecomeStatement& become_statement) override {
+    become_ = true;
+    if (self_call(*(become_statement.get_function_call()), function_)) {
+      plain_ = true;
+    }
+    ASTWalker::visit(become_statement);
+  }
+
+  bool get_plain() const { return plain_; }
+
+  bool get_become() const { return become_; }
+
+  auto& get_accumulators() const { return accumulators_; }
+
+ private:
+  const std::string& function_;
+  bool plain_;
+  bool become_;
+  std::set<type::BinaryOp> accumulators_;
+};
+
+// the subset of expressions a recurrence may be built from, order receives
+// the largest d of the f(n - d) calls and calls their number
+bool is_recurrence_term(Expression& expression, const std::string& function,
+                        const std::string& parameter, int* order,
+                        int* calls) {
+  if (is_literal(expression)) {
+    return true;
+  } else if (auto* identifier = dynamic_cast<Identifier*>(&expression)) {
+    return identifier->get_name() == parameter;
+  } else if (auto* binary =
+                 dynamic_cast<BinaryOperationExpression*>(&expression)) {
+    return binary->get_op_type() != type::BinaryOp::ASSIGN &&
+           is_recurrence_term(*(binary->get_lhs()), function, parameter, order,
+                              calls) &&
+           is_recurrence_term(*(binary->get_rhs()), function, parameter, order,
+                              calls);
+  } else if (auto* unary =
+                 dynamic_cast<UnaryOperationExpression*>(&expression)) {
+    return is_recurrence_term(*(unary->get_operand()), function, parameter,
+                              order, calls);
+  } else if (auto* function_call = self_call(expression, function)) {
+    auto& argument_list = function_call->get_argument_list();
+    if (argument_list.size() != 1) {
+      return false;
+    }
+    auto* argument =
+        dynamic_cast<BinaryOperationExpression*>(argument_list[0].get());
+    if (argument == nullptr || argument->get_op_type() != type::BinaryOp::SUB) {
+      return false;
+    }
+    auto* identifier = dynamic_cast<Identifier*>(argument->get_lhs().get());
+    auto* distance =
+        dynamic_cast<IntegerExpression*>(argument->get_rhs().get());
+    if (identifier == nullptr || identifier->get_name() != parameter ||
+        distance == nullptr || distance->get_val() < 1 ||
+        distance->get_val() > 16) {
+      return false;
+    }
+    *order = std::max(*order, distance->get_val());
+    ++*calls;
+    return true;
+  }
+  return false;
+}
+
+// copy of a recurrence term with f(n - d) read from the window and the
+// parameter renamed to index
+std::unique_ptr<Expression> substitute(Expression& expression,
+                                       const std::string& function,
+                                       const std::string& index) {
+  if (is_literal(expression)) {
+    return clone_literal(expression);
+  } else if (dynamic_cast<Identifier*>(&expression)) {
+    return make_ast<Identifier>(index);
+  } else if (auto* binary =
+                 dynamic_cast<BinaryOperationExpression*>(&expression)) {
+    return make_ast<BinaryOperationExpression>(
+        binary->get_op_type(),
+        substitute(*(binary->get_lhs()), function, index),
+        substitute(*(binary->get_rhs()), function, index));
+  } else if (auto* unary =
+                 dynamic_cast<UnaryOperationExpression*>(&expression)) {
+    return make_ast<UnaryOperationExpression>(
+        unary->get_op_type(),
+        substitute(*(unary->get_operand()), function, index));
+  }
+  auto* argument = static_cast<BinaryOperationExpression*>(
+      self_call(expression, function)->get_argument_list()[0].get());
+  auto* distance = static_cast<IntegerExpression*>(argument->get_rhs().get());
+  return make_ast<Identifier>(kWindow + std::to_string(distance->get_val()));
+}
+
+// if (n < C) return e; and its variants, upper receives the largest value
+// a threshold guard returns for, equal the value of an equality guard
+bool match_guard(BlockItem& block_item, const std::string& function,
+                 const std::string& parameter, long long* upper,
+                 std::set<long long>* equal) {
+  auto* if_statement = dynamic_cast<IfStatement*>(&block_item);
+  if (if_statement == nullptr ||
+      if_statement->get_else_statement() != nullptr) {
+    return false;
+  }
+  Statement* then_statement = if_statement->get_then_statment().get();
+  if (auto* compound = dynamic_cast<CompoundStatement*>(then_statement)) {
+    auto& block_item_list = compound->get_block_item_list();
+    if (block_item_list.size() != 1) {
+      return false;
+    }
+    then_statement = dynamic_cast<Statement*>(block_item_list[0].get());
+  }
+  auto* return_statement = dynamic_cast<ReturnStatement*>(then_statement);
+  if (return_statement == nullptr ||
+      return_statement->get_expression() == nullptr ||
+      count_calls(*(return_statement->get_expression()), function) != 0) {
+    return false;
+  }
+  auto* condition = dynamic_cast<BinaryOperationExpression*>(
+      if_statement->get_if_expression().get());
+  if (condition == nullptr) {
+    return false;
+  }
+  auto op = condition->get_op_type();
+  auto* identifier = dynamic_cast<Identifier*>(condition->get_lhs().get());
+  auto* bound = dynamic_cast<IntegerExpression*>(condition->get_rhs().get());
+  if (identifier == nullptr) {
+    // C > n is n < C
+    identifier = dynamic_cast<Identifier*>(condition->get_rhs().get());
+    bound = dynamic_cast<IntegerExpression*>(condition->get_lhs().get());
+    if (op == type::BinaryOp::GREATER) {
+      op = type::BinaryOp::LESS;
+    } else if (op == type::BinaryOp::GREATER_EQUAL) {
+      op = type::BinaryOp::LESS_EQUAL;
+    } else if (op != type::BinaryOp::EQUAL) {
+      return false;
+    }
+  }
+  if (identifier == nullptr || bound == nullptr ||
+      identifier->get_name() != parameter) {
+    return false;
+  }
+  long long value = bound->get_val();
+  switch (op) {
+    case type::BinaryOp::LESS:
+      *upper = std::max(*upper, value - 1);
+      return true;
+    case type::BinaryOp::LESS_EQUAL:
+      *upper = std::max(*upper, value);
+      return true;
+    case type::BinaryOp::EQUAL:
+      equal->insert(value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::unique_ptr<Declaration> make_declaration(
+    type::Specifier specifier, const std::string& name,
+    std::unique_ptr<Expression>&& value) {
+  return make_ast<Declaration>(
+      make_ast<DeclarationSpecifier>(make_ast<TypeSpecifier>(specifier)),
+      make_ast<Declarator>(make_ast<Identifier>(name), false, 0),
+      make_ast<Initializer>(std::move(value)));
+}
+
+std::unique_ptr<ExpressionStatement> make_assignment(
+    const std::string& name, std::unique_ptr<Expression>&& value) {
+  return make_ast<ExpressionStatement>(make_ast<BinaryOperationExpression>(
+      type::BinaryOp::ASSIGN, make_ast<Identifier>(name), std::move(value)));
+}
+}  // namespace
+
+TailRecursion analyze_tail_recursion(FunctionDefinition& function_definition) {
+  TailCallFinder finder(function_definition.get_identifier()->get_name());
+  function_definition.get_compound_statement()->accept(finder);
+  TailRecursion result;
+  auto& accumulators = finder.get_accumulators();
+  // wrapping integer + and * reassociate exactly, floating point does not,
+  // and become leaves the function without a chance to apply the accumulator
+  auto specifier = function_definition.get_declaration_specifier()
+                       ->get_type_specifier()
+                       ->get_specifier();
+  bool integral = specifier == type::Specifier::SHORT ||
+                  specifier == type::Specifier::INT ||
+                  specifier == type::Specifier::LONG ||
+                  type::is_unsigned(specifier);
+  if (accumulators.size() == 1 && integral && !finder.get_become()) {
+    result.enabled = true;
+    result.accumulator = *accumulators.begin();
+  } else if (finder.get_plain()) {
+    result.enabled = true;
+  }
+  return result;
+}
+
+FunctionCall* match_tail_call(Expression& expression,
+                              const std::string& function,
+                              type::BinaryOp accumulator,
+                              Expression** operand) {
+  *operand = nullptr;
+  if (auto* function_call = self_call(expression, function)) {
+    return function_call;
+  }
+  auto* binary = dynamic_cast<BinaryOperationExpression*>(&expression);
+  if (accumulator == type::BinaryOp::ASSIGN || binary == nullptr ||
+      binary->get_op_type() != accumulator) {
+    return nullptr;
+  }
+  // the operand is folded before the arguments are evaluated, so neither
+  // side may observe the other
+  auto* function_call = self_call(*(binary->get_rhs()), function);
+  Expression* other = binary->get_lhs().get();
+  if (function_call == nullptr) {
+    function_call = self_call(*(binary->get_lhs()), function);
+    other = binary->get_rhs().get();
+  }
+  if (function_call == nullptr || has_side_effects(*other)) {
+    return nullptr;
+  }
+  for (auto& argument : function_call->get_argument_list()) {
+    if (has_side_effects(*argument)) {
+      return nullptr;
+    }
+  }
+  *operand = other;
+  return function_call;
+}
+
+RecurrenceRewriter::RecurrenceRewriter() : rewritten_(0) {}
+
+void RecurrenceRewriter::visit(TranslationUnit& translation_unit) {
+  translation_unit.accept(purity_);
+  ASTWalker::visit(translation_unit);
+}
+
+void RecurrenceRewriter::visit(FunctionDefinition& function_definition) {
+  auto& function = function_definition.get_identifier()->get_name();
+  auto& parameter_list = function_definition.get_parameter_list();
+  auto return_type = function_definition.get_declaration_specifier()
+                         ->get_type_specifier()
+                         ->get_specifier();
+  if (function_definition.has_qualifier(type::FunctionQualifier::MEMO) ||
+      !purity_.is_pure(function) || parameter_list.size() != 1 ||
+      return_type == type::Specifier::VOID ||
+      return_type == type::Specifier::STRING) {
+    return;
+  }
+  auto& declarator = parameter_list[0]->get_declarator();
+  if (declarator->get_is_array() ||
+      parameter_list[0]->get_declaration_specifier()
+              ->get_type_specifier()
+              ->get_specifier() != type::Specifier::INT) {
+    return;
+  }
+  auto& parameter = declarator->get_identifier()->get_name();
+
+  // guards, then return E with at least two calls f(n - d)
+  auto& block_item_list =
+      function_definition.get_compound_statement()->get_block_item_list();
+  if (block_item_list.empty()) {
+    return;
+  }
+  long long upper = LLONG_MIN;
+  std::set<long long> equal;
+  for (size_t i = 0; i + 1 < block_item_list.size(); ++i) {
+    if (!match_guard(*block_item_list[i], function, parameter, &upper,
+                     &equal)) {
+      return;
+    }
+  }
+  auto* final_return =
+      dynamic_cast<ReturnStatement*>(block_item_list.back().get());
+  if (final_return == nullptr || final_return->get_expression() == nullptr) {
+    return;
+  }
+  auto& recurrence = *(final_return->get_expression());
+  int order = 0;
+  int calls = 0;
+  if (!is_recurrence_term(recurrence, function, parameter, &order, &calls) ||
+      calls < 2 || upper == LLONG_MIN) {
+    return;
+  }
+
+  // the guards must return for every n below base and for none above it
+  long long base = upper + 1;
+  while (equal.count(base) != 0) {
+    ++base;
+  }
+  if ((!equal.empty() && *equal.rbegin() > base) || base - order < INT_MIN ||
+      base > INT_MAX) {
+    return;
+  }
+
+  // rec.wd holds f(rec.i - d), the loop slides the window up to n
+  auto body = make_ast<CompoundStatement>(nullptr);
+  auto& items = body->get_block_item_list();
+  for (int d = 1; d <= order; ++d) {
+    auto argument_list =
+        make_ast<ArgumentList>(make_ast<IntegerExpression>(base - d));
+    items.push_back(make_declaration(
+        return_type, kWindow + std::to_string(d),
+        make_ast<FunctionCall>(make_ast<Identifier>(function),
+                               std::move(argument_list))));
+  }
+  items.push_back(make_declaration(type::Specifier::INT, kIndex,
+                                   make_ast<IntegerExpression>(base)));
+  auto loop = make_ast<CompoundStatement>(nullptr);
+  auto& loop_items = loop->get_block_item_list();
+  loop_items.push_back(make_declaration(
+      return_type, kNext, substitute(recurrence, function, kIndex)));
+  for (int d = order; d > 1; --d) {
+    loop_items.push_back(make_assignment(
+        kWindow + std::to_string(d),
+        make_ast<Identifier>(kWindow + std::to_string(d - 1))));
+  }
+  loop_items.push_back(
+      make_assignment(kWindow + "1", make_ast<Identifier>(kNext)));
+  loop_items.push_back(make_assignment(
+      kIndex, make_ast<BinaryOperationExpression>(
+                  type::BinaryOp::ADD, make_ast<Identifier>(kIndex),
+                  make_ast<IntegerExpression>(1))));
+  items.push_back(make_ast<WhileStatement>(
+      make_ast<BinaryOperationExpression>(type::BinaryOp::LESS,
+                                          make_ast<Identifier>(kIndex),
+                                          make_ast<Identifier>(parameter)),
+      std::move(loop)));
+  items.push_back(
+      make_ast<ReturnStatement>(substitute(recurrence, function, parameter)));
+  block_item_list.back() = std::move(body);
+  ++rewritten_;
+}
+}  // namespace ntc
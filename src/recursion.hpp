@@ -0,0 +1,42 @@
+// Self recursion that can run without growing the stack: tail calls and
+// accumulator patterns are turned into loops by codegen, linear recurrences
+// such as f(n - 1) + f(n - 2) are rewritten into a sliding window loop here
+#pragma once
+#include <string>
+#include "purity.hpp"
+#include "walker.hpp"
+namespace ntc {
+struct TailRecursion {
+  bool enabled = false;
+  // ASSIGN for plain tail calls only, ADD or MUL when calls combined as
+  // e op f(...) are folded into an accumulator as well
+  type::BinaryOp accumulator = type::BinaryOp::ASSIGN;
+};
+
+TailRecursion analyze_tail_recursion(FunctionDefinition& function_definition);
+
+// self call of function that expression returns in tail position under the
+// given accumulator, nullptr if there is none, operand receives the other
+// side of an accumulated call and nullptr for a plain one
+FunctionCall* match_tail_call(Expression& expression,
+                              const std::string& function,
+                              type::BinaryOp accumulator,
+                              Expression** operand);
+
+class RecurrenceRewriter final : public ASTWalker {
+ public:
+  RecurrenceRewriter();
+
+  using ASTWalker::visit;
+
+  virtual void visit(TranslationUnit& translation_unit) override;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  int get_rewritten() const { return rewritten_; }
+
+ private:
+  PurityAnalysis purity_;
+  int rewritten_;
+};
+}  // namespace ntc
@@ -0,0 +1,161 @@
+#include "remarks.hpp"
+#include <llvm/IR/Function.h>
+#include <algorithm>
+#include <iostream>
+namespace ntc {
+namespace {
+enum class RemarkKind { NONE, PASSED, MISSED, ANALYSIS };
+
+RemarkKind get_remark_kind(const llvm::DiagnosticInfo& info) {
+  switch (info.getKind()) {
+    case llvm::DK_OptimizationRemark:
+    case llvm::DK_MachineOptimizationRemark:
+      return RemarkKind::PASSED;
+    case llvm::DK_OptimizationRemarkMissed:
+    case llvm::DK_MachineOptimizationRemarkMissed:
+      return RemarkKind::MISSED;
+    case llvm::DK_OptimizationRemarkAnalysis:
+    case llvm::DK_OptimizationRemarkAnalysisFPCommute:
+    case llvm::DK_OptimizationRemarkAnalysisAliasing:
+    case llvm::DK_MachineOptimizationRemarkAnalysis:
+      return RemarkKind::ANALYSIS;
+    default:
+      return RemarkKind::NONE;
+  }
+}
+}  // namespace
+
+RemarkHandler::RemarkHandler(const ProgramConfig& config)
+    : filename_(config.input_filename), summary_(config.remarks_summary) {
+  std::vector<std::pair<Filter*, const std::string*>> filters = {
+      {&passed_, &config.remarks_passed},
+      {&missed_, &config.remarks_missed},
+      {&analysis_, &config.remarks_analysis}};
+  for (auto& filter : filters) {
+    if (!filter.second->empty()) {
+      filter.first->enabled = true;
+      filter.first->pattern = std::regex(*filter.second);
+    }
+  }
+}
+
+bool RemarkHandler::handleDiagnostics(const llvm::DiagnosticInfo& info) {
+  auto kind = get_remark_kind(info);
+  if (kind == RemarkKind::NONE) {
+    return false;
+  }
+  auto& remark = llvm::cast<llvm::DiagnosticInfoOptimizationBase>(info);
+  auto pass = remark.getPassName();
+  std::string location;
+  if (remark.isLocationAvailable()) {
+    location = std::to_string(remark.getLocation().getLine()) + ":" +
+               std::to_string(remark.getLocation().getColumn());
+  }
+  const char* flag = "-Rpass-analysis";
+  const Filter* filter = &analysis_;
+  if (kind == RemarkKind::PASSED) {
+    flag = "-Rpass";
+    filter = &passed_;
+  } else if (kind == RemarkKind::MISSED) {
+    flag = "-Rpass-missed";
+    filter = &missed_;
+  }
+  if (matches(*filter, pass)) {
+    std::cerr << filename_ << ":" << (location.empty() ? "" : location + ":")
+              << " remark: " << remark.getMsg() << " [" << flag << "="
+              << pass.str() << "]" << std::endl;
+  }
+  if (is_summarized(pass)) {
+    summarize(remark, location, kind != RemarkKind::PASSED);
+  }
+  return true;
+}
+
+bool RemarkHandler::isAnalysisRemarkEnabled(llvm::StringRef pass) const {
+  return matches(analysis_, pass) || is_summarized(pass);
+}
+
+bool RemarkHandler::isMissedOptRemarkEnabled(llvm::StringRef pass) const {
+  return matches(missed_, pass) || is_summarized(pass);
+}
+
+bool RemarkHandler::isPassedOptRemarkEnabled(llvm::StringRef pass) const {
+  return matches(passed_, pass) || is_summarized(pass);
+}
+
+bool RemarkHandler::isAnyRemarkEnabled() const {
+  return passed_.enabled || missed_.enabled || analysis_.enabled || summary_;
+}
+
+void RemarkHandler::print_summary(std::ostream& os) const {
+  os << "===------ ntc remarks summary ------===" << std::endl;
+  for (auto& function : functions_) {
+    auto& summary = summaries_.at(function);
+    os << function << ": " << summary.inlined.size() << " calls inlined, "
+       << summary.vectorized.size() << " vectorized, "
+       << summary.missed.size() << " missed" << std::endl;
+    if (!summary.inlined.empty()) {
+      os << "  inlined:";
+      for (auto& callee : summary.inlined) {
+        os << " " << callee;
+      }
+      os << std::endl;
+    }
+    for (auto& loop : summary.vectorized) {
+      os << "  vectorized " << loop << std::endl;
+    }
+    for (auto& reason : summary.missed) {
+      os << "  missed " << reason << std::endl;
+    }
+  }
+}
+
+bool RemarkHandler::matches(const Filter& filter, llvm::StringRef pass) {
+  return filter.enabled && std::regex_search(pass.str(), filter.pattern);
+}
+
+bool RemarkHandler::is_summarized(llvm::StringRef pass) const {
+  return summary_ && (pass == "inline" || pass == "loop-vectorize" ||
+                      pass == "slp-vectorizer");
+}
+
+void RemarkHandler::summarize(
+    const llvm::DiagnosticInfoOptimizationBase& remark,
+    const std::string& location, bool is_missed) {
+  auto name = remark.getRemarkName();
+  // every call of a runtime or libc function and every straight-line
+  // bundle the SLP vectorizer tried would be listed
+  if (name == "NoDefinition" ||
+      (is_missed && remark.getPassName() == "slp-vectorizer")) {
+    return;
+  }
+  auto function = remark.getFunction().getName().str();
+  auto inserted = summaries_.emplace(function, FunctionSummary());
+  if (inserted.second) {
+    functions_.push_back(function);
+  }
+  auto& summary = inserted.first->second;
+  std::map<std::string, std::string> arguments;
+  for (auto& argument : remark.getArgs()) {
+    arguments[argument.Key] = argument.Val;
+  }
+  auto where = location.empty() ? std::string("?") : location;
+  if (is_missed) {
+    auto reason = where + " " + remark.getPassName().str() + ": " +
+                  remark.getMsg();
+    // the inliner retries a call every time its caller changes
+    if (std::find(summary.missed.begin(), summary.missed.end(), reason) ==
+        summary.missed.end()) {
+      summary.missed.push_back(reason);
+    }
+  } else if (name == "Inlined") {
+    summary.inlined.push_back(arguments["Callee"]);
+  } else if (name == "Vectorized") {
+    summary.vectorized.push_back(where + " (VF " +
+                                 arguments["VectorizationFactor"] + ", UF " +
+                                 arguments["InterleaveCount"] + ")");
+  } else if (remark.getPassName() == "slp-vectorizer") {
+    summary.vectorized.push_back(where + " (SLP)");
+  }
+}
+}  // namespace ntc
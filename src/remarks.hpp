@@ -0,0 +1,63 @@
+// Optimization remarks of the LLVM passes: the -Rpass filters print them
+// as they come, --remarks-summary collects inlining and vectorization per
+// function. Locations need the line table, which codegen keeps whenever
+// remarks are requested
+#pragma once
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <map>
+#include <ostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include "config.hpp"
+namespace ntc {
+class RemarkHandler final : public llvm::DiagnosticHandler {
+ public:
+  explicit RemarkHandler(const ProgramConfig& config);
+
+  // true for every remark, other diagnostics are left to LLVM
+  virtual bool handleDiagnostics(const llvm::DiagnosticInfo& info) override;
+
+  virtual bool isAnalysisRemarkEnabled(llvm::StringRef pass) const override;
+
+  virtual bool isMissedOptRemarkEnabled(llvm::StringRef pass) const override;
+
+  virtual bool isPassedOptRemarkEnabled(llvm::StringRef pass) const override;
+
+  virtual bool isAnyRemarkEnabled() const override;
+
+  // functions in the order their first remark came in
+  void print_summary(std::ostream& os) const;
+
+ private:
+  struct Filter {
+    bool enabled = false;
+    std::regex pattern;
+  };
+
+  struct FunctionSummary {
+    std::vector<std::string> inlined;
+    // line:column of the loop with its vectorization and interleave factor,
+    // or of the code the SLP vectorizer packed
+    std::vector<std::string> vectorized;
+    std::vector<std::string> missed;
+  };
+
+  static bool matches(const Filter& filter, llvm::StringRef pass);
+
+  // the inliner and the vectorizers, whose remarks the summary reads
+  bool is_summarized(llvm::StringRef pass) const;
+
+  void summarize(const llvm::DiagnosticInfoOptimizationBase& remark,
+                 const std::string& location, bool is_missed);
+
+  std::string filename_;
+  Filter passed_;
+  Filter missed_;
+  Filter analysis_;
+  bool summary_;
+  std::vector<std::string> functions_;
+  std::map<std::string, FunctionSummary> summaries_;
+};
+}  // namespace ntc
@@ -0,0 +1,22 @@
+#include "statistics.hpp"
+#include <iomanip>
+namespace ntc {
+void Statistics::add(const std::string& pass, const std::string& description,
+                     long long value) {
+  for (auto& entry : entries_) {
+    if (entry.pass == pass && entry.description == description) {
+      entry.value += value;
+      return;
+    }
+  }
+  entries_.push_back(Entry{pass, description, value});
+}
+
+void Statistics::print(std::ostream& os) const {
+  os << "===------ ntc statistics ------===" << std::endl;
+  for (auto& entry : entries_) {
+    os << std::setw(12) << entry.value << " " << entry.pass << " - "
+       << entry.description << std::endl;
+  }
+}
+}  // namespace ntc
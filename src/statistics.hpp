@@ -0,0 +1,24 @@
+// Counters collected by the passes, printed with --stats
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+namespace ntc {
+class Statistics {
+ public:
+  // counters of several files add up
+  void add(const std::string& pass, const std::string& description,
+           long long value);
+
+  void print(std::ostream& os) const;
+
+ private:
+  struct Entry {
+    std::string pass;
+    std::string description;
+    long long value;
+  };
+
+  std::vector<Entry> entries_;
+};
+}  // namespace ntc
@@ -0,0 +1,230 @@
+#include "switch.hpp"
+#include <set>
+#include <vector>
+namespace ntc {
+namespace {
+bool is_switchable(type::Specifier specifier) {
+  return specifier == type::Specifier::SHORT ||
+         specifier == type::Specifier::INT ||
+         specifier == type::Specifier::LONG ||
+         specifier == type::Specifier::UINT ||
+         specifier == type::Specifier::ULONG ||
+         specifier == type::Specifier::CHAR;
+}
+
+class VariableCollector final : public ASTWalker {
+ public:
+  explicit VariableCollector(std::map<std::string, type::Specifier>& variables)
+      : variables_(variables) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(Declaration& declaration) override {
+    add(*(declaration.get_declaration_specifier()),
+        *(declaration.get_declarator()));
+    ASTWalker::visit(declaration);
+  }
+
+  void add(DeclarationSpecifier& declaration_specifier,
+           Declarator& declarator) {
+    auto specifier =
+        declaration_specifier.get_type_specifier()->get_specifier();
+    if (declarator.get_is_array() || declaration_specifier.get_is_atomic() ||
+        !is_switchable(specifier)) {
+      specifier = type::Specifier::UNDEFINED;
+    }
+    auto& name = declarator.get_identifier()->get_name();
+    auto search = variables_.find(name);
+    if (search == variables_.end()) {
+      variables_[name] = specifier;
+    } else if (search->second != specifier) {
+      search->second = type::Specifier::UNDEFINED;
+    }
+  }
+
+ private:
+  std::map<std::string, type::Specifier>& variables_;
+};
+
+// whether a break in the statement would leave a loop around it
+class BreakFinder final : public ASTWalker {
+ public:
+  BreakFinder() : depth_(0), found_(false) {}
+
+  using ASTWalker::visit;
+
+  virtual void visit(BreakStatement&) override {
+    if (depth_ == 0) {
+      found_ = true;
+    }
+  }
+
+  virtual void visit(WhileStatement& while_statement) override {
+    ++depth_;
+    ASTWalker::visit(while_statement);
+    --depth_;
+  }
+
+  virtual void visit(ForStatement& for_statement) override {
+    ++depth_;
+    ASTWalker::visit(for_statement);
+    --depth_;
+  }
+
+  virtual void visit(SwitchStatement& switch_statement) override {
+    ++depth_;
+    ASTWalker::visit(switch_statement);
+    --depth_;
+  }
+
+  bool get_found() const { return found_; }
+
+ private:
+  int depth_;
+  bool found_;
+};
+
+bool has_break(Statement& statement) {
+  BreakFinder finder;
+  statement.accept(finder);
+  return finder.get_found();
+}
+
+// v == c, c == v and || of those, name receives v on the first match and
+// has to stay the same, literals the slots holding each c
+bool match_cases(std::unique_ptr<Expression>& condition, std::string* name,
+                 std::vector<std::unique_ptr<Expression>*>* literals) {
+  auto* binary = dynamic_cast<BinaryOperationExpression*>(condition.get());
+  if (binary == nullptr) {
+    return false;
+  }
+  if (binary->get_op_type() == type::BinaryOp::LOGIC_OR) {
+    return match_cases(binary->get_lhs(), name, literals) &&
+           match_cases(binary->get_rhs(), name, literals);
+  }
+  if (binary->get_op_type() != type::BinaryOp::EQUAL) {
+    return false;
+  }
+  auto* variable = &(binary->get_lhs());
+  auto* literal = &(binary->get_rhs());
+  if (dynamic_cast<Identifier*>(variable->get()) == nullptr) {
+    std::swap(variable, literal);
+  }
+  auto* identifier = dynamic_cast<Identifier*>(variable->get());
+  if (identifier == nullptr ||
+      (dynamic_cast<IntegerExpression*>(literal->get()) == nullptr &&
+       dynamic_cast<CharacterExpression*>(literal->get()) == nullptr)) {
+    return false;
+  }
+  if (name->empty()) {
+    *name = identifier->get_name();
+  } else if (*name != identifier->get_name()) {
+    return false;
+  }
+  literals->push_back(literal);
+  return true;
+}
+}  // namespace
+
+SwitchConverter::SwitchConverter(int min_cases)
+    : min_cases_(min_cases), converted_(0) {}
+
+void SwitchConverter::visit(FunctionDefinition& function_definition) {
+  variables_.clear();
+  VariableCollector collector(variables_);
+  for (auto& parameter : function_definition.get_parameter_list()) {
+    collector.add(*(parameter->get_declaration_specifier()),
+                  *(parameter->get_declarator()));
+  }
+  function_definition.get_compound_statement()->accept(collector);
+  ASTWalker::visit(function_definition);
+}
+
+void SwitchConverter::visit(CompoundStatement& compound_statement) {
+  for (auto& block_item : compound_statement.get_block_item_list()) {
+    block_item->accept(*this);
+    auto* if_statement = dynamic_cast<IfStatement*>(block_item.get());
+    if (if_statement == nullptr) {
+      continue;
+    }
+    auto switch_statement = convert(*if_statement);
+    if (switch_statement != nullptr) {
+      block_item = std::move(switch_statement);
+      ++converted_;
+    }
+  }
+}
+
+std::unique_ptr<SwitchStatement> SwitchConverter::convert(
+    IfStatement& if_statement) {
+  // check the whole chain before taking any of it apart
+  std::string name;
+  std::vector<IfStatement*> links;
+  std::vector<std::vector<std::unique_ptr<Expression>*>> literals;
+  Statement* otherwise = &if_statement;
+  while (auto* link = dynamic_cast<IfStatement*>(otherwise)) {
+    std::vector<std::unique_ptr<Expression>*> link_literals;
+    if (!match_cases(link->get_if_expression(), &name, &link_literals)) {
+      break;
+    }
+    if (has_break(*(link->get_then_statment()))) {
+      return nullptr;
+    }
+    links.push_back(link);
+    literals.push_back(std::move(link_literals));
+    otherwise = link->get_else_statement().get();
+  }
+  if (links.empty()) {
+    return nullptr;
+  }
+  auto search = variables_.find(name);
+  if (search == variables_.end() ||
+      search->second == type::Specifier::UNDEFINED) {
+    return nullptr;
+  }
+  bool is_char = search->second == type::Specifier::CHAR;
+  std::set<int> seen;
+  for (auto& link_literals : literals) {
+    for (auto* literal : link_literals) {
+      int value;
+      if (auto* integer = dynamic_cast<IntegerExpression*>(literal->get())) {
+        value = integer->get_val();
+      } else {
+        value = static_cast<CharacterExpression*>(literal->get())->get_val();
+      }
+      bool literal_is_char =
+          dynamic_cast<CharacterExpression*>(literal->get()) != nullptr;
+      if (literal_is_char != is_char || !seen.insert(value).second) {
+        return nullptr;
+      }
+    }
+  }
+  if (static_cast<int>(seen.size()) < min_cases_ ||
+      (otherwise != nullptr && has_break(*otherwise))) {
+    return nullptr;
+  }
+
+  // every clause ends in a break, a chain never falls through
+  auto switch_statement = make_ast<SwitchStatement>();
+  switch_statement->set_range(links.front()->get_range());
+  switch_statement->set_expression(make_ast<Identifier>(name));
+  for (size_t i = 0; i < links.size(); ++i) {
+    SwitchStatement::Clause clause;
+    for (auto* literal : literals[i]) {
+      clause.values.push_back(std::move(*literal));
+    }
+    clause.block_items.push_back(std::move(links[i]->get_then_statment()));
+    clause.block_items.push_back(make_ast<BreakStatement>());
+    switch_statement->add_clause(std::move(clause));
+  }
+  if (otherwise != nullptr) {
+    SwitchStatement::Clause clause;
+    clause.is_default = true;
+    clause.block_items.push_back(
+        std::move(links.back()->get_else_statement()));
+    clause.block_items.push_back(make_ast<BreakStatement>());
+    switch_statement->add_clause(std::move(clause));
+  }
+  return switch_statement;
+}
+}  // namespace ntc
@@ -0,0 +1,32 @@
+// -fif-to-switch: chains of if / else if that compare one integer or char
+// variable against distinct literals become a switch, so codegen can emit a
+// jump table or a balanced compare tree instead of a linear test sequence
+#pragma once
+#include <map>
+#include <string>
+#include "walker.hpp"
+namespace ntc {
+class SwitchConverter final : public ASTWalker {
+ public:
+  // shorter chains are left alone, a couple of compares beat a switch
+  explicit SwitchConverter(int min_cases = 3);
+
+  using ASTWalker::visit;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  virtual void visit(CompoundStatement& compound_statement) override;
+
+  int get_converted() const { return converted_; }
+
+ private:
+  // the switch equivalent of if_statement, nullptr if it has another form
+  std::unique_ptr<SwitchStatement> convert(IfStatement& if_statement);
+
+  int min_cases_;
+  int converted_;
+  // plain variables of the current function, UNDEFINED for names declared
+  // more than once with different types
+  std::map<std::string, type::Specifier> variables_;
+};
+}  // namespace ntc
@@ -25,11 +25,52 @@ namespace ntc
       return prefix + "bool";
     case Specifier::STRING:
       return prefix + "string";
+    case Specifier::UINT:
+      return prefix + "unsigned int";
+    case Specifier::ULONG:
+      return prefix + "unsigned long";
+    case Specifier::INT4:
+      return prefix + "int4";
+    case Specifier::INT8:
+      return prefix + "int8";
+    case Specifier::LONG2:
+      return prefix + "long2";
+    case Specifier::LONG4:
+      return prefix + "long4";
+    case Specifier::FLOAT4:
+      return prefix + "float4";
+    case Specifier::FLOAT8:
+      return prefix + "float8";
+    case Specifier::DOUBLE2:
+      return prefix + "double2";
+    case Specifier::DOUBLE4:
+      return prefix + "double4";
     default:
       return prefix + "undefined";
     }
   }
 
+  bool is_vector(Specifier specifier) {
+    switch (specifier)
+    {
+    case Specifier::INT4:
+    case Specifier::INT8:
+    case Specifier::LONG2:
+    case Specifier::LONG4:
+    case Specifier::FLOAT4:
+    case Specifier::FLOAT8:
+    case Specifier::DOUBLE2:
+    case Specifier::DOUBLE4:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool is_unsigned(Specifier specifier) {
+    return specifier == Specifier::UINT || specifier == Specifier::ULONG;
+  }
+
   std::string to_string(BinaryOp op) {
     static std::string prefix("BinaryOp::");
     switch (op)
@@ -60,6 +101,16 @@ namespace ntc
       return prefix + "LOGIC_OR";
     case BinaryOp::LOGIC_AND:
       return prefix + "LOGIC_AND";
+    case BinaryOp::SHIFT_LEFT:
+      return prefix + "SHIFT_LEFT";
+    case BinaryOp::SHIFT_RIGHT:
+      return prefix + "SHIFT_RIGHT";
+    case BinaryOp::BIT_AND:
+      return prefix + "BIT_AND";
+    case BinaryOp::BIT_XOR:
+      return prefix + "BIT_XOR";
+    case BinaryOp::BIT_OR:
+      return prefix + "BIT_OR";
     case BinaryOp::ASSIGN:
       return prefix + "ASSIGN";
     default:
@@ -77,10 +128,46 @@ namespace ntc
       return prefix + "NEGATE";
     case UnaryOp::LOGIC_NOT:
       return prefix + "LOGIC_NOT";
+    case UnaryOp::BIT_NOT:
+      return prefix + "BIT_NOT";
     default:
       return prefix + "UNKNWON";
     }
   } 
+
+  std::string to_string(FunctionQualifier qualifier) {
+    switch (qualifier)
+    {
+    case FunctionQualifier::MEMO:
+      return "memo";
+    case FunctionQualifier::HOT:
+      return "hot";
+    case FunctionQualifier::COLD:
+      return "cold";
+    case FunctionQualifier::STATIC:
+      return "static";
+    case FunctionQualifier::INLINE:
+      return "inline";
+    case FunctionQualifier::EXPORT:
+      return "export";
+    default:
+      return "unknown";
+    }
+  }
+
+  std::string to_string(Schedule schedule) {
+    switch (schedule)
+    {
+    case Schedule::STATIC:
+      return "static";
+    case Schedule::DYNAMIC:
+      return "dynamic";
+    case Schedule::GUIDED:
+      return "guided";
+    default:
+      return "unknown";
+    }
+  }
   } // namespace type
   
 } // namespace ntc
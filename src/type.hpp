@@ -13,6 +13,17 @@ namespace type {
     VOID,
     BOOL,
     STRING,
+    UINT,
+    ULONG,
+    // fixed width SIMD vectors, lane-wise arithmetic
+    INT4,
+    INT8,
+    LONG2,
+    LONG4,
+    FLOAT4,
+    FLOAT8,
+    DOUBLE2,
+    DOUBLE4,
   };
 
   enum class BinaryOp {
@@ -29,20 +40,51 @@ namespace type {
     NOT_EQUAL,
     LOGIC_OR,
     LOGIC_AND,
+    SHIFT_LEFT,
+    SHIFT_RIGHT,
+    BIT_AND,
+    BIT_XOR,
+    BIT_OR,
     ASSIGN
   };
 
   enum class UnaryOp {
     POSITIVIZE,
     NEGATE,
-    LOGIC_NOT
+    LOGIC_NOT,
+    BIT_NOT
+  };
+
+  enum class FunctionQualifier {
+    MEMO,
+    HOT,
+    COLD,
+    STATIC,
+    INLINE,
+    // external with a C entry point, array parameters take a length
+    EXPORT
+  };
+
+  // iteration scheduling of parallel for, values match NTRT_SCHEDULE_*
+  enum class Schedule {
+    STATIC,
+    DYNAMIC,
+    GUIDED
   };
   
   std::string to_string(Specifier specifier);
 
+  bool is_vector(Specifier specifier);
+
+  bool is_unsigned(Specifier specifier);
+
   std::string to_string(BinaryOp op);
 
   std::string to_string(UnaryOp op);
+
+  std::string to_string(FunctionQualifier qualifier);
+
+  std::string to_string(Schedule schedule);
 }
 
 }  // namespace ntc
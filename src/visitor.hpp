@@ -6,6 +6,7 @@ class BlockItem;
 class ExternalDeclaration;
 class TranslationUnit;
 class FunctionDefinition;
+class FunctionDeclaration;
 class DeclarationSpecifier;
 class Identifier;
 class ParameterDeclaration;
@@ -20,9 +21,14 @@ class ExpressionStatement;
 class ReturnStatement;
 class BreakStatement;
 class ContinueStatement;
+class BecomeStatement;
+class SyncStatement;
+class TraceSpanStatement;
 class IfStatement;
+class SwitchStatement;
 class WhileStatement;
 class ForStatement;
+class ParallelForStatement;
 
 class Expression;
 class IntegerExpression;
@@ -34,6 +40,7 @@ class BinaryOperationExpression;
 class UnaryOperationExpression;
 class ConditionalExpression;
 class FunctionCall;
+class SpawnExpression;
 class ArrayReference;
 
 class ASTVisitor {
@@ -44,6 +51,7 @@ class ASTVisitor {
   virtual void visit(ExternalDeclaration&) = 0;
   virtual void visit(TranslationUnit&) = 0;
   virtual void visit(FunctionDefinition&) = 0;
+  virtual void visit(FunctionDeclaration&) = 0;
   virtual void visit(DeclarationSpecifier&) = 0;
   virtual void visit(Identifier&) = 0;
   virtual void visit(ParameterDeclaration&) = 0;
@@ -58,9 +66,14 @@ class ASTVisitor {
   virtual void visit(ReturnStatement&) = 0;
   virtual void visit(BreakStatement&) = 0;
   virtual void visit(ContinueStatement&) = 0;
+  virtual void visit(BecomeStatement&) = 0;
+  virtual void visit(SyncStatement&) = 0;
+  virtual void visit(TraceSpanStatement&) = 0;
   virtual void visit(IfStatement&) = 0;
+  virtual void visit(SwitchStatement&) = 0;
   virtual void visit(WhileStatement&) = 0;
   virtual void visit(ForStatement&) = 0;
+  virtual void visit(ParallelForStatement&) = 0;
 
   virtual void visit(Expression&) = 0;
   virtual void visit(IntegerExpression&) = 0;
@@ -72,6 +85,7 @@ class ASTVisitor {
   virtual void visit(UnaryOperationExpression&) = 0;
   virtual void visit(ConditionalExpression&) = 0;
   virtual void visit(FunctionCall&) = 0;
+  virtual void visit(SpawnExpression&) = 0;
   virtual void visit(ArrayReference&) = 0;
 };
 
@@ -83,6 +97,7 @@ class IRVisitor {
   virtual llvm::Value* visit(ExternalDeclaration&) = 0;
   virtual llvm::Value* visit(TranslationUnit&) = 0;
   virtual llvm::Value* visit(FunctionDefinition&) = 0;
+  virtual llvm::Value* visit(FunctionDeclaration&) = 0;
   virtual llvm::Value* visit(DeclarationSpecifier&) = 0;
   virtual llvm::Value* visit(Identifier&) = 0;
   virtual llvm::Value* visit(ParameterDeclaration&) = 0;
@@ -96,9 +111,14 @@ class IRVisitor {
   virtual llvm::Value* visit(ReturnStatement&) = 0;
   virtual llvm::Value* visit(BreakStatement&) = 0;
   virtual llvm::Value* visit(ContinueStatement&) = 0;
+  virtual llvm::Value* visit(BecomeStatement&) = 0;
+  virtual llvm::Value* visit(SyncStatement&) = 0;
+  virtual llvm::Value* visit(TraceSpanStatement&) = 0;
   virtual llvm::Value* visit(IfStatement&) = 0;
+  virtual llvm::Value* visit(SwitchStatement&) = 0;
   virtual llvm::Value* visit(WhileStatement&) = 0;
   virtual llvm::Value* visit(ForStatement&) = 0;
+  virtual llvm::Value* visit(ParallelForStatement&) = 0;
   virtual llvm::Value* visit(Expression&) = 0;
   virtual llvm::Value* visit(IntegerExpression&) = 0;
   virtual llvm::Value* visit(FloatExpression&) = 0;
@@ -109,6 +129,7 @@ class IRVisitor {
   virtual llvm::Value* visit(UnaryOperationExpression&) = 0;
   virtual llvm::Value* visit(ConditionalExpression&) = 0;
   virtual llvm::Value* visit(FunctionCall&) = 0;
+  virtual llvm::Value* visit(SpawnExpression&) = 0;
   virtual llvm::Value* visit(ArrayReference&) = 0;
 };
 }  // namespace ntc
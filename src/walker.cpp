@@ -0,0 +1,243 @@
+#include "walker.hpp"
+namespace ntc {
+void ASTWalker::visit(AST& ast) { ast.accept(*this); }
+
+void ASTWalker::visit(BlockItem& block_item) { block_item.accept(*this); }
+
+void ASTWalker::visit(ExternalDeclaration& external_declaration) {
+  external_declaration.accept(*this);
+}
+
+void ASTWalker::visit(TranslationUnit& translation_unit) {
+  enter(translation_unit);
+  for (auto& decl : translation_unit.get_declarations()) {
+    visit(*decl);
+  }
+}
+
+void ASTWalker::visit(FunctionDefinition& function_definition) {
+  enter(function_definition);
+  visit(*(function_definition.get_declaration_specifier()));
+  visit(*(function_definition.get_identifier()));
+  for (auto& parameter : function_definition.get_parameter_list()) {
+    visit(*parameter);
+  }
+  visit(*(function_definition.get_compound_statement()));
+}
+
+void ASTWalker::visit(FunctionDeclaration& function_declaration) {
+  enter(function_declaration);
+}
+
+void ASTWalker::visit(DeclarationSpecifier& declaration_specifier) {
+  enter(declaration_specifier);
+  auto& type_specifier = declaration_specifier.get_type_specifier();
+  if (type_specifier != nullptr) {
+    visit(*type_specifier);
+  }
+}
+
+void ASTWalker::visit(Identifier& identifier) { enter(identifier); }
+
+void ASTWalker::visit(ParameterDeclaration& parameter_declaration) {
+  enter(parameter_declaration);
+  visit(*(parameter_declaration.get_declaration_specifier()));
+  visit(*(parameter_declaration.get_declarator()));
+}
+
+void ASTWalker::visit(TypeSpecifier& type_specifier) { enter(type_specifier); }
+
+void ASTWalker::visit(Declaration& declaration) {
+  enter(declaration);
+  visit(*(declaration.get_declaration_specifier()));
+  visit(*(declaration.get_declarator()));
+  auto& initializer = declaration.get_initializer();
+  if (initializer != nullptr) {
+    visit(*initializer);
+  }
+}
+
+void ASTWalker::visit(Initializer& initializer) {
+  enter(initializer);
+  visit(*(initializer.get_expression()));
+}
+
+void ASTWalker::visit(Declarator& declarator) {
+  enter(declarator);
+  visit(*(declarator.get_identifier()));
+}
+
+void ASTWalker::visit(Statement& statement) { statement.accept(*this); }
+
+void ASTWalker::visit(CompoundStatement& compound_statement) {
+  enter(compound_statement);
+  for (auto& block_item : compound_statement.get_block_item_list()) {
+    visit(*block_item);
+  }
+}
+
+void ASTWalker::visit(ExpressionStatement& expression_statement) {
+  enter(expression_statement);
+  auto& expression = expression_statement.get_expression();
+  if (expression != nullptr) {
+    visit(*expression);
+  }
+}
+
+void ASTWalker::visit(ReturnStatement& return_statement) {
+  enter(return_statement);
+  auto& expression = return_statement.get_expression();
+  if (expression != nullptr) {
+    visit(*expression);
+  }
+}
+
+void ASTWalker::visit(BreakStatement& break_statement) {
+  enter(break_statement);
+}
+
+void ASTWalker::visit(ContinueStatement& continue_statement) {
+  enter(continue_statement);
+}
+
+void ASTWalker::visit(SyncStatement& sync_statement) {
+  enter(sync_statement);
+}
+
+void ASTWalker::visit(TraceSpanStatement& trace_span_statement) {
+  enter(trace_span_statement);
+  visit(*(trace_span_statement.get_body()));
+}
+
+void ASTWalker::visit(BecomeStatement& become_statement) {
+  enter(become_statement);
+  visit(*(become_statement.get_function_call()));
+}
+
+void ASTWalker::visit(IfStatement& if_statement) {
+  enter(if_statement);
+  visit(*(if_statement.get_if_expression()));
+  visit(*(if_statement.get_then_statment()));
+  auto& else_statement = if_statement.get_else_statement();
+  if (else_statement != nullptr) {
+    visit(*else_statement);
+  }
+}
+
+void ASTWalker::visit(SwitchStatement& switch_statement) {
+  enter(switch_statement);
+  visit(*(switch_statement.get_expression()));
+  for (auto& clause : switch_statement.get_clauses()) {
+    for (auto& value : clause.values) {
+      visit(*value);
+    }
+    for (auto& block_item : clause.block_items) {
+      visit(*block_item);
+    }
+  }
+}
+
+void ASTWalker::visit(WhileStatement& while_statement) {
+  enter(while_statement);
+  visit(*(while_statement.get_while_expression()));
+  visit(*(while_statement.get_loop_statement()));
+}
+
+void ASTWalker::visit(ForStatement& for_statement) {
+  enter(for_statement);
+  visit(*(for_statement.get_init_clause()));
+  visit(*(for_statement.get_cond_expression()));
+  auto& iteration_expression = for_statement.get_iteration_expression();
+  if (iteration_expression != nullptr) {
+    visit(*iteration_expression);
+  }
+  visit(*(for_statement.get_loop_statement()));
+}
+
+void ASTWalker::visit(ParallelForStatement& parallel_for_statement) {
+  enter(parallel_for_statement);
+  auto& chunk = parallel_for_statement.get_chunk();
+  if (chunk != nullptr) {
+    visit(*chunk);
+  }
+  visit(*(parallel_for_statement.get_for_statement()));
+}
+
+void ASTWalker::visit(Expression& expression) { expression.accept(*this); }
+
+void ASTWalker::visit(IntegerExpression& integer_expression) {
+  enter(integer_expression);
+}
+
+void ASTWalker::visit(FloatExpression& float_expression) {
+  enter(float_expression);
+}
+
+void ASTWalker::visit(BooleanExpression& boolean_expression) {
+  enter(boolean_expression);
+}
+
+void ASTWalker::visit(CharacterExpression& character_expression) {
+  enter(character_expression);
+}
+
+void ASTWalker::visit(StringLiteralExpression& string_literal_expression) {
+  enter(string_literal_expression);
+}
+
+void ASTWalker::visit(BinaryOperationExpression& binary_operation_expression) {
+  enter(binary_operation_expression);
+  visit(*(binary_operation_expression.get_lhs()));
+  visit(*(binary_operation_expression.get_rhs()));
+}
+
+void ASTWalker::visit(UnaryOperationExpression& unary_operation_expression) {
+  enter(unary_operation_expression);
+  visit(*(unary_operation_expression.get_operand()));
+}
+
+void ASTWalker::visit(ConditionalExpression& conditional_expression) {
+  enter(conditional_expression);
+  visit(*(conditional_expression.get_cond_expression()));
+  visit(*(conditional_expression.get_true_expression()));
+  visit(*(conditional_expression.get_false_expression()));
+}
+
+void ASTWalker::visit(FunctionCall& function_call) {
+  enter(function_call);
+  visit(*(function_call.get_target()));
+  for (auto& argument : function_call.get_argument_list()) {
+    visit(*argument);
+  }
+}
+
+void ASTWalker::visit(SpawnExpression& spawn_expression) {
+  enter(spawn_expression);
+  visit(*(spawn_expression.get_function_call()));
+}
+
+void ASTWalker::visit(ArrayReference& array_reference) {
+  enter(array_reference);
+  visit(*(array_reference.get_target()));
+  visit(*(array_reference.get_index()));
+}
+
+namespace {
+class NodeCounter final : public ASTWalker {
+ public:
+  int get_count() const { return count_; }
+
+ protected:
+  virtual void enter(AST&) override { ++count_; }
+
+ private:
+  int count_ = 0;
+};
+}  // namespace
+
+int count_nodes(AST& ast) {
+  NodeCounter counter;
+  ast.accept(counter);
+  return counter.get_count();
+}
+}  // namespace ntc
@@ -0,0 +1,98 @@
+// Default traversal for AST passes, every node visits its children so a
+// pass only overrides the nodes it cares about
+#pragma once
+#include "ast.hpp"
+#include "visitor.hpp"
+namespace ntc {
+class ASTWalker : public ASTVisitor {
+ public:
+  virtual void visit(AST& ast) override;
+
+  virtual void visit(BlockItem& block_item) override;
+
+  virtual void visit(ExternalDeclaration& external_declaration) override;
+
+  virtual void visit(TranslationUnit& translation_unit) override;
+
+  virtual void visit(FunctionDefinition& function_definition) override;
+
+  // only the node itself, passes work on function bodies
+  virtual void visit(FunctionDeclaration& function_declaration) override;
+
+  virtual void visit(DeclarationSpecifier& declaration_specifier) override;
+
+  virtual void visit(Identifier& identifier) override;
+
+  virtual void visit(ParameterDeclaration& parameter_declaration) override;
+
+  virtual void visit(TypeSpecifier& type_specifier) override;
+
+  virtual void visit(Declaration& declaration) override;
+
+  virtual void visit(Initializer& initializer) override;
+
+  virtual void visit(Declarator& declarator) override;
+
+  virtual void visit(Statement& statement) override;
+
+  virtual void visit(CompoundStatement& compound_statement) override;
+
+  virtual void visit(ExpressionStatement& expression_statement) override;
+
+  virtual void visit(ReturnStatement& return_statement) override;
+
+  virtual void visit(BreakStatement& break_statement) override;
+
+  virtual void visit(ContinueStatement& continue_statement) override;
+
+  virtual void visit(BecomeStatement& become_statement) override;
+
+  virtual void visit(SyncStatement& sync_statement) override;
+
+  virtual void visit(TraceSpanStatement& trace_span_statement) override;
+
+  virtual void visit(IfStatement& if_statement) override;
+
+  virtual void visit(SwitchStatement& switch_statement) override;
+
+  virtual void visit(WhileStatement& while_statement) override;
+
+  virtual void visit(ForStatement& for_statement) override;
+
+  virtual void visit(ParallelForStatement& parallel_for_statement) override;
+
+  virtual void visit(Expression& expression) override;
+
+  virtual void visit(IntegerExpression& integer_expression) override;
+
+  virtual void visit(FloatExpression& float_expression) override;
+
+  virtual void visit(BooleanExpression& boolean_expression) override;
+
+  virtual void visit(CharacterExpression& character_expression) override;
+
+  virtual void visit(
+      StringLiteralExpression& string_literal_expression) override;
+
+  virtual void visit(
+      BinaryOperationExpression& binary_operation_expression) override;
+
+  virtual void visit(
+      UnaryOperationExpression& unary_operation_expression) override;
+
+  virtual void visit(ConditionalExpression& conditional_expression) override;
+
+  virtual void visit(FunctionCall& function_call) override;
+
+  virtual void visit(SpawnExpression& spawn_expression) override;
+
+  virtual void visit(ArrayReference& array_reference) override;
+
+ protected:
+  // called on every node before its children are walked
+  virtual void enter(AST&) {}
+};
+
+// number of nodes in the subtree rooted at ast
+int count_nodes(AST& ast);
+}  // namespace ntc
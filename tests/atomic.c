@@ -0,0 +1,57 @@
+// four threads bump one shared counter a million times each, the mode read
+// from stdin picks how: 0 fetch_add, 1 a compare_exchange loop, 2 a plain
+// counter under lock; tools/mode_bench.sh times the three
+void add_fetch(atomic long counter[1], int n) {
+  int i;
+  for (i = 0; i < n; i = i + 1) {
+    fetch_add(counter[0], 1, relaxed);
+  }
+}
+
+void add_cas(atomic long counter[1], int n) {
+  int i;
+  long old;
+  for (i = 0; i < n; i = i + 1) {
+    old = load(counter[0], relaxed);
+    while (!compare_exchange(counter[0], old, old + 1, relaxed)) {
+      old = load(counter[0], relaxed);
+    }
+  }
+}
+
+void add_locked(atomic int mutex[1], long counter[1], int n) {
+  int i;
+  for (i = 0; i < n; i = i + 1) {
+    lock(mutex[0]);
+    counter[0] = counter[0] + 1;
+    unlock(mutex[0]);
+  }
+}
+
+int main() {
+  int mode;
+  input(mode);
+  atomic long counter[1];
+  atomic int mutex[1];
+  long plain[1];
+  long threads[4];
+  int n = 1000000;
+  int t;
+  counter[0] = 0;
+  mutex[0] = 0;
+  plain[0] = 0;
+  for (t = 0; t < 4; t = t + 1) {
+    if (mode == 0) {
+      threads[t] = thread_spawn(add_fetch, counter, n);
+    } else if (mode == 1) {
+      threads[t] = thread_spawn(add_cas, counter, n);
+    } else {
+      threads[t] = thread_spawn(add_locked, mutex, plain, n);
+    }
+  }
+  for (t = 0; t < 4; t = t + 1) {
+    thread_join(threads[t]);
+  }
+  println(load(counter[0], acquire) + plain[0]);
+  return 0;
+}
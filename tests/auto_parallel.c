@@ -0,0 +1,84 @@
+// compile with -fauto-parallel --parallel-report to see which loops are
+// taken and why the others stay serial
+int square(int x) { return x * x; }
+
+int limit(int n) {
+  println(n);
+  return n;
+}
+
+// may alias, so the loop stays serial
+void scale(double a[4096], double b[4096], int n) {
+  int i;
+  for (i = 0; i < n; i = i + 1) {
+    a[i] = b[i] * 2.0;
+  }
+}
+
+// the trip count is checked against the threshold at run time
+void scale_restrict(double a[restrict 4096], double b[restrict 4096], int n) {
+  int i;
+  for (i = 0; i < n; i = i + 1) {
+    a[i] = b[i] * 2.0;
+  }
+}
+
+int main() {
+  long a[4096];
+  long b[4096];
+  double x[4096];
+  double y[4096];
+  int i;
+  int j;
+  long t;
+  long s = 0;
+  double d = 0.0;
+  for (i = 0; i < 4096; i = i + 1) {
+    a[i] = square(i) % 1000;
+    y[i] = i;
+  }
+  // a[i - 1] was written one iteration earlier
+  for (i = 1; i < 4096; i = i + 1) {
+    a[i] = a[i - 1] + 1;
+  }
+  // even elements written, odd ones read
+  for (i = 0; i < 2048; i = i + 1) {
+    b[2 * i] = a[2 * i + 1];
+  }
+  // t is read after the loop
+  for (i = 0; i < 4096; i = i + 1) {
+    t = a[i] * 3;
+    b[i] = t + 1;
+  }
+  for (i = 0; i < 4096; i = i + 1) {
+    s = s + b[i];
+  }
+  // floating point sums depend on the order of the additions
+  for (i = 0; i < 4096; i = i + 1) {
+    d = d + 0.5;
+  }
+  for (i = 0; i < 100; i = i + 1) {
+    b[i] = 0;
+  }
+  // the bound changes with i, and evaluating it prints
+  int n = 4000;
+  for (i = 0; i < n - i; i = i + 1) {
+    b[i] = 1;
+  }
+  for (i = 0; i < limit(20); i = i + 1) {
+    b[i] = i;
+  }
+  for (i = 0; i < 4096; i = i + 1) {
+    for (j = 0; j < 4; j = j + 1) {
+      s = s + j;
+    }
+  }
+  scale(x, y, 4096);
+  scale_restrict(x, y, 10);
+  scale_restrict(x, y, 4096);
+  println(s);
+  println(t);
+  println(d);
+  println(x[4095]);
+  return 0;
+}
@@ -0,0 +1,138 @@
+// checks 131072 tic tac toe boards in a scrambled order 100 times, one in 64
+// of them holds a line; the mode read from stdin picks the version: 0 plain,
+// 1 unlikely wins reported by a cold function, 2 also prefetching the boards
+// ahead; tools/mode_bench.sh times them
+int check_win(int boards[1179648], int b) {
+  if (boards[b] != 0 && boards[b] == boards[b + 1] &&
+      boards[b + 1] == boards[b + 2]) {
+    return boards[b];
+  }
+  if (boards[b + 3] != 0 && boards[b + 3] == boards[b + 4] &&
+      boards[b + 4] == boards[b + 5]) {
+    return boards[b + 3];
+  }
+  if (boards[b + 6] != 0 && boards[b + 6] == boards[b + 7] &&
+      boards[b + 7] == boards[b + 8]) {
+    return boards[b + 6];
+  }
+  if (boards[b] != 0 && boards[b] == boards[b + 3] &&
+      boards[b + 3] == boards[b + 6]) {
+    return boards[b];
+  }
+  if (boards[b + 1] != 0 && boards[b + 1] == boards[b + 4] &&
+      boards[b + 4] == boards[b + 7]) {
+    return boards[b + 1];
+  }
+  if (boards[b + 2] != 0 && boards[b + 2] == boards[b + 5] &&
+      boards[b + 5] == boards[b + 8]) {
+    return boards[b + 2];
+  }
+  if (boards[b] != 0 && boards[b] == boards[b + 4] &&
+      boards[b + 4] == boards[b + 8]) {
+    return boards[b];
+  }
+  if (boards[b + 2] != 0 && boards[b + 2] == boards[b + 4] &&
+      boards[b + 4] == boards[b + 6]) {
+    return boards[b + 2];
+  }
+  return 0;
+}
+
+int check_win_hinted(int boards[1179648], int b) {
+  if (unlikely(boards[b] != 0 && boards[b] == boards[b + 1] &&
+               boards[b + 1] == boards[b + 2])) {
+    return boards[b];
+  }
+  if (unlikely(boards[b + 3] != 0 && boards[b + 3] == boards[b + 4] &&
+               boards[b + 4] == boards[b + 5])) {
+    return boards[b + 3];
+  }
+  if (unlikely(boards[b + 6] != 0 && boards[b + 6] == boards[b + 7] &&
+               boards[b + 7] == boards[b + 8])) {
+    return boards[b + 6];
+  }
+  if (unlikely(boards[b] != 0 && boards[b] == boards[b + 3] &&
+               boards[b + 3] == boards[b + 6])) {
+    return boards[b];
+  }
+  if (unlikely(boards[b + 1] != 0 && boards[b + 1] == boards[b + 4] &&
+               boards[b + 4] == boards[b + 7])) {
+    return boards[b + 1];
+  }
+  if (unlikely(boards[b + 2] != 0 && boards[b + 2] == boards[b + 5] &&
+               boards[b + 5] == boards[b + 8])) {
+    return boards[b + 2];
+  }
+  if (unlikely(boards[b] != 0 && boards[b] == boards[b + 4] &&
+               boards[b + 4] == boards[b + 8])) {
+    return boards[b];
+  }
+  if (unlikely(boards[b + 2] != 0 && boards[b + 2] == boards[b + 4] &&
+               boards[b + 4] == boards[b + 6])) {
+    return boards[b + 2];
+  }
+  return 0;
+}
+
+void record(int wins[3], int winner) {
+  wins[winner] = wins[winner] + 1;
+}
+
+cold void record_cold(int wins[3], int winner) {
+  wins[winner] = wins[winner] + 1;
+}
+
+int main() {
+  int mode;
+  input(mode);
+  int n = 131072;
+  int boards[1179648];
+  int wins[3];
+  int i;
+  unsigned hash;
+  // a drawn board, one in 64 gets the centre that completes a diagonal
+  for (i = 0; i < n; i = i + 1) {
+    boards[i * 9] = 1;
+    boards[i * 9 + 1] = 2;
+    boards[i * 9 + 2] = 1;
+    boards[i * 9 + 3] = 1;
+    boards[i * 9 + 4] = 2;
+    boards[i * 9 + 5] = 2;
+    boards[i * 9 + 6] = 2;
+    boards[i * 9 + 7] = 1;
+    boards[i * 9 + 8] = 1;
+    hash = i * 0x9e3779b1;
+    if ((hash >> 26) == 0) {
+      boards[i * 9 + 4] = 1;
+    }
+  }
+  wins[0] = 0;
+  wins[1] = 0;
+  wins[2] = 0;
+  int pass;
+  int k;
+  int b;
+  int winner;
+  for (pass = 0; pass < 100; pass = pass + 1) {
+    for (k = 0; k < n; k = k + 1) {
+      // an odd multiplier modulo a power of two visits every board once
+      b = ((k * 40503) & (n - 1)) * 9;
+      if (mode == 0) {
+        winner = check_win(boards, b);
+        if (winner != 0) {
+          record(wins, winner);
+        }
+      } else {
+        if (mode == 2) {
+          prefetch(boards[(((k + 16) * 40503) & (n - 1)) * 9]);
+        }
+        winner = check_win_hinted(boards, b);
+        if (unlikely(winner != 0)) {
+          record_cold(wins, winner);
+        }
+      }
+    }
+  }
+  println(wins[1]);
+  return 0;
+}
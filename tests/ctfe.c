@@ -0,0 +1,27 @@
+int fib(int n) {
+  if (n < 2) {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+int square_sum(int n) {
+  int squares[64];
+  int i;
+  int sum = 0;
+  for (i = 0; i < n; i = i + 1) {
+    squares[i] = i * i;
+  }
+  for (i = 0; i < n; i = i + 1) {
+    sum = sum + squares[i];
+  }
+  return sum;
+}
+
+int main() {
+  constexpr int table_size = fib(12);
+  int checksum = square_sum(40);
+  println(table_size);
+  println(checksum);
+  return 0;
+}
@@ -1,6 +1,6 @@
 int rand(int seed) { return (35121 * seed + 56437) % 56437; }
 
-int dot(int in1[9], int in2[9], int out[9], int n) {
+int dot(int in1[restrict 9], int in2[restrict 9], int out[restrict 9], int n) {
   int i = 0;
   for (i = 0; i < n; i = i + 1) {
     out[i] = in1[i] * in2[i];
@@ -0,0 +1,53 @@
+// hashes fifty million keys, the mode read from stdin picks the function:
+// 0 FNV-1a over the four key bytes, 1 the murmur3 mixing of a 32 bit block;
+// tools/mode_bench.sh times the two
+unsigned fnv1a(unsigned key) {
+  unsigned hash = 0x811c9dc5;
+  int i;
+  for (i = 0; i < 32; i = i + 8) {
+    hash = (hash ^ ((key >> i) & 0xff)) * 0x01000193;
+  }
+  return hash;
+}
+
+unsigned murmur3(unsigned key) {
+  unsigned k = rotl(key * 0xcc9e2d51, 15) * 0x1b873593;
+  unsigned hash = rotl(k, 13) * 5 + 0xe6546b64;
+  hash = hash ^ 4;
+  hash = (hash ^ (hash >> 16)) * 0x85ebca6b;
+  hash = (hash ^ (hash >> 13)) * 0xc2b2ae35;
+  return hash ^ (hash >> 16);
+}
+
+int main() {
+  int mode;
+  input(mode);
+  int n = 50000000;
+  int i;
+  unsigned hash;
+  unsigned mixed = 0;
+  long bits = 0;
+  int zeros = 0;
+  for (i = 0; i < n; i = i + 1) {
+    if (mode == 0) {
+      hash = fnv1a(i);
+    } else {
+      hash = murmur3(i);
+    }
+    // a checksum of the hashes, the bit count and the longest run of
+    // leading zeros show how evenly they spread
+    mixed = rotl(mixed, 5) ^ hash;
+    bits = bits + popcount(hash);
+    zeros = max(zeros, clz(hash));
+  }
+  println(mixed);
+  println(bits);
+  println(zeros);
+  // unsigned variables print without a sign
+  unsigned top = 0xffffffff;
+  unsigned long wide = top;
+  wide = wide * 3;
+  println(top);
+  println(wide);
+  return 0;
+}
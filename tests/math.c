@@ -0,0 +1,68 @@
+// distances and gaussian weights of 4096 points, 5000 times, the mode read
+// from stdin picks the square root: 0 a hand-rolled Newton iteration, 1 the
+// sqrt builtin; tools/mode_bench.sh times them. Building with -O3
+// -march=native also vectorizes the exp loop through libmvec
+double newton_sqrt(double x) {
+  if (x <= 0) {
+    return 0;
+  }
+  double r = x;
+  int i;
+  for (i = 0; i < 30; i = i + 1) {
+    r = 0.5 * (r + x / r);
+  }
+  return r;
+}
+
+void distances_newton(double x[4096], double y[4096], double d[4096]) {
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    d[i] = newton_sqrt(x[i] * x[i] + y[i] * y[i]);
+  }
+}
+
+void distances(double x[4096], double y[4096], double d[4096]) {
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    d[i] = sqrt(fma(x[i], x[i], y[i] * y[i]));
+  }
+}
+
+void weights(double d[4096], double w[4096]) {
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    w[i] = exp(0 - 0.5 * d[i] * d[i]);
+  }
+}
+
+int main() {
+  int mode;
+  input(mode);
+  double x[4096];
+  double y[4096];
+  double d[4096];
+  double w[4096];
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    x[i] = (i % 64) * 0.0625;
+    y[i] = (i / 64) * 0.0625;
+  }
+  double total = 0;
+  int r;
+  for (r = 0; r < 5000; r = r + 1) {
+    x[r % 4096] = (r % 64) * 0.0625;
+    if (mode == 0) {
+      distances_newton(x, y, d);
+    } else {
+      distances(x, y, d);
+    }
+    weights(d, w);
+    total = total + d[r % 4096] + w[r % 4096];
+  }
+  println(total);
+
+  // folded at compile time
+  println(sqrt(2.0));
+  println(max(floor(2.5), 1) + min(3, 7) + abs(0 - 4));
+  return 0;
+}
@@ -0,0 +1,27 @@
+memo int fib(int n) {
+  if (n <= 1) {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+memo long binomial(int n, int k) {
+  if (k == 0) {
+    return 1;
+  }
+  if (k == n) {
+    return 1;
+  }
+  return binomial(n - 1, k - 1) + binomial(n - 1, k);
+}
+
+int main() {
+  int n;
+  println("Please input a number between 0 to 45");
+  input(n);
+  println(fib(n));
+  if (binomial(2 * n, n) > 0) {
+    println("binomial ok");
+  }
+  return 0;
+}
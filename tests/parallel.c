@@ -0,0 +1,62 @@
+// run with NTRT_NUM_THREADS=1..N, see tools/parallel_scaling.sh
+bool is_prime(int n) {
+  if (n < 2) {
+    return false;
+  }
+  int d = 2;
+  while (d * d <= n) {
+    if (n % d == 0) {
+      return false;
+    }
+    d = d + 1;
+  }
+  return true;
+}
+
+// trial division gets slower towards the end, dynamic chunks balance it
+long count_primes(int n) {
+  long count = 0;
+  int i;
+  parallel schedule(dynamic, 256) reduce(+: count)
+  for (i = 0; i < n; i = i + 1) {
+    if (is_prime(i)) {
+      count = count + 1;
+    }
+  }
+  return count;
+}
+
+double dot(int n) {
+  double x[4096];
+  double y[4096];
+  double sum = 0.0;
+  int i;
+  parallel for (i = 0; i < n; i = i + 1) {
+    x[i] = 0.5;
+    y[i] = 2.0;
+  }
+  parallel schedule(guided) reduce(+: sum)
+  for (i = 0; i < n; i = i + 1) {
+    sum = sum + x[i] * y[i];
+  }
+  return sum;
+}
+
+long checksum(int n) {
+  long product = 1;
+  long total = 0;
+  int i;
+  parallel schedule(static, 3) reduce(*: product) reduce(+: total)
+  for (i = 1; i <= n; i = i + 2) {
+    product = product * 2;
+    total = total + i;
+  }
+  return product + total;
+}
+
+int main() {
+  println(count_primes(3000000));
+  println(dot(4096));
+  println(checksum(25));
+  return 0;
+}
@@ -0,0 +1,87 @@
+// self tail calls and accumulators become loops at -O 1 and above, become
+// is a tail call at every level, so only the become cases recurse deeply
+long factorial(int n) {
+  if (n <= 1) {
+    return 1;
+  }
+  return n * factorial(n - 1);
+}
+
+long sum_to(long n, long acc) {
+  if (n == 0) {
+    return acc;
+  }
+  return sum_to(n - 1, acc + n);
+}
+
+long sum_down(long n, long acc) {
+  if (n == 0) {
+    return acc;
+  }
+  become sum_down(n - 1, acc + n);
+}
+
+int gcd(int a, int b) {
+  if (b == 0) {
+    return a;
+  }
+  return gcd(b, a % b);
+}
+
+long fib(int n) {
+  if (n < 2) {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+long tribonacci(int n) {
+  if (n < 2) {
+    return 0;
+  }
+  if (n == 2) {
+    return 1;
+  }
+  return tribonacci(n - 1) + tribonacci(n - 2) + tribonacci(n - 3);
+}
+
+long collatz_steps(long n, long steps) {
+  if (n == 1) {
+    return steps;
+  }
+  if (n % 2 == 0) {
+    become collatz_steps(n / 2, steps + 1);
+  }
+  become collatz_steps(3 * n + 1, steps + 1);
+}
+
+unsigned long total(long n, unsigned x) {
+  if (n == 0) {
+    return 0;
+  }
+  return x + total(n - 1, x);
+}
+
+long sum_from_zero(long n, long acc) {
+  become sum_down(n, acc);
+}
+
+int main() {
+  long modulus = 1000000007;
+  long n = 10000;
+  long deep = 10000000;
+  long zero = 0;
+  long start = 27;
+  println(factorial(20) % modulus);
+  println(sum_to(n, zero) % modulus);
+  println(gcd(1071, 462));
+  println(fib(30));
+  println(tribonacci(30));
+  println(collatz_steps(start, zero));
+  println(sum_down(deep, zero) % modulus);
+  println(sum_from_zero(deep, zero) % modulus);
+  unsigned x = 0xffffffff;
+  long three = 3;
+  println(total(three, x));
+  return 0;
+}
@@ -0,0 +1,75 @@
+// dot product of two 4096 element arrays, repeated 20000 times, the mode
+// read from stdin picks the version: 0 scalar, 1 double4 lanes, 2 float8
+// lanes; tools/mode_bench.sh times them
+double dot_scalar(double a[4096], double b[4096]) {
+  double sum = 0;
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    sum = sum + a[i] * b[i];
+  }
+  return sum;
+}
+
+// two accumulators hide the latency of the vector add
+double dot_double4(double a[4096], double b[4096]) {
+  double4 even = 0;
+  double4 odd = 0;
+  int i;
+  for (i = 0; i < 4096; i = i + 8) {
+    even = even + vload4(a, i) * vload4(b, i);
+    odd = odd + vload4(a, i + 4) * vload4(b, i + 4);
+  }
+  return reduce_add(even + odd);
+}
+
+float dot_float8(float a[4096], float b[4096]) {
+  float8 sum = 0;
+  int i;
+  for (i = 0; i < 4096; i = i + 8) {
+    sum = sum + vload8(a, i) * vload8(b, i);
+  }
+  return reduce_add(sum);
+}
+
+int main() {
+  int mode;
+  input(mode);
+  double a[4096];
+  double b[4096];
+  float af[4096];
+  float bf[4096];
+  int i;
+  for (i = 0; i < 4096; i = i + 1) {
+    a[i] = (i % 7) * 0.25;
+    b[i] = (i % 5) * 0.5;
+    af[i] = a[i];
+    bf[i] = b[i];
+  }
+  double total = 0;
+  int r;
+  for (r = 0; r < 20000; r = r + 1) {
+    // keeps the calls from being hoisted out of the loop
+    a[r % 4096] = r % 3;
+    af[r % 4096] = a[r % 4096];
+    if (mode == 0) {
+      total = total + dot_scalar(a, b);
+    } else if (mode == 1) {
+      total = total + dot_double4(a, b);
+    } else {
+      total = total + dot_float8(af, bf);
+    }
+  }
+  println(total);
+
+  // lane-wise operators, masks and shuffles
+  int4 v = broadcast4(3);
+  v[1] = 7;
+  int4 mask = v > 4;
+  println(mask[1] + mask[0]);
+  int8 w = shuffle(v, v * 2, 0, 1, 2, 3, 4, 5, 6, 7);
+  println(reduce_max(w) + reduce_min(-w));
+  long five = 5;
+  long2 l = shuffle(broadcast4(five), 0, 1);
+  println(l[0]);
+  return 0;
+}
@@ -0,0 +1,74 @@
+// fib(35) with and without spawn, NTRT_NUM_THREADS sets the pool size
+long fib(long n) {
+  if (n < 2) {
+    return n;
+  }
+  long x;
+  long y;
+  x = spawn fib(n - 1);
+  y = fib(n - 2);
+  sync;
+  return x + y;
+}
+
+// the serial elision of fib
+long fib_serial(long n) {
+  if (n < 2) {
+    return n;
+  }
+  long x;
+  long y;
+  x = fib_serial(n - 1);
+  y = fib_serial(n - 2);
+  return x + y;
+}
+
+long sum(long a[1024], int lo, int hi) {
+  if (hi - lo <= 16) {
+    long total = 0;
+    int i;
+    for (i = lo; i < hi; i = i + 1) {
+      total = total + a[i];
+    }
+    return total;
+  }
+  int mid = (lo + hi) / 2;
+  long left;
+  long right;
+  left = spawn sum(a, lo, mid);
+  right = spawn sum(a, mid, hi);
+  sync;
+  return left + right;
+}
+
+void fill(long a[1024], int lo, int hi) {
+  int i;
+  for (i = lo; i < hi; i = i + 1) {
+    a[i] = i * i;
+  }
+}
+
+int main() {
+  long a[1024];
+  int i;
+  // one task per block, the records stay alive until the implicit sync
+  for (i = 0; i < 1024; i = i + 64) {
+    spawn fill(a, i, i + 64);
+  }
+  sync;
+  println(sum(a, 0, 1024));
+  // a million spawns in one frame, each sync frees the records of the
+  // iterations before it
+  long total = 0;
+  for (i = 0; i < 1000000; i = i + 1) {
+    long part;
+    part = spawn sum(a, i % 960, i % 960 + 64);
+    sync;
+    total = total + part;
+  }
+  println(total);
+  long n = 35;
+  println(fib(n));
+  println(fib_serial(n));
+  return 0;
+}
@@ -0,0 +1,164 @@
+// a small stack machine sums (i % 7) * (i % 7) for i from a million down to
+// one, ten times over; the mode read from stdin picks the dispatch: 0 an
+// if / else if chain on the opcode, 1 a switch; -fif-to-switch turns the
+// first into the second, tools/mode_bench.sh times the two
+int run_if(int code[32], int stack[16]) {
+  int pc = 0;
+  int sp = 0;
+  int op;
+  int top;
+  while (true) {
+    op = code[pc];
+    if (op == 0) {
+      stack[sp] = code[pc + 1];
+      sp = sp + 1;
+      pc = pc + 2;
+    } else if (op == 1) {
+      sp = sp - 1;
+      stack[sp - 1] = stack[sp - 1] + stack[sp];
+      pc = pc + 1;
+    } else if (op == 2) {
+      sp = sp - 1;
+      stack[sp - 1] = stack[sp - 1] - stack[sp];
+      pc = pc + 1;
+    } else if (op == 3) {
+      sp = sp - 1;
+      stack[sp - 1] = stack[sp - 1] * stack[sp];
+      pc = pc + 1;
+    } else if (op == 4) {
+      sp = sp - 1;
+      stack[sp - 1] = stack[sp - 1] % stack[sp];
+      pc = pc + 1;
+    } else if (op == 5) {
+      stack[sp] = stack[sp - 1];
+      sp = sp + 1;
+      pc = pc + 1;
+    } else if (op == 6) {
+      top = stack[sp - 1];
+      stack[sp - 1] = stack[sp - 2];
+      stack[sp - 2] = top;
+      pc = pc + 1;
+    } else if (op == 7) {
+      top = stack[sp - 3];
+      stack[sp - 3] = stack[sp - 2];
+      stack[sp - 2] = stack[sp - 1];
+      stack[sp - 1] = top;
+      pc = pc + 1;
+    } else if (op == 8) {
+      sp = sp - 1;
+      if (stack[sp] != 0) {
+        pc = code[pc + 1];
+      } else {
+        pc = pc + 2;
+      }
+    } else if (op == 9) {
+      sp = sp - 1;
+      pc = pc + 1;
+    } else {
+      return stack[sp - 1];
+    }
+  }
+  return 0;
+}
+
+int run_switch(int code[32], int stack[16]) {
+  int pc = 0;
+  int sp = 0;
+  int top;
+  while (true) {
+    switch (code[pc]) {
+      case 0:
+        stack[sp] = code[pc + 1];
+        sp = sp + 1;
+        pc = pc + 2;
+        break;
+      case 1:
+        sp = sp - 1;
+        stack[sp - 1] = stack[sp - 1] + stack[sp];
+        pc = pc + 1;
+        break;
+      case 2:
+        sp = sp - 1;
+        stack[sp - 1] = stack[sp - 1] - stack[sp];
+        pc = pc + 1;
+        break;
+      case 3:
+        sp = sp - 1;
+        stack[sp - 1] = stack[sp - 1] * stack[sp];
+        pc = pc + 1;
+        break;
+      case 4:
+        sp = sp - 1;
+        stack[sp - 1] = stack[sp - 1] % stack[sp];
+        pc = pc + 1;
+        break;
+      case 5:
+        stack[sp] = stack[sp - 1];
+        sp = sp + 1;
+        pc = pc + 1;
+        break;
+      case 6:
+        top = stack[sp - 1];
+        stack[sp - 1] = stack[sp - 2];
+        stack[sp - 2] = top;
+        pc = pc + 1;
+        break;
+      case 7:
+        top = stack[sp - 3];
+        stack[sp - 3] = stack[sp - 2];
+        stack[sp - 2] = stack[sp - 1];
+        stack[sp - 1] = top;
+        pc = pc + 1;
+        break;
+      case 8:
+        sp = sp - 1;
+        if (stack[sp] != 0) {
+          pc = code[pc + 1];
+        } else {
+          pc = pc + 2;
+        }
+        break;
+      case 9:
+        sp = sp - 1;
+        pc = pc + 1;
+        break;
+      default:
+        return stack[sp - 1];
+    }
+  }
+  return 0;
+}
+
+int emit(int code[32], int pc, int op) {
+  code[pc] = op;
+  return pc + 1;
+}
+
+int main() {
+  int mode;
+  input(mode);
+  // push 0, push n; loop: dup push 7 mod dup mul rot add swap push 1 sub
+  // dup jnz loop; pop halt
+  int code[32];
+  int pc = 0;
+  pc = emit(code, emit(code, pc, 0), 0);
+  pc = emit(code, emit(code, pc, 0), 1000000);
+  pc = emit(code, emit(code, emit(code, pc, 5), 0), 7);
+  pc = emit(code, emit(code, emit(code, pc, 4), 5), 3);
+  pc = emit(code, emit(code, emit(code, pc, 7), 1), 6);
+  pc = emit(code, emit(code, emit(code, pc, 0), 1), 2);
+  pc = emit(code, emit(code, emit(code, pc, 5), 8), 4);
+  pc = emit(code, emit(code, pc, 9), 10);
+  int stack[16];
+  int i;
+  int sum = 0;
+  for (i = 0; i < 10; i = i + 1) {
+    if (mode == 0) {
+      sum = sum + run_if(code, stack) % 1000;
+    } else {
+      sum = sum + run_switch(code, stack) % 1000;
+    }
+  }
+  println(sum);
+  return 0;
+}
@@ -0,0 +1,56 @@
+// nested trace_span blocks left through return, break and continue, written
+// to ntc.trace.json or NTRT_TRACE_FILE; built with -fno-trace it prints the
+// same and records nothing
+long collatz(long n) {
+  long steps = 0;
+  trace_span("collatz") {
+    while (n != 1) {
+      trace_span("step") {
+        if (n % 2 == 0) {
+          n = n / 2;
+          steps = steps + 1;
+          continue;
+        }
+        n = 3 * n + 1;
+      }
+      steps = steps + 1;
+    }
+  }
+  return steps;
+}
+
+long first_long(long limit) {
+  long n;
+  trace_span("search") {
+    for (n = 1; n < 1000; n = n + 1) {
+      trace_span("candidate") {
+        if (collatz(n) > limit) {
+          return n;
+        }
+        if (n == 999) {
+          break;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int main() {
+  long total = 0;
+  long n;
+  trace_span("main") {
+    for (n = 1; n <= 30; n = n + 1) {
+      long steps = collatz(n);
+      trace(1, steps);
+      total = total + steps;
+    }
+    trace_span("empty") {
+    }
+  }
+  println(total);
+  long limit = 100;
+  println(first_long(limit));
+  trace_flush();
+  return 0;
+}
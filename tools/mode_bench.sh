@@ -0,0 +1,19 @@
+#!/bin/sh
+# times a test program that reads its mode from stdin, once per mode, the
+# names label modes 0, 1, ...
+# usage: tools/mode_bench.sh prog name...
+prog=$1
+if [ -z "$prog" ] || [ $# -lt 2 ]; then
+  echo "usage: $0 prog name..." >&2
+  exit 1
+fi
+shift
+
+mode=0
+for name in "$@"; do
+  start=$(date +%s%N)
+  result=$(echo $mode | "$prog") || exit 1
+  end=$(date +%s%N)
+  echo "$name: $(( (end - start) / 1000000 )) ms, $(echo "$result" | head -n 1)"
+  mode=$((mode + 1))
+done
@@ -0,0 +1,28 @@
+#!/bin/sh
+# times a program built with parallel for loops from 1 to N pool threads
+# usage: tools/parallel_scaling.sh prog [max_threads] [args...]
+prog=$1
+max=${2:-$(getconf _NPROCESSORS_ONLN)}
+[ $# -ge 2 ] && shift 2 || shift 1
+if [ -z "$prog" ]; then
+  echo "usage: $0 prog [max_threads] [args...]" >&2
+  exit 1
+fi
+
+base=
+threads=1
+while [ "$threads" -le "$max" ]; do
+  start=$(date +%s%N)
+  NTRT_NUM_THREADS=$threads "$prog" "$@" > /dev/null || exit 1
+  end=$(date +%s%N)
+  ms=$(( (end - start) / 1000000 ))
+  [ -z "$base" ] && base=$ms
+  [ "$ms" -eq 0 ] && ms=1
+  echo "threads $threads: ${ms} ms, speedup $(awk "BEGIN { printf \"%.2f\", $base / $ms }")"
+  # doubling, but always ending with max itself
+  if [ "$threads" -lt "$max" ] && [ $(( threads * 2 )) -gt "$max" ]; then
+    threads=$max
+  else
+    threads=$(( threads * 2 ))
+  fi
+done
@@ -0,0 +1,31 @@
+#!/bin/sh
+# builds a test program at -O 2 with --perf-counters around main and runs it
+# several times; the runtime collects the samples of every run and the last
+# one reports their median and MAD; the mode is written to stdin like for
+# mode_bench.sh
+# usage: tools/perf_bench.sh prog.c [mode] [runs] [functions]
+src=$1
+mode=${2:-0}
+runs=${3:-5}
+functions=${4:-main}
+if [ -z "$src" ]; then
+  echo "usage: $0 prog.c [mode] [runs] [functions]" >&2
+  exit 1
+fi
+ntc=${NTC:-build/ntc}
+lib=${NTRT_LIB:-build}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cp "$src" "$work/prog.c" || exit 1
+
+# the object lands next to the copied source
+"$ntc" -i "$work/prog.c" -c -O 2 --perf-counters="$functions" || exit 1
+cc "$work/prog.o" -L"$lib" -lntrt -lpthread -lm -o "$work/prog" || exit 1
+
+run=1
+while [ "$run" -lt "$runs" ]; do
+  echo "$mode" | NTRT_PERF_FILE="$work/samples" "$work/prog" \
+    > /dev/null 2>&1 || exit 1
+  run=$((run + 1))
+done
+echo "$mode" | NTRT_PERF_FILE="$work/samples" "$work/prog" > /dev/null
@@ -0,0 +1,43 @@
+#!/bin/sh
+# builds a test program at -O 2 without and with a profile of a training
+# run and times both; the mode is written to stdin like for mode_bench.sh
+# usage: tools/pgo_bench.sh prog.c [mode] [runs]
+src=$1
+mode=${2:-0}
+runs=${3:-3}
+if [ -z "$src" ]; then
+  echo "usage: $0 prog.c [mode] [runs]" >&2
+  exit 1
+fi
+ntc=${NTC:-build/ntc}
+lib=${NTRT_LIB:-build}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cp "$src" "$work/prog.c" || exit 1
+
+# the object lands next to the copied source
+build() {
+  "$ntc" -i "$work/prog.c" -c -O 2 $2 &&
+    cc "$work/prog.o" -L"$lib" -lntrt -lpthread -lm -o "$work/$1"
+}
+
+build plain "" || exit 1
+build train "-fprofile-generate=$work/prof" || exit 1
+echo "$mode" | "$work/train" > /dev/null || exit 1
+build pgo "-fprofile-use=$work/prof" || exit 1
+
+for build in plain pgo; do
+  best=
+  run=0
+  while [ "$run" -lt "$runs" ]; do
+    start=$(date +%s%N)
+    result=$(echo "$mode" | "$work/$build") || exit 1
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$ms" -lt "$best" ]; then
+      best=$ms
+    fi
+    run=$((run + 1))
+  done
+  echo "$build: $best ms, $(echo "$result" | head -n 1)"
+done